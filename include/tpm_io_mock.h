@@ -0,0 +1,101 @@
+/* tpm_io_mock.h
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef _TPM_IO_MOCK_H_
+#define _TPM_IO_MOCK_H_
+
+#include "wolftpm/tpm2.h"
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+/* In-process TIS register emulator used by the measurements. It speaks the
+ * SPI frame protocol of tpm2_tis.c and answers every command with a canned
+ * TPM_RC_SUCCESS response, so IO patterns can be counted without hardware.
+ * Pass a TPM2_MOCK_TIS as userCtx with the mock IO callbacks. */
+
+/* transient object and session slots the mock can emulate, see maxObjects
+ * and maxSessions */
+#ifndef TPM2_MOCK_MAX_OBJECTS
+#define TPM2_MOCK_MAX_OBJECTS 16
+#endif
+typedef struct TPM2_MOCK_TIS {
+    /* configuration, defaults set by TPM2_Mock_Init */
+    word32 caps;        /* TPM_INTF_CAPS register */
+    word32 didVid;      /* TPM_DID_VID register */
+    word16 burstCount;  /* burst count while the FIFO is accessible */
+    word32 execPolls;   /* status reads before a response is available */
+    word32 execUs;      /* minimum command execution time */
+    word32 maxObjects;  /* transient slots, 0 does not track objects. When
+                         * set, commands fail with TPM_RC_HANDLE on objects
+                         * not loaded and TPM_RC_OBJECT_MEMORY when full */
+    word32 maxSessions; /* session slots, 0 does not track sessions. When
+                         * set, sessions have to be loaded to be used and
+                         * fail with TPM_RC_SESSION_MEMORY when full */
+    word32 warnPct;     /* share of commands refused with warnRc, 0 never */
+    TPM_RC warnRc;      /* e.g. TPM_RC_RETRY, TPM_RC_YIELDED or TESTING */
+
+    /* register state */
+    byte   access;
+    byte   sts;
+    word32 intEnable;
+    word32 intStatus;
+    byte   cmd[MAX_COMMAND_SIZE];
+    int    cmdPos;
+    byte   rsp[MAX_RESPONSE_SIZE];
+    int    rspSz;
+    int    rspPos;
+    int    executing;
+    word32 pollsLeft;
+    word64 goTimeUs;
+    word32 objects[TPM2_MOCK_MAX_OBJECTS];  /* loaded, 0 if free */
+    word32 sessions[TPM2_MOCK_MAX_OBJECTS]; /* loaded, 0 if free */
+    word32 savedSessions[TPM2_MOCK_MAX_OBJECTS]; /* context saved */
+    word32 warnSeed;
+
+    /* statistics */
+    word32 ioCalls;     /* IO callback invocations (IPCs on a real bus) */
+    word32 xfers;       /* SPI transactions */
+    word32 stsReads;    /* status register reads */
+    word32 xferBytes;   /* payload bytes */
+    word32 cmdCount;    /* commands executed */
+    word32 irqWaits;    /* blocking interrupt waits */
+    word32 warnings;    /* commands refused with warnRc */
+} TPM2_MOCK_TIS;
+
+void TPM2_Mock_Init(TPM2_MOCK_TIS* mock);
+void TPM2_Mock_ResetStats(TPM2_MOCK_TIS* mock);
+
+#ifndef WOLFTPM_ADV_IO
+int TPM2_IoCb_Mock_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    word16 xferSz, void* userCtx);
+int TPM2_IoVecCb_Mock_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    const word16* xferSz, word16 count, void* userCtx);
+#endif
+/* Sleeps until the running command completes, then raises the interrupt */
+int TPM2_IrqWaitCb_Mock(TPM2_CTX* ctx, UINT32 timeoutMs, void* irqCtx);
+
+#ifdef __cplusplus
+    }  /* extern "C" */
+#endif
+
+#endif /* _TPM_IO_MOCK_H_ */
@@ -31,6 +31,46 @@ extern "C" {
 #endif
 
 #define WOLFTPM2_NO_WOLFCRYPT
+/* sleep through the expected command time instead of busy polling */
+/* #define WOLFTPM_ADAPTIVE_POLL */
+/* frame FIFO transfers in place in the command buffer */
+#define WOLFTPM_TIS_ZERO_COPY
+
+/* Optional features. libwolftpm and every program using it include this
+ * file, so both sides agree on the layout of TPM2_CTX and
+ * TPM2_AUTH_SESSION. Select features here for the whole build, never with
+ * -D in the Makefile of a single program. */
+/* #define WOLFTPM_TIS_OFFLOAD */
+/* talk to a TPM simulator socket, on L4Re to the vtpm server */
+/* #define WOLFTPM_SWTPM */
+/* serialize TIS commands of several processes, on L4Re through the tpm_lock
+ * semaphore and tpm_lock_ds dataspace capabilities */
+/* #define WOLFTPM_TIS_LOCK */
+/* let threads sharing a context queue commands, see TPM2_SetPipeline */
+/* #define WOLFTPM_PIPELINE */
+/* virtualize transient objects, see TPM2_SetResourceMgr */
+/* #define WOLFTPM_RESOURCE_MGR */
+/* share one TPM between clients with separate handle spaces, see
+ * TPM2_Broker_Init */
+/* #define WOLFTPM_BROKER */
+/* hand out the hwLock by command class, see TPM2_SetCmdPriority */
+/* #define WOLFTPM_CMD_PRIORITY */
+/* run commands of many threads from one IO thread, see TPM2_IoRing_Start */
+/* #define WOLFTPM_IO_RING */
+/* C++20 coroutine front end, see tpm2_coro.h */
+/* #define WOLFTPM_COROUTINES */
+/* resubmit commands the TPM asks to retry, see TPM2_GetRetryStats */
+/* #define WOLFTPM_AUTO_RETRY */
+/* keep the HMAC pads and AES object in the session, needs wolfCrypt */
+/* #define WOLFTPM_SESSION_CACHE */
+/* draw nonces from a host DRBG seeded by the TPM, see TPM2_GetDrbgStats */
+/* #define WOLFTPM_HOST_DRBG */
+/* keep started sessions ready, see wolfTPM2_SessionPool_Init */
+/* #define WOLFTPM_SESSION_POOL */
+/* cache the names of loaded objects for the cpHash, needs wolfCrypt */
+/* #define WOLFTPM_NAME_CACHE */
+/* use TPM_XDATA_FIFO on TIS 1.3 interfaces, only for TPMs known to have it */
+/* #define WOLFTPM_TIS_XDATA_FIFO */
 #ifdef __cplusplus
 }
 #endif
@@ -1607,6 +1607,32 @@ typedef struct TPMS_AUTH_RESPONSE {
     TPM2B_AUTH hmac;
 } TPMS_AUTH_RESPONSE;
 
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+/* HMAC key schedule, the hash states after the key ^ ipad and key ^ opad
+ * blocks. Every HMAC with the key starts from wc_*Copy copies of them. */
+typedef struct TPM2_HMAC_PAD {
+    wc_HashAlg inner;
+    wc_HashAlg outer;
+    int hashType;
+    int digestSz;
+    TPMI_ALG_HASH hashAlg;  /* TPM_ALG_ERROR until the pads are computed */
+} TPM2_HMAC_PAD;
+#endif
+
+#ifdef WOLFTPM_SESSION_CACHE
+/* Crypto state of a session reused across its commands. The hash states may
+ * own memory or hardware, so a byte copy of a session moves the cache and
+ * only one of them releases it with TPM2_SessionCache_Free. */
+typedef struct TPM2_SESSION_CACHE {
+    TPM2_HMAC_PAD hmacPad;  /* pads of hmacKey for authHash */
+    TPM2B_AUTH hmacKey;
+#ifdef WOLFSSL_AES_CFB
+    Aes aes;                /* initialized once, keyed per parameter */
+    byte aesInit;
+#endif
+} TPM2_SESSION_CACHE;
+#endif
+
 /* Implementation specific authorization session information */
 typedef struct TPM2_AUTH_SESSION {
     /* BEGIN */
@@ -1622,6 +1648,9 @@ typedef struct TPM2_AUTH_SESSION {
     TPMT_SYM_DEF symmetric;
     TPMI_ALG_HASH authHash;
     TPM2B_NAME name;
+#ifdef WOLFTPM_SESSION_CACHE
+    TPM2_SESSION_CACHE cache;   /* see TPM2_CalcSessionHmac */
+#endif
 } TPM2_AUTH_SESSION;
 
 /* Macros to determine TPM 2.0 Session type */
@@ -1653,7 +1682,14 @@ struct TPM2_CTX;
 
 #ifdef WOLFTPM_SWTPM
 struct wolfTPM_tcpContext {
-    int fd;
+    int fd;                 /* socket, on L4 0 while connected to vtpm */
+#ifdef L4API_l4f
+    unsigned long vtpm;     /* vtpm server capability */
+    unsigned long ds;       /* dataspace shared with the vtpm server */
+    unsigned char* shm;     /* local mapping of ds */
+    unsigned int rspSz;     /* response message bytes in shm */
+    unsigned int rspPos;    /* response message bytes consumed */
+#endif
 };
 #endif /* WOLFTPM_SWTPM */
 
@@ -1675,8 +1711,28 @@ struct wolfTPM_winContext {
 typedef int (*TPM2HalIoCb)(struct TPM2_CTX*, INT32 isRead, UINT32 addr,
     BYTE* xferBuf, UINT16 xferSz, void* userCtx);
 #else
+/* With WOLFTPM_TIS_ZERO_COPY FIFO reads pass the same buffer as txBuf and
+ * rxBuf, the callback must consume each tx byte before storing its rx byte */
 typedef int (*TPM2HalIoCb)(struct TPM2_CTX*, const BYTE* txBuf, BYTE* rxBuf,
     UINT16 xferSz, void* userCtx);
+/* Optional vectored IO: count frames of xferSz[i] bytes are packed
+ * back-to-back in txBuf / rxBuf and transferred in one call */
+typedef int (*TPM2HalIoVecCb)(struct TPM2_CTX*, const BYTE* txBuf,
+    BYTE* rxBuf, const UINT16* xferSz, UINT16 count, void* userCtx);
+#endif
+
+/* Blocks until the TPM interrupt fires or timeoutMs elapsed. Returns 0 on
+ * interrupt, TPM_RC_TIMEOUT on timeout and any other error if interrupts
+ * are not available. */
+typedef int (*TPM2HalIrqWaitCb)(struct TPM2_CTX*, UINT32 timeoutMs,
+    void* irqCtx);
+
+#ifdef WOLFTPM_TIS_OFFLOAD
+/* Submits a complete command to a TIS engine running elsewhere (for example
+ * the SPI server). On input rspSz is the size of rsp, on output the size of
+ * the response. cmd and rsp may point to the same buffer. */
+typedef int (*TPM2HalCmdCb)(struct TPM2_CTX*, const BYTE* cmd, UINT32 cmdSz,
+    BYTE* rsp, UINT32* rspSz, void* cmdCtx);
 #endif
 
 #if !defined(WOLFTPM2_NO_WOLFCRYPT) && !defined(WC_NO_RNG) && \
@@ -1684,9 +1740,143 @@ typedef int (*TPM2HalIoCb)(struct TPM2_CTX*, const BYTE* txBuf, BYTE* rxBuf,
     #define WOLFTPM2_USE_WOLF_RNG
 #endif
 
+#ifdef WOLFTPM_CMD_PRIORITY
+/* Command classes of TPM2_SetCmdPriority, higher classes go first */
+typedef enum {
+    TPM2_PRIO_BULK,     /* chunks of multi-command operations */
+    TPM2_PRIO_NORMAL,   /* default */
+    TPM2_PRIO_HIGH,     /* latency critical single commands */
+    TPM2_PRIO_COUNT
+} TPM2_CMD_PRIO;
+#endif
+
+#ifdef WOLFTPM_PIPELINE
+/* TPM2_PIPE_SLOT state values */
+#define TPM2_PIPE_FREE  0
+#define TPM2_PIPE_PREP  1   /* session nonces are being generated */
+#define TPM2_PIPE_READY 2   /* authorized, waiting for its ticket */
+#define TPM2_PIPE_BUSY  3   /* on the device or parsed by its owner */
+
+/* A command prepared or in flight, see TPM2_SetPipeline */
+typedef struct TPM2_PIPE_SLOT {
+    byte buf[TPM2_PACKET_HEADROOM + MAX_COMMAND_SIZE + TPM2_PACKET_TAILROOM];
+    TPM2B_NONCE nonceCaller[MAX_SESSION_NUM];   /* prepared nonces */
+    TPM2_AUTH_SESSION* session;     /* ctx->session of the command */
+    byte held;          /* session entries reserved by the command */
+    byte state;
+} TPM2_PIPE_SLOT;
+#endif
+
+#ifdef WOLFTPM_RESOURCE_MGR
+/* A transient object behind a virtual handle, see TPM2_SetResourceMgr */
+typedef struct TPM2_RM_OBJECT {
+    TPM_HANDLE vHandle;     /* handle of the caller, 0 if the entry is free */
+    TPM_HANDLE pHandle;     /* handle in the TPM, 0 while evicted */
+    word32 lastUse;
+    byte saved;             /* context holds the current object state */
+    byte seq;               /* hash or HMAC sequence, changes with each use */
+    TPMS_CONTEXT context;
+} TPM2_RM_OBJECT;
+
+/* A session of a space, saved by TPM2_SpaceSwapOut */
+typedef struct TPM2_RM_SESSION {
+    TPM_HANDLE handle;      /* 0 if the entry is free */
+    byte loaded;
+    TPMS_CONTEXT context;
+} TPM2_RM_SESSION;
+
+/* Operation counts, see TPM2_GetResourceMgrStats */
+typedef struct TPM2_RM_STATS {
+    word32 uses;        /* virtual handles referenced by commands */
+    word32 saves;       /* ContextSave issued on eviction or swap out */
+    word32 loads;       /* ContextLoad issued on use of an evicted object or
+                         * a swapped out session */
+    word32 flushes;     /* FlushContext issued on eviction */
+} TPM2_RM_STATS;
+
+/* Transient objects and sessions of one TPM user, see TPM2_SpaceCommand */
+typedef struct TPM2_RM_SPACE {
+    TPM2_RM_OBJECT obj[TPM2_RM_MAX_OBJECTS];
+    TPM2_RM_SESSION sess[TPM2_RM_MAX_SESSIONS];
+    TPM2_RM_STATS stats;
+    word32 tick;        /* use counter for the LRU order */
+    word32 next;        /* next virtual handle */
+    byte isolate;       /* only objects and sessions of the space are usable */
+} TPM2_RM_SPACE;
+#endif
+
+#ifdef WOLFTPM_AUTO_RETRY
+/* Resubmissions of one command code, see TPM2_GetRetryStats */
+typedef struct TPM2_RETRY_STAT {
+    TPM_CC cc;
+    word32 retries;     /* resubmissions after TPM_RC_RETRY, TPM_RC_YIELDED
+                         * or TPM_RC_TESTING */
+    word32 exhausted;   /* commands still refused after TPM2_RETRY_MAX */
+} TPM2_RETRY_STAT;
+#endif
+
+#ifdef WOLFTPM_ADAPTIVE_POLL
+/* Completion times of one command code, see TPM2_TIS_GetCmdTimes */
+typedef struct TPM2_TIS_CMD_STAT {
+    word32 expectUs;
+    word32 samples;
+    word32 time[TPM_TIS_TIME_SAMPLES];
+} TPM2_TIS_CMD_STAT;
+#endif
+
+#ifdef WOLFTPM_NAME_CACHE
+/* Name of a transient or persistent object, taken from the responses of
+ * TPM2_CreatePrimary, TPM2_CreateLoaded, TPM2_Load, TPM2_LoadExternal and
+ * TPM2_ReadPublic */
+typedef struct TPM2_NAME_CACHE_ENTRY {
+    TPM_HANDLE handle;  /* 0 for a free entry */
+    TPM2B_NAME name;
+} TPM2_NAME_CACHE_ENTRY;
+#endif
+
+#ifdef WOLFTPM_HOST_DRBG
+/* Counts of the host DRBG, see TPM2_GetDrbgStats */
+typedef struct TPM2_DRBG_STATS {
+    word32 seeds;       /* seeds and reseeds taken from the TPM */
+    word32 getRandom;   /* TPM2_GetRandom commands sent for them */
+    word32 requests;    /* nonces and random blocks served */
+    word32 bytes;       /* bytes served */
+    word32 avoided;     /* TPM2_GetRandom commands not sent for requests
+                         * served without taking a seed */
+} TPM2_DRBG_STATS;
+
+/* ChaCha20 DRBG with fast key erasure: every refill of buf replaces the key
+ * with the first bytes of its own output, served bytes are zeroed */
+typedef struct TPM2_DRBG {
+    word32 key[8];
+    byte buf[TPM2_DRBG_BUF_SZ];
+    word32 avail;       /* unserved bytes at the end of buf */
+    word32 seedBytes;   /* served since the last seed */
+    word32 seedReqs;
+    word32 reseedBytes; /* reseed after this many bytes, 0 for no limit */
+    word32 reseedReqs;  /* reseed after this many requests, 0 for no limit */
+    TPM2_DRBG_STATS stats;
+    byte seeded;
+} TPM2_DRBG;
+#endif
+
+/* TPM2_CTX cmdState values */
+#define TPM2_CMD_IDLE   0
+#define TPM2_CMD_EXEC   1   /* submitted, the TPM is executing it */
+#define TPM2_CMD_DONE   2   /* response is in cmdBuf */
+
 typedef struct TPM2_CTX {
     TPM2HalIoCb ioCb;
     void* userCtx;
+#ifndef WOLFTPM_ADV_IO
+    TPM2HalIoVecCb ioVecCb;
+#endif
+    TPM2HalIrqWaitCb irqWaitCb;
+    void* irqCtx;
+#ifdef WOLFTPM_TIS_OFFLOAD
+    TPM2HalCmdCb cmdCb;
+    void* cmdCtx;
+#endif
 #ifdef WOLFTPM_SWTPM
     struct wolfTPM_tcpContext tcpCtx;
 #endif
@@ -1694,35 +1884,106 @@ typedef struct TPM2_CTX {
     struct wolfTPM_winContext winCtx;
 #endif
 #ifndef WOLFTPM2_NO_WOLFCRYPT
-#ifndef SINGLE_THREADED
+#if !defined(SINGLE_THREADED) && !defined(WOLFTPM_PIPELINE) && \
+    !defined(WOLFTPM_CMD_PRIORITY)
     wolfSSL_Mutex hwLock;
 #endif
     #ifdef WOLFTPM2_USE_WOLF_RNG
     WC_RNG rng;
     #endif
 #endif /* !WOLFTPM2_NO_WOLFCRYPT */
+#ifdef WOLFTPM_PIPELINE
+    pthread_mutex_t hwLock;     /* recursive */
+    pthread_cond_t pipeCond;    /* signalled when the pipeline progresses */
+    pthread_key_t pipeSessionKey;   /* sessions set by the calling thread */
+    /* name cache and host DRBG, used by pipelined commands without the
+     * hwLock */
+    pthread_mutex_t dataLock;
+#endif
+#ifdef WOLFTPM_CMD_PRIORITY
+    pthread_mutex_t hwLock;     /* guards the hand out below */
+    pthread_cond_t prioCond;    /* signalled when the holder is done */
+    pthread_key_t prioKey;      /* class of the calling thread */
+    pthread_t prioOwner;
+    word32 prioDepth;           /* nested acquisitions of the holder */
+    word32 prioNext[TPM2_PRIO_COUNT];   /* next ticket per class */
+    word32 prioServe[TPM2_PRIO_COUNT];  /* ticket served next per class */
+#endif
 
     /* TPM TIS Info */
     int locality;
     word32 caps;
     word32 did_vid;
     byte rid;
+    word16 burstStatic; /* cached with TPM_INTF_BURST_COUNT_STATIC */
+    word16 frameSz;     /* negotiated FIFO frame payload size */
+#ifdef WOLFTPM_TIS_LOCK
+    void* tisLock;      /* semaphore (Linux) or lock counter (L4Re) shared
+                         * between processes */
+    int tisLockDepth;   /* nested TIS lock count of this ctx */
+#if defined(L4API_l4f)
+    unsigned long tisLockSem; /* semaphore capability, valid with tisLock */
+    byte tisLockOpen;   /* capabilities looked up */
+#endif
+#endif
+
+    /* Command in flight, see TPM2_SubmitCommand */
+    byte cmdState;      /* TPM2_CMD_IDLE, TPM2_CMD_EXEC or TPM2_CMD_DONE */
+    byte cmdSts;        /* last status sampled while executing */
+    word16 cmdBurst;    /* burst count sampled with cmdSts */
+#ifdef WOLFTPM_ADAPTIVE_POLL
+    TPM_CC cmdCc;
+    word64 cmdGoUs;     /* start of execution */
+    word64 cmdIdleUs;   /* last status read without DATA_AVAIL */
+    TPM2_TIS_CMD_STAT cmdStat[TPM_CC_LAST - TPM_CC_FIRST + 1];
+#endif
+#ifdef WOLFTPM_PIPELINE
+    TPM2_PIPE_SLOT pipe[TPM2_PIPE_DEPTH];
+    TPM2_PIPE_SLOT* pipeOwned;  /* response parsed by the hwLock holder */
+    word32 pipeNext;    /* next ticket */
+    word32 pipeServe;   /* ticket allowed on the device */
+    byte pipeEnable;
+#endif
+#ifdef WOLFTPM_AUTO_RETRY
+    TPM2_RETRY_STAT retryStat[TPM_CC_LAST - TPM_CC_FIRST + 1];
+    word32 retrySeed;   /* jitter of the backoff */
+    /* command as marshalled by the caller, restored for a resubmission */
+    byte retryBuf[MAX_COMMAND_SIZE];
+#endif
+#ifdef WOLFTPM_RESOURCE_MGR
+    TPM2_RM_SPACE rm;   /* space of the TPM2_* commands */
+    byte rmEnable;
+    /* ContextSave, FlushContext and ContextLoad of the resource manager */
+    byte rmBuf[TPM2_PACKET_HEADROOM + MAX_COMMAND_SIZE + TPM2_PACKET_TAILROOM];
+#endif
+#ifdef WOLFTPM_HOST_DRBG
+    TPM2_DRBG drbg;     /* source of TPM2_GetNonce_ex */
+#endif
+#ifdef WOLFTPM_NAME_CACHE
+    /* names of the handles of a command without a name in its session */
+    TPM2_NAME_CACHE_ENTRY nameCache[TPM2_NAME_CACHE_SZ];
+    word32 nameCacheNext;   /* entry replaced next */
+#endif
 
     /* Pointer to current TPM auth sessions */
     TPM2_AUTH_SESSION* session;
 
-    /* Command / Response Buffer */
-    byte cmdBuf[MAX_COMMAND_SIZE];
+    /* Command / Response Buffer, packets start after the headroom */
+    byte cmdBuf[TPM2_PACKET_HEADROOM + MAX_COMMAND_SIZE + TPM2_PACKET_TAILROOM];
 
     /* Informational Bits - use unsigned int for best compiler compatibility */
 #ifndef WOLFTPM2_NO_WOLFCRYPT
-    #ifndef SINGLE_THREADED
+    #if !defined(SINGLE_THREADED) && !defined(WOLFTPM_PIPELINE) && \
+        !defined(WOLFTPM_CMD_PRIORITY)
     unsigned int hwLockInit:1;
     #endif
     #ifndef WC_NO_RNG
     unsigned int rngInit:1;
     #endif
 #endif
+#if defined(WOLFTPM_PIPELINE) || defined(WOLFTPM_CMD_PRIORITY)
+    unsigned int hwLockInit:1;
+#endif
 } TPM2_CTX;
 
 
@@ -1731,11 +1992,13 @@ typedef struct {
     TPM_SU startupType;
 } Startup_In;
 WOLFTPM_API TPM_RC TPM2_Startup(Startup_In* in);
+WOLFTPM_API TPM_RC TPM2_Startup_ex(TPM2_CTX* ctx, Startup_In* in);
 
 typedef struct {
     TPM_SU shutdownType;
 } Shutdown_In;
 WOLFTPM_API TPM_RC TPM2_Shutdown(Shutdown_In* in);
+WOLFTPM_API TPM_RC TPM2_Shutdown_ex(TPM2_CTX* ctx, Shutdown_In* in);
 
 
 typedef struct {
@@ -1749,12 +2012,15 @@ typedef struct {
 } GetCapability_Out;
 WOLFTPM_API TPM_RC TPM2_GetCapability(GetCapability_In* in,
     GetCapability_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetCapability_ex(TPM2_CTX* ctx, GetCapability_In* in,
+    GetCapability_Out* out);
 
 
 typedef struct {
     TPMI_YES_NO fullTest;
 } SelfTest_In;
 WOLFTPM_API TPM_RC TPM2_SelfTest(SelfTest_In* in);
+WOLFTPM_API TPM_RC TPM2_SelfTest_ex(TPM2_CTX* ctx, SelfTest_In* in);
 
 typedef struct {
     TPML_ALG toTest;
@@ -1764,12 +2030,15 @@ typedef struct {
 } IncrementalSelfTest_Out;
 WOLFTPM_API TPM_RC TPM2_IncrementalSelfTest(IncrementalSelfTest_In* in,
     IncrementalSelfTest_Out* out);
+WOLFTPM_API TPM_RC TPM2_IncrementalSelfTest_ex(TPM2_CTX* ctx,
+    IncrementalSelfTest_In* in, IncrementalSelfTest_Out* out);
 
 typedef struct {
     TPM2B_MAX_BUFFER outData;
     UINT16 testResult; /* TPM_RC */
 } GetTestResult_Out;
 WOLFTPM_API TPM_RC TPM2_GetTestResult(GetTestResult_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetTestResult_ex(TPM2_CTX* ctx, GetTestResult_Out* out);
 
 
 typedef struct {
@@ -1779,11 +2048,14 @@ typedef struct {
     TPM2B_DIGEST randomBytes; /* hardware max is 32-bytes */
 } GetRandom_Out;
 WOLFTPM_API TPM_RC TPM2_GetRandom(GetRandom_In* in, GetRandom_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetRandom_ex(TPM2_CTX* ctx, GetRandom_In* in,
+    GetRandom_Out* out);
 
 typedef struct {
     TPM2B_SENSITIVE_DATA inData;
 } StirRandom_In;
 WOLFTPM_API TPM_RC TPM2_StirRandom(StirRandom_In* in);
+WOLFTPM_API TPM_RC TPM2_StirRandom_ex(TPM2_CTX* ctx, StirRandom_In* in);
 
 typedef struct {
     TPML_PCR_SELECTION pcrSelectionIn;
@@ -1794,6 +2066,8 @@ typedef struct {
     TPML_DIGEST pcrValues;
 } PCR_Read_Out;
 WOLFTPM_API TPM_RC TPM2_PCR_Read(PCR_Read_In* in, PCR_Read_Out* out);
+WOLFTPM_API TPM_RC TPM2_PCR_Read_ex(TPM2_CTX* ctx, PCR_Read_In* in,
+    PCR_Read_Out* out);
 
 
 typedef struct {
@@ -1801,6 +2075,7 @@ typedef struct {
     TPML_DIGEST_VALUES digests;
 } PCR_Extend_In;
 WOLFTPM_API TPM_RC TPM2_PCR_Extend(PCR_Extend_In* in);
+WOLFTPM_API TPM_RC TPM2_PCR_Extend_ex(TPM2_CTX* ctx, PCR_Extend_In* in);
 
 
 typedef struct {
@@ -1818,6 +2093,8 @@ typedef struct {
     TPMT_TK_CREATION creationTicket;
 } Create_Out;
 WOLFTPM_API TPM_RC TPM2_Create(Create_In* in, Create_Out* out);
+WOLFTPM_API TPM_RC TPM2_Create_ex(TPM2_CTX* ctx, Create_In* in,
+    Create_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT parentHandle;
@@ -1832,6 +2109,8 @@ typedef struct {
 } CreateLoaded_Out;
 WOLFTPM_API TPM_RC TPM2_CreateLoaded(CreateLoaded_In* in,
     CreateLoaded_Out* out);
+WOLFTPM_API TPM_RC TPM2_CreateLoaded_ex(TPM2_CTX* ctx, CreateLoaded_In* in,
+    CreateLoaded_Out* out);
 
 
 typedef struct {
@@ -1851,6 +2130,8 @@ typedef struct {
 } CreatePrimary_Out;
 WOLFTPM_API TPM_RC TPM2_CreatePrimary(CreatePrimary_In* in,
     CreatePrimary_Out* out);
+WOLFTPM_API TPM_RC TPM2_CreatePrimary_ex(TPM2_CTX* ctx, CreatePrimary_In* in,
+    CreatePrimary_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT parentHandle;
@@ -1862,12 +2143,14 @@ typedef struct {
     TPM2B_NAME name;
 } Load_Out;
 WOLFTPM_API TPM_RC TPM2_Load(Load_In* in, Load_Out* out);
+WOLFTPM_API TPM_RC TPM2_Load_ex(TPM2_CTX* ctx, Load_In* in, Load_Out* out);
 
 
 typedef struct {
     TPMI_DH_CONTEXT flushHandle;
 } FlushContext_In;
 WOLFTPM_API TPM_RC TPM2_FlushContext(FlushContext_In* in);
+WOLFTPM_API TPM_RC TPM2_FlushContext_ex(TPM2_CTX* ctx, FlushContext_In* in);
 
 
 typedef struct {
@@ -1877,6 +2160,8 @@ typedef struct {
     TPM2B_SENSITIVE_DATA outData;
 } Unseal_Out;
 WOLFTPM_API TPM_RC TPM2_Unseal(Unseal_In* in, Unseal_Out* out);
+WOLFTPM_API TPM_RC TPM2_Unseal_ex(TPM2_CTX* ctx, Unseal_In* in,
+    Unseal_Out* out);
 
 
 typedef struct {
@@ -1894,11 +2179,14 @@ typedef struct {
 } StartAuthSession_Out;
 WOLFTPM_API TPM_RC TPM2_StartAuthSession(StartAuthSession_In* in,
     StartAuthSession_Out* out);
+WOLFTPM_API TPM_RC TPM2_StartAuthSession_ex(TPM2_CTX* ctx,
+    StartAuthSession_In* in, StartAuthSession_Out* out);
 
 typedef struct {
     TPMI_SH_POLICY sessionHandle;
 } PolicyRestart_In;
 WOLFTPM_API TPM_RC TPM2_PolicyRestart(PolicyRestart_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyRestart_ex(TPM2_CTX* ctx, PolicyRestart_In* in);
 
 
 typedef struct {
@@ -1912,6 +2200,8 @@ typedef struct {
 } LoadExternal_Out;
 WOLFTPM_API TPM_RC TPM2_LoadExternal(LoadExternal_In* in,
     LoadExternal_Out* out);
+WOLFTPM_API TPM_RC TPM2_LoadExternal_ex(TPM2_CTX* ctx, LoadExternal_In* in,
+    LoadExternal_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT objectHandle;
@@ -1922,6 +2212,8 @@ typedef struct {
     TPM2B_NAME qualifiedName;
 } ReadPublic_Out;
 WOLFTPM_API TPM_RC TPM2_ReadPublic(ReadPublic_In* in, ReadPublic_Out* out);
+WOLFTPM_API TPM_RC TPM2_ReadPublic_ex(TPM2_CTX* ctx, ReadPublic_In* in,
+    ReadPublic_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT activateHandle;
@@ -1934,6 +2226,8 @@ typedef struct {
 } ActivateCredential_Out;
 WOLFTPM_API TPM_RC TPM2_ActivateCredential(ActivateCredential_In* in,
     ActivateCredential_Out* out);
+WOLFTPM_API TPM_RC TPM2_ActivateCredential_ex(TPM2_CTX* ctx,
+    ActivateCredential_In* in, ActivateCredential_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT handle;
@@ -1946,6 +2240,8 @@ typedef struct {
 } MakeCredential_Out;
 WOLFTPM_API TPM_RC TPM2_MakeCredential(MakeCredential_In* in,
     MakeCredential_Out* out);
+WOLFTPM_API TPM_RC TPM2_MakeCredential_ex(TPM2_CTX* ctx, MakeCredential_In* in,
+    MakeCredential_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT objectHandle;
@@ -1957,6 +2253,8 @@ typedef struct {
 } ObjectChangeAuth_Out;
 WOLFTPM_API TPM_RC TPM2_ObjectChangeAuth(ObjectChangeAuth_In* in,
     ObjectChangeAuth_Out* out);
+WOLFTPM_API TPM_RC TPM2_ObjectChangeAuth_ex(TPM2_CTX* ctx,
+    ObjectChangeAuth_In* in, ObjectChangeAuth_Out* out);
 
 
 typedef struct {
@@ -1971,6 +2269,8 @@ typedef struct {
     TPM2B_ENCRYPTED_SECRET outSymSeed;
 } Duplicate_Out;
 WOLFTPM_API TPM_RC TPM2_Duplicate(Duplicate_In* in, Duplicate_Out* out);
+WOLFTPM_API TPM_RC TPM2_Duplicate_ex(TPM2_CTX* ctx, Duplicate_In* in,
+    Duplicate_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT oldParent;
@@ -1984,6 +2284,8 @@ typedef struct {
     TPM2B_ENCRYPTED_SECRET outSymSeed;
 } Rewrap_Out;
 WOLFTPM_API TPM_RC TPM2_Rewrap(Rewrap_In* in, Rewrap_Out* out);
+WOLFTPM_API TPM_RC TPM2_Rewrap_ex(TPM2_CTX* ctx, Rewrap_In* in,
+    Rewrap_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT parentHandle;
@@ -1997,6 +2299,8 @@ typedef struct {
     TPM2B_PRIVATE outPrivate;
 } Import_Out;
 WOLFTPM_API TPM_RC TPM2_Import(Import_In* in, Import_Out* out);
+WOLFTPM_API TPM_RC TPM2_Import_ex(TPM2_CTX* ctx, Import_In* in,
+    Import_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT keyHandle;
@@ -2008,6 +2312,8 @@ typedef struct {
     TPM2B_PUBLIC_KEY_RSA outData;
 } RSA_Encrypt_Out;
 WOLFTPM_API TPM_RC TPM2_RSA_Encrypt(RSA_Encrypt_In* in, RSA_Encrypt_Out* out);
+WOLFTPM_API TPM_RC TPM2_RSA_Encrypt_ex(TPM2_CTX* ctx, RSA_Encrypt_In* in,
+    RSA_Encrypt_Out* out);
 
 
 typedef struct {
@@ -2020,6 +2326,8 @@ typedef struct {
     TPM2B_PUBLIC_KEY_RSA message;
 } RSA_Decrypt_Out;
 WOLFTPM_API TPM_RC TPM2_RSA_Decrypt(RSA_Decrypt_In* in, RSA_Decrypt_Out* out);
+WOLFTPM_API TPM_RC TPM2_RSA_Decrypt_ex(TPM2_CTX* ctx, RSA_Decrypt_In* in,
+    RSA_Decrypt_Out* out);
 
 
 typedef struct {
@@ -2030,6 +2338,8 @@ typedef struct {
     TPM2B_ECC_POINT pubPoint;
 } ECDH_KeyGen_Out;
 WOLFTPM_API TPM_RC TPM2_ECDH_KeyGen(ECDH_KeyGen_In* in, ECDH_KeyGen_Out* out);
+WOLFTPM_API TPM_RC TPM2_ECDH_KeyGen_ex(TPM2_CTX* ctx, ECDH_KeyGen_In* in,
+    ECDH_KeyGen_Out* out);
 
 
 typedef struct {
@@ -2040,6 +2350,8 @@ typedef struct {
     TPM2B_ECC_POINT outPoint;
 } ECDH_ZGen_Out;
 WOLFTPM_API TPM_RC TPM2_ECDH_ZGen(ECDH_ZGen_In* in, ECDH_ZGen_Out* out);
+WOLFTPM_API TPM_RC TPM2_ECDH_ZGen_ex(TPM2_CTX* ctx, ECDH_ZGen_In* in,
+    ECDH_ZGen_Out* out);
 
 typedef struct {
     TPMI_ECC_CURVE curveID;
@@ -2049,6 +2361,8 @@ typedef struct {
 } ECC_Parameters_Out;
 WOLFTPM_API TPM_RC TPM2_ECC_Parameters(ECC_Parameters_In* in,
     ECC_Parameters_Out* out);
+WOLFTPM_API TPM_RC TPM2_ECC_Parameters_ex(TPM2_CTX* ctx, ECC_Parameters_In* in,
+    ECC_Parameters_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT keyA;
@@ -2062,6 +2376,8 @@ typedef struct {
     TPM2B_ECC_POINT outZ2;
 } ZGen_2Phase_Out;
 WOLFTPM_API TPM_RC TPM2_ZGen_2Phase(ZGen_2Phase_In* in, ZGen_2Phase_Out* out);
+WOLFTPM_API TPM_RC TPM2_ZGen_2Phase_ex(TPM2_CTX* ctx, ZGen_2Phase_In* in,
+    ZGen_2Phase_Out* out);
 
 
 typedef struct {
@@ -2077,6 +2393,8 @@ typedef struct {
 } EncryptDecrypt_Out;
 WOLFTPM_API TPM_RC TPM2_EncryptDecrypt(EncryptDecrypt_In* in,
     EncryptDecrypt_Out* out);
+WOLFTPM_API TPM_RC TPM2_EncryptDecrypt_ex(TPM2_CTX* ctx, EncryptDecrypt_In* in,
+    EncryptDecrypt_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT keyHandle;
@@ -2091,6 +2409,8 @@ typedef struct {
 } EncryptDecrypt2_Out;
 WOLFTPM_API TPM_RC TPM2_EncryptDecrypt2(EncryptDecrypt2_In* in,
     EncryptDecrypt2_Out* out);
+WOLFTPM_API TPM_RC TPM2_EncryptDecrypt2_ex(TPM2_CTX* ctx,
+    EncryptDecrypt2_In* in, EncryptDecrypt2_Out* out);
 
 
 typedef struct {
@@ -2103,6 +2423,7 @@ typedef struct {
     TPMT_TK_HASHCHECK validation;
 } Hash_Out;
 WOLFTPM_API TPM_RC TPM2_Hash(Hash_In* in, Hash_Out* out);
+WOLFTPM_API TPM_RC TPM2_Hash_ex(TPM2_CTX* ctx, Hash_In* in, Hash_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT handle;
@@ -2113,6 +2434,7 @@ typedef struct {
     TPM2B_DIGEST outHMAC;
 } HMAC_Out;
 WOLFTPM_API TPM_RC TPM2_HMAC(HMAC_In* in, HMAC_Out* out);
+WOLFTPM_API TPM_RC TPM2_HMAC_ex(TPM2_CTX* ctx, HMAC_In* in, HMAC_Out* out);
 
 
 typedef struct {
@@ -2124,6 +2446,8 @@ typedef struct {
     TPMI_DH_OBJECT sequenceHandle;
 } HMAC_Start_Out;
 WOLFTPM_API TPM_RC TPM2_HMAC_Start(HMAC_Start_In* in, HMAC_Start_Out* out);
+WOLFTPM_API TPM_RC TPM2_HMAC_Start_ex(TPM2_CTX* ctx, HMAC_Start_In* in,
+    HMAC_Start_Out* out);
 
 
 typedef struct {
@@ -2135,12 +2459,15 @@ typedef struct {
 } HashSequenceStart_Out;
 WOLFTPM_API TPM_RC TPM2_HashSequenceStart(HashSequenceStart_In* in,
     HashSequenceStart_Out* out);
+WOLFTPM_API TPM_RC TPM2_HashSequenceStart_ex(TPM2_CTX* ctx,
+    HashSequenceStart_In* in, HashSequenceStart_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT sequenceHandle;
     TPM2B_MAX_BUFFER buffer;
 } SequenceUpdate_In;
 WOLFTPM_API TPM_RC TPM2_SequenceUpdate(SequenceUpdate_In* in);
+WOLFTPM_API TPM_RC TPM2_SequenceUpdate_ex(TPM2_CTX* ctx, SequenceUpdate_In* in);
 
 typedef struct {
     TPMI_DH_OBJECT sequenceHandle;
@@ -2153,6 +2480,8 @@ typedef struct {
 } SequenceComplete_Out;
 WOLFTPM_API TPM_RC TPM2_SequenceComplete(SequenceComplete_In* in,
     SequenceComplete_Out* out);
+WOLFTPM_API TPM_RC TPM2_SequenceComplete_ex(TPM2_CTX* ctx,
+    SequenceComplete_In* in, SequenceComplete_Out* out);
 
 
 typedef struct {
@@ -2165,6 +2494,8 @@ typedef struct {
 } EventSequenceComplete_Out;
 WOLFTPM_API TPM_RC TPM2_EventSequenceComplete(EventSequenceComplete_In* in,
     EventSequenceComplete_Out* out);
+WOLFTPM_API TPM_RC TPM2_EventSequenceComplete_ex(TPM2_CTX* ctx,
+    EventSequenceComplete_In* in, EventSequenceComplete_Out* out);
 
 
 typedef struct {
@@ -2178,6 +2509,8 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } Certify_Out;
 WOLFTPM_API TPM_RC TPM2_Certify(Certify_In* in, Certify_Out* out);
+WOLFTPM_API TPM_RC TPM2_Certify_ex(TPM2_CTX* ctx, Certify_In* in,
+    Certify_Out* out);
 
 
 typedef struct {
@@ -2193,6 +2526,8 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } CertifyCreation_Out;
 WOLFTPM_API TPM_RC TPM2_CertifyCreation(CertifyCreation_In* in, CertifyCreation_Out* out);
+WOLFTPM_API TPM_RC TPM2_CertifyCreation_ex(TPM2_CTX* ctx,
+    CertifyCreation_In* in, CertifyCreation_Out* out);
 
 
 typedef struct {
@@ -2206,6 +2541,7 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } Quote_Out;
 WOLFTPM_API TPM_RC TPM2_Quote(Quote_In* in, Quote_Out* out);
+WOLFTPM_API TPM_RC TPM2_Quote_ex(TPM2_CTX* ctx, Quote_In* in, Quote_Out* out);
 
 typedef struct {
     TPMI_RH_ENDORSEMENT privacyAdminHandle;
@@ -2220,6 +2556,8 @@ typedef struct {
 } GetSessionAuditDigest_Out;
 WOLFTPM_API TPM_RC TPM2_GetSessionAuditDigest(GetSessionAuditDigest_In* in,
     GetSessionAuditDigest_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetSessionAuditDigest_ex(TPM2_CTX* ctx,
+    GetSessionAuditDigest_In* in, GetSessionAuditDigest_Out* out);
 
 typedef struct {
     TPMI_RH_ENDORSEMENT privacyHandle;
@@ -2233,6 +2571,8 @@ typedef struct {
 } GetCommandAuditDigest_Out;
 WOLFTPM_API TPM_RC TPM2_GetCommandAuditDigest(GetCommandAuditDigest_In* in,
     GetCommandAuditDigest_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetCommandAuditDigest_ex(TPM2_CTX* ctx,
+    GetCommandAuditDigest_In* in, GetCommandAuditDigest_Out* out);
 
 typedef struct {
     TPMI_RH_ENDORSEMENT privacyAdminHandle;
@@ -2245,6 +2585,8 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } GetTime_Out;
 WOLFTPM_API TPM_RC TPM2_GetTime(GetTime_In* in, GetTime_Out* out);
+WOLFTPM_API TPM_RC TPM2_GetTime_ex(TPM2_CTX* ctx, GetTime_In* in,
+    GetTime_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT signHandle;
@@ -2259,6 +2601,8 @@ typedef struct {
     UINT16 counter;
 } Commit_Out;
 WOLFTPM_API TPM_RC TPM2_Commit(Commit_In* in, Commit_Out* out);
+WOLFTPM_API TPM_RC TPM2_Commit_ex(TPM2_CTX* ctx, Commit_In* in,
+    Commit_Out* out);
 
 
 typedef struct {
@@ -2270,6 +2614,8 @@ typedef struct {
 } EC_Ephemeral_Out;
 WOLFTPM_API TPM_RC TPM2_EC_Ephemeral(EC_Ephemeral_In* in,
     EC_Ephemeral_Out* out);
+WOLFTPM_API TPM_RC TPM2_EC_Ephemeral_ex(TPM2_CTX* ctx, EC_Ephemeral_In* in,
+    EC_Ephemeral_Out* out);
 
 typedef struct {
     TPMI_DH_OBJECT keyHandle;
@@ -2281,6 +2627,8 @@ typedef struct {
 } VerifySignature_Out;
 WOLFTPM_API TPM_RC TPM2_VerifySignature(VerifySignature_In* in,
     VerifySignature_Out* out);
+WOLFTPM_API TPM_RC TPM2_VerifySignature_ex(TPM2_CTX* ctx,
+    VerifySignature_In* in, VerifySignature_Out* out);
 
 
 typedef struct {
@@ -2293,6 +2641,7 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } Sign_Out;
 WOLFTPM_API TPM_RC TPM2_Sign(Sign_In* in, Sign_Out* out);
+WOLFTPM_API TPM_RC TPM2_Sign_ex(TPM2_CTX* ctx, Sign_In* in, Sign_Out* out);
 
 
 typedef struct {
@@ -2303,6 +2652,8 @@ typedef struct {
 } SetCommandCodeAuditStatus_In;
 WOLFTPM_API TPM_RC TPM2_SetCommandCodeAuditStatus(
     SetCommandCodeAuditStatus_In* in);
+WOLFTPM_API TPM_RC TPM2_SetCommandCodeAuditStatus_ex(TPM2_CTX* ctx,
+    SetCommandCodeAuditStatus_In* in);
 
 
 typedef struct {
@@ -2313,6 +2664,8 @@ typedef struct {
     TPML_DIGEST_VALUES digests;
 } PCR_Event_Out;
 WOLFTPM_API TPM_RC TPM2_PCR_Event(PCR_Event_In* in, PCR_Event_Out* out);
+WOLFTPM_API TPM_RC TPM2_PCR_Event_ex(TPM2_CTX* ctx, PCR_Event_In* in,
+    PCR_Event_Out* out);
 
 
 typedef struct {
@@ -2327,6 +2680,8 @@ typedef struct {
 } PCR_Allocate_Out;
 WOLFTPM_API TPM_RC TPM2_PCR_Allocate(PCR_Allocate_In* in,
     PCR_Allocate_Out* out);
+WOLFTPM_API TPM_RC TPM2_PCR_Allocate_ex(TPM2_CTX* ctx, PCR_Allocate_In* in,
+    PCR_Allocate_Out* out);
 
 typedef struct {
     TPMI_RH_PLATFORM authHandle;
@@ -2335,17 +2690,22 @@ typedef struct {
     TPMI_DH_PCR pcrNum;
 } PCR_SetAuthPolicy_In;
 WOLFTPM_API TPM_RC TPM2_PCR_SetAuthPolicy(PCR_SetAuthPolicy_In* in);
+WOLFTPM_API TPM_RC TPM2_PCR_SetAuthPolicy_ex(TPM2_CTX* ctx,
+    PCR_SetAuthPolicy_In* in);
 
 typedef struct {
     TPMI_DH_PCR pcrHandle;
     TPM2B_DIGEST auth;
 } PCR_SetAuthValue_In;
 WOLFTPM_API TPM_RC TPM2_PCR_SetAuthValue(PCR_SetAuthValue_In* in);
+WOLFTPM_API TPM_RC TPM2_PCR_SetAuthValue_ex(TPM2_CTX* ctx,
+    PCR_SetAuthValue_In* in);
 
 typedef struct {
     TPMI_DH_PCR pcrHandle;
 } PCR_Reset_In;
 WOLFTPM_API TPM_RC TPM2_PCR_Reset(PCR_Reset_In* in);
+WOLFTPM_API TPM_RC TPM2_PCR_Reset_ex(TPM2_CTX* ctx, PCR_Reset_In* in);
 
 
 typedef struct {
@@ -2363,6 +2723,8 @@ typedef struct {
 } PolicySigned_Out;
 WOLFTPM_API TPM_RC TPM2_PolicySigned(PolicySigned_In* in,
     PolicySigned_Out* out);
+WOLFTPM_API TPM_RC TPM2_PolicySigned_ex(TPM2_CTX* ctx, PolicySigned_In* in,
+    PolicySigned_Out* out);
 
 typedef struct {
     TPMI_DH_ENTITY authHandle;
@@ -2378,6 +2740,8 @@ typedef struct {
 } PolicySecret_Out;
 WOLFTPM_API TPM_RC TPM2_PolicySecret(PolicySecret_In* in,
     PolicySecret_Out* out);
+WOLFTPM_API TPM_RC TPM2_PolicySecret_ex(TPM2_CTX* ctx, PolicySecret_In* in,
+    PolicySecret_Out* out);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2388,12 +2752,14 @@ typedef struct {
     TPMT_TK_AUTH ticket;
 } PolicyTicket_In;
 WOLFTPM_API TPM_RC TPM2_PolicyTicket(PolicyTicket_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyTicket_ex(TPM2_CTX* ctx, PolicyTicket_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPML_DIGEST pHashList;
 } PolicyOR_In;
 WOLFTPM_API TPM_RC TPM2_PolicyOR(PolicyOR_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyOR_ex(TPM2_CTX* ctx, PolicyOR_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2401,12 +2767,14 @@ typedef struct {
     TPML_PCR_SELECTION pcrs;
 } PolicyPCR_In;
 WOLFTPM_API TPM_RC TPM2_PolicyPCR(PolicyPCR_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyPCR_ex(TPM2_CTX* ctx, PolicyPCR_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPMA_LOCALITY locality;
 } PolicyLocality_In;
 WOLFTPM_API TPM_RC TPM2_PolicyLocality(PolicyLocality_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyLocality_ex(TPM2_CTX* ctx, PolicyLocality_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2417,6 +2785,7 @@ typedef struct {
     TPM_EO operation;
 } PolicyNV_In;
 WOLFTPM_API TPM_RC TPM2_PolicyNV(PolicyNV_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyNV_ex(TPM2_CTX* ctx, PolicyNV_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2425,29 +2794,37 @@ typedef struct {
     TPM_EO operation;
 } PolicyCounterTimer_In;
 WOLFTPM_API TPM_RC TPM2_PolicyCounterTimer(PolicyCounterTimer_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyCounterTimer_ex(TPM2_CTX* ctx,
+    PolicyCounterTimer_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPM_CC code;
 } PolicyCommandCode_In;
 WOLFTPM_API TPM_RC TPM2_PolicyCommandCode(PolicyCommandCode_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyCommandCode_ex(TPM2_CTX* ctx,
+    PolicyCommandCode_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
 } PolicyPhysicalPresence_In;
 WOLFTPM_API TPM_RC TPM2_PolicyPhysicalPresence(PolicyPhysicalPresence_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyPhysicalPresence_ex(TPM2_CTX* ctx,
+    PolicyPhysicalPresence_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPM2B_DIGEST cpHashA;
 } PolicyCpHash_In;
 WOLFTPM_API TPM_RC TPM2_PolicyCpHash(PolicyCpHash_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyCpHash_ex(TPM2_CTX* ctx, PolicyCpHash_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPM2B_DIGEST nameHash;
 } PolicyNameHash_In;
 WOLFTPM_API TPM_RC TPM2_PolicyNameHash(PolicyNameHash_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyNameHash_ex(TPM2_CTX* ctx, PolicyNameHash_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2456,6 +2833,8 @@ typedef struct {
     TPMI_YES_NO includeObject;
 } PolicyDuplicationSelect_In;
 WOLFTPM_API TPM_RC TPM2_PolicyDuplicationSelect(PolicyDuplicationSelect_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyDuplicationSelect_ex(TPM2_CTX* ctx,
+    PolicyDuplicationSelect_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2465,16 +2844,21 @@ typedef struct {
     TPMT_TK_VERIFIED checkTicket;
 } PolicyAuthorize_In;
 WOLFTPM_API TPM_RC TPM2_PolicyAuthorize(PolicyAuthorize_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyAuthorize_ex(TPM2_CTX* ctx,
+    PolicyAuthorize_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
 } PolicyAuthValue_In;
 WOLFTPM_API TPM_RC TPM2_PolicyAuthValue(PolicyAuthValue_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyAuthValue_ex(TPM2_CTX* ctx,
+    PolicyAuthValue_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
 } PolicyPassword_In;
 WOLFTPM_API TPM_RC TPM2_PolicyPassword(PolicyPassword_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyPassword_ex(TPM2_CTX* ctx, PolicyPassword_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
@@ -2483,18 +2867,23 @@ typedef struct {
     TPM2B_DIGEST policyDigest;
 } PolicyGetDigest_Out;
 WOLFTPM_API TPM_RC TPM2_PolicyGetDigest(PolicyGetDigest_In* in, PolicyGetDigest_Out* out);
+WOLFTPM_API TPM_RC TPM2_PolicyGetDigest_ex(TPM2_CTX* ctx,
+    PolicyGetDigest_In* in, PolicyGetDigest_Out* out);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPMI_YES_NO writtenSet;
 } PolicyNvWritten_In;
 WOLFTPM_API TPM_RC TPM2_PolicyNvWritten(PolicyNvWritten_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyNvWritten_ex(TPM2_CTX* ctx,
+    PolicyNvWritten_In* in);
 
 typedef struct {
     TPMI_SH_POLICY policySession;
     TPM2B_DIGEST templateHash;
 } PolicyTemplate_In;
 WOLFTPM_API TPM_RC TPM2_PolicyTemplate(PolicyTemplate_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyTemplate_ex(TPM2_CTX* ctx, PolicyTemplate_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2502,6 +2891,8 @@ typedef struct {
     TPMI_SH_POLICY policySession;
 } PolicyAuthorizeNV_In;
 WOLFTPM_API TPM_RC TPM2_PolicyAuthorizeNV(PolicyAuthorizeNV_In* in);
+WOLFTPM_API TPM_RC TPM2_PolicyAuthorizeNV_ex(TPM2_CTX* ctx,
+    PolicyAuthorizeNV_In* in);
 
 
 
@@ -2516,6 +2907,8 @@ typedef struct {
     TPMI_YES_NO state;
 } HierarchyControl_In;
 WOLFTPM_API TPM_RC TPM2_HierarchyControl(HierarchyControl_In* in);
+WOLFTPM_API TPM_RC TPM2_HierarchyControl_ex(TPM2_CTX* ctx,
+    HierarchyControl_In* in);
 
 typedef struct {
     TPMI_RH_HIERARCHY_AUTH authHandle;
@@ -2523,6 +2916,8 @@ typedef struct {
     TPMI_ALG_HASH hashAlg;
 } SetPrimaryPolicy_In;
 WOLFTPM_API TPM_RC TPM2_SetPrimaryPolicy(SetPrimaryPolicy_In* in);
+WOLFTPM_API TPM_RC TPM2_SetPrimaryPolicy_ex(TPM2_CTX* ctx,
+    SetPrimaryPolicy_In* in);
 
 typedef struct {
     TPMI_RH_PLATFORM authHandle;
@@ -2530,32 +2925,40 @@ typedef struct {
 
 typedef ChangeSeed_In ChangePPS_In;
 WOLFTPM_API TPM_RC TPM2_ChangePPS(ChangePPS_In* in);
+WOLFTPM_API TPM_RC TPM2_ChangePPS_ex(TPM2_CTX* ctx, ChangePPS_In* in);
 
 typedef ChangeSeed_In ChangeEPS_In;
 WOLFTPM_API TPM_RC TPM2_ChangeEPS(ChangeEPS_In* in);
+WOLFTPM_API TPM_RC TPM2_ChangeEPS_ex(TPM2_CTX* ctx, ChangeEPS_In* in);
 
 
 typedef struct {
     TPMI_RH_CLEAR authHandle;
 } Clear_In;
 WOLFTPM_API TPM_RC TPM2_Clear(Clear_In* in);
+WOLFTPM_API TPM_RC TPM2_Clear_ex(TPM2_CTX* ctx, Clear_In* in);
 
 typedef struct {
     TPMI_RH_CLEAR auth;
     TPMI_YES_NO disable;
 } ClearControl_In;
 WOLFTPM_API TPM_RC TPM2_ClearControl(ClearControl_In* in);
+WOLFTPM_API TPM_RC TPM2_ClearControl_ex(TPM2_CTX* ctx, ClearControl_In* in);
 
 typedef struct {
     TPMI_RH_HIERARCHY_AUTH authHandle;
     TPM2B_AUTH newAuth;
 } HierarchyChangeAuth_In;
 WOLFTPM_API TPM_RC TPM2_HierarchyChangeAuth(HierarchyChangeAuth_In* in);
+WOLFTPM_API TPM_RC TPM2_HierarchyChangeAuth_ex(TPM2_CTX* ctx,
+    HierarchyChangeAuth_In* in);
 
 typedef struct {
     TPMI_RH_LOCKOUT lockHandle;
 } DictionaryAttackLockReset_In;
 WOLFTPM_API TPM_RC TPM2_DictionaryAttackLockReset(DictionaryAttackLockReset_In* in);
+WOLFTPM_API TPM_RC TPM2_DictionaryAttackLockReset_ex(TPM2_CTX* ctx,
+    DictionaryAttackLockReset_In* in);
 
 typedef struct {
     TPMI_RH_LOCKOUT lockHandle;
@@ -2564,6 +2967,8 @@ typedef struct {
     UINT32 lockoutRecovery;
 } DictionaryAttackParameters_In;
 WOLFTPM_API TPM_RC TPM2_DictionaryAttackParameters(DictionaryAttackParameters_In* in);
+WOLFTPM_API TPM_RC TPM2_DictionaryAttackParameters_ex(TPM2_CTX* ctx,
+    DictionaryAttackParameters_In* in);
 
 
 typedef struct {
@@ -2572,12 +2977,15 @@ typedef struct {
     TPML_CC clearList;
 } PP_Commands_In;
 WOLFTPM_API TPM_RC TPM2_PP_Commands(PP_Commands_In* in);
+WOLFTPM_API TPM_RC TPM2_PP_Commands_ex(TPM2_CTX* ctx, PP_Commands_In* in);
 
 typedef struct {
     TPMI_RH_PLATFORM authHandle;
     UINT32 algorithmSet;
 } SetAlgorithmSet_In;
 WOLFTPM_API TPM_RC TPM2_SetAlgorithmSet(SetAlgorithmSet_In* in);
+WOLFTPM_API TPM_RC TPM2_SetAlgorithmSet_ex(TPM2_CTX* ctx,
+    SetAlgorithmSet_In* in);
 
 typedef struct {
     TPMI_RH_PLATFORM authorization;
@@ -2586,6 +2994,8 @@ typedef struct {
     TPMT_SIGNATURE manifestSignature;
 } FieldUpgradeStart_In;
 WOLFTPM_API TPM_RC TPM2_FieldUpgradeStart(FieldUpgradeStart_In* in);
+WOLFTPM_API TPM_RC TPM2_FieldUpgradeStart_ex(TPM2_CTX* ctx,
+    FieldUpgradeStart_In* in);
 
 typedef struct {
     TPM2B_MAX_BUFFER fuData;
@@ -2596,6 +3006,8 @@ typedef struct {
 } FieldUpgradeData_Out;
 WOLFTPM_API TPM_RC TPM2_FieldUpgradeData(FieldUpgradeData_In* in,
     FieldUpgradeData_Out* out);
+WOLFTPM_API TPM_RC TPM2_FieldUpgradeData_ex(TPM2_CTX* ctx,
+    FieldUpgradeData_In* in, FieldUpgradeData_Out* out);
 
 typedef struct {
     UINT32 sequenceNumber;
@@ -2604,6 +3016,8 @@ typedef struct {
     TPM2B_MAX_BUFFER fuData;
 } FirmwareRead_Out;
 WOLFTPM_API TPM_RC TPM2_FirmwareRead(FirmwareRead_In* in, FirmwareRead_Out* out);
+WOLFTPM_API TPM_RC TPM2_FirmwareRead_ex(TPM2_CTX* ctx, FirmwareRead_In* in,
+    FirmwareRead_Out* out);
 
 
 typedef struct {
@@ -2613,6 +3027,8 @@ typedef struct {
     TPMS_CONTEXT context;
 } ContextSave_Out;
 WOLFTPM_API TPM_RC TPM2_ContextSave(ContextSave_In* in, ContextSave_Out* out);
+WOLFTPM_API TPM_RC TPM2_ContextSave_ex(TPM2_CTX* ctx, ContextSave_In* in,
+    ContextSave_Out* out);
 
 typedef struct {
     TPMS_CONTEXT context;
@@ -2621,6 +3037,8 @@ typedef struct {
     TPMI_DH_CONTEXT loadedHandle;
 } ContextLoad_Out;
 WOLFTPM_API TPM_RC TPM2_ContextLoad(ContextLoad_In* in, ContextLoad_Out* out);
+WOLFTPM_API TPM_RC TPM2_ContextLoad_ex(TPM2_CTX* ctx, ContextLoad_In* in,
+    ContextLoad_Out* out);
 
 
 typedef struct {
@@ -2629,30 +3047,36 @@ typedef struct {
     TPMI_DH_PERSISTENT persistentHandle;
 } EvictControl_In;
 WOLFTPM_API TPM_RC TPM2_EvictControl(EvictControl_In* in);
+WOLFTPM_API TPM_RC TPM2_EvictControl_ex(TPM2_CTX* ctx, EvictControl_In* in);
 
 
 typedef struct {
     TPMS_TIME_INFO currentTime;
 } ReadClock_Out;
 WOLFTPM_API TPM_RC TPM2_ReadClock(ReadClock_Out* out);
+WOLFTPM_API TPM_RC TPM2_ReadClock_ex(TPM2_CTX* ctx, ReadClock_Out* out);
 
 typedef struct {
     TPMI_RH_PROVISION auth;
     UINT64 newTime;
 } ClockSet_In;
 WOLFTPM_API TPM_RC TPM2_ClockSet(ClockSet_In* in);
+WOLFTPM_API TPM_RC TPM2_ClockSet_ex(TPM2_CTX* ctx, ClockSet_In* in);
 
 typedef struct {
     TPMI_RH_PROVISION auth;
     TPM_CLOCK_ADJUST rateAdjust;
 } ClockRateAdjust_In;
 WOLFTPM_API TPM_RC TPM2_ClockRateAdjust(ClockRateAdjust_In* in);
+WOLFTPM_API TPM_RC TPM2_ClockRateAdjust_ex(TPM2_CTX* ctx,
+    ClockRateAdjust_In* in);
 
 
 typedef struct {
     TPMT_PUBLIC_PARMS parameters;
 } TestParms_In;
 WOLFTPM_API TPM_RC TPM2_TestParms(TestParms_In* in);
+WOLFTPM_API TPM_RC TPM2_TestParms_ex(TPM2_CTX* ctx, TestParms_In* in);
 
 
 typedef struct {
@@ -2661,18 +3085,23 @@ typedef struct {
     TPM2B_NV_PUBLIC publicInfo;
 } NV_DefineSpace_In;
 WOLFTPM_API TPM_RC TPM2_NV_DefineSpace(NV_DefineSpace_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_DefineSpace_ex(TPM2_CTX* ctx, NV_DefineSpace_In* in);
 
 typedef struct {
     TPMI_RH_PROVISION authHandle;
     TPMI_RH_NV_INDEX nvIndex;
 } NV_UndefineSpace_In;
 WOLFTPM_API TPM_RC TPM2_NV_UndefineSpace(NV_UndefineSpace_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_UndefineSpace_ex(TPM2_CTX* ctx,
+    NV_UndefineSpace_In* in);
 
 typedef struct {
     TPMI_RH_NV_INDEX nvIndex;
     TPMI_RH_PLATFORM platform;
 } NV_UndefineSpaceSpecial_In;
 WOLFTPM_API TPM_RC TPM2_NV_UndefineSpaceSpecial(NV_UndefineSpaceSpecial_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_UndefineSpaceSpecial_ex(TPM2_CTX* ctx,
+    NV_UndefineSpaceSpecial_In* in);
 
 typedef struct {
     TPMI_RH_NV_INDEX nvIndex;
@@ -2682,6 +3111,8 @@ typedef struct {
     TPM2B_NAME nvName;
 } NV_ReadPublic_Out;
 WOLFTPM_API TPM_RC TPM2_NV_ReadPublic(NV_ReadPublic_In* in, NV_ReadPublic_Out* out);
+WOLFTPM_API TPM_RC TPM2_NV_ReadPublic_ex(TPM2_CTX* ctx, NV_ReadPublic_In* in,
+    NV_ReadPublic_Out* out);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2690,12 +3121,14 @@ typedef struct {
     UINT16 offset;
 } NV_Write_In;
 WOLFTPM_API TPM_RC TPM2_NV_Write(NV_Write_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_Write_ex(TPM2_CTX* ctx, NV_Write_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
     TPMI_RH_NV_INDEX nvIndex;
 } NV_Increment_In;
 WOLFTPM_API TPM_RC TPM2_NV_Increment(NV_Increment_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_Increment_ex(TPM2_CTX* ctx, NV_Increment_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2703,6 +3136,7 @@ typedef struct {
     TPM2B_MAX_NV_BUFFER data;
 } NV_Extend_In;
 WOLFTPM_API TPM_RC TPM2_NV_Extend(NV_Extend_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_Extend_ex(TPM2_CTX* ctx, NV_Extend_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2710,17 +3144,21 @@ typedef struct {
     UINT64 bits;
 } NV_SetBits_In;
 WOLFTPM_API TPM_RC TPM2_NV_SetBits(NV_SetBits_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_SetBits_ex(TPM2_CTX* ctx, NV_SetBits_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
     TPMI_RH_NV_INDEX nvIndex;
 } NV_WriteLock_In;
 WOLFTPM_API TPM_RC TPM2_NV_WriteLock(NV_WriteLock_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_WriteLock_ex(TPM2_CTX* ctx, NV_WriteLock_In* in);
 
 typedef struct {
     TPMI_RH_PROVISION authHandle;
 } NV_GlobalWriteLock_In;
 WOLFTPM_API TPM_RC TPM2_NV_GlobalWriteLock(NV_GlobalWriteLock_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_GlobalWriteLock_ex(TPM2_CTX* ctx,
+    NV_GlobalWriteLock_In* in);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
@@ -2732,18 +3170,22 @@ typedef struct {
     TPM2B_MAX_NV_BUFFER data;
 } NV_Read_Out;
 WOLFTPM_API TPM_RC TPM2_NV_Read(NV_Read_In* in, NV_Read_Out* out);
+WOLFTPM_API TPM_RC TPM2_NV_Read_ex(TPM2_CTX* ctx, NV_Read_In* in,
+    NV_Read_Out* out);
 
 typedef struct {
     TPMI_RH_NV_AUTH authHandle;
     TPMI_RH_NV_INDEX nvIndex;
 } NV_ReadLock_In;
 WOLFTPM_API TPM_RC TPM2_NV_ReadLock(NV_ReadLock_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_ReadLock_ex(TPM2_CTX* ctx, NV_ReadLock_In* in);
 
 typedef struct {
     TPMI_RH_NV_INDEX nvIndex;
     TPM2B_AUTH newAuth;
 } NV_ChangeAuth_In;
 WOLFTPM_API TPM_RC TPM2_NV_ChangeAuth(NV_ChangeAuth_In* in);
+WOLFTPM_API TPM_RC TPM2_NV_ChangeAuth_ex(TPM2_CTX* ctx, NV_ChangeAuth_In* in);
 
 typedef struct {
     TPMI_DH_OBJECT signHandle;
@@ -2759,6 +3201,8 @@ typedef struct {
     TPMT_SIGNATURE signature;
 } NV_Certify_Out;
 WOLFTPM_API TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out);
+WOLFTPM_API TPM_RC TPM2_NV_Certify_ex(TPM2_CTX* ctx, NV_Certify_In* in,
+    NV_Certify_Out* out);
 
 
 /* Vendor Specific API's */
@@ -2771,6 +3215,7 @@ WOLFTPM_API TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out);
         UINT32 lockFlag;
     } SetCommandSet_In;
     WOLFTPM_API int TPM2_SetCommandSet(SetCommandSet_In* in);
+    WOLFTPM_API int TPM2_SetCommandSet_ex(TPM2_CTX* ctx, SetCommandSet_In* in);
 
     enum {
         TPMLib_2 = 0x01,
@@ -2791,6 +3236,7 @@ WOLFTPM_API TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out);
         TPM_MODE_SET modeSet;
     } SetMode_In;
     WOLFTPM_API int TPM2_SetMode(SetMode_In* in);
+    WOLFTPM_API int TPM2_SetMode_ex(TPM2_CTX* ctx, SetMode_In* in);
 #endif
 
 /* Vendor Specific GPIO */
@@ -2862,6 +3308,7 @@ WOLFTPM_API TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out);
         TPML_GPIO_CONFIG config;
     } GpioConfig_In;
     WOLFTPM_API int TPM2_GPIO_Config(GpioConfig_In* in);
+    WOLFTPM_API int TPM2_GPIO_Config_ex(TPM2_CTX* ctx, GpioConfig_In* in);
 
 #elif defined(WOLFTPM_NUVOTON)
 
@@ -2922,11 +3369,15 @@ WOLFTPM_API TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out);
         CFG_STRUCT preConfig;
     } NTC2_PreConfig_In;
     WOLFTPM_API int TPM2_NTC2_PreConfig(NTC2_PreConfig_In* in);
+    WOLFTPM_API int TPM2_NTC2_PreConfig_ex(TPM2_CTX* ctx,
+        NTC2_PreConfig_In* in);
 
     typedef struct {
         CFG_STRUCT preConfig;
     } NTC2_GetConfig_Out;
     WOLFTPM_API int TPM2_NTC2_GetConfig(NTC2_GetConfig_Out* out);
+    WOLFTPM_API int TPM2_NTC2_GetConfig_ex(TPM2_CTX* ctx,
+        NTC2_GetConfig_Out* out);
 
 #endif /* WOLFTPM_ST33 || WOLFTPM_AUTODETECT */
 
@@ -3090,6 +3541,408 @@ WOLFTPM_API TPM_RC TPM2_ChipStartup(TPM2_CTX* ctx, int timeoutTries);
 */
 WOLFTPM_API TPM_RC TPM2_SetHalIoCb(TPM2_CTX* ctx, TPM2HalIoCb ioCb, void* userCtx);
 
+#ifndef WOLFTPM_ADV_IO
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets an optional vectored IO callback used by the TIS layer to
+    issue several independent register transactions in one transport call
+    \note The frames are passed back-to-back with their sizes in xferSz.
+    The regular ioCb set by TPM2_SetHalIoCb is still required and is used
+    for single transactions. Set ioVecCb to NULL to disable batching.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: could not acquire the lock on the wolfTPM2 context
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param ioVecCb pointer to TPM2HalIoVecCb (HAL IO) callback function
+
+    \sa TPM2_SetHalIoCb
+*/
+WOLFTPM_API TPM_RC TPM2_SetHalIoVecCb(TPM2_CTX* ctx, TPM2HalIoVecCb ioVecCb);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Limits the payload of a single SPI frame to what the transport
+    supports. TPM2_Init negotiates the frame size from the transfer size
+    reported in TPM_INTF_CAPS, bounded by MAX_SPI_FRAMESIZE, this lowers it
+    further.
+    \note Call after TPM2_Init, a later TPM2_Init negotiates again. Up to
+    TPM_TIS_MAX_XFER_VEC - 1 frames are moved per burst count handshake.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: could not acquire the lock on the wolfTPM2 context
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer or
+    maxFrame is zero
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param maxFrame largest frame payload in bytes the transport supports
+
+    \sa TPM2_SetHalIoVecCb
+*/
+WOLFTPM_API TPM_RC TPM2_SetHalMaxFrame(TPM2_CTX* ctx, word16 maxFrame);
+#endif
+
+#ifdef WOLFTPM_PIPELINE
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Enables pipelined command processing on a context shared by several
+    threads. While one command executes on the TPM, the next ones are
+    marshalled, get their session nonces and wait in a queue of
+    TPM2_PIPE_DEPTH slots instead of behind the hwLock. Commands on the same
+    auth session stay in order: a session is held from its command HMAC until
+    its response was verified, so each HMAC uses the latest nonceTPM. The
+    session crypto runs without the hwLock, the lock only covers the
+    transport and the session reservations. The name cache and the host
+    DRBG have a lock of their own. With WOLFTPM_PIPELINE every thread uses
+    the sessions it set with TPM2_SetSessionAuth, so threads with distinct
+    sessions are authorized and verified concurrently.
+    \note Only available with WOLFTPM_PIPELINE, which makes the hwLock a
+    pthread mutex. Do not mix with TPM2_SubmitCommand on the same context.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: commands are still in the pipeline or the lock on
+    the wolfTPM2 context could not be acquired
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param enable non-zero to enable the pipeline
+
+    \sa TPM2_SubmitCommand
+*/
+WOLFTPM_API TPM_RC TPM2_SetPipeline(TPM2_CTX* ctx, int enable);
+#endif
+
+#ifdef WOLFTPM_CMD_PRIORITY
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets the command class of the calling thread on a context shared
+    by several threads. Waiting commands get the hwLock by class, in arrival
+    order within a class. Multi-command operations such as
+    wolfTPM2_HashUpdate or wolfTPM2_NVWriteAuth take the lock per chunk, so
+    a TPM2_PRIO_HIGH command waits for at most the chunk that is running
+    when its thread runs them at TPM2_PRIO_BULK. A steady stream of higher
+    class commands starves the lower classes.
+    \note Only available with WOLFTPM_CMD_PRIORITY, which makes the hwLock a
+    pthread mutex. The class stays until it is set again, set it around a
+    single call to prioritize just that one.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the lock could not be created
+    \return BAD_FUNC_ARG: ctx is a NULL pointer or prio is not a class
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param prio TPM2_PRIO_BULK, TPM2_PRIO_NORMAL or TPM2_PRIO_HIGH
+
+    \sa TPM2_GetCmdPriority
+*/
+WOLFTPM_API TPM_RC TPM2_SetCmdPriority(TPM2_CTX* ctx, TPM2_CMD_PRIO prio);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Returns the command class of the calling thread.
+    \note Only available with WOLFTPM_CMD_PRIORITY.
+
+    \return the class set with TPM2_SetCmdPriority, TPM2_PRIO_NORMAL if none
+
+    \param ctx pointer to a TPM2_CTX struct
+
+    \sa TPM2_SetCmdPriority
+*/
+WOLFTPM_API TPM2_CMD_PRIO TPM2_GetCmdPriority(TPM2_CTX* ctx);
+#endif
+
+#ifdef WOLFTPM_AUTO_RETRY
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Fills stats with the resubmission counts of every command code
+    that was answered with TPM_RC_RETRY, TPM_RC_YIELDED or TPM_RC_TESTING on
+    ctx. Such a command is sent again up to TPM2_RETRY_MAX times, after an
+    exponential backoff from TPM2_RETRY_BASE_US with random jitter. Every
+    attempt is marshalled again from the caller's command, so HMAC sessions
+    use a fresh nonceCaller against the nonceTPM the TPM kept. The hwLock is
+    released during the backoff, so commands of other threads run in between
+    unless the refused command was sent with the lock already held by its
+    thread.
+    \note Only available with WOLFTPM_AUTO_RETRY. Commands sent with
+    TPM2_SubmitCommand and in pipeline mode are not resubmitted.
+
+    \return the number of entries filled
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param stats array for the counts
+    \param maxCount number of entries of stats
+*/
+WOLFTPM_API int TPM2_GetRetryStats(TPM2_CTX* ctx, TPM2_RETRY_STAT* stats,
+    int maxCount);
+#endif
+
+#ifdef WOLFTPM_HOST_DRBG
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets when the host DRBG behind TPM2_GetNonce_ex takes a new seed
+    from the TPM. The DRBG is seeded with TPM2_DRBG_SEED_SZ bytes of
+    TPM2_GetRandom on first use and again once maxBytes bytes were served or
+    maxRequests requests were answered since the last seed, whichever comes
+    first. Session nonces, salts and the RNG requests of
+    wolfTPM2_CryptoDevCb are served in between without a TPM round trip.
+    \note Only available with WOLFTPM_HOST_DRBG. The defaults are
+    TPM2_DRBG_RESEED_BYTES and TPM2_DRBG_RESEED_REQS.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the lock could not be taken
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param maxBytes bytes served per seed, 0 for no limit
+    \param maxRequests requests answered per seed, 0 for no limit
+
+    \sa TPM2_GetDrbgStats
+*/
+WOLFTPM_API int TPM2_SetDrbgReseed(TPM2_CTX* ctx, word32 maxBytes,
+    word32 maxRequests);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Copies the counts of the host DRBG of ctx, including the
+    TPM2_GetRandom commands avoided by serving requests from the host.
+    \note Only available with WOLFTPM_HOST_DRBG.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the lock could not be taken
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param stats filled with the counts
+
+    \sa TPM2_SetDrbgReseed
+*/
+WOLFTPM_API int TPM2_GetDrbgStats(TPM2_CTX* ctx, TPM2_DRBG_STATS* stats);
+#endif
+
+#ifdef WOLFTPM_RESOURCE_MGR
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Enables the in-process resource manager. Transient objects created
+    or loaded on the context get virtual handles starting at
+    TPM2_RM_HANDLE_FIRST, which commands translate to the handles in the TPM.
+    When more than TPM2_RM_MAX_LOADED objects are in use, the least recently
+    used one is saved with TPM2_ContextSave and flushed, and loaded again with
+    TPM2_ContextLoad when a command references it. An object whose saved
+    context is still current is only flushed. Callers keep using the virtual
+    handle and never see TPM_RC_OBJECT_MEMORY from their own objects.
+    \note Only available with WOLFTPM_RESOURCE_MGR, not together with
+    WOLFTPM_PIPELINE. Sessions stay loaded, objects loaded by other TPM users
+    are not evicted and commands passed to TPM2_SubmitCommand are sent as
+    they are.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: objects are still tracked or the lock on the
+    wolfTPM2 context could not be acquired
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param enable non-zero to enable the resource manager
+
+    \sa TPM2_GetResourceMgrStats
+*/
+WOLFTPM_API TPM_RC TPM2_SetResourceMgr(TPM2_CTX* ctx, int enable);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Returns the operation counts of the resource manager. Reloading
+    each object around every use would cost stats->uses loads and flushes.
+    \note Only available with WOLFTPM_RESOURCE_MGR.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: ctx or stats is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param stats receives the counts since TPM2_SetResourceMgr
+
+    \sa TPM2_SetResourceMgr
+*/
+WOLFTPM_API TPM_RC TPM2_GetResourceMgrStats(TPM2_CTX* ctx,
+    TPM2_RM_STATS* stats);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Runs a raw TPM command in a space of its own, for a server sharing
+    the TPM between several users. Handles of objects created in the space
+    are virtual as with TPM2_SetResourceMgr, sessions keep their TPM handle.
+    Saved objects and sessions of the space are loaded as the command needs
+    them. With space->isolate set, commands that name transient objects or
+    sessions of other spaces fail with TPM_RC_HANDLE, unknown command codes
+    with TPM_RC_COMMAND_CODE, and more than TPM2_RM_MAX_OBJECTS objects or
+    TPM2_RM_MAX_SESSIONS sessions with TPM_RC_OBJECT_MEMORY or
+    TPM_RC_SESSION_MEMORY. These come back as responses in rsp.
+    \note Only available with WOLFTPM_RESOURCE_MGR. Before a command of
+    another space runs, call TPM2_SpaceSwapOut for this one. A space starts
+    zeroed.
+
+    \return TPM_RC_SUCCESS: the response is in rsp, its return code is not
+    parsed
+    \return BUFFER_E: rsp is too small, the response is dropped
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param space objects and sessions of the user
+    \param cmd marshalled TPM command including the header
+    \param cmdSz size of cmd in bytes, at most MAX_COMMAND_SIZE
+    \param rsp buffer for the response
+    \param rspSz on input the size of rsp, on output the response size
+
+    \sa TPM2_SpaceSwapOut
+    \sa TPM2_SpaceFlush
+*/
+WOLFTPM_API TPM_RC TPM2_SpaceCommand(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    const byte* cmd, word32 cmdSz, byte* rsp, word32* rspSz);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Frees the TPM slots of a space. Loaded objects are saved unless
+    their saved context is current and flushed, loaded sessions are saved.
+    TPM2_SpaceCommand loads them again when a command of the space uses them.
+    \note Only available with WOLFTPM_RESOURCE_MGR.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: ctx or space is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param space objects and sessions of the user
+
+    \sa TPM2_SpaceCommand
+*/
+WOLFTPM_API TPM_RC TPM2_SpaceSwapOut(TPM2_CTX* ctx, TPM2_RM_SPACE* space);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Flushes all objects and sessions of a space from the TPM, when its
+    user goes away. The space is empty afterwards.
+    \note Only available with WOLFTPM_RESOURCE_MGR.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: ctx or space is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param space objects and sessions of the user
+
+    \sa TPM2_SpaceCommand
+*/
+WOLFTPM_API TPM_RC TPM2_SpaceFlush(TPM2_CTX* ctx, TPM2_RM_SPACE* space);
+#endif
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Starts a raw TPM command without waiting for its execution. The
+    command is written to the TPM and started, the response is collected
+    with TPM2_PollCommand or TPM2_WaitCommand, so the caller can do other work
+    or serve several contexts while the TPM computes.
+    \note One command per context can be pending. Until it is completed the
+    context must not be used for other commands. On the TIS interface the TIS
+    lock stays held meanwhile. Backends that cannot resume a command (Linux
+    device, SWTPM, offload) run it to completion here.
+
+    \return TPM_RC_SUCCESS: successful, the command is executing
+    \return TPM_RC_FAILURE: a command is already pending or the lock on the
+    wolfTPM2 context could not be acquired
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param cmd marshalled TPM command including the header
+    \param cmdSz size of cmd in bytes, at most MAX_COMMAND_SIZE
+
+    \sa TPM2_PollCommand
+    \sa TPM2_WaitCommand
+*/
+WOLFTPM_API TPM_RC TPM2_SubmitCommand(TPM2_CTX* ctx, const byte* cmd,
+    word32 cmdSz);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Checks with a single status read whether the TPM finished the
+    command started with TPM2_SubmitCommand and if so reads the response.
+    \note The TPM return code is in the response header, it is not parsed.
+
+    \return TPM_RC_SUCCESS: the response is in rsp
+    \return WC_PENDING_E: the TPM is still executing, call again
+    \return BUFFER_E: rsp is too small, the response is dropped
+    \return BAD_FUNC_ARG: invalid arguments or no command is pending
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param rsp buffer for the response
+    \param rspSz on input the size of rsp, on output the response size
+
+    \sa TPM2_SubmitCommand
+    \sa TPM2_WaitCommand
+*/
+WOLFTPM_API TPM_RC TPM2_PollCommand(TPM2_CTX* ctx, byte* rsp, word32* rspSz);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Blocks until the command started with TPM2_SubmitCommand
+    completed and reads the response, as the synchronous TPM2_* functions do.
+
+    \return TPM_RC_SUCCESS: the response is in rsp
+    \return TPM_RC_TIMEOUT: the TPM did not complete the command
+    \return BUFFER_E: rsp is too small, the response is dropped
+    \return BAD_FUNC_ARG: invalid arguments or no command is pending
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param rsp buffer for the response
+    \param rspSz on input the size of rsp, on output the response size
+
+    \sa TPM2_SubmitCommand
+    \sa TPM2_PollCommand
+*/
+WOLFTPM_API TPM_RC TPM2_WaitCommand(TPM2_CTX* ctx, byte* rsp, word32* rspSz);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Enables interrupt driven completion. The TIS data available and
+    status valid interrupts are enabled in TPM_INT_ENABLE and the TIS layer
+    blocks in irqWaitCb instead of polling the status register.
+    \note If the interrupt wait fails the TIS layer falls back to polling.
+    Pass NULL as irqWaitCb to disable the interrupts again.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the TPM does not support the interrupts or the
+    lock on the wolfTPM2 context could not be acquired
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param irqWaitCb pointer to TPM2HalIrqWaitCb callback function
+    \param irqCtx pointer to the context passed to irqWaitCb
+
+    \sa TPM2_SetHalIoCb
+*/
+WOLFTPM_API TPM_RC TPM2_SetHalIrqCb(TPM2_CTX* ctx, TPM2HalIrqWaitCb irqWaitCb,
+    void* irqCtx);
+
+#ifdef WOLFTPM_TIS_OFFLOAD
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets the command callback used to submit whole commands to a TIS
+    engine outside of this process, so each command needs a single round trip
+    \note Only available with WOLFTPM_TIS_OFFLOAD. While no command callback
+    is set, commands are sent with the local TIS layer through the ioCb.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: could not acquire the lock on the wolfTPM2 context
+    \return BAD_FUNC_ARG: the TPM2 device structure is a NULL pointer
+
+    \param ctx pointer to a TPM2_CTX struct
+    \param cmdCb pointer to TPM2HalCmdCb callback function
+    \param cmdCtx pointer to the context passed to cmdCb
+
+    \sa TPM2_SetHalIoCb
+    \sa TPM2_TIS_ServeCommand
+*/
+WOLFTPM_API TPM_RC TPM2_SetHalCmdCb(TPM2_CTX* ctx, TPM2HalCmdCb cmdCb,
+    void* cmdCtx);
+#endif
+
 /*!
     \ingroup TPM2_Proprietary
     \brief Sets the structure holding the TPM Authorizations.
@@ -3123,6 +3976,8 @@ WOLFTPM_API TPM_RC TPM2_SetHalIoCb(TPM2_CTX* ctx, TPM2HalIoCb ioCb, void* userCt
     \sa wolfTPM2_Init
 */
 WOLFTPM_API TPM_RC TPM2_SetSessionAuth(TPM2_AUTH_SESSION *session);
+WOLFTPM_API TPM_RC TPM2_SetSessionAuth_ex(TPM2_CTX* ctx,
+    TPM2_AUTH_SESSION* session);
 
 /*!
     \ingroup TPM2_Proprietary
@@ -3152,6 +4007,10 @@ WOLFTPM_API int    TPM2_GetSessionAuthCount(TPM2_CTX* ctx);
 /*!
     \ingroup TPM2_Proprietary
     \brief Sets a new TPM2 context for use
+    \note The active context is process wide and only used by the TPM2_*
+    commands without a context argument. Every command also has a TPM2_*_ex
+    variant taking the TPM2_CTX first, which independent contexts used from
+    several threads should call instead.
 
     \param ctx pointer to a TPM2_CTX struct
 
@@ -3253,6 +4112,7 @@ WOLFTPM_API int TPM2_GetHashType(TPMI_ALG_HASH hashAlg);
     \endcode
 */
 WOLFTPM_API int TPM2_GetNonce(byte* nonceBuf, int nonceSz);
+WOLFTPM_API int TPM2_GetNonce_ex(TPM2_CTX* ctx, byte* nonceBuf, int nonceSz);
 
 /*!
     \ingroup TPM2_Proprietary
@@ -3534,6 +4394,7 @@ WOLFTPM_LOCAL int TPM2_GetName(TPM2_CTX* ctx, UINT32 handleValue, int handleCnt,
 
 #ifdef WOLFTPM2_USE_WOLF_RNG
 WOLFTPM_API int TPM2_GetWolfRng(WC_RNG** rng);
+WOLFTPM_API int TPM2_GetWolfRng_ex(TPM2_CTX* ctx, WC_RNG** rng);
 #endif
 
 typedef enum {
@@ -3566,6 +4427,35 @@ typedef enum {
     \sa TPM2_Init
 */
 WOLFTPM_API UINT16 TPM2_GetVendorID(void);
+WOLFTPM_API UINT16 TPM2_GetVendorID_ex(TPM2_CTX* ctx);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Zeroes a buffer holding secrets, in a way the compiler does not
+    remove even when the buffer is not read again
+
+    \param mem pointer to the buffer, may be NULL
+    \param len number of bytes to zero
+
+    \sa TPM2_ConstantCompare
+*/
+WOLFTPM_API void TPM2_ForceZero(void* mem, word32 len);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Compares two buffers in a time that only depends on len, for
+    HMACs and keys
+
+    \return 0 if the buffers are equal, non-zero otherwise
+
+    \param a pointer to the first buffer
+    \param b pointer to the second buffer
+    \param len number of bytes to compare
+
+    \sa TPM2_ForceZero
+*/
+WOLFTPM_API int TPM2_ConstantCompare(const byte* a, const byte* b,
+    word32 len);
 
 #ifdef DEBUG_WOLFTPM
 /*!
@@ -0,0 +1,210 @@
+/* tpm2_broker.h
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef _TPM2_BROKER_H_
+#define _TPM2_BROKER_H_
+
+#include <wolftpm/tpm2.h>
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#ifdef WOLFTPM_BROKER
+
+/* Queueing and swap counts of a broker client */
+typedef struct TPM2_BROKER_STATS {
+    word32 cmds;        /* commands run */
+    word32 swaps;       /* commands that had to swap the previous client out */
+    word64 waitUs;      /* total time commands were queued */
+    word32 maxWaitUs;   /* longest time a command was queued */
+} TPM2_BROKER_STATS;
+
+typedef struct TPM2_BROKER_CLIENT {
+    TPM2_RM_SPACE space;    /* objects and sessions of the client */
+    word64 pass;            /* stride scheduling position */
+    word32 ticket;          /* arrival order of the queued command */
+    word16 priority;        /* weight, 1 to TPM2_BROKER_MAX_PRIORITY */
+    byte inUse;
+    byte waiting;           /* a command is queued */
+    TPM2_BROKER_STATS stats;
+} TPM2_BROKER_CLIENT;
+
+/* Shares one TPM2_CTX between clients, see TPM2_Broker_Init */
+typedef struct TPM2_BROKER {
+    TPM2_CTX* ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;    /* signalled when the TPM becomes free */
+    TPM2_BROKER_CLIENT client[TPM2_BROKER_MAX_CLIENTS];
+    word64 vtime;           /* pass of the last dispatched command */
+    word32 tickets;
+    int owner;              /* client with handles in the TPM, -1 if none */
+    byte busy;              /* a command is running */
+} TPM2_BROKER;
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets up a broker that runs the raw commands of several clients on
+    one context. Each client has its own resource manager space, so its
+    transient objects get virtual handles and it cannot use the objects or
+    sessions of another client. When the TPM goes to another client, the
+    previous one is swapped out with TPM2_SpaceSwapOut and its objects and
+    sessions are loaded back with ContextLoad as its commands need them.
+    Waiting commands are dispatched by stride scheduling over the client
+    priorities: a client of priority p gets p/P of the commands while all
+    clients with a total priority of P have commands queued, and a queued
+    command waits for at most q/p + 1 commands of each other client of
+    priority q.
+    \note Only available with WOLFTPM_BROKER. The context must not be used
+    for other commands while the broker runs.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the lock could not be created
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param broker pointer to a TPM2_BROKER struct
+    \param ctx initialized context of the TPM to share
+
+    \sa TPM2_Broker_Open
+    \sa TPM2_Broker_Command
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_Init(TPM2_BROKER* broker, TPM2_CTX* ctx);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Closes all clients and releases the broker lock.
+    \note Only available with WOLFTPM_BROKER.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: broker is a NULL pointer
+
+    \param broker pointer to a TPM2_BROKER struct
+
+    \sa TPM2_Broker_Init
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_Cleanup(TPM2_BROKER* broker);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Adds a client with an empty space.
+    \note Only available with WOLFTPM_BROKER.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_MEMORY: all TPM2_BROKER_MAX_CLIENTS clients are open
+    \return BAD_FUNC_ARG: invalid arguments or priority out of range
+
+    \param broker pointer to a TPM2_BROKER struct
+    \param priority scheduling weight, 1 to TPM2_BROKER_MAX_PRIORITY
+    \param id receives the client id
+
+    \sa TPM2_Broker_Close
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_Open(TPM2_BROKER* broker, int priority,
+    int* id);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Flushes the objects and sessions of a client from the TPM and
+    removes the client. Waits for the command that is running.
+    \note Only available with WOLFTPM_BROKER. The client must not have a
+    command queued.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: invalid arguments
+    \return the code of a failed flush, the client is removed anyway
+
+    \param broker pointer to a TPM2_BROKER struct
+    \param id client id from TPM2_Broker_Open
+
+    \sa TPM2_Broker_Open
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_Close(TPM2_BROKER* broker, int id);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Queues a raw command of a client and blocks until its response is
+    in rsp. Only one command per client may be queued, clients call from
+    threads of their own.
+    \note Only available with WOLFTPM_BROKER.
+
+    \return TPM_RC_SUCCESS: the response is in rsp, its return code is not
+    parsed
+    \return BUFFER_E: rsp is too small, the response is dropped
+    \return BAD_FUNC_ARG: invalid arguments, a closed client or a command
+    already queued for it
+
+    \param broker pointer to a TPM2_BROKER struct
+    \param id client id from TPM2_Broker_Open
+    \param cmd marshalled TPM command including the header
+    \param cmdSz size of cmd in bytes, at most MAX_COMMAND_SIZE
+    \param rsp buffer for the response
+    \param rspSz on input the size of rsp, on output the response size
+
+    \sa TPM2_SpaceCommand
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_Command(TPM2_BROKER* broker, int id,
+    const byte* cmd, word32 cmdSz, byte* rsp, word32* rspSz);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Returns the queueing and swap counts of a client.
+    \note Only available with WOLFTPM_BROKER.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: invalid arguments or a closed client
+
+    \param broker pointer to a TPM2_BROKER struct
+    \param id client id from TPM2_Broker_Open
+    \param stats receives the counts since TPM2_Broker_Open
+
+    \sa TPM2_Broker_Command
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_GetStats(TPM2_BROKER* broker, int id,
+    TPM2_BROKER_STATS* stats);
+
+#ifdef L4API_l4f
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Serves the broker over L4 IPC and does not return on success. The
+    gate capName is a factory: each create call with the VTPM protocol and
+    the priority as argument opens a client and returns a vtpm gate of its
+    own, served by a thread of its own. Clients built with WOLFTPM_SWTPM use
+    such a gate as their "vtpm" capability.
+    \note Only available with WOLFTPM_BROKER on L4Re, see tpm2_broker_l4.cc.
+
+    \return TPM_RC_FAILURE: capName is not a valid server gate
+
+    \param broker initialized TPM2_BROKER struct
+    \param capName name of the factory gate capability
+
+    \sa TPM2_Broker_Init
+*/
+WOLFTPM_API TPM_RC TPM2_Broker_L4_Serve(TPM2_BROKER* broker,
+    const char* capName);
+#endif
+
+#endif /* WOLFTPM_BROKER */
+
+#ifdef __cplusplus
+    }  /* extern "C" */
+#endif
+
+#endif /* _TPM2_BROKER_H_ */
@@ -0,0 +1,339 @@
+/* tpm2_coro.h
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* C++20 coroutine front end. A Tpm2_loop drives any number of TPMs from one
+ * thread: a coroutine awaiting a TPM operation is suspended while the TPM
+ * executes and resumed by the loop once the response is parsed, e.g.
+ *
+ *   Tpm2_task<> attest(Tpm2_device &tpm, WOLFTPM2_KEY &aik, ...) {
+ *     TPM_RC rc = co_await tpm.quote(aik, sel, nonce, &quote);
+ *     ...
+ *   }
+ *   loop.spawn(attest(tpm0, aik0, ...));
+ *   loop.spawn(attest(tpm1, aik1, ...));
+ *   loop.run();
+ *
+ * Operations are queued per device in FIFO order and run with
+ * TPM2_SubmitCommand and TPM2_PollCommand, the next queued command is put on
+ * the TPM before the coroutine of the previous one is resumed. An awaited
+ * operation lives in the frame of its coroutine and frames come from a per
+ * thread pool, so no heap allocation happens once the pool is warm. Keyed
+ * operations authorize with the password of the key, HMAC and policy
+ * sessions are left to the synchronous wolfTPM2_* API. A loop, its devices
+ * and coroutines belong to one thread, the WOLFTPM2_DEV of a device must
+ * not be used otherwise meanwhile. */
+
+#ifndef _TPM2_CORO_H_
+#define _TPM2_CORO_H_
+
+#include <wolftpm/tpm2.h>
+#include <wolftpm/tpm2_wrap.h>
+
+#if defined(WOLFTPM_COROUTINES) && defined(__cplusplus)
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+struct TPM2_Packet;
+
+/* Allocation counts of the calling thread, see Tpm2_frame_pool */
+struct Tpm2_frame_stats {
+  word32 frames;    /* coroutine frames allocated */
+  word32 refills;   /* heap allocations of TPM2_CORO_POOL_FRAMES frames */
+  word32 oversized; /* frames above TPM2_CORO_FRAME_MAX, from the heap */
+};
+
+/* Coroutine frames in power of two size classes with a free list per class
+ * and thread. Freed frames are kept for reuse and never returned. */
+class Tpm2_frame_pool {
+public:
+  static void *alloc(std::size_t size);
+  static void release(void *frame, std::size_t size) noexcept;
+  static Tpm2_frame_stats stats() noexcept;
+};
+
+struct Tpm2_promise_base {
+  std::coroutine_handle<> continuation;
+  bool detached = false;
+
+  static void *operator new(std::size_t size) {
+    return Tpm2_frame_pool::alloc(size);
+  }
+  static void operator delete(void *frame, std::size_t size) noexcept {
+    Tpm2_frame_pool::release(frame, size);
+  }
+
+  /* resumes the awaiting coroutine, a spawned task frees itself */
+  struct Final_awaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> self) noexcept {
+      Tpm2_promise_base &p = self.promise();
+      if (p.continuation)
+        return p.continuation;
+      if (p.detached)
+        self.destroy();
+      return std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  Final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template <typename T> struct Tpm2_promise : Tpm2_promise_base {
+  T value{};
+  void return_value(T v) { value = v; }
+  T result() { return value; }
+};
+
+template <> struct Tpm2_promise<void> : Tpm2_promise_base {
+  void return_void() const noexcept {}
+  void result() const noexcept {}
+};
+
+/* Lazily started coroutine, runs when awaited or spawned on a Tpm2_loop */
+template <typename T = void> class Tpm2_task {
+public:
+  struct promise_type : Tpm2_promise<T> {
+    Tpm2_task get_return_object() {
+      return Tpm2_task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+  };
+
+  Tpm2_task(Tpm2_task &&other) noexcept : _h(other._h) { other._h = nullptr; }
+  Tpm2_task(const Tpm2_task &) = delete;
+  Tpm2_task &operator=(const Tpm2_task &) = delete;
+  ~Tpm2_task() {
+    if (_h)
+      _h.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<> caller) noexcept {
+    _h.promise().continuation = caller;
+    return _h;
+  }
+  T await_resume() { return _h.promise().result(); }
+
+  std::coroutine_handle<promise_type> release() noexcept {
+    std::coroutine_handle<promise_type> h = _h;
+    _h = nullptr;
+    return h;
+  }
+
+private:
+  explicit Tpm2_task(std::coroutine_handle<promise_type> h) : _h(h) {}
+  std::coroutine_handle<promise_type> _h;
+};
+
+class Tpm2_device;
+class Tpm2_loop;
+
+/* A TPM command awaited by a coroutine, co_await returns its TPM_RC */
+class Tpm2_op {
+public:
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> waiter);
+  TPM_RC await_resume() const noexcept { return _rc; }
+
+protected:
+  explicit Tpm2_op(Tpm2_device &dev) : _dev(dev) {}
+  ~Tpm2_op() = default;
+  /* appends the command to the packet initialized past the header */
+  virtual TPM_RC marshal(TPM2_Packet *packet) = 0;
+  /* parses the response, packet holds it from offset 0 */
+  virtual TPM_RC parse(TPM2_Packet *packet) = 0;
+
+private:
+  friend class Tpm2_device;
+  Tpm2_device &_dev;
+  Tpm2_op *_next = nullptr;
+  std::coroutine_handle<> _waiter;
+  TPM_RC _rc = TPM_RC_SUCCESS;
+};
+
+/* Marshalled command, *rspSz is the size of rsp and then of the response */
+class Tpm2_command_op : public Tpm2_op {
+public:
+  Tpm2_command_op(Tpm2_device &dev, const byte *cmd, word32 cmdSz, byte *rsp,
+                  word32 *rspSz)
+      : Tpm2_op(dev), _cmd(cmd), _cmdSz(cmdSz), _rsp(rsp), _rspSz(rspSz) {}
+
+private:
+  TPM_RC marshal(TPM2_Packet *packet) override;
+  TPM_RC parse(TPM2_Packet *packet) override;
+  const byte *_cmd;
+  word32 _cmdSz;
+  byte *_rsp;
+  word32 *_rspSz;
+};
+
+/* GetRandom of at most MAX_RNG_REQ_SIZE bytes */
+class Tpm2_get_random_op : public Tpm2_op {
+public:
+  Tpm2_get_random_op(Tpm2_device &dev, byte *buf, word32 len)
+      : Tpm2_op(dev), _buf(buf), _len(len) {}
+
+private:
+  TPM_RC marshal(TPM2_Packet *packet) override;
+  TPM_RC parse(TPM2_Packet *packet) override;
+  byte *_buf;
+  word32 _len;
+};
+
+class Tpm2_pcr_read_op : public Tpm2_op {
+public:
+  Tpm2_pcr_read_op(Tpm2_device &dev, const TPML_PCR_SELECTION &sel,
+                   PCR_Read_Out *out)
+      : Tpm2_op(dev), _sel(sel), _out(out) {}
+
+private:
+  TPM_RC marshal(TPM2_Packet *packet) override;
+  TPM_RC parse(TPM2_Packet *packet) override;
+  const TPML_PCR_SELECTION &_sel;
+  PCR_Read_Out *_out;
+};
+
+/* Quote with the default scheme of the key */
+class Tpm2_quote_op : public Tpm2_op {
+public:
+  Tpm2_quote_op(Tpm2_device &dev, const WOLFTPM2_KEY &key,
+                const TPML_PCR_SELECTION &sel, const TPM2B_DATA &nonce,
+                Quote_Out *out)
+      : Tpm2_op(dev), _key(key), _sel(sel), _nonce(nonce), _out(out) {}
+
+private:
+  TPM_RC marshal(TPM2_Packet *packet) override;
+  TPM_RC parse(TPM2_Packet *packet) override;
+  const WOLFTPM2_KEY &_key;
+  const TPML_PCR_SELECTION &_sel;
+  const TPM2B_DATA &_nonce;
+  Quote_Out *_out;
+};
+
+/* Sign of a digest with the default scheme of the key */
+class Tpm2_sign_op : public Tpm2_op {
+public:
+  Tpm2_sign_op(Tpm2_device &dev, const WOLFTPM2_KEY &key, const byte *digest,
+               int digestSz, TPMT_SIGNATURE *sig)
+      : Tpm2_op(dev), _key(key), _digest(digest), _digestSz(digestSz),
+        _sig(sig) {}
+
+private:
+  TPM_RC marshal(TPM2_Packet *packet) override;
+  TPM_RC parse(TPM2_Packet *packet) override;
+  const WOLFTPM2_KEY &_key;
+  const byte *_digest;
+  int _digestSz;
+  TPMT_SIGNATURE *_sig;
+};
+
+/* Operation counts of a loop, see Tpm2_loop::stats */
+struct Tpm2_loop_stats {
+  word32 cmds;   /* commands completed */
+  word32 queued; /* commands that waited for their TPM to become free */
+  word32 polls;  /* TPM2_PollCommand calls */
+  word32 sleeps; /* passes without a completion */
+};
+
+/* One TPM driven by a loop. Commands of a device run one at a time. */
+class Tpm2_device {
+public:
+  Tpm2_device(Tpm2_loop &loop, WOLFTPM2_DEV *dev);
+  ~Tpm2_device();
+  Tpm2_device(const Tpm2_device &) = delete;
+  Tpm2_device &operator=(const Tpm2_device &) = delete;
+
+  Tpm2_command_op command(const byte *cmd, word32 cmdSz, byte *rsp,
+                          word32 *rspSz) {
+    return Tpm2_command_op(*this, cmd, cmdSz, rsp, rspSz);
+  }
+  Tpm2_get_random_op get_random(byte *buf, word32 len) {
+    return Tpm2_get_random_op(*this, buf, len);
+  }
+  Tpm2_pcr_read_op pcr_read(const TPML_PCR_SELECTION &sel,
+                            PCR_Read_Out *out) {
+    return Tpm2_pcr_read_op(*this, sel, out);
+  }
+  Tpm2_quote_op quote(const WOLFTPM2_KEY &key, const TPML_PCR_SELECTION &sel,
+                      const TPM2B_DATA &nonce, Quote_Out *out) {
+    return Tpm2_quote_op(*this, key, sel, nonce, out);
+  }
+  Tpm2_sign_op sign(const WOLFTPM2_KEY &key, const byte *digest, int digestSz,
+                    TPMT_SIGNATURE *sig) {
+    return Tpm2_sign_op(*this, key, digest, digestSz, sig);
+  }
+
+private:
+  friend class Tpm2_op;
+  friend class Tpm2_loop;
+  bool submit(Tpm2_op *op);
+  bool issue(Tpm2_op *op);
+  void start_next();
+  int poll();
+
+  Tpm2_loop &_loop;
+  WOLFTPM2_DEV *_dev;
+  Tpm2_device *_next;
+  Tpm2_op *_head = nullptr; /* queued, not yet on the TPM */
+  Tpm2_op *_tail = nullptr;
+  Tpm2_op *_active = nullptr;
+  /* the command is marshalled and the response parsed here */
+  byte _buf[MAX_COMMAND_SIZE > MAX_RESPONSE_SIZE ? MAX_COMMAND_SIZE
+                                                 : MAX_RESPONSE_SIZE];
+};
+
+/* Polls the devices attached to it and resumes the waiting coroutines */
+class Tpm2_loop {
+public:
+  Tpm2_loop() = default;
+  Tpm2_loop(const Tpm2_loop &) = delete;
+  Tpm2_loop &operator=(const Tpm2_loop &) = delete;
+
+  /* Runs the task up to its first TPM operation, it frees itself when done */
+  void spawn(Tpm2_task<void> task) {
+    std::coroutine_handle<Tpm2_task<void>::promise_type> h = task.release();
+    h.promise().detached = true;
+    h.resume();
+  }
+  /* Polls every device with a command on the TPM once, returns the number
+   * of completed commands */
+  int run_once();
+  /* Runs until no operation is queued or executing */
+  void run();
+  word32 pending() const { return _pending; }
+  Tpm2_loop_stats stats() const { return _stats; }
+
+private:
+  friend class Tpm2_device;
+  Tpm2_device *_devs = nullptr;
+  word32 _pending = 0; /* awaited operations */
+  Tpm2_loop_stats _stats = {};
+};
+
+#endif /* WOLFTPM_COROUTINES && __cplusplus */
+
+#endif /* _TPM2_CORO_H_ */
@@ -0,0 +1,48 @@
+/* tpm2_drbg.h
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef _TPM2_DRBG_H_
+#define _TPM2_DRBG_H_
+
+#include <wolftpm/tpm2.h>
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#ifdef WOLFTPM_HOST_DRBG
+
+WOLFTPM_LOCAL void TPM2_Drbg_Init(TPM2_DRBG* drbg);
+WOLFTPM_LOCAL void TPM2_Drbg_Free(TPM2_DRBG* drbg);
+/* 1 if a seed has to be taken before the next request */
+WOLFTPM_LOCAL int TPM2_Drbg_NeedSeed(const TPM2_DRBG* drbg);
+WOLFTPM_LOCAL void TPM2_Drbg_Seed(TPM2_DRBG* drbg, const byte* seed,
+    word32 seedSz);
+WOLFTPM_LOCAL void TPM2_Drbg_Generate(TPM2_DRBG* drbg, byte* out,
+    word32 outSz);
+
+#endif /* WOLFTPM_HOST_DRBG */
+
+#ifdef __cplusplus
+    }  /* extern "C" */
+#endif
+
+#endif /* _TPM2_DRBG_H_ */
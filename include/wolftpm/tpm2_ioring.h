@@ -0,0 +1,173 @@
+/* tpm2_ioring.h
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef _TPM2_IORING_H_
+#define _TPM2_IORING_H_
+
+#include <wolftpm/tpm2.h>
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#ifdef WOLFTPM_IO_RING
+
+/* A prepared command and its future, see TPM2_IoRing_Submit */
+typedef struct TPM2_IO_REQ {
+    const byte* cmd;    /* marshalled command including the header */
+    word32 cmdSz;
+    byte* rsp;          /* response buffer */
+    word32 rspSz;       /* size of rsp, the response size once done */
+    TPM_RC rc;          /* result once done */
+    sem_t done;         /* posted by the IO thread on completion */
+} TPM2_IO_REQ;
+
+typedef struct TPM2_IO_RING_SLOT {
+    word32 seq;         /* ring position the slot is ready for */
+    TPM2_IO_REQ* req;
+} TPM2_IO_RING_SLOT;
+
+/* Counts of the IO thread, read them after TPM2_IoRing_Stop */
+typedef struct TPM2_IO_RING_STATS {
+    word32 cmds;        /* commands run */
+    word32 chained;     /* submitted before the previous caller was woken */
+    word32 sleeps;      /* times the IO thread found the ring empty */
+} TPM2_IO_RING_STATS;
+
+typedef struct TPM2_IO_RING {
+    TPM2_IO_RING_SLOT slot[TPM2_IO_RING_SIZE];
+    /* producers claim positions here */
+    word32 tail;
+    byte pad0[TPM2_CACHE_LINE_SZ - sizeof(word32)];
+    /* consumed by the IO thread only */
+    word32 head;
+    int sleeping;       /* the IO thread waits on wake */
+    byte pad1[TPM2_CACHE_LINE_SZ - sizeof(word32) - sizeof(int)];
+    sem_t wake;
+    TPM2_CTX* ctx;
+    pthread_t thread;
+    int stop;
+    TPM2_IO_RING_STATS stats;
+} TPM2_IO_RING;
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Starts a thread that owns the transport of ctx and runs the
+    commands queued with TPM2_IoRing_Submit. Submitting threads do not take
+    a lock, they claim a slot of a bounded ring with a compare and swap and
+    sleep on the future of their request. The IO thread puts the next queued
+    command on the device before it wakes the caller of the previous one.
+    \note Only available with WOLFTPM_IO_RING. While the ring runs, ctx must
+    not be used for other commands.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the thread or its semaphore could not be created
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ring pointer to a TPM2_IO_RING struct
+    \param ctx initialized context of the TPM
+    \param cpu CPU the IO thread is pinned to, -1 to leave it unpinned
+
+    \sa TPM2_IoRing_Submit
+    \sa TPM2_IoRing_Stop
+*/
+WOLFTPM_API TPM_RC TPM2_IoRing_Start(TPM2_IO_RING* ring, TPM2_CTX* ctx,
+    int cpu);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Runs the commands still queued and stops the IO thread.
+    \note Only available with WOLFTPM_IO_RING. No submissions may follow.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: ring is a NULL pointer
+
+    \param ring pointer to a started TPM2_IO_RING struct
+
+    \sa TPM2_IoRing_Start
+*/
+WOLFTPM_API TPM_RC TPM2_IoRing_Stop(TPM2_IO_RING* ring);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Sets up the future of a request, once per request struct.
+    \note Only available with WOLFTPM_IO_RING.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: the semaphore could not be created
+    \return BAD_FUNC_ARG: req is a NULL pointer
+
+    \param req pointer to a TPM2_IO_REQ struct
+
+    \sa TPM2_IoReq_Free
+*/
+WOLFTPM_API TPM_RC TPM2_IoReq_Init(TPM2_IO_REQ* req);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Releases the future of a request that is not queued.
+    \note Only available with WOLFTPM_IO_RING.
+
+    \param req pointer to a TPM2_IO_REQ struct
+
+    \sa TPM2_IoReq_Init
+*/
+WOLFTPM_API void TPM2_IoReq_Free(TPM2_IO_REQ* req);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Queues a prepared command. Set cmd, cmdSz, rsp and rspSz of req
+    before, the request belongs to the IO thread until TPM2_IoRing_Wait
+    returns. Only yields while all TPM2_IO_RING_SIZE slots are taken.
+    \note Only available with WOLFTPM_IO_RING.
+
+    \return TPM_RC_SUCCESS: queued
+    \return BAD_FUNC_ARG: invalid arguments
+
+    \param ring pointer to a started TPM2_IO_RING struct
+    \param req request set up with TPM2_IoReq_Init
+
+    \sa TPM2_IoRing_Wait
+*/
+WOLFTPM_API TPM_RC TPM2_IoRing_Submit(TPM2_IO_RING* ring, TPM2_IO_REQ* req);
+
+/*!
+    \ingroup TPM2_Proprietary
+    \brief Waits for a queued request to complete.
+    \note Only available with WOLFTPM_IO_RING.
+
+    \return the result of the command as TPM2_WaitCommand returns it, the
+    response is in req->rsp with req->rspSz bytes
+    \return BAD_FUNC_ARG: req is a NULL pointer
+
+    \param req request queued with TPM2_IoRing_Submit
+
+    \sa TPM2_IoRing_Submit
+*/
+WOLFTPM_API TPM_RC TPM2_IoRing_Wait(TPM2_IO_REQ* req);
+
+#endif /* WOLFTPM_IO_RING */
+
+#ifdef __cplusplus
+    }  /* extern "C" */
+#endif
+
+#endif /* _TPM2_IORING_H_ */
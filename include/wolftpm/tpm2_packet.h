@@ -104,6 +104,25 @@ WOLFTPM_LOCAL void TPM2_Packet_ParseAttest(TPM2_Packet* packet, TPMS_ATTEST* out
 WOLFTPM_LOCAL TPM_RC TPM2_Packet_Parse(TPM_RC rc, TPM2_Packet* packet);
 WOLFTPM_LOCAL int TPM2_Packet_Finalize(TPM2_Packet* packet, TPM_ST tag, TPM_CC cc);
 
+#if defined(WOLFTPM_RESOURCE_MGR) || defined(WOLFTPM_BROKER)
+/* TPM2_CMD_HANDLES flags */
+#define TPM2_CMD_OUT_OBJECT  0x01   /* returns a transient object handle */
+#define TPM2_CMD_OUT_SEQ     0x02   /* the returned object is a sequence */
+#define TPM2_CMD_OUT_SESSION 0x04   /* returns a session handle */
+#define TPM2_CMD_END_SEQ     0x08   /* the TPM flushes the completed sequence */
+#define TPM2_CMD_FLUSH       0x10   /* flushHandle is at the handle position */
+
+/* Handle area of a command, for translating handles in marshalled commands */
+typedef struct TPM2_CMD_HANDLES {
+    TPM_CC cc;
+    byte inHandleCnt;
+    byte flags;
+} TPM2_CMD_HANDLES;
+
+/* Returns NULL for commands not defined in TPM 2.0 part 3 */
+WOLFTPM_LOCAL const TPM2_CMD_HANDLES* TPM2_GetCmdHandles(TPM_CC cc);
+#endif
+
 #ifdef __cplusplus
     }  /* extern "C" */
 #endif
@@ -39,11 +39,22 @@ WOLFTPM_LOCAL int TPM2_CalcHmac(TPMI_ALG_HASH authHash, TPM2B_AUTH* auth,
     const TPM2B_DIGEST* hash, const TPM2B_NONCE* nonceNew,
     const TPM2B_NONCE* nonceOld, TPMA_SESSION sessionAttributes,
     TPM2B_AUTH* hmac);
+WOLFTPM_LOCAL int TPM2_CalcSessionHmac(TPM2_AUTH_SESSION* session,
+    const TPM2B_DIGEST* hash, const TPM2B_NONCE* nonceNew,
+    const TPM2B_NONCE* nonceOld, TPMA_SESSION sessionAttributes,
+    TPM2B_AUTH* hmac);
 WOLFTPM_LOCAL int TPM2_CalcRpHash(TPMI_ALG_HASH authHash,
     TPM_CC cmdCode, BYTE* param, UINT32 paramSz, TPM2B_DIGEST* hash);
 WOLFTPM_LOCAL int TPM2_CalcCpHash(TPMI_ALG_HASH authHash, TPM_CC cmdCode,
     TPM2B_NAME* name1, TPM2B_NAME* name2, TPM2B_NAME* name3,
     BYTE* param, UINT32 paramSz, TPM2B_DIGEST* hash);
+/* cpHash straight over the command. names has handleCnt entries, NULL for a
+ * handle that is its own name, hashed from the handle area at handles. */
+WOLFTPM_LOCAL int TPM2_CalcCpHash_ex(TPMI_ALG_HASH authHash, TPM_CC cmdCode,
+    const BYTE* handles, const TPM2B_NAME* const* names, int handleCnt,
+    const BYTE* param, UINT32 paramSz, TPM2B_DIGEST* hash);
+/* Frees and zeroes the session cache, a no-op without WOLFTPM_SESSION_CACHE */
+WOLFTPM_LOCAL void TPM2_SessionCache_Free(TPM2_AUTH_SESSION* session);
 
 /* Perform encryption over the first parameter of a TPM packet */
 WOLFTPM_LOCAL TPM_RC TPM2_ParamEnc_CmdRequest(TPM2_AUTH_SESSION *session,
@@ -42,8 +42,28 @@
 #define TPM_STOP                    21
 #endif
 
-/* TPM2 IO for using TPM through a Socket connection */
+/* TPM_SEND_COMMAND message header: command, locality and command size */
+#define TPM2_SWTPM_CMD_HDR_SZ       9
+
+/* Unix domain socket of the TPM simulator, for example
+ * swtpm socket --tpm2 --server type=unixio,path=/tmp/swtpm.sock */
+#ifndef TPM2_SWTPM_SOCKET
+#define TPM2_SWTPM_SOCKET           "/tmp/swtpm.sock"
+#endif
+
+/* TPM2 IO for using TPM through a Socket connection, on L4 through the vtpm
+ * server. The connection is kept until TPM2_Cleanup. */
 WOLFTPM_LOCAL int TPM2_SWTPM_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet);
+WOLFTPM_LOCAL void TPM2_SWTPM_Cleanup(TPM2_CTX* ctx);
+
+#if defined(WOLFTPM_SWTPM) && defined(L4API_l4f)
+/* vtpm IPC transport, see tpm2_swtpm_l4.cc */
+WOLFTPM_LOCAL int TPM2_SWTPM_L4_Connect(struct wolfTPM_tcpContext* tcpCtx);
+WOLFTPM_LOCAL int TPM2_SWTPM_L4_Transmit(struct wolfTPM_tcpContext* tcpCtx,
+    const byte* hdr, word32 hdrSz, const byte* cmd, word32 cmdSz);
+WOLFTPM_LOCAL void TPM2_SWTPM_L4_Disconnect(
+    struct wolfTPM_tcpContext* tcpCtx);
+#endif
 
 #ifdef __cplusplus
     }  /* extern "C" */
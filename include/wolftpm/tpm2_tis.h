@@ -41,18 +41,63 @@
 
 #define TPM_TIS_READY_MASK 0x01
 
+/* Maximum number of register transactions batched into one IO call */
+#ifndef TPM_TIS_MAX_XFER_VEC
+#define TPM_TIS_MAX_XFER_VEC 4
+#endif
+
+/* One register transaction of a batch */
+typedef struct TPM2_TIS_XFER {
+    word32 addr;
+    byte*  buf;
+    word16 len;
+    byte   isRead;
+} TPM2_TIS_XFER;
 
 WOLFTPM_LOCAL int TPM2_TIS_GetBurstCount(TPM2_CTX* ctx, word16* burstCount);
 WOLFTPM_LOCAL int TPM2_TIS_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet);
+/* TPM2_TIS_SendCommand split at the start of execution, see
+ * TPM2_SubmitCommand */
+WOLFTPM_LOCAL int TPM2_TIS_SubmitCommand(TPM2_CTX* ctx, TPM2_Packet* packet);
+WOLFTPM_LOCAL int TPM2_TIS_PollCommand(TPM2_CTX* ctx, TPM2_Packet* packet,
+    int wait);
+WOLFTPM_LOCAL void TPM2_TIS_AbortCommand(TPM2_CTX* ctx);
+/* Runs a complete command through the local TIS layer, used by a server that
+ * owns the TPM on behalf of TPM2_TIS_OffloadCommand clients */
+WOLFTPM_API int TPM2_TIS_ServeCommand(TPM2_CTX* ctx, const byte* cmd,
+    word32 cmdSz, byte* rsp, word32* rspSz);
+#ifdef WOLFTPM_TIS_OFFLOAD
+WOLFTPM_LOCAL int TPM2_TIS_OffloadCommand(TPM2_CTX* ctx, TPM2_Packet* packet);
+#endif
 WOLFTPM_LOCAL int TPM2_TIS_Ready(TPM2_CTX* ctx);
 WOLFTPM_LOCAL int TPM2_TIS_WaitForStatus(TPM2_CTX* ctx, byte status, byte status_mask);
 WOLFTPM_LOCAL int TPM2_TIS_Status(TPM2_CTX* ctx, byte* status);
 WOLFTPM_LOCAL int TPM2_TIS_GetInfo(TPM2_CTX* ctx);
+WOLFTPM_LOCAL int TPM2_TIS_SetMaxFrame(TPM2_CTX* ctx, word16 maxFrame);
+#ifdef WOLFTPM_TIS_LOCK
+WOLFTPM_LOCAL void TPM2_TIS_LockFree(TPM2_CTX* ctx);
+#endif
 WOLFTPM_LOCAL int TPM2_TIS_RequestLocality(TPM2_CTX* ctx, int timeout);
+WOLFTPM_LOCAL int TPM2_TIS_EnableIrq(TPM2_CTX* ctx, int enable);
+
+#ifdef WOLFTPM_ADAPTIVE_POLL
+/* Learned command execution time, see TPM2_TIS_GetCmdTimes */
+typedef struct TPM2_TIS_CMD_TIME {
+    TPM_CC cc;
+    word32 expectUs;    /* median of the observed times or the default */
+    word32 samples;     /* number of completions observed */
+} TPM2_TIS_CMD_TIME;
+
+/* Fills times with every command that has an expected execution time on
+ * ctx, returns the number of entries */
+WOLFTPM_API int TPM2_TIS_GetCmdTimes(TPM2_CTX* ctx, TPM2_TIS_CMD_TIME* times,
+    int maxCount);
+#endif
 WOLFTPM_LOCAL int TPM2_TIS_CheckLocality(TPM2_CTX* ctx, int locality, byte* access);
 WOLFTPM_LOCAL int TPM2_TIS_StartupWait(TPM2_CTX* ctx, int timeout);
 WOLFTPM_LOCAL int TPM2_TIS_Write(TPM2_CTX* ctx, word32 addr, const byte* value, word32 len);
 WOLFTPM_LOCAL int TPM2_TIS_Read(TPM2_CTX* ctx, word32 addr, byte* result, word32 len);
+WOLFTPM_LOCAL int TPM2_TIS_ReadWriteVec(TPM2_CTX* ctx, TPM2_TIS_XFER* xfer, int count);
 
 #ifdef __cplusplus
     }  /* extern "C" */
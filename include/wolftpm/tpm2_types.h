@@ -125,6 +125,7 @@ typedef int64_t  INT64;
     #define NOT_COMPILED_IN       -174  /* Feature not compiled in */
     #define BAD_MUTEX_E           -106  /* Bad mutex operation */
     #define WC_TIMEOUT_E          -107  /* timeout error */
+    #define WC_PENDING_E          -108  /* operation pending, call again */
 
     /* Errors from wolfssl/error-ssl.h */
     #define SOCKET_ERROR_E        -308  /* error state on socket    */
@@ -303,6 +304,11 @@ typedef int64_t  INT64;
     #endif
 #endif
 
+/* Longest single wait for a TIS interrupt before polling again */
+#ifndef TPM_IRQ_TIMEOUT_MS
+#define TPM_IRQ_TIMEOUT_MS 2000
+#endif
+
 #ifndef TPM_SPI_WAIT_RETRY
 #define TPM_SPI_WAIT_RETRY 50
 #endif
@@ -360,6 +366,229 @@ typedef int64_t  INT64;
     #define XTPM_WAIT() /* just poll without delay by default */
 #endif
 
+/* Adaptive wait scheduler for command completion, see tpm2_tis.c */
+#ifdef WOLFTPM_ADAPTIVE_POLL
+    #ifndef XTPM_SLEEP_US
+        #include <unistd.h>
+        #define XTPM_SLEEP_US(us) usleep(us)
+    #endif
+    /* share of the expected execution time slept before polling */
+    #ifndef TPM_TIS_SLEEP_PCT
+        #define TPM_TIS_SLEEP_PCT 75
+    #endif
+    /* first and largest delay between status reads */
+    #ifndef TPM_TIS_POLL_MIN_US
+        #define TPM_TIS_POLL_MIN_US 10
+    #endif
+    #ifndef TPM_TIS_POLL_MAX_US
+        #define TPM_TIS_POLL_MAX_US 1000
+    #endif
+    /* completion times kept per command for the median */
+    #ifndef TPM_TIS_TIME_SAMPLES
+        #define TPM_TIS_TIME_SAMPLES 9
+    #endif
+    /* longest wait for a response, TIMEOUT_B of the TIS specification, and
+     * for CreatePrimary, Create and CreateLoaded, which may generate keys */
+    #ifndef TPM_TIS_EXEC_TIMEOUT_MS
+        #define TPM_TIS_EXEC_TIMEOUT_MS 2000
+    #endif
+    #ifndef TPM_TIS_KEYGEN_TIMEOUT_MS
+        #define TPM_TIS_KEYGEN_TIMEOUT_MS 300000
+    #endif
+#endif
+
+/* Pipelined command preparation, see TPM2_SetPipeline */
+#ifdef WOLFTPM_PIPELINE
+    /* the hwLock is a pthread mutex with a condition variable */
+    #include <pthread.h>
+    /* commands prepared or in flight per context */
+    #ifndef TPM2_PIPE_DEPTH
+        #define TPM2_PIPE_DEPTH 3
+    #endif
+#endif
+
+/* Command priority classes, see TPM2_SetCmdPriority */
+#ifdef WOLFTPM_CMD_PRIORITY
+    #ifdef WOLFTPM_PIPELINE
+        #error WOLFTPM_CMD_PRIORITY does not support WOLFTPM_PIPELINE
+    #endif
+    /* the hwLock is handed out by class from a pthread condition variable */
+    #include <pthread.h>
+#endif
+
+/* Resubmission of commands the TPM asks to retry, see TPM2_GetRetryStats */
+#ifdef WOLFTPM_AUTO_RETRY
+    #ifndef XTPM_SLEEP_US
+        #include <unistd.h>
+        #define XTPM_SLEEP_US(us) usleep(us)
+    #endif
+    /* resubmissions of one command at most */
+    #ifndef TPM2_RETRY_MAX
+        #define TPM2_RETRY_MAX 8
+    #endif
+    /* backoff before the first resubmission, doubled for each further one */
+    #ifndef TPM2_RETRY_BASE_US
+        #define TPM2_RETRY_BASE_US 500
+    #endif
+    #ifndef TPM2_RETRY_MAX_US
+        #define TPM2_RETRY_MAX_US 50000
+    #endif
+#endif
+
+/* Session HMAC pads and AES object kept in TPM2_AUTH_SESSION, see
+ * TPM2_CalcSessionHmac */
+#ifdef WOLFTPM_SESSION_CACHE
+    #ifdef WOLFTPM2_NO_WOLFCRYPT
+        #error WOLFTPM_SESSION_CACHE requires wolfCrypt
+    #endif
+#endif
+#if !defined(WOLFTPM2_NO_WOLFCRYPT) && defined(WOLFSSL_SMALL_STACK_CACHE)
+    /* the pads are copied as plain structs, which this option does not allow */
+    #error WOLFSSL_SMALL_STACK_CACHE is not supported
+#endif
+
+/* Names of loaded objects kept in TPM2_CTX for the cpHash */
+#ifdef WOLFTPM_NAME_CACHE
+    #ifdef WOLFTPM2_NO_WOLFCRYPT
+        #error WOLFTPM_NAME_CACHE requires wolfCrypt
+    #endif
+    #ifndef TPM2_NAME_CACHE_SZ
+        #define TPM2_NAME_CACHE_SZ 8
+    #endif
+#endif
+
+/* Host DRBG seeded from TPM2_GetRandom for the nonces, see
+ * TPM2_GetDrbgStats */
+#ifdef WOLFTPM_HOST_DRBG
+    #ifdef WOLFTPM2_USE_WOLF_RNG
+        #error WOLFTPM_HOST_DRBG replaces WOLFTPM2_USE_WOLF_RNG
+    #endif
+    /* TPM entropy folded into the key per seed, one TPM2_GetRandom on TPMs
+     * answering MAX_RNG_REQ_SIZE bytes */
+    #ifndef TPM2_DRBG_SEED_SZ
+        #define TPM2_DRBG_SEED_SZ 32
+    #endif
+    /* output generated per key, a multiple of the 64 byte ChaCha20 block */
+    #ifndef TPM2_DRBG_BUF_SZ
+        #define TPM2_DRBG_BUF_SZ 512
+    #endif
+    /* default reseed schedule, 0 disables a limit, see TPM2_SetDrbgReseed */
+    #ifndef TPM2_DRBG_RESEED_BYTES
+        #define TPM2_DRBG_RESEED_BYTES 4096
+    #endif
+    #ifndef TPM2_DRBG_RESEED_REQS
+        #define TPM2_DRBG_RESEED_REQS 128
+    #endif
+#endif
+
+/* Pre-started authorization sessions, see wolfTPM2_SessionPool_Init */
+#ifdef WOLFTPM_SESSION_POOL
+    /* session kinds a pool keeps, see wolfTPM2_SessionPool_AddProfile */
+    #ifndef TPM2_SESSION_POOL_PROFILES
+        #define TPM2_SESSION_POOL_PROFILES 4
+    #endif
+    /* ready sessions per profile at most */
+    #ifndef TPM2_SESSION_POOL_DEPTH
+        #define TPM2_SESSION_POOL_DEPTH 4
+    #endif
+#endif
+
+/* Submission ring with a TPM IO thread, see TPM2_IoRing_Start */
+#ifdef WOLFTPM_IO_RING
+    #include <pthread.h>
+    #include <semaphore.h>
+    /* commands queued at most, a power of two */
+    #ifndef TPM2_IO_RING_SIZE
+        #define TPM2_IO_RING_SIZE 64
+    #endif
+    /* keeps the producer and consumer indices on cache lines of their own */
+    #ifndef TPM2_CACHE_LINE_SZ
+        #define TPM2_CACHE_LINE_SZ 64
+    #endif
+    /* scheduling priority of the pinned IO thread on L4 */
+    #ifndef TPM2_IO_RING_L4_PRIO
+        #define TPM2_IO_RING_L4_PRIO 2
+    #endif
+#endif
+
+/* C++20 coroutine front end, see tpm2_coro.h */
+#ifdef WOLFTPM_COROUTINES
+    #ifndef XTPM_SLEEP_US
+        #include <unistd.h>
+        #define XTPM_SLEEP_US(us) usleep(us)
+    #endif
+    /* frames are pooled in power of two classes up to this size, larger
+     * frames come from the heap on every call */
+    #ifndef TPM2_CORO_FRAME_MAX
+        #define TPM2_CORO_FRAME_MAX 8192
+    #endif
+    /* frames of a class taken from the heap at once */
+    #ifndef TPM2_CORO_POOL_FRAMES
+        #define TPM2_CORO_POOL_FRAMES 16
+    #endif
+    /* sleep of the event loop when no TPM completed a command */
+    #ifndef TPM2_CORO_POLL_US
+        #define TPM2_CORO_POLL_US 50
+    #endif
+#endif
+
+/* Multi-client broker on top of the resource manager, see TPM2_Broker_Init */
+#ifdef WOLFTPM_BROKER
+    #ifndef WOLFTPM_RESOURCE_MGR
+        #define WOLFTPM_RESOURCE_MGR
+    #endif
+    /* the broker queue is a pthread mutex with a condition variable */
+    #include <pthread.h>
+    #ifndef TPM2_BROKER_MAX_CLIENTS
+        #define TPM2_BROKER_MAX_CLIENTS 8
+    #endif
+    #ifndef TPM2_BROKER_MAX_PRIORITY
+        #define TPM2_BROKER_MAX_PRIORITY 16
+    #endif
+    /* pass advance of a command at priority 1 */
+    #ifndef TPM2_BROKER_STRIDE
+        #define TPM2_BROKER_STRIDE 0x10000
+    #endif
+#endif
+
+/* Transient object virtualization, see TPM2_SetResourceMgr */
+#ifdef WOLFTPM_RESOURCE_MGR
+    #ifdef WOLFTPM_PIPELINE
+        #error WOLFTPM_RESOURCE_MGR does not support WOLFTPM_PIPELINE
+    #endif
+    /* objects tracked per context, loaded or saved */
+    #ifndef TPM2_RM_MAX_OBJECTS
+        #define TPM2_RM_MAX_OBJECTS 8
+    #endif
+    /* transient slots of the TPM used by the context */
+    #ifndef TPM2_RM_MAX_LOADED
+        #define TPM2_RM_MAX_LOADED MAX_LOADED_OBJECTS
+    #endif
+    /* sessions tracked per space */
+    #ifndef TPM2_RM_MAX_SESSIONS
+        #define TPM2_RM_MAX_SESSIONS MAX_SESSION_NUM
+    #endif
+    /* virtual handles start here, above the handles a TPM hands out */
+    #ifndef TPM2_RM_HANDLE_FIRST
+        #define TPM2_RM_HANDLE_FIRST 0x80FF0000
+    #endif
+#endif
+
+/* In place TIS framing, the command buffer reserves room for the SPI header
+ * in front of the packet and for a status frame behind it, see tpm2_tis.c */
+#if defined(WOLFTPM_TIS_ZERO_COPY) && (defined(WOLFTPM_ADV_IO) || \
+    defined(WOLFTPM_I2C) || defined(WOLFTPM_LINUX_DEV) || defined(WOLFTPM_SWTPM) || \
+    defined(WOLFTPM_WINAPI))
+    #undef WOLFTPM_TIS_ZERO_COPY
+#endif
+#ifdef WOLFTPM_TIS_ZERO_COPY
+    #define TPM2_PACKET_HEADROOM 4
+    #define TPM2_PACKET_TAILROOM 8
+#else
+    #define TPM2_PACKET_HEADROOM 0
+    #define TPM2_PACKET_TAILROOM 0
+#endif
+
 #ifndef BUFFER_ALIGNMENT
 #define BUFFER_ALIGNMENT 4
 #endif
@@ -108,6 +108,37 @@ typedef struct WOLFTPM2_CAPS {
     word16 req_wait_state : 1; /* requires SPI wait state */
 } WOLFTPM2_CAPS;
 
+#ifdef WOLFTPM_SESSION_POOL
+/* Counts of a session pool, see wolfTPM2_SessionPool_GetStats */
+typedef struct WOLFTPM2_SESSION_POOL_STATS {
+    word32 hits;        /* requests served with a ready session */
+    word32 misses;      /* requests that started their session */
+    word32 started;     /* sessions started by wolfTPM2_SessionPool_Refill */
+    word32 saved;       /* sessions written by wolfTPM2_SessionPool_Save */
+    word32 restored;    /* sessions loaded by wolfTPM2_SessionPool_Restore */
+    word32 dropped;     /* saved sessions the TPM or the profiles refused */
+} WOLFTPM2_SESSION_POOL_STATS;
+
+/* Sessions of one (salt key, bind, type, symmetric algorithm) kind */
+typedef struct WOLFTPM2_SESSION_PROFILE {
+    WOLFTPM2_KEY* tpmKey;       /* salt key or NULL, kept by the caller */
+    WOLFTPM2_HANDLE* bind;      /* bind entity or NULL, kept by the caller */
+    TPM_SE sesType;
+    int encDecAlg;
+    int depth;                  /* ready sessions wolfTPM2_SessionPool_Refill
+                                 * keeps */
+    int count;                  /* ready sessions */
+    WOLFTPM2_SESSION ready[TPM2_SESSION_POOL_DEPTH];
+} WOLFTPM2_SESSION_PROFILE;
+
+typedef struct WOLFTPM2_SESSION_POOL {
+    WOLFTPM2_DEV* dev;
+    WOLFTPM2_SESSION_PROFILE profile[TPM2_SESSION_POOL_PROFILES];
+    int profileCount;
+    WOLFTPM2_SESSION_POOL_STATS stats;
+} WOLFTPM2_SESSION_POOL;
+#endif
+
 /* NV Handles */
 #define TPM2_NV_RSA_EK_CERT 0x01C00002
 #define TPM2_NV_ECC_EK_CERT 0x01C0000A
@@ -474,6 +505,162 @@ WOLFTPM_API int wolfTPM2_StartSession(WOLFTPM2_DEV* dev,
     WOLFTPM2_SESSION* session, WOLFTPM2_KEY* tpmKey,
     WOLFTPM2_HANDLE* bind, TPM_SE sesType, int encDecAlg);
 
+#ifdef WOLFTPM_SESSION_POOL
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Initializes an empty pool of pre-started sessions on dev. Add the
+    session kinds with wolfTPM2_SessionPool_AddProfile, start their sessions
+    with wolfTPM2_SessionPool_Refill while the TPM is idle and take them
+    with wolfTPM2_SessionPool_Get, so a request only pays for the
+    StartAuthSession, salt encryption and KDFa of wolfTPM2_StartSession on a
+    miss.
+    \note Only available with WOLFTPM_SESSION_POOL. The pool is not locked,
+    use it from one thread or serialize the calls.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param dev pointer to a TPM2_DEV struct
+    \param pool pointer to a WOLFTPM2_SESSION_POOL struct
+
+    \sa wolfTPM2_SessionPool_Cleanup
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Init(WOLFTPM2_DEV* dev,
+    WOLFTPM2_SESSION_POOL* pool);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Adds a session kind to the pool, with the arguments of
+    wolfTPM2_StartSession. The pool keeps the tpmKey and bind pointers, they
+    have to stay valid as long as the pool is used.
+
+    \return the profile index for wolfTPM2_SessionPool_Get
+    \return BUFFER_E: TPM2_SESSION_POOL_PROFILES profiles are in use
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+    \param tpmKey key the salt is encrypted to or NULL for no salt
+    \param bind entity the sessions are bound to or NULL
+    \param sesType byte value, the session type (HMAC, Policy or Trial)
+    \param encDecAlg TPM_ALG_CFB, TPM_ALG_XOR or TPM_ALG_NULL
+    \param depth ready sessions to keep, at most TPM2_SESSION_POOL_DEPTH
+
+    \sa wolfTPM2_SessionPool_Refill
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_AddProfile(WOLFTPM2_SESSION_POOL* pool,
+    WOLFTPM2_KEY* tpmKey, WOLFTPM2_HANDLE* bind, TPM_SE sesType,
+    int encDecAlg, int depth);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Starts sessions until every profile has its depth of ready
+    sessions. Call it off the critical path, for example when a request is
+    done or the application is idle. The auth set at index 0 of dev is kept.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: generic failure (check TPM IO and TPM return code)
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+
+    \sa wolfTPM2_SessionPool_Get
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Refill(WOLFTPM2_SESSION_POOL* pool);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Hands out a session of a profile, a ready one if there is one
+    (a hit) or one started with wolfTPM2_StartSession (a miss). The session
+    then belongs to the caller, who sets it with wolfTPM2_SetAuthSession and
+    ends it with wolfTPM2_UnloadHandle or a command without
+    TPMA_SESSION_continueSession.
+
+    \return TPM_RC_SUCCESS: successful
+    \return TPM_RC_FAILURE: generic failure (check TPM IO and TPM return code)
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+    \param profile index returned by wolfTPM2_SessionPool_AddProfile
+    \param session pointer to a WOLFTPM2_SESSION struct for the session
+
+    \sa wolfTPM2_SessionPool_Refill
+    \sa wolfTPM2_SessionPool_GetStats
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Get(WOLFTPM2_SESSION_POOL* pool,
+    int profile, WOLFTPM2_SESSION* session);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Saves the ready sessions with TPM2_ContextSave into buf, for
+    wolfTPM2_SessionPool_Restore in a later process. The sessions stay
+    reserved in the TPM but are no longer in the pool. buf holds the session
+    keys and has to be kept as secret as the salt key; it is only valid for
+    the same build of the library and until the TPM is reset.
+    \note Only the ready sessions are saved, the profiles have to be added
+    again in the same order before restoring.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BUFFER_E: buf is too small, *bufSz is set to the size needed
+    \return TPM_RC_FAILURE: generic failure (check TPM IO and TPM return code)
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+    \param buf buffer for the saved sessions, NULL to query the size
+    \param bufSz size of buf, set to the bytes written
+
+    \sa wolfTPM2_SessionPool_Restore
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Save(WOLFTPM2_SESSION_POOL* pool,
+    byte* buf, word32* bufSz);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Loads the sessions saved by wolfTPM2_SessionPool_Save with
+    TPM2_ContextLoad and makes them ready again, so the first request after
+    a restart is a hit. A saved session that does not match its profile or
+    does not fit in it is loaded and flushed, one that the TPM does not load
+    is left alone. Both are counted as dropped.
+
+    \return TPM_RC_SUCCESS: successful, also when sessions were dropped
+    \return BUFFER_E: buf is not a saved pool
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to a WOLFTPM2_SESSION_POOL with the profiles added
+    \param buf saved sessions
+    \param bufSz size of buf
+
+    \sa wolfTPM2_SessionPool_Save
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Restore(WOLFTPM2_SESSION_POOL* pool,
+    const byte* buf, word32 bufSz);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Copies the hit and miss counts of the pool.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+    \param stats filled with the counts
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_GetStats(WOLFTPM2_SESSION_POOL* pool,
+    WOLFTPM2_SESSION_POOL_STATS* stats);
+
+/*!
+    \ingroup wolfTPM2_Wrappers
+    \brief Flushes the ready sessions of the pool and clears it.
+
+    \return TPM_RC_SUCCESS: successful
+    \return BAD_FUNC_ARG: check the provided arguments
+
+    \param pool pointer to an initialized WOLFTPM2_SESSION_POOL struct
+
+    \sa wolfTPM2_SessionPool_Init
+*/
+WOLFTPM_API int wolfTPM2_SessionPool_Cleanup(WOLFTPM2_SESSION_POOL* pool);
+#endif
+
 /*!
     \ingroup wolfTPM2_Wrappers
     \brief Creates a TPM session with Policy Secret to satisfy the default EK policy
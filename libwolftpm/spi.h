@@ -3,12 +3,37 @@
 #include <l4/sys/capability>
 #include <l4/sys/cxx/ipc_iface>
 #include <l4/sys/cxx/ipc_types>
+#include <l4/re/dataspace>
 
 enum
 {
   SPI_PROTO = 0x44
 };
 
+/* Layout of the dataspace shared with map_shm. The client fills frames into
+ * consecutive slots of the ring and rings the doorbell with the first slot
+ * and the number of slots. The server clocks out each frame with its own
+ * chip select, writes the received bytes back into the same slot and sets
+ * the status of the descriptor. */
+enum
+{
+  Spi_shm_slots = 16,
+  Spi_shm_frame_max = 256,
+};
+
+struct Spi_shm_desc
+{
+  l4_uint16_t len;
+  l4_uint16_t flags;
+  l4_int32_t status;
+};
+
+struct Spi_shm_ring
+{
+  Spi_shm_desc desc[Spi_shm_slots];
+  l4_uint8_t data[Spi_shm_slots][Spi_shm_frame_max];
+};
+
 struct SPI : L4::Kobject_t<SPI, L4::Kobject, SPI_PROTO>
 {
   L4_INLINE_RPC(int, transfer,
@@ -18,5 +43,24 @@ struct SPI : L4::Kobject_t<SPI, L4::Kobject, SPI_PROTO>
                 (L4::Ipc::Array<l4_uint8_t> tbuf, l4_uint32_t size));
   L4_INLINE_RPC(int, read,
                 ( L4::Ipc::Array<l4_uint8_t> &rbuf, l4_uint32_t size));
-  typedef L4::Typeid::Rpcs<transfer_t, register_irq_t, read_t, write_t> Rpcs;
+  /* Scatter list of independent transfers: tbuf holds sizes.length frames
+   * back-to-back, each frame is clocked out with its own chip select and all
+   * rx frames are returned back-to-back in rbuf */
+  L4_INLINE_RPC(int, transfer_vec,
+                (L4::Ipc::Array<const l4_uint16_t, l4_uint32_t> sizes, L4::Ipc::Array<const l4_uint8_t, l4_uint32_t> tbuf, L4::Ipc::Array<l4_uint8_t, l4_uint32_t> &rbuf));
+  /* Shares a dataspace holding a Spi_shm_ring with the server */
+  L4_INLINE_RPC(int, map_shm, (L4::Ipc::Cap<L4Re::Dataspace> ds));
+  /* Runs count slots of the shared ring starting at slot first */
+  L4_INLINE_RPC(int, doorbell, (l4_uint32_t first, l4_uint32_t count));
+  /* Runs a complete TPM command with the TIS protocol in the server and
+   * returns the complete response */
+  L4_INLINE_RPC(int, send_command,
+                (L4::Ipc::Array<const l4_uint8_t, l4_uint32_t> cmd, L4::Ipc::Array<l4_uint8_t, l4_uint32_t> &rsp));
+  /* Same as send_command, the command and the response are passed in the
+   * data area of the shared ring used as one flat buffer */
+  L4_INLINE_RPC(int, send_command_shm, (l4_uint32_t cmd_size, l4_uint32_t *rsp_size));
+  /* Largest frame payload, without the 4 byte TIS header, the server clocks
+   * out under one chip select */
+  L4_INLINE_RPC(int, max_frame, (l4_uint32_t *size));
+  typedef L4::Typeid::Rpcs<transfer_t, register_irq_t, read_t, write_t, transfer_vec_t, map_shm_t, doorbell_t, send_command_t, send_command_shm_t, max_frame_t> Rpcs;
 };
@@ -24,6 +24,8 @@
 #include "wolftpm/tpm2_packet.h"
 #include "wolftpm/tpm2_tis.h"
 #include "wolftpm/tpm2_param_enc.h"
+#include "wolftpm/tpm2_swtpm.h"
+#include "wolftpm/tpm2_drbg.h"
 
 /******************************************************************************/
 /* --- Local Variables -- */
@@ -39,21 +41,135 @@ static volatile int gWolfCryptRefCount = 0;
 #define TPM2_INTERNAL_CLEANUP(ctx)
 #elif defined(WOLFTPM_SWTPM)
 #define INTERNAL_SEND_COMMAND      TPM2_SWTPM_SendCommand
-#define TPM2_INTERNAL_CLEANUP(ctx)
+#define TPM2_INTERNAL_CLEANUP(ctx) TPM2_SWTPM_Cleanup(ctx)
 #elif defined(WOLFTPM_WINAPI)
 #define INTERNAL_SEND_COMMAND      TPM2_WinApi_SendCommand
 #define TPM2_INTERNAL_CLEANUP(ctx) TPM2_WinApi_Cleanup(ctx)
+#elif defined(WOLFTPM_TIS_OFFLOAD)
+#define INTERNAL_SEND_COMMAND      TPM2_TIS_OffloadCommand
+#define TPM2_INTERNAL_CLEANUP(ctx)
 #else
 #define INTERNAL_SEND_COMMAND      TPM2_TIS_SendCommand
+#define INTERNAL_SUBMIT_COMMAND    TPM2_TIS_SubmitCommand
+#define INTERNAL_POLL_COMMAND      TPM2_TIS_PollCommand
+#define INTERNAL_ABORT_COMMAND     TPM2_TIS_AbortCommand
 #define TPM2_INTERNAL_CLEANUP(ctx)
 #endif
 
 /******************************************************************************/
 /* --- Local Functions -- */
 /******************************************************************************/
-static TPM_RC TPM2_AcquireLock(TPM2_CTX* ctx)
+#ifdef WOLFTPM_CMD_PRIORITY
+static TPM_RC TPM2_PrioInit(TPM2_CTX* ctx)
+{
+    int ret;
+
+    if (ctx->hwLockInit)
+        return TPM_RC_SUCCESS;
+    ret = pthread_mutex_init(&ctx->hwLock, NULL);
+    if (ret == 0) {
+        ret = pthread_cond_init(&ctx->prioCond, NULL);
+        if (ret == 0) {
+            ret = pthread_key_create(&ctx->prioKey, NULL);
+            if (ret != 0)
+                pthread_cond_destroy(&ctx->prioCond);
+        }
+        if (ret != 0)
+            pthread_mutex_destroy(&ctx->hwLock);
+    }
+    if (ret != 0) {
+    #ifdef DEBUG_WOLFTPM
+        printf("TPM Mutex Init failed\n");
+    #endif
+        return TPM_RC_FAILURE;
+    }
+    ctx->hwLockInit = 1;
+    return TPM_RC_SUCCESS;
+}
+
+/* class of the calling thread, the key holds the class plus one */
+static int TPM2_PrioClass(TPM2_CTX* ctx)
 {
-#if defined(WOLFTPM2_NO_WOLFCRYPT) || defined(SINGLE_THREADED)
+    void* val = pthread_getspecific(ctx->prioKey);
+    return (val != NULL) ? (int)((size_t)val - 1) : TPM2_PRIO_NORMAL;
+}
+
+/* a command of a higher class than prio is waiting */
+static int TPM2_PrioHigherWaiting(TPM2_CTX* ctx, int prio)
+{
+    int i;
+    for (i = prio + 1; i < TPM2_PRIO_COUNT; i++) {
+        if (ctx->prioNext[i] != ctx->prioServe[i])
+            return 1;
+    }
+    return 0;
+}
+#endif
+
+static TPM_RC TPM2_AcquireLockHw(TPM2_CTX* ctx)
+{
+#ifdef WOLFTPM_CMD_PRIORITY
+    pthread_t self = pthread_self();
+    word32 ticket;
+    int prio;
+
+    if (TPM2_PrioInit(ctx) != TPM_RC_SUCCESS ||
+            pthread_mutex_lock(&ctx->hwLock) != 0) {
+        return TPM_RC_FAILURE;
+    }
+    /* recursive for the holder */
+    if (ctx->prioDepth > 0 && pthread_equal(ctx->prioOwner, self)) {
+        ctx->prioDepth++;
+        pthread_mutex_unlock(&ctx->hwLock);
+        return TPM_RC_SUCCESS;
+    }
+    prio = TPM2_PrioClass(ctx);
+    ticket = ctx->prioNext[prio]++;
+    while (ctx->prioDepth > 0 || ticket != ctx->prioServe[prio] ||
+            TPM2_PrioHigherWaiting(ctx, prio)) {
+        pthread_cond_wait(&ctx->prioCond, &ctx->hwLock);
+    }
+    ctx->prioServe[prio]++;
+    ctx->prioOwner = self;
+    ctx->prioDepth = 1;
+    pthread_mutex_unlock(&ctx->hwLock);
+#elif defined(WOLFTPM_PIPELINE)
+    if (!ctx->hwLockInit) {
+        pthread_mutexattr_t attr;
+        int ret;
+
+        /* recursive, TPM2_GetNonce runs TPM2_GetRandom under the lock */
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        ret = pthread_mutex_init(&ctx->hwLock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        if (ret == 0) {
+            ret = pthread_cond_init(&ctx->pipeCond, NULL);
+            if (ret == 0) {
+                ret = pthread_key_create(&ctx->pipeSessionKey, NULL);
+                if (ret == 0) {
+                    ret = pthread_mutex_init(&ctx->dataLock, NULL);
+                    if (ret != 0)
+                        pthread_key_delete(ctx->pipeSessionKey);
+                }
+                if (ret != 0)
+                    pthread_cond_destroy(&ctx->pipeCond);
+            }
+            if (ret != 0)
+                pthread_mutex_destroy(&ctx->hwLock);
+        }
+        if (ret != 0) {
+        #ifdef DEBUG_WOLFTPM
+            printf("TPM Mutex Init failed\n");
+        #endif
+            return TPM_RC_FAILURE;
+        }
+        ctx->hwLockInit = 1;
+    }
+
+    if (pthread_mutex_lock(&ctx->hwLock) != 0)
+        return TPM_RC_FAILURE;
+#elif defined(WOLFTPM2_NO_WOLFCRYPT) || defined(SINGLE_THREADED)
     (void)ctx;
 #else
     int ret;
@@ -75,15 +191,100 @@ static TPM_RC TPM2_AcquireLock(TPM2_CTX* ctx)
     return TPM_RC_SUCCESS;
 }
 
-static void TPM2_ReleaseLock(TPM2_CTX* ctx)
+static void TPM2_ReleaseLockHw(TPM2_CTX* ctx)
 {
-#if defined(WOLFTPM2_NO_WOLFCRYPT) || defined(SINGLE_THREADED)
+#ifdef WOLFTPM_CMD_PRIORITY
+    pthread_mutex_lock(&ctx->hwLock);
+    if (ctx->prioDepth > 0 && --ctx->prioDepth == 0)
+        pthread_cond_broadcast(&ctx->prioCond);
+    pthread_mutex_unlock(&ctx->hwLock);
+#elif defined(WOLFTPM_PIPELINE)
+    pthread_mutex_unlock(&ctx->hwLock);
+#elif defined(WOLFTPM2_NO_WOLFCRYPT) || defined(SINGLE_THREADED)
     (void)ctx;
 #else
     wc_UnLockMutex(&ctx->hwLock);
 #endif
 }
 
+#ifdef WOLFTPM_PIPELINE
+static TPM2_PIPE_SLOT* TPM2_PipeFreeSlot(TPM2_CTX* ctx)
+{
+    int i;
+    for (i = 0; i < TPM2_PIPE_DEPTH; i++) {
+        if (ctx->pipe[i].state == TPM2_PIPE_FREE)
+            return &ctx->pipe[i];
+    }
+    return NULL;
+}
+
+/* Waits for pipeline progress. Only called with the hwLock held once, which
+ * pthread_cond_wait then releases entirely. */
+static TPM_RC TPM2_PipeWait(TPM2_CTX* ctx)
+{
+    if (pthread_cond_wait(&ctx->pipeCond, &ctx->hwLock) != 0)
+        return TPM_RC_FAILURE;
+    return TPM_RC_SUCCESS;
+}
+
+static void TPM2_PipeSignal(TPM2_CTX* ctx)
+{
+    pthread_cond_broadcast(&ctx->pipeCond);
+}
+
+/* Guards the name cache and the host DRBG. Pipelined commands use them
+ * without the hwLock. Taken after the hwLock, never held while waiting for
+ * it. */
+static void TPM2_DataLock(TPM2_CTX* ctx)
+{
+    if (ctx->hwLockInit)
+        pthread_mutex_lock(&ctx->dataLock);
+}
+
+static void TPM2_DataUnlock(TPM2_CTX* ctx)
+{
+    if (ctx->hwLockInit)
+        pthread_mutex_unlock(&ctx->dataLock);
+}
+
+/* With the pipeline enabled the lock is only handed out while a slot is
+ * free, so the command marshalled in cmdBuf can always be moved out of it.
+ * The holder gets the sessions its thread set with TPM2_SetSessionAuth. */
+static TPM_RC TPM2_AcquireLock(TPM2_CTX* ctx)
+{
+    TPM_RC rc = TPM2_AcquireLockHw(ctx);
+    TPM2_AUTH_SESSION* session;
+
+    while (rc == TPM_RC_SUCCESS && ctx->pipeEnable &&
+            TPM2_PipeFreeSlot(ctx) == NULL) {
+        rc = TPM2_PipeWait(ctx);
+    }
+    if (rc == TPM_RC_SUCCESS) {
+        session = (TPM2_AUTH_SESSION*)pthread_getspecific(ctx->pipeSessionKey);
+        if (session != NULL)
+            ctx->session = session;
+    }
+    return rc;
+}
+
+static void TPM2_ReleaseLock(TPM2_CTX* ctx)
+{
+    /* the lock holder is done with its response */
+    if (ctx->pipeOwned != NULL) {
+        ctx->pipeOwned->state = TPM2_PIPE_FREE;
+        ctx->pipeOwned = NULL;
+        TPM2_PipeSignal(ctx);
+    }
+    TPM2_ReleaseLockHw(ctx);
+}
+#else
+#define TPM2_AcquireLock TPM2_AcquireLockHw
+#define TPM2_ReleaseLock TPM2_ReleaseLockHw
+/* without the pipeline the hwLock covers the name cache and the DRBG */
+#define TPM2_DataLock(ctx)      (void)(ctx)
+#define TPM2_DataUnlock(ctx)    (void)(ctx)
+#endif
+
 /* Send Command Wrapper */
 typedef enum CmdFlags {
     CMD_FLAG_NONE = 0x00,
@@ -101,15 +302,151 @@ typedef struct {
     int flags;        /* If command allows param enc or dec - fixed */
 } CmdInfo_t;
 
-static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
-    CmdInfo_t* info, TPM_CC cmdCode, UINT32 cmdSz)
+static int TPM2_GetSessionName(TPM2_AUTH_SESSION* sessions,
+    UINT32 handleValue, int handleCnt, int idx, TPM2B_NAME* name);
+
+#ifdef WOLFTPM_NAME_CACHE
+/* The entries are only touched with TPM2_DataLock held */
+static TPM2_NAME_CACHE_ENTRY* TPM2_NameCache_Find(TPM2_CTX* ctx,
+    TPM_HANDLE handle)
+{
+    int i;
+    for (i = 0; i < TPM2_NAME_CACHE_SZ; i++) {
+        if (ctx->nameCache[i].handle == handle)
+            return &ctx->nameCache[i];
+    }
+    return NULL;
+}
+
+static void TPM2_NameCache_Put(TPM2_CTX* ctx, TPM_HANDLE handle,
+    const TPM2B_NAME* name)
+{
+    TPM2_NAME_CACHE_ENTRY* entry;
+
+    if (handle < TRANSIENT_FIRST || name->size == 0 ||
+            name->size > sizeof(name->name)) {
+        return;
+    }
+    TPM2_DataLock(ctx);
+    entry = TPM2_NameCache_Find(ctx, handle);
+    if (entry == NULL) {
+        entry = &ctx->nameCache[ctx->nameCacheNext++ % TPM2_NAME_CACHE_SZ];
+        entry->handle = handle;
+    }
+    entry->name.size = name->size;
+    XMEMCPY(entry->name.name, name->name, name->size);
+    TPM2_DataUnlock(ctx);
+}
+
+static void TPM2_NameCache_Drop(TPM2_CTX* ctx, TPM_HANDLE handle)
+{
+    TPM2_NAME_CACHE_ENTRY* entry;
+
+    TPM2_DataLock(ctx);
+    entry = TPM2_NameCache_Find(ctx, handle);
+    if (entry != NULL && handle != 0)
+        XMEMSET(entry, 0, sizeof(TPM2_NAME_CACHE_ENTRY));
+    TPM2_DataUnlock(ctx);
+}
+
+static void TPM2_NameCache_Clear(TPM2_CTX* ctx)
+{
+    TPM2_DataLock(ctx);
+    XMEMSET(ctx->nameCache, 0, sizeof(ctx->nameCache));
+    TPM2_DataUnlock(ctx);
+}
+#endif
+
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+/* cpHash or rpHash of one algorithm, shared by the sessions using it */
+typedef struct TPM2_PHASH {
+    TPMI_ALG_HASH alg;
+    TPM2B_DIGEST digest;
+} TPM2_PHASH;
+
+/* Points names at the names of the handles at handles. Transient,
+ * persistent and NV handles are named by the session of their index, or by
+ * the name cache if that has no name. A cached name is copied to cached[i],
+ * as the cache may change while the command is authorized. Other handles
+ * are their own name and get NULL. */
+static void TPM2_GetHandleNames(TPM2_CTX* ctx, TPM2_AUTH_SESSION* sessions,
+    const BYTE* handles, int handleCnt, const TPM2B_NAME** names,
+    TPM2B_NAME* cached)
+{
+    UINT32 handleValue;
+    int i;
+
+    for (i = 0; i < handleCnt; i++) {
+        XMEMCPY(&handleValue, &handles[i * sizeof(TPM_HANDLE)],
+            sizeof(handleValue));
+        handleValue = TPM2_Packet_SwapU32(handleValue);
+        names[i] = NULL;
+        if ((handleValue >= TRANSIENT_FIRST) ||
+            (handleValue >= NV_INDEX_FIRST && handleValue <= NV_INDEX_LAST)) {
+            names[i] = &sessions[i].name;
+        #ifdef WOLFTPM_NAME_CACHE
+            if (sessions[i].name.size == 0) {
+                TPM2_NAME_CACHE_ENTRY* entry;
+
+                TPM2_DataLock(ctx);
+                entry = TPM2_NameCache_Find(ctx, handleValue);
+                if (entry != NULL) {
+                    XMEMCPY(&cached[i], &entry->name, sizeof(TPM2B_NAME));
+                    names[i] = &cached[i];
+                }
+                TPM2_DataUnlock(ctx);
+            }
+        #endif
+        }
+    }
+    (void)ctx;
+    (void)cached;
+}
+
+/* Finds the hash of alg in hashes, or adds an entry for it and clears
+ * found */
+static TPM2_PHASH* TPM2_FindPHash(TPM2_PHASH* hashes, int* hashCnt,
+    TPMI_ALG_HASH alg, int* found)
+{
+    int i;
+    for (i = 0; i < *hashCnt; i++) {
+        if (hashes[i].alg == alg) {
+            *found = 1;
+            return &hashes[i];
+        }
+    }
+    *found = 0;
+    hashes[i].alg = alg;
+    (*hashCnt)++;
+    return &hashes[i];
+}
+#endif
+
+/* Authorizes the command with sessions, the ctx->session of the command.
+ * nonces, if not NULL, holds a prepared nonceCaller per session. The
+ * parameter is encrypted first, then the cpHash is computed once per hash
+ * algorithm straight over the packet and shared by the HMAC sessions. */
+static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_AUTH_SESSION* sessions,
+    TPM2_Packet* packet, CmdInfo_t* info, TPM_CC cmdCode, UINT32 cmdSz,
+    const TPM2B_NONCE* nonces)
 {
     int rc = TPM_RC_SUCCESS;
-    UINT32 authSz, handleValue;
+    UINT32 authSz;
     BYTE *param, *encParam = NULL;
     int paramSz, encParamSz = 0;
-    int i, authPos, handlePos;
+    int i, authPos;
     int tmpSz = 0; /* Used to calculate the new total size of the Auth Area */
+    TPMS_AUTH_COMMAND authCmd[MAX_SESSION_NUM];
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+    const TPM2B_NAME* names[MAX_HANDLE_NUM];
+    TPM2B_NAME cached[MAX_HANDLE_NUM];
+    TPM2_PHASH cpHash[MAX_SESSION_NUM];
+    TPM2_PHASH* hash;
+    int cpHashCnt = 0, found;
+#endif
+
+    if (info->authCnt > MAX_SESSION_NUM || info->inHandleCnt > MAX_HANDLE_NUM)
+        return BAD_FUNC_ARG;
 
     /* Skip the header and handles area */
     packet->pos = TPM2_HEADER_SIZE + (info->inHandleCnt * sizeof(TPM_HANDLE));
@@ -148,13 +485,19 @@ static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
     (void)paramSz;
 #endif
 
+    /* Nonces and parameter encryption, the cpHash is over the encrypted
+     * parameter */
     for (i=0; i<info->authCnt; i++) {
-        TPM2_AUTH_SESSION* session = &ctx->session[i];
-        TPMS_AUTH_COMMAND authCmd;
+        TPM2_AUTH_SESSION* session = &sessions[i];
 
-        if (session->sessionHandle != TPM_RS_PW) {
+        if (session->sessionHandle != TPM_RS_PW && nonces != NULL) {
+            session->nonceCaller.size = nonces[i].size;
+            XMEMCPY(session->nonceCaller.buffer, nonces[i].buffer,
+                nonces[i].size);
+        }
+        else if (session->sessionHandle != TPM_RS_PW) {
             /* Generate fresh nonce */
-            rc = TPM2_GetNonce(session->nonceCaller.buffer,
+            rc = TPM2_GetNonce_ex(ctx, session->nonceCaller.buffer,
                 session->nonceCaller.size);
             if (rc != TPM_RC_SUCCESS) {
                 return rc;
@@ -162,26 +505,22 @@ static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
         }
 
         /* Note: Copy between TPM2_AUTH_SESSION and TPMS_AUTH_COMMAND is allowed */
-        XMEMCPY(&authCmd, session, sizeof(TPMS_AUTH_COMMAND));
+        XMEMCPY(&authCmd[i], session, sizeof(TPMS_AUTH_COMMAND));
 
         /* Skip Policy session, because Enhanced Authorization is not yet implemented */
         if (TPM2_IS_HMAC_SESSION(session->sessionHandle)) {
-        #ifndef WOLFTPM2_NO_WOLFCRYPT
-            TPM2B_NAME name1, name2, name3;
-            TPM2B_DIGEST hash;
-        #endif
-
             /* if param enc is not supported for this command then clear flag */
             /* session attribute flags are from TPM perspective */
             if ((info->flags & (CMD_FLAG_ENC2 | CMD_FLAG_ENC4)) == 0) {
-                authCmd.sessionAttributes &= ~TPMA_SESSION_decrypt;
+                authCmd[i].sessionAttributes &= ~TPMA_SESSION_decrypt;
             }
             if ((info->flags & (CMD_FLAG_DEC2 | CMD_FLAG_DEC4)) == 0) {
-                authCmd.sessionAttributes &= ~TPMA_SESSION_encrypt;
+                authCmd[i].sessionAttributes &= ~TPMA_SESSION_encrypt;
             }
 
             /* Handle session request for encryption */
-            if (encParam && authCmd.sessionAttributes & TPMA_SESSION_decrypt) {
+            if (encParam &&
+                    authCmd[i].sessionAttributes & TPMA_SESSION_decrypt) {
                 /* Encrypt the first command parameter */
                 rc = TPM2_ParamEnc_CmdRequest(session, encParam, encParamSz);
                 if (rc != TPM_RC_SUCCESS) {
@@ -191,53 +530,51 @@ static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
                     return rc;
                 }
             }
+        }
+    }
 
-        #ifndef WOLFTPM2_NO_WOLFCRYPT
-            handlePos = packet->pos;
-            packet->pos = TPM2_HEADER_SIZE; /* Handles are right after header */
-            TPM2_Packet_ParseU32(packet, &handleValue);
-            packet->pos = handlePos;
-
-            rc =  TPM2_GetName(ctx, handleValue, info->inHandleCnt, 0, &name1);
-            rc |= TPM2_GetName(ctx, handleValue, info->inHandleCnt, 1, &name2);
-            rc |= TPM2_GetName(ctx, handleValue, info->inHandleCnt, 2, &name3);
-            if (rc != TPM_RC_SUCCESS) {
-            #ifdef DEBUG_WOLFTPM
-                printf("Error getting names for cpHash!\n");
-            #endif
-                return BAD_FUNC_ARG;
-            }
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+    for (i=0; i<info->authCnt; i++) {
+        TPM2_AUTH_SESSION* session = &sessions[i];
+
+        if (!TPM2_IS_HMAC_SESSION(session->sessionHandle))
+            continue;
 
-            /* calculate "cpHash" hash for command code, names and parameters */
-            rc = TPM2_CalcCpHash(session->authHash, cmdCode, &name1,
-                &name2, &name3, param, paramSz, &hash);
+        if (cpHashCnt == 0) {
+            TPM2_GetHandleNames(ctx, sessions, &packet->buf[TPM2_HEADER_SIZE],
+                info->inHandleCnt, names, cached);
+        }
+        /* calculate "cpHash" hash for command code, names and parameters */
+        hash = TPM2_FindPHash(cpHash, &cpHashCnt, session->authHash, &found);
+        if (!found) {
+            rc = TPM2_CalcCpHash_ex(session->authHash, cmdCode,
+                &packet->buf[TPM2_HEADER_SIZE], names, info->inHandleCnt,
+                param, paramSz, &hash->digest);
             if (rc != TPM_RC_SUCCESS) {
             #ifdef DEBUG_WOLFTPM
                 printf("Error calculating cpHash!\n");
             #endif
                 return rc;
             }
-            /* Calculate HMAC for policy, hmac or salted sessions */
-            /* this is done after encryption */
-            rc = TPM2_CalcHmac(session->authHash, &session->auth, &hash,
-                &session->nonceCaller, &session->nonceTPM,
-                authCmd.sessionAttributes, &authCmd.hmac);
-            if (rc != TPM_RC_SUCCESS) {
-            #ifdef DEBUG_WOLFTPM
-                printf("Error calculating command HMAC!\n");
-            #endif
-                return rc;
-            }
-        #else
-            (void)handleValue;
-            (void)handlePos;
+        }
+        /* Calculate HMAC for policy, hmac or salted sessions */
+        /* this is done after encryption */
+        rc = TPM2_CalcSessionHmac(session, &hash->digest,
+            &session->nonceCaller, &session->nonceTPM,
+            authCmd[i].sessionAttributes, &authCmd[i].hmac);
+        if (rc != TPM_RC_SUCCESS) {
+        #ifdef DEBUG_WOLFTPM
+            printf("Error calculating command HMAC!\n");
         #endif
+            return rc;
         }
+    }
+#endif
 
-        /* Replace auth in session */
-        packet->pos = authPos;
-        TPM2_Packet_AppendAuthCmd(packet, &authCmd);
-        authPos = packet->pos; /* update auth position */
+    /* Replace auth in session */
+    packet->pos = authPos;
+    for (i=0; i<info->authCnt; i++) {
+        TPM2_Packet_AppendAuthCmd(packet, &authCmd[i]);
     }
 
     /* Update the Auth Area size in the command packet */
@@ -247,13 +584,22 @@ static int TPM2_CommandProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
     return rc;
 }
 
-static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
-    CmdInfo_t* info, TPM_CC cmdCode, UINT32 respSz)
+static int TPM2_ResponseProcess(TPM2_AUTH_SESSION* sessions,
+    TPM2_Packet* packet, CmdInfo_t* info, TPM_CC cmdCode, UINT32 respSz)
 {
     int rc = TPM_RC_SUCCESS;
     BYTE *param, *decParam = NULL;
     UINT32 paramSz, decParamSz = 0, authPos;
     int i;
+    TPMA_SESSION rspAttr[MAX_SESSION_NUM];
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+    TPM2_PHASH rpHash[MAX_SESSION_NUM];
+    TPM2_PHASH* hash;
+    int rpHashCnt = 0, found;
+#endif
+
+    if (info->authCnt > MAX_SESSION_NUM)
+        return BAD_FUNC_ARG;
 
     /* Skip the header output handles */
     packet->pos = TPM2_HEADER_SIZE + (info->outHandleCnt * sizeof(TPM_HANDLE));
@@ -282,8 +628,9 @@ static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
         info->outHandleCnt, respSz, paramSz, decParamSz, respSz - authPos);
 #endif
 
+    /* Response HMACs, the rpHash is over the encrypted parameter */
     for (i=0; i<info->authCnt; i++) {
-        TPM2_AUTH_SESSION* session = &ctx->session[i];
+        TPM2_AUTH_SESSION* session = &sessions[i];
         TPMS_AUTH_RESPONSE authRsp;
         XMEMSET(&authRsp, 0, sizeof(authRsp));
 
@@ -304,21 +651,24 @@ static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
 
         #ifndef WOLFTPM2_NO_WOLFCRYPT
             if (authRsp.hmac.size > 0) {
-                TPM2B_DIGEST hash;
                 TPM2B_AUTH hmac;
 
                 /* calculate "rpHash" hash for command code and parameters */
-                rc = TPM2_CalcRpHash(session->authHash, cmdCode, param, paramSz,
-                    &hash);
-                if (rc != TPM_RC_SUCCESS) {
-                #ifdef DEBUG_WOLFTPM
-                    printf("Error calculating rpHash!\n");
-                #endif
-                    return rc;
+                hash = TPM2_FindPHash(rpHash, &rpHashCnt, session->authHash,
+                    &found);
+                if (!found) {
+                    rc = TPM2_CalcRpHash(session->authHash, cmdCode, param,
+                        paramSz, &hash->digest);
+                    if (rc != TPM_RC_SUCCESS) {
+                    #ifdef DEBUG_WOLFTPM
+                        printf("Error calculating rpHash!\n");
+                    #endif
+                        return rc;
+                    }
                 }
 
                 /* Calculate HMAC prior to decryption */
-                rc = TPM2_CalcHmac(session->authHash, &session->auth, &hash,
+                rc = TPM2_CalcSessionHmac(session, &hash->digest,
                     &session->nonceTPM, &session->nonceCaller,
                     authRsp.sessionAttributes, &hmac);
                 if (rc != TPM_RC_SUCCESS) {
@@ -330,7 +680,8 @@ static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
 
                 /* Verify HMAC */
                 if (hmac.size != authRsp.hmac.size ||
-                    XMEMCMP(hmac.buffer, authRsp.hmac.buffer, hmac.size) != 0) {
+                    TPM2_ConstantCompare(hmac.buffer, authRsp.hmac.buffer,
+                        hmac.size) != 0) {
                 #ifdef DEBUG_WOLFTPM
                     printf("Response HMAC verification failed!\n");
                 #endif
@@ -340,18 +691,24 @@ static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
         #else
             (void)cmdCode;
         #endif
+        }
+        rspAttr[i] = authRsp.sessionAttributes;
+    }
 
-            /* Handle session request for decryption */
-            /* If the response supports decryption */
-            if (decParam && authRsp.sessionAttributes & TPMA_SESSION_encrypt) {
-                /* Decrypt the first response parameter */
-                rc = TPM2_ParamDec_CmdResponse(session, decParam, decParamSz);
-                if (rc != TPM_RC_SUCCESS) {
-            #ifdef DEBUG_WOLFTPM
-                    printf("Response parameter decryption failed\n");
-            #endif
-                    return rc;
-                }
+    for (i=0; i<info->authCnt; i++) {
+        TPM2_AUTH_SESSION* session = &sessions[i];
+
+        /* Handle session request for decryption */
+        /* If the response supports decryption */
+        if (session->sessionHandle != TPM_RS_PW && decParam &&
+                rspAttr[i] & TPMA_SESSION_encrypt) {
+            /* Decrypt the first response parameter */
+            rc = TPM2_ParamDec_CmdResponse(session, decParam, decParamSz);
+            if (rc != TPM_RC_SUCCESS) {
+        #ifdef DEBUG_WOLFTPM
+                printf("Response parameter decryption failed\n");
+        #endif
+                return rc;
             }
         }
     }
@@ -359,172 +716,1516 @@ static int TPM2_ResponseProcess(TPM2_CTX* ctx, TPM2_Packet* packet,
     return rc;
 }
 
-static TPM_RC TPM2_SendCommandAuth(TPM2_CTX* ctx, TPM2_Packet* packet,
-    CmdInfo_t* info)
+#ifdef WOLFTPM_PIPELINE
+/* Runs packet on the device in ticket order. The hwLock is dropped while
+ * waiting for the turn and while the TPM executes, only the ticket holder
+ * touches the device and the slot it sends from. */
+static TPM_RC TPM2_PipeDevice(TPM2_CTX* ctx, TPM2_Packet* packet)
 {
-    TPM_RC rc = TPM_RC_FAILURE;
-    TPM_ST tag;
-    TPM_CC cmdCode;
-    BYTE *cmd;
-    UINT32 cmdSz, respSz;
-
-    if (ctx == NULL || packet == NULL || info == NULL)
-        return BAD_FUNC_ARG;
-
-    cmd = packet->buf;
-    cmdSz = packet->pos;
-    (void)cmd;
-
-    /* restart the unmarshalling position */
-    packet->pos = 0;
-    TPM2_Packet_ParseU16(packet, &tag);
-    TPM2_Packet_ParseU32(packet, NULL);
-    TPM2_Packet_ParseU32(packet, &cmdCode);  /* Extract TPM Command Code */
-
-    /* Is auth session required for this TPM command? */
-    if (tag == TPM_ST_SESSIONS) {
-        /* Is there at least one auth session present? */
-        if (info->authCnt < 1 || ctx->session == NULL)
-            return TPM_RC_AUTH_MISSING;
-
-    #ifdef WOLFTPM_DEBUG_VERBOSE
-        printf("Found %d auth sessions\n", info->authCnt);
-    #endif
+    TPM_RC rc = TPM_RC_SUCCESS;
+    word32 ticket = ctx->pipeNext++;
 
-        rc = TPM2_CommandProcess(ctx, packet, info, cmdCode, cmdSz);
-        if (rc != 0)
-            return rc;
+    while (rc == TPM_RC_SUCCESS &&
+            (ctx->pipeServe != ticket || ctx->cmdState != TPM2_CMD_IDLE)) {
+        rc = TPM2_PipeWait(ctx);
     }
-
-    /* reset packet->pos to total command length (send command requires it) */
-    packet->pos = cmdSz;
-
-    /* submit command and wait for response */
-    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
-    if (rc != 0)
+    if (rc != TPM_RC_SUCCESS)
         return rc;
 
-    /* parse response */
-    rc = TPM2_Packet_Parse(rc, packet);
-    respSz = packet->size;
-
-    /* restart the unmarshalling position */
-    packet->pos = 0;
-    TPM2_Packet_ParseU16(packet, &tag);
-
-    /* Is auth session required for this TPM command? */
-    if (rc == TPM_RC_SUCCESS && tag == TPM_ST_SESSIONS) {
-        rc = TPM2_ResponseProcess(ctx, packet, info, cmdCode, respSz);
-    }
+    TPM2_ReleaseLockHw(ctx);
+    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+    if (TPM2_AcquireLockHw(ctx) != TPM_RC_SUCCESS)
+        rc = TPM_RC_FAILURE;
 
-    /* Caller expects packet position to be at end of header */
-    packet->pos = TPM2_HEADER_SIZE;
+    ctx->pipeServe++;
+    TPM2_PipeSignal(ctx);
 
     return rc;
 }
 
-static TPM_RC TPM2_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
+#ifndef WOLFTPM2_USE_WOLF_RNG
+/* Fills buf with TPM2_GetRandom run in the caller's turn on the device */
+static TPM_RC TPM2_PipeRandom(TPM2_CTX* ctx, byte* randBuf, int randBufSz)
 {
-    TPM_RC rc;
-
-    if (ctx == NULL || packet == NULL)
-        return BAD_FUNC_ARG;
+    TPM_RC rc = TPM_RC_SUCCESS;
+    byte buf[TPM2_HEADER_SIZE + sizeof(TPM2B_DIGEST)];
+    TPM2_Packet packet;
+    UINT16 randSz;
+    int pos = 0;
+
+    while (rc == TPM_RC_SUCCESS && pos < randBufSz) {
+        packet.buf = buf;
+        packet.size = (int)sizeof(buf);
+        packet.pos = TPM2_HEADER_SIZE;
+        randSz = (UINT16)(randBufSz - pos);
+        if (randSz > sizeof(TPMU_HA))
+            randSz = sizeof(TPMU_HA);
+        TPM2_Packet_AppendU16(&packet, randSz);
+        TPM2_Packet_Finalize(&packet, TPM_ST_NO_SESSIONS, TPM_CC_GetRandom);
 
-    /* submit command and wait for response */
-    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
-    if (rc != 0)
-        return rc;
+        rc = TPM2_Packet_Parse(TPM2_PipeDevice(ctx, &packet), &packet);
+    #ifdef WOLFTPM_HOST_DRBG
+        TPM2_DataLock(ctx);
+        ctx->drbg.stats.getRandom++;
+        TPM2_DataUnlock(ctx);
+    #endif
+        if (rc == TPM_RC_SUCCESS) {
+            TPM2_Packet_ParseU16(&packet, &randSz);
+            if (randSz == 0 || randSz > randBufSz - pos)
+                rc = TPM_RC_FAILURE;
+        }
+        if (rc == TPM_RC_SUCCESS) {
+            TPM2_Packet_ParseBytes(&packet, &randBuf[pos], randSz);
+            pos += randSz;
+        }
+    }
 
-    return TPM2_Packet_Parse(rc, packet);
+    return rc;
 }
+#endif
 
-static TPM_ST TPM2_GetTag(TPM2_CTX* ctx)
+/* Fills the nonceCaller of every session in the sessions mask. Without the
+ * wolfCrypt RNG the nonces come from the host DRBG or from a TPM2_GetRandom
+ * run in the slot's own turn, not through TPM2_GetNonce, so no second slot is
+ * needed. */
+static TPM_RC TPM2_PipeNonces(TPM2_CTX* ctx, TPM2_PIPE_SLOT* slot,
+    byte sessions)
 {
-    TPM_ST st = TPM_ST_NO_SESSIONS;
-    if (ctx && ctx->session) {
-        int authCount = TPM2_GetSessionAuthCount(ctx);
-        if (authCount == 1 && ctx->session[0].sessionHandle != TPM_RS_PW) {
-            st = TPM_ST_SESSIONS;
+    TPM_RC rc = TPM_RC_SUCCESS;
+    int i;
+#ifndef WOLFTPM2_USE_WOLF_RNG
+    byte rnd[MAX_SESSION_NUM * sizeof(TPMU_HA)];
+    int pos = 0, total = 0;
+#ifdef WOLFTPM_HOST_DRBG
+    byte seed[TPM2_DRBG_SEED_SZ];
+    int needSeed;
+#endif
+
+    for (i = 0; i < MAX_SESSION_NUM; i++) {
+        if (sessions & (1 << i))
+            total += slot->session[i].nonceCaller.size;
+    }
+    if (total > (int)sizeof(rnd))
+        return BUFFER_E;
+
+#ifdef WOLFTPM_HOST_DRBG
+    TPM2_DataLock(ctx);
+    needSeed = TPM2_Drbg_NeedSeed(&ctx->drbg);
+    TPM2_DataUnlock(ctx);
+    /* the hwLock is dropped while the seed is read, another command may
+     * seed meanwhile as well */
+    if (needSeed)
+        rc = TPM2_PipeRandom(ctx, seed, (int)sizeof(seed));
+
+    /* the DRBG has its own lock, the device is free meanwhile */
+    TPM2_ReleaseLockHw(ctx);
+    TPM2_DataLock(ctx);
+    if (needSeed && rc == TPM_RC_SUCCESS) {
+        TPM2_Drbg_Seed(&ctx->drbg, seed, (word32)sizeof(seed));
+    }
+    else if (!needSeed && total > 0) {
+        ctx->drbg.stats.avoided +=
+            ((word32)total + MAX_RNG_REQ_SIZE - 1) / MAX_RNG_REQ_SIZE;
+    }
+    if (rc == TPM_RC_SUCCESS && total > 0)
+        TPM2_Drbg_Generate(&ctx->drbg, rnd, (word32)total);
+    TPM2_DataUnlock(ctx);
+    TPM2_ForceZero(seed, sizeof(seed));
+    if (TPM2_AcquireLockHw(ctx) != TPM_RC_SUCCESS)
+        rc = TPM_RC_FAILURE;
+#else
+    rc = TPM2_PipeRandom(ctx, rnd, total);
+#endif
+
+    for (i = 0; rc == TPM_RC_SUCCESS && i < MAX_SESSION_NUM; i++) {
+        if (sessions & (1 << i)) {
+            slot->nonceCaller[i].size = slot->session[i].nonceCaller.size;
+            XMEMCPY(slot->nonceCaller[i].buffer, &rnd[pos],
+                slot->nonceCaller[i].size);
+            pos += slot->nonceCaller[i].size;
         }
     }
-    return st;
+#else
+    for (i = 0; rc == TPM_RC_SUCCESS && i < MAX_SESSION_NUM; i++) {
+        if (sessions & (1 << i)) {
+            slot->nonceCaller[i].size = slot->session[i].nonceCaller.size;
+            rc = TPM2_GetNonce_ex(ctx, slot->nonceCaller[i].buffer,
+                slot->nonceCaller[i].size);
+        }
+    }
+#endif
+    return rc;
 }
 
-#ifndef WOLFTPM2_NO_WOLFCRYPT
-static inline void TPM2_WolfCrypt_Init(void)
+/* Returns non-zero while another command holds one of the sessions slot
+ * wants to reserve */
+static int TPM2_PipeSessionsHeld(TPM2_CTX* ctx, TPM2_PIPE_SLOT* slot,
+    byte sessions)
+{
+    TPM2_PIPE_SLOT* other;
+    int i, j, k;
+
+    for (k = 0; k < TPM2_PIPE_DEPTH; k++) {
+        other = &ctx->pipe[k];
+        if (other == slot || other->held == 0)
+            continue;
+        for (i = 0; i < MAX_SESSION_NUM; i++) {
+            if ((sessions & (1 << i)) == 0)
+                continue;
+            for (j = 0; j < MAX_SESSION_NUM; j++) {
+                if ((other->held & (1 << j)) &&
+                        &other->session[j] == &slot->session[i]) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* Pipelined TPM2_SendCommandAuth (info set) or TPM2_SendCommand. The command
+ * leaves cmdBuf for a slot, so the next caller can marshal while this one
+ * waits. Nonces are generated before the sessions are taken. A session is
+ * held from its HMAC until the response was processed, so the nonceTPM chain
+ * stays in order, other sessions are authorized and verified concurrently
+ * without the hwLock. The response stays in the slot until
+ * TPM2_ReleaseLock. */
+static TPM_RC TPM2_PipeCommand(TPM2_CTX* ctx, TPM2_Packet* packet,
+    CmdInfo_t* info)
 {
-    /* track reference count for wolfCrypt initialization */
-    if (gWolfCryptRefCount == 0) {
-    #ifdef DEBUG_WOLFSSL
-        wolfSSL_Debugging_ON();
+    TPM_RC rc = TPM_RC_SUCCESS;
+    TPM2_PIPE_SLOT* slot;
+    TPM_ST tag;
+    TPM_CC cmdCode;
+    UINT32 cmdSz = (UINT32)packet->pos, respSz;
+    byte sessions = 0;
+    int i, auth = 0;
+
+    /* a response of the lock holder that was not released */
+    if (ctx->pipeOwned != NULL) {
+        ctx->pipeOwned->state = TPM2_PIPE_FREE;
+        ctx->pipeOwned = NULL;
+    }
+
+    packet->pos = 0;
+    TPM2_Packet_ParseU16(packet, &tag);
+    TPM2_Packet_ParseU32(packet, NULL);
+    TPM2_Packet_ParseU32(packet, &cmdCode);
+
+    if (info != NULL && tag == TPM_ST_SESSIONS) {
+        if (info->authCnt < 1 || ctx->session == NULL)
+            return TPM_RC_AUTH_MISSING;
+        auth = 1;
+        for (i = 0; i < info->authCnt && i < MAX_SESSION_NUM; i++) {
+            if (ctx->session[i].sessionHandle != TPM_RS_PW)
+                sessions |= (byte)(1 << i);
+        }
+    }
+
+    /* TPM2_AcquireLock made sure a slot is free */
+    slot = TPM2_PipeFreeSlot(ctx);
+    if (slot == NULL)
+        return TPM_RC_FAILURE;
+    XMEMCPY(&slot->buf[TPM2_PACKET_HEADROOM], packet->buf, cmdSz);
+    packet->buf = &slot->buf[TPM2_PACKET_HEADROOM];
+    packet->size = MAX_COMMAND_SIZE;
+    slot->session = ctx->session;
+    slot->state = TPM2_PIPE_PREP;
+
+    if (sessions != 0) {
+        rc = TPM2_PipeNonces(ctx, slot, sessions);
+
+        while (rc == TPM_RC_SUCCESS &&
+                TPM2_PipeSessionsHeld(ctx, slot, sessions)) {
+            rc = TPM2_PipeWait(ctx);
+        }
+        if (rc == TPM_RC_SUCCESS)
+            slot->held = sessions;
+    }
+    if (rc == TPM_RC_SUCCESS && auth) {
+        /* only this command touches its slot and held sessions */
+        TPM2_ReleaseLockHw(ctx);
+        rc = TPM2_CommandProcess(ctx, slot->session, packet, info, cmdCode,
+            cmdSz, slot->nonceCaller);
+        if (TPM2_AcquireLockHw(ctx) != TPM_RC_SUCCESS)
+            rc = TPM_RC_FAILURE;
+    }
+
+    if (rc == TPM_RC_SUCCESS) {
+        slot->state = TPM2_PIPE_READY;
+        packet->pos = cmdSz;
+        rc = TPM2_PipeDevice(ctx, packet);
+    }
+    slot->state = TPM2_PIPE_BUSY;
+
+    rc = TPM2_Packet_Parse(rc, packet);
+    if (info != NULL) {
+        respSz = packet->size;
+        packet->pos = 0;
+        TPM2_Packet_ParseU16(packet, &tag);
+        if (rc == TPM_RC_SUCCESS && auth && tag == TPM_ST_SESSIONS) {
+            /* the device is free for the next command meanwhile */
+            TPM2_ReleaseLockHw(ctx);
+            rc = TPM2_ResponseProcess(slot->session, packet, info, cmdCode,
+                respSz);
+            if (TPM2_AcquireLockHw(ctx) != TPM_RC_SUCCESS)
+                rc = TPM_RC_FAILURE;
+        }
+        packet->pos = TPM2_HEADER_SIZE;
+    }
+    if (slot->held != 0) {
+        slot->held = 0;
+        TPM2_PipeSignal(ctx);
+    }
+    /* the hwLock is kept from here on until TPM2_ReleaseLock, other holders
+     * may have set their sessions meanwhile */
+    ctx->session = slot->session;
+    ctx->pipeOwned = slot;
+
+    return rc;
+}
+#endif /* WOLFTPM_PIPELINE */
+
+#ifdef WOLFTPM_RESOURCE_MGR
+/* Command state kept by TPM2_RM_Command for TPM2_RM_Response */
+typedef struct {
+    const TPM2_CMD_HANDLES* cmd;
+    TPM2_RM_OBJECT* obj[MAX_HANDLE_NUM];    /* objects of the handle area */
+    TPM2_RM_SESSION* sess[MAX_HANDLE_NUM];  /* sessions of the handle area */
+    TPM2_RM_SESSION* auth[MAX_SESSION_NUM]; /* sessions of the auth area */
+    byte authEnd[MAX_SESSION_NUM];  /* continueSession is clear */
+    int done;           /* completed without the TPM */
+} TPM2_RM_XFER;
+
+static int TPM2_RM_IsSession(TPM_HANDLE handle)
+{
+    handle &= HR_RANGE_MASK;
+    return handle == HR_HMAC_SESSION || handle == HR_POLICY_SESSION;
+}
+
+static TPM2_RM_OBJECT* TPM2_RM_FindObj(TPM2_RM_SPACE* space,
+    TPM_HANDLE vHandle)
+{
+    int i;
+    if (vHandle < TPM2_RM_HANDLE_FIRST ||
+            vHandle > (TRANSIENT_FIRST | HR_HANDLE_MASK)) {
+        return NULL;
+    }
+    for (i = 0; i < TPM2_RM_MAX_OBJECTS; i++) {
+        if (space->obj[i].vHandle == vHandle)
+            return &space->obj[i];
+    }
+    return NULL;
+}
+
+static TPM2_RM_SESSION* TPM2_RM_FindSess(TPM2_RM_SPACE* space,
+    TPM_HANDLE handle)
+{
+    int i;
+    for (i = 0; i < TPM2_RM_MAX_SESSIONS; i++) {
+        if (space->sess[i].handle == handle)
+            return &space->sess[i];
+    }
+    return NULL;
+}
+
+/* The resource manager commands use rmBuf, the command of the caller stays
+ * in its packet */
+static TPM_RC TPM2_RM_Send(TPM2_CTX* ctx, TPM2_Packet* packet, TPM_CC cc)
+{
+    TPM_RC rc;
+
+    TPM2_Packet_Finalize(packet, TPM_ST_NO_SESSIONS, cc);
+    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+    return TPM2_Packet_Parse(rc, packet);
+}
+
+static void TPM2_RM_PacketInit(TPM2_CTX* ctx, TPM2_Packet* packet)
+{
+    packet->buf = &ctx->rmBuf[TPM2_PACKET_HEADROOM];
+    packet->pos = TPM2_HEADER_SIZE;
+    packet->size = MAX_COMMAND_SIZE;
+}
+
+static TPM_RC TPM2_RM_SaveContext(TPM2_CTX* ctx, TPM_HANDLE handle,
+    TPMS_CONTEXT* context)
+{
+    TPM_RC rc;
+    TPM2_Packet packet;
+
+    TPM2_RM_PacketInit(ctx, &packet);
+    TPM2_Packet_AppendU32(&packet, handle);
+    rc = TPM2_RM_Send(ctx, &packet, TPM_CC_ContextSave);
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_Packet_ParseU64(&packet, &context->sequence);
+        TPM2_Packet_ParseU32(&packet, &context->savedHandle);
+        TPM2_Packet_ParseU32(&packet, &context->hierarchy);
+        TPM2_Packet_ParseU16(&packet, &context->contextBlob.size);
+        if (context->contextBlob.size > sizeof(context->contextBlob.buffer))
+            return TPM_RC_SIZE;
+        TPM2_Packet_ParseBytes(&packet, context->contextBlob.buffer,
+            context->contextBlob.size);
+    }
+    return rc;
+}
+
+static TPM_RC TPM2_RM_LoadContext(TPM2_CTX* ctx, TPMS_CONTEXT* context,
+    TPM_HANDLE* handle)
+{
+    TPM_RC rc;
+    TPM2_Packet packet;
+
+    TPM2_RM_PacketInit(ctx, &packet);
+    TPM2_Packet_AppendU64(&packet, context->sequence);
+    TPM2_Packet_AppendU32(&packet, context->savedHandle);
+    TPM2_Packet_AppendU32(&packet, context->hierarchy);
+    TPM2_Packet_AppendU16(&packet, context->contextBlob.size);
+    TPM2_Packet_AppendBytes(&packet, context->contextBlob.buffer,
+        context->contextBlob.size);
+    rc = TPM2_RM_Send(ctx, &packet, TPM_CC_ContextLoad);
+    if (rc == TPM_RC_SUCCESS)
+        TPM2_Packet_ParseU32(&packet, handle);
+    return rc;
+}
+
+static TPM_RC TPM2_RM_Flush(TPM2_CTX* ctx, TPM_HANDLE handle)
+{
+    TPM2_Packet packet;
+
+    TPM2_RM_PacketInit(ctx, &packet);
+    TPM2_Packet_AppendU32(&packet, handle);
+    return TPM2_RM_Send(ctx, &packet, TPM_CC_FlushContext);
+}
+
+/* Saves the object unless its saved context is current and frees its slot */
+static TPM_RC TPM2_RM_Evict(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    TPM2_RM_OBJECT* obj)
+{
+    TPM_RC rc = TPM_RC_SUCCESS;
+
+    if (!obj->saved) {
+        rc = TPM2_RM_SaveContext(ctx, obj->pHandle, &obj->context);
+        if (rc == TPM_RC_SUCCESS) {
+            obj->saved = 1;
+            space->stats.saves++;
+        }
+    }
+    if (rc == TPM_RC_SUCCESS) {
+        rc = TPM2_RM_Flush(ctx, obj->pHandle);
+        if (rc == TPM_RC_SUCCESS) {
+            obj->pHandle = 0;
+            space->stats.flushes++;
+        }
+    }
+    return rc;
+}
+
+/* Evicts the least recently used objects until a transient slot is free.
+ * Objects of the current command are not evicted. */
+static TPM_RC TPM2_RM_MakeRoom(TPM2_CTX* ctx, TPM2_RM_SPACE* space)
+{
+    TPM_RC rc = TPM_RC_SUCCESS;
+    TPM2_RM_OBJECT* lru;
+    int i, loaded;
+
+    while (rc == TPM_RC_SUCCESS) {
+        lru = NULL;
+        loaded = 0;
+        for (i = 0; i < TPM2_RM_MAX_OBJECTS; i++) {
+            TPM2_RM_OBJECT* obj = &space->obj[i];
+            if (obj->vHandle == 0 || obj->pHandle == 0)
+                continue;
+            loaded++;
+            if (obj->lastUse != space->tick &&
+                    (lru == NULL || obj->lastUse < lru->lastUse)) {
+                lru = obj;
+            }
+        }
+        if (loaded < TPM2_RM_MAX_LOADED)
+            break;
+        if (lru == NULL)
+            rc = TPM_RC_OBJECT_MEMORY;
+        else
+            rc = TPM2_RM_Evict(ctx, space, lru);
+    }
+    return rc;
+}
+
+static TPM_RC TPM2_RM_LoadObj(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    TPM2_RM_OBJECT* obj)
+{
+    TPM_RC rc;
+
+    rc = TPM2_RM_MakeRoom(ctx, space);
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_RM_LoadContext(ctx, &obj->context, &obj->pHandle);
+    if (rc == TPM_RC_SUCCESS)
+        space->stats.loads++;
+    return rc;
+}
+
+/* A session keeps its handle when it is saved and loaded again */
+static TPM_RC TPM2_RM_LoadSess(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    TPM2_RM_SESSION* sess)
+{
+    TPM_RC rc = TPM_RC_SUCCESS;
+    TPM_HANDLE handle;
+
+    if (!sess->loaded) {
+        rc = TPM2_RM_LoadContext(ctx, &sess->context, &handle);
+        if (rc == TPM_RC_SUCCESS) {
+            sess->loaded = 1;
+            space->stats.loads++;
+        }
+    }
+    return rc;
+}
+
+/* Answers the command without the TPM */
+static void TPM2_RM_Reply(TPM2_Packet* packet, TPM2_RM_XFER* xfer,
+    TPM_RC rc)
+{
+    packet->pos = 0;
+    TPM2_Packet_AppendU16(packet, TPM_ST_NO_SESSIONS);
+    TPM2_Packet_AppendU32(packet, TPM2_HEADER_SIZE);
+    TPM2_Packet_AppendU32(packet, rc);
+    xfer->done = 1;
+}
+
+/* Translates the virtual handles of the command in packet, loading evicted
+ * objects and saved sessions and making room for a new object. Commands the
+ * space does not allow and flushes of evicted objects are answered here,
+ * xfer->done is set then. A NULL space leaves the command as it is. */
+static TPM_RC TPM2_RM_Command(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    TPM2_Packet* packet, TPM2_RM_XFER* xfer)
+{
+    TPM_RC rc = TPM_RC_SUCCESS;
+    TPM_ST tag;
+    TPM_CC cc;
+    TPM_HANDLE handle;
+    TPM2_RM_OBJECT* obj;
+    UINT32 authSz;
+    UINT16 sz;
+    BYTE attrib;
+    int cmdSz = packet->pos;
+    int i, authEnd, newObj = 0, newSess = 0;
+
+    XMEMSET(xfer, 0, sizeof(*xfer));
+    if (space == NULL || cmdSz < TPM2_HEADER_SIZE)
+        return TPM_RC_SUCCESS;
+
+    packet->pos = 0;
+    TPM2_Packet_ParseU16(packet, &tag);
+    TPM2_Packet_ParseU32(packet, NULL);
+    TPM2_Packet_ParseU32(packet, &cc);
+    xfer->cmd = TPM2_GetCmdHandles(cc);
+    if (xfer->cmd == NULL) {
+        packet->pos = cmdSz;
+        if (space->isolate)
+            TPM2_RM_Reply(packet, xfer, TPM_RC_COMMAND_CODE);
+        return TPM_RC_SUCCESS;
+    }
+
+    /* mark all objects of the command first, so loading one of them does
+     * not evict another */
+    space->tick++;
+    for (i = 0; i < xfer->cmd->inHandleCnt; i++) {
+        TPM2_Packet_ParseU32(packet, &handle);
+        if ((handle & HR_RANGE_MASK) == HR_TRANSIENT) {
+            obj = TPM2_RM_FindObj(space, handle);
+            if (obj != NULL) {
+                obj->lastUse = space->tick;
+                xfer->obj[i] = obj;
+            }
+            else if (space->isolate) {
+                TPM2_RM_Reply(packet, xfer, TPM_RC_HANDLE + TPM_RC_H +
+                    (TPM_RC_1 * (i + 1)));
+                return TPM_RC_SUCCESS;
+            }
+        }
+        else if (TPM2_RM_IsSession(handle)) {
+            xfer->sess[i] = TPM2_RM_FindSess(space, handle);
+            if (xfer->sess[i] == NULL && space->isolate) {
+                TPM2_RM_Reply(packet, xfer, TPM_RC_HANDLE + TPM_RC_H +
+                    (TPM_RC_1 * (i + 1)));
+                return TPM_RC_SUCCESS;
+            }
+        }
+    }
+
+    /* sessions of the authorization area */
+    if (tag == TPM_ST_SESSIONS) {
+        TPM2_Packet_ParseU32(packet, &authSz);
+        authEnd = packet->pos + (int)authSz;
+        for (i = 0; i < MAX_SESSION_NUM && packet->pos < authEnd; i++) {
+            TPM2_Packet_ParseU32(packet, &handle);
+            TPM2_Packet_ParseU16(packet, &sz);
+            packet->pos += sz;
+            TPM2_Packet_ParseU8(packet, &attrib);
+            TPM2_Packet_ParseU16(packet, &sz);
+            packet->pos += sz;
+            if (!TPM2_RM_IsSession(handle))
+                continue;
+            xfer->auth[i] = TPM2_RM_FindSess(space, handle);
+            xfer->authEnd[i] = (attrib & TPMA_SESSION_continueSession) == 0;
+            if (xfer->auth[i] == NULL && space->isolate) {
+                TPM2_RM_Reply(packet, xfer, TPM_RC_HANDLE + TPM_RC_S +
+                    (TPM_RC_1 * (i + 1)));
+                return TPM_RC_SUCCESS;
+            }
+        }
+    }
+
+    obj = xfer->obj[0];
+    if ((xfer->cmd->flags & TPM2_CMD_FLUSH) && obj != NULL) {
+        if (obj->pHandle == 0) {
+            /* nothing left in the TPM, drop the entry */
+            XMEMSET(obj, 0, sizeof(*obj));
+            TPM2_RM_Reply(packet, xfer, TPM_RC_SUCCESS);
+            return TPM_RC_SUCCESS;
+        }
+    }
+    else if ((xfer->cmd->flags & TPM2_CMD_FLUSH) == 0) {
+        for (i = 0; i < xfer->cmd->inHandleCnt && rc == TPM_RC_SUCCESS; i++) {
+            obj = xfer->obj[i];
+            if (obj != NULL) {
+                space->stats.uses++;
+                if (obj->pHandle == 0)
+                    rc = TPM2_RM_LoadObj(ctx, space, obj);
+                /* a sequence changes with every use */
+                if (obj->seq)
+                    obj->saved = 0;
+            }
+            if (xfer->sess[i] != NULL && rc == TPM_RC_SUCCESS)
+                rc = TPM2_RM_LoadSess(ctx, space, xfer->sess[i]);
+        }
+        for (i = 0; i < MAX_SESSION_NUM && rc == TPM_RC_SUCCESS; i++) {
+            if (xfer->auth[i] != NULL)
+                rc = TPM2_RM_LoadSess(ctx, space, xfer->auth[i]);
+        }
+    }
+
+    /* a context may hold an object or a session */
+    if (xfer->cmd->flags & TPM2_CMD_OUT_OBJECT) {
+        newObj = 1;
+        if (xfer->cmd->flags & TPM2_CMD_OUT_SESSION) {
+            packet->pos = TPM2_HEADER_SIZE + sizeof(UINT64);
+            TPM2_Packet_ParseU32(packet, &handle);
+            newObj = !TPM2_RM_IsSession(handle);
+        }
+    }
+    newSess = !newObj && (xfer->cmd->flags & TPM2_CMD_OUT_SESSION);
+    if (rc == TPM_RC_SUCCESS && newObj) {
+        for (i = 0; i < TPM2_RM_MAX_OBJECTS; i++) {
+            if (space->obj[i].vHandle == 0)
+                break;
+        }
+        if (i == TPM2_RM_MAX_OBJECTS) {
+            TPM2_RM_Reply(packet, xfer, TPM_RC_OBJECT_MEMORY);
+            return TPM_RC_SUCCESS;
+        }
+        rc = TPM2_RM_MakeRoom(ctx, space);
+    }
+    if (rc == TPM_RC_SUCCESS && newSess && space->isolate &&
+            TPM2_RM_FindSess(space, 0) == NULL) {
+        TPM2_RM_Reply(packet, xfer, TPM_RC_SESSION_MEMORY);
+        return TPM_RC_SUCCESS;
+    }
+
+    /* patch in the TPM handles */
+    for (i = 0; i < xfer->cmd->inHandleCnt && rc == TPM_RC_SUCCESS; i++) {
+        if (xfer->obj[i] != NULL) {
+            TPM2_Packet_U32ToByteArray(xfer->obj[i]->pHandle,
+                &packet->buf[TPM2_HEADER_SIZE + i * sizeof(TPM_HANDLE)]);
+        }
+    }
+
+    packet->pos = cmdSz;
+    return rc;
+}
+
+/* Gives a created object a virtual handle, records a started session and
+ * drops the objects and sessions the command flushed from the TPM */
+static void TPM2_RM_Response(TPM2_RM_SPACE* space, TPM2_Packet* packet,
+    TPM2_RM_XFER* xfer)
+{
+    TPM2_RM_OBJECT* obj = NULL;
+    TPM2_RM_SESSION* sess;
+    TPM_HANDLE handle, vHandle;
+    int i, pos = packet->pos;
+
+    if (xfer->cmd == NULL || xfer->done)
+        return;
+
+    for (i = 0; i < xfer->cmd->inHandleCnt; i++) {
+        if (xfer->obj[i] != NULL && ((xfer->cmd->flags & TPM2_CMD_FLUSH) ||
+                ((xfer->cmd->flags & TPM2_CMD_END_SEQ) &&
+                    xfer->obj[i]->seq))) {
+            XMEMSET(xfer->obj[i], 0, sizeof(TPM2_RM_OBJECT));
+        }
+        if (xfer->sess[i] != NULL && (xfer->cmd->flags & TPM2_CMD_FLUSH))
+            XMEMSET(xfer->sess[i], 0, sizeof(TPM2_RM_SESSION));
+    }
+    for (i = 0; i < MAX_SESSION_NUM; i++) {
+        if (xfer->auth[i] != NULL && xfer->authEnd[i])
+            XMEMSET(xfer->auth[i], 0, sizeof(TPM2_RM_SESSION));
+    }
+
+    if ((xfer->cmd->flags & (TPM2_CMD_OUT_OBJECT | TPM2_CMD_OUT_SESSION)) ==
+            0 || packet->size < TPM2_HEADER_SIZE + (int)sizeof(TPM_HANDLE)) {
+        return;
+    }
+    packet->pos = TPM2_HEADER_SIZE;
+    TPM2_Packet_ParseU32(packet, &handle);
+    packet->pos = pos;
+
+    if (TPM2_RM_IsSession(handle)) {
+        sess = TPM2_RM_FindSess(space, 0);
+        if (sess != NULL) {
+            sess->handle = handle;
+            sess->loaded = 1;
+        }
+        return;
+    }
+    if ((handle & HR_RANGE_MASK) != HR_TRANSIENT ||
+            (xfer->cmd->flags & TPM2_CMD_OUT_OBJECT) == 0) {
+        return;
+    }
+    for (i = 0; i < TPM2_RM_MAX_OBJECTS && obj == NULL; i++) {
+        if (space->obj[i].vHandle == 0)
+            obj = &space->obj[i];
+    }
+    if (obj == NULL)
+        return;
+
+    /* next virtual handle not in use */
+    do {
+        vHandle = TPM2_RM_HANDLE_FIRST +
+            (space->next++ % (HR_HANDLE_MASK - (TPM2_RM_HANDLE_FIRST &
+                HR_HANDLE_MASK) + 1));
+    } while (TPM2_RM_FindObj(space, vHandle) != NULL);
+
+    obj->pHandle = handle;
+    obj->vHandle = vHandle;
+    obj->lastUse = space->tick;
+    obj->saved = 0;
+    obj->seq = (xfer->cmd->flags & TPM2_CMD_OUT_SEQ) != 0;
+    TPM2_Packet_U32ToByteArray(vHandle, &packet->buf[TPM2_HEADER_SIZE]);
+}
+#endif /* WOLFTPM_RESOURCE_MGR */
+
+static TPM_RC TPM2_SendCommandAuthOnce(TPM2_CTX* ctx, TPM2_Packet* packet,
+    CmdInfo_t* info)
+{
+    TPM_RC rc = TPM_RC_FAILURE;
+    TPM_ST tag;
+    TPM_CC cmdCode;
+    BYTE *cmd;
+    UINT32 cmdSz, respSz;
+#ifdef WOLFTPM_RESOURCE_MGR
+    TPM2_RM_XFER xfer;
+#endif
+
+    if (ctx == NULL || packet == NULL || info == NULL)
+        return BAD_FUNC_ARG;
+
+#ifdef WOLFTPM_PIPELINE
+    if (ctx->pipeEnable)
+        return TPM2_PipeCommand(ctx, packet, info);
+#endif
+
+    cmd = packet->buf;
+    cmdSz = packet->pos;
+    (void)cmd;
+
+    /* restart the unmarshalling position */
+    packet->pos = 0;
+    TPM2_Packet_ParseU16(packet, &tag);
+    TPM2_Packet_ParseU32(packet, NULL);
+    TPM2_Packet_ParseU32(packet, &cmdCode);  /* Extract TPM Command Code */
+
+    /* Is auth session required for this TPM command? */
+    if (tag == TPM_ST_SESSIONS) {
+        /* Is there at least one auth session present? */
+        if (info->authCnt < 1 || ctx->session == NULL)
+            return TPM_RC_AUTH_MISSING;
+
+    #ifdef WOLFTPM_DEBUG_VERBOSE
+        printf("Found %d auth sessions\n", info->authCnt);
     #endif
 
-        wolfCrypt_Init();
+        rc = TPM2_CommandProcess(ctx, ctx->session, packet, info, cmdCode,
+            cmdSz, NULL);
+        if (rc != 0)
+            return rc;
+    }
+
+    /* reset packet->pos to total command length (send command requires it) */
+    packet->pos = cmdSz;
+
+#ifdef WOLFTPM_RESOURCE_MGR
+    /* translate virtual handles, then submit command and wait for response */
+    rc = TPM2_RM_Command(ctx, ctx->rmEnable ? &ctx->rm : NULL, packet, &xfer);
+    if (rc == TPM_RC_SUCCESS && !xfer.done)
+        rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+#else
+    /* submit command and wait for response */
+    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+#endif
+    if (rc != 0)
+        return rc;
+
+    /* parse response */
+    rc = TPM2_Packet_Parse(rc, packet);
+    respSz = packet->size;
+
+    /* restart the unmarshalling position */
+    packet->pos = 0;
+    TPM2_Packet_ParseU16(packet, &tag);
+
+    /* Is auth session required for this TPM command? */
+    if (rc == TPM_RC_SUCCESS && tag == TPM_ST_SESSIONS) {
+        rc = TPM2_ResponseProcess(ctx->session, packet, info, cmdCode,
+            respSz);
+    }
+#ifdef WOLFTPM_RESOURCE_MGR
+    if (rc == TPM_RC_SUCCESS)
+        TPM2_RM_Response(&ctx->rm, packet, &xfer);
+#endif
+
+    /* Caller expects packet position to be at end of header */
+    packet->pos = TPM2_HEADER_SIZE;
+
+    return rc;
+}
+
+static TPM_RC TPM2_SendCommandOnce(TPM2_CTX* ctx, TPM2_Packet* packet)
+{
+    TPM_RC rc;
+#ifdef WOLFTPM_RESOURCE_MGR
+    TPM2_RM_XFER xfer;
+#endif
+
+    if (ctx == NULL || packet == NULL)
+        return BAD_FUNC_ARG;
+
+#ifdef WOLFTPM_PIPELINE
+    if (ctx->pipeEnable)
+        return TPM2_PipeCommand(ctx, packet, NULL);
+#endif
+
+#ifdef WOLFTPM_RESOURCE_MGR
+    /* translate virtual handles, then submit command and wait for response */
+    rc = TPM2_RM_Command(ctx, ctx->rmEnable ? &ctx->rm : NULL, packet, &xfer);
+    if (rc == TPM_RC_SUCCESS && !xfer.done)
+        rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+#else
+    /* submit command and wait for response */
+    rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, packet);
+#endif
+    if (rc != 0)
+        return rc;
+
+#ifdef WOLFTPM_RESOURCE_MGR
+    rc = TPM2_Packet_Parse(rc, packet);
+    if (rc == TPM_RC_SUCCESS)
+        TPM2_RM_Response(&ctx->rm, packet, &xfer);
+    return rc;
+#else
+    return TPM2_Packet_Parse(rc, packet);
+#endif
+}
+
+#ifdef WOLFTPM_AUTO_RETRY
+/* Warnings of a TPM that did not run the command and can run it later */
+static int TPM2_IsRetryRc(TPM_RC rc)
+{
+    return rc == TPM_RC_RETRY || rc == TPM_RC_YIELDED || rc == TPM_RC_TESTING;
+}
+
+/* Backoff before resubmission n, TPM2_RETRY_BASE_US doubled n times and
+ * capped, with the second half picked at random so callers refused at the
+ * same time do not come back at the same time */
+static word32 TPM2_RetryDelay(TPM2_CTX* ctx, int n)
+{
+    word32 us = TPM2_RETRY_BASE_US;
+    word32 x = ctx->retrySeed;
+
+    while (n-- > 0 && us < TPM2_RETRY_MAX_US)
+        us <<= 1;
+    if (us > TPM2_RETRY_MAX_US)
+        us = TPM2_RETRY_MAX_US;
+
+    /* xorshift, the jitter needs no cryptographic quality */
+    if (x == 0)
+        x = (word32)(size_t)ctx | 1;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ctx->retrySeed = x;
+
+    return us / 2 + x % (us / 2 + 1);
+}
+
+/* Sleeps us with the hwLock dropped, so other commands use the TPM in the
+ * meantime, and restores the command of cmdSz into packet. They may reuse
+ * cmdBuf, retryBuf and ctx->session, so the command waits on the stack. The
+ * stack copy is only paid for by a command that is refused. */
+static TPM_RC TPM2_RetryWait(TPM2_CTX* ctx, TPM2_Packet* packet, int cmdSz,
+    word32 us)
+{
+    byte cmd[MAX_COMMAND_SIZE];
+    TPM2_AUTH_SESSION* session = ctx->session;
+
+    XMEMCPY(cmd, ctx->retryBuf, cmdSz);
+    TPM2_ReleaseLockHw(ctx);
+    XTPM_SLEEP_US(us);
+    if (TPM2_AcquireLockHw(ctx) != TPM_RC_SUCCESS)
+        return TPM_RC_FAILURE;
+
+    ctx->session = session;
+    XMEMCPY(ctx->retryBuf, cmd, cmdSz);
+    XMEMCPY(packet->buf, cmd, cmdSz);
+    packet->pos = cmdSz;
+    packet->size = MAX_COMMAND_SIZE;
+    return TPM_RC_SUCCESS;
+}
+
+/* Sends the command again while the TPM refuses it with a warning. Every
+ * attempt starts from the caller's command, so nonceCaller, HMAC and
+ * parameter encryption are computed afresh and virtual handles translated
+ * again. A refusing TPM keeps nonceTPM and no response auth is processed. */
+static TPM_RC TPM2_SendCommandRetry(TPM2_CTX* ctx, TPM2_Packet* packet,
+    CmdInfo_t* info)
+{
+    TPM_RC rc;
+    TPM_CC cc;
+    TPM2_RETRY_STAT* stat = NULL;
+    int cmdSz = packet->pos;
+    int n;
+
+#ifdef WOLFTPM_PIPELINE
+    if (ctx->pipeEnable) {
+        return (info != NULL) ? TPM2_SendCommandAuthOnce(ctx, packet, info) :
+            TPM2_SendCommandOnce(ctx, packet);
+    }
+#endif
+
+    XMEMCPY(&cc, &packet->buf[6], sizeof(cc));
+    cc = TPM2_Packet_SwapU32(cc);
+    if (cc >= TPM_CC_FIRST && cc <= TPM_CC_LAST)
+        stat = &ctx->retryStat[cc - TPM_CC_FIRST];
+    XMEMCPY(ctx->retryBuf, packet->buf, cmdSz);
+
+    for (n = 0; ; n++) {
+        rc = (info != NULL) ? TPM2_SendCommandAuthOnce(ctx, packet, info) :
+            TPM2_SendCommandOnce(ctx, packet);
+        if (!TPM2_IsRetryRc(rc))
+            break;
+        if (n == TPM2_RETRY_MAX) {
+            if (stat != NULL)
+                stat->exhausted++;
+            break;
+        }
+        if (stat != NULL)
+            stat->retries++;
+    #ifdef DEBUG_WOLFTPM
+        printf("TPM2: command 0x%x refused with 0x%x, retry %d\n",
+            (word32)cc, rc, n + 1);
+    #endif
+
+        if (TPM2_RetryWait(ctx, packet, cmdSz, TPM2_RetryDelay(ctx, n)) !=
+                TPM_RC_SUCCESS) {
+            rc = TPM_RC_FAILURE;
+            break;
+        }
+    #ifdef WOLFTPM_PIPELINE
+        /* pipeline mode was enabled meanwhile, the caller gets the warning */
+        if (ctx->pipeEnable)
+            break;
+    #endif
+    }
+
+    return rc;
+}
+#endif /* WOLFTPM_AUTO_RETRY */
+
+static TPM_RC TPM2_SendCommandAuth(TPM2_CTX* ctx, TPM2_Packet* packet,
+    CmdInfo_t* info)
+{
+    if (ctx == NULL || packet == NULL || info == NULL)
+        return BAD_FUNC_ARG;
+#ifdef WOLFTPM_AUTO_RETRY
+    return TPM2_SendCommandRetry(ctx, packet, info);
+#else
+    return TPM2_SendCommandAuthOnce(ctx, packet, info);
+#endif
+}
+
+static TPM_RC TPM2_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
+{
+    if (ctx == NULL || packet == NULL)
+        return BAD_FUNC_ARG;
+#ifdef WOLFTPM_AUTO_RETRY
+    return TPM2_SendCommandRetry(ctx, packet, NULL);
+#else
+    return TPM2_SendCommandOnce(ctx, packet);
+#endif
+}
+
+static TPM_ST TPM2_GetTag(TPM2_CTX* ctx)
+{
+    TPM_ST st = TPM_ST_NO_SESSIONS;
+    if (ctx && ctx->session) {
+        int authCount = TPM2_GetSessionAuthCount(ctx);
+        if (authCount == 1 && ctx->session[0].sessionHandle != TPM_RS_PW) {
+            st = TPM_ST_SESSIONS;
+        }
+    }
+    return st;
+}
+
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+static inline void TPM2_WolfCrypt_Init(void)
+{
+    /* track reference count for wolfCrypt initialization */
+    if (gWolfCryptRefCount == 0) {
+    #ifdef DEBUG_WOLFSSL
+        wolfSSL_Debugging_ON();
+    #endif
+
+        wolfCrypt_Init();
+    }
+    gWolfCryptRefCount++;
+}
+#endif
+
+/******************************************************************************/
+/* --- Public Functions -- */
+/******************************************************************************/
+TPM2_CTX* TPM2_GetActiveCtx(void)
+{
+    return gActiveTPM;
+}
+
+void TPM2_SetActiveCtx(TPM2_CTX* ctx)
+{
+    gActiveTPM = ctx;
+}
+
+TPM_RC TPM2_SetSessionAuth_ex(TPM2_CTX* ctx, TPM2_AUTH_SESSION* session)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        ctx->session = session;
+    #ifdef WOLFTPM_PIPELINE
+        /* threads sharing ctx keep their own sessions */
+        if (pthread_setspecific(ctx->pipeSessionKey, session) != 0)
+            rc = TPM_RC_FAILURE;
+    #endif
+
+        TPM2_ReleaseLock(ctx);
+    }
+    return rc;
+}
+
+TPM_RC TPM2_SetSessionAuth(TPM2_AUTH_SESSION* session)
+{
+    return TPM2_SetSessionAuth_ex(TPM2_GetActiveCtx(), session);
+}
+
+/* Finds the number of active Auth Session in the given TPM2 context */
+int TPM2_GetSessionAuthCount(TPM2_CTX* ctx)
+{
+    int sessionCount, sessionHandle;
+
+    if (ctx == NULL || ctx->session == NULL)
+        return BAD_FUNC_ARG;
+
+    for (sessionCount = 0; sessionCount < MAX_SESSION_NUM; sessionCount++) {
+        sessionHandle = ctx->session[sessionCount].sessionHandle;
+        /* According to the TCG Spec, Part 1, Chapter 15.4
+         * Session Handles have most significant octet at
+         * 0x02 for HMAC sessions
+         * 0x03 for Policy sessions
+         * Password sessions use predefined value of TPM_RS_PW
+         * Trial sessions are not of interest
+         */
+        if (sessionHandle != TPM_RS_PW) {
+            /* Not a password session, mask the most significant octet(MSO) */
+            sessionHandle &= 0xFF000000;
+            /* Check MSO for an HMAC or Policy session, otherwise invalid */
+            if ((sessionHandle ^ 0x02000000) && (sessionHandle ^ 0x03000000))
+                break;
+        }
+    }
+
+    return sessionCount;
+}
+
+TPM_RC TPM2_ChipStartup(TPM2_CTX* ctx, int timeoutTries)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+
+        /* Wait for chip startup to complete */
+        rc = TPM2_TIS_StartupWait(ctx, timeoutTries);
+        if (rc == TPM_RC_SUCCESS) {
+
+            /* Request locality for TPM module */
+            rc = TPM2_TIS_RequestLocality(ctx, timeoutTries);
+            if (rc == TPM_RC_SUCCESS) {
+
+                /* Get device information */
+                rc = TPM2_TIS_GetInfo(ctx);
+            }
+        }
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_SetHalIoCb(TPM2_CTX* ctx, TPM2HalIoCb ioCb, void* userCtx)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL || ioCb == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        ctx->ioCb = ioCb;
+        ctx->userCtx = userCtx;
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+#ifndef WOLFTPM_ADV_IO
+TPM_RC TPM2_SetHalIoVecCb(TPM2_CTX* ctx, TPM2HalIoVecCb ioVecCb)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        ctx->ioVecCb = ioVecCb;
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_SetHalMaxFrame(TPM2_CTX* ctx, word16 maxFrame)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL || maxFrame == 0) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        rc = TPM2_TIS_SetMaxFrame(ctx, maxFrame);
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+#endif
+
+#ifdef WOLFTPM_PIPELINE
+TPM_RC TPM2_SetPipeline(TPM2_CTX* ctx, int enable)
+{
+    TPM_RC rc;
+    int i;
+
+    if (ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLockHw(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        /* commands in the pipeline finish in the mode they started in */
+        for (i = 0; i < TPM2_PIPE_DEPTH; i++) {
+            if (ctx->pipe[i].state != TPM2_PIPE_FREE) {
+                rc = TPM_RC_FAILURE;
+            }
+        }
+        if (rc == TPM_RC_SUCCESS)
+            ctx->pipeEnable = (enable != 0);
+
+        TPM2_ReleaseLockHw(ctx);
+    }
+
+    return rc;
+}
+#endif
+
+#ifdef WOLFTPM_CMD_PRIORITY
+TPM_RC TPM2_SetCmdPriority(TPM2_CTX* ctx, TPM2_CMD_PRIO prio)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL || (int)prio < TPM2_PRIO_BULK || prio >= TPM2_PRIO_COUNT) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_PrioInit(ctx);
+    if (rc == TPM_RC_SUCCESS &&
+            pthread_setspecific(ctx->prioKey, (void*)((size_t)prio + 1)) != 0) {
+        rc = TPM_RC_FAILURE;
+    }
+    return rc;
+}
+
+TPM2_CMD_PRIO TPM2_GetCmdPriority(TPM2_CTX* ctx)
+{
+    if (ctx == NULL || !ctx->hwLockInit)
+        return TPM2_PRIO_NORMAL;
+    return (TPM2_CMD_PRIO)TPM2_PrioClass(ctx);
+}
+#endif
+
+#ifdef WOLFTPM_RESOURCE_MGR
+TPM_RC TPM2_SetResourceMgr(TPM2_CTX* ctx, int enable)
+{
+    TPM_RC rc;
+    int i;
+
+    if (ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        /* virtual handles held by the caller would become invalid */
+        for (i = 0; i < TPM2_RM_MAX_OBJECTS; i++) {
+            if (ctx->rm.obj[i].vHandle != 0) {
+                rc = TPM_RC_FAILURE;
+            }
+        }
+        if (rc == TPM_RC_SUCCESS) {
+            ctx->rmEnable = (enable != 0);
+            XMEMSET(&ctx->rm, 0, sizeof(ctx->rm));
+        }
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_GetResourceMgrStats(TPM2_CTX* ctx, TPM2_RM_STATS* stats)
+{
+    TPM_RC rc;
+
+    if (ctx == NULL || stats == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        XMEMCPY(stats, &ctx->rm.stats, sizeof(*stats));
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_SpaceCommand(TPM2_CTX* ctx, TPM2_RM_SPACE* space,
+    const byte* cmd, word32 cmdSz, byte* rsp, word32* rspSz)
+{
+    TPM_RC rc;
+    TPM2_Packet packet;
+    TPM2_RM_XFER xfer;
+
+    if (ctx == NULL || space == NULL || cmd == NULL || rsp == NULL ||
+            rspSz == NULL || cmdSz < TPM2_HEADER_SIZE ||
+            cmdSz > MAX_COMMAND_SIZE) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_Packet_Init(ctx, &packet);
+        XMEMCPY(packet.buf, cmd, cmdSz);
+        packet.pos = (int)cmdSz;
+
+        rc = TPM2_RM_Command(ctx, space, &packet, &xfer);
+        if (rc == TPM_RC_SUCCESS && !xfer.done)
+            rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, &packet);
+        if (rc == TPM_RC_SUCCESS) {
+            /* the TPM return code stays in the response */
+            if (TPM2_Packet_Parse(rc, &packet) == TPM_RC_SUCCESS)
+                TPM2_RM_Response(space, &packet, &xfer);
+            if ((word32)packet.size > *rspSz) {
+                rc = BUFFER_E;
+            }
+            else {
+                XMEMCPY(rsp, packet.buf, packet.size);
+                *rspSz = (word32)packet.size;
+            }
+        }
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_SpaceSwapOut(TPM2_CTX* ctx, TPM2_RM_SPACE* space)
+{
+    TPM_RC rc;
+    int i;
+
+    if (ctx == NULL || space == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        for (i = 0; i < TPM2_RM_MAX_OBJECTS && rc == TPM_RC_SUCCESS; i++) {
+            if (space->obj[i].vHandle != 0 && space->obj[i].pHandle != 0)
+                rc = TPM2_RM_Evict(ctx, space, &space->obj[i]);
+        }
+        /* a saved session leaves its slot but keeps its handle */
+        for (i = 0; i < TPM2_RM_MAX_SESSIONS && rc == TPM_RC_SUCCESS; i++) {
+            TPM2_RM_SESSION* sess = &space->sess[i];
+            if (sess->handle != 0 && sess->loaded) {
+                rc = TPM2_RM_SaveContext(ctx, sess->handle, &sess->context);
+                if (rc == TPM_RC_SUCCESS) {
+                    sess->loaded = 0;
+                    space->stats.saves++;
+                }
+            }
+        }
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+
+TPM_RC TPM2_SpaceFlush(TPM2_CTX* ctx, TPM2_RM_SPACE* space)
+{
+    TPM_RC rc, ret;
+    int i;
+
+    if (ctx == NULL || space == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        /* flush as much as possible, the entries are dropped anyway */
+        for (i = 0; i < TPM2_RM_MAX_OBJECTS; i++) {
+            if (space->obj[i].vHandle != 0 && space->obj[i].pHandle != 0) {
+                ret = TPM2_RM_Flush(ctx, space->obj[i].pHandle);
+                if (rc == TPM_RC_SUCCESS)
+                    rc = ret;
+            }
+        }
+        /* saved sessions are flushed by their handle as well */
+        for (i = 0; i < TPM2_RM_MAX_SESSIONS; i++) {
+            if (space->sess[i].handle != 0) {
+                ret = TPM2_RM_Flush(ctx, space->sess[i].handle);
+                if (rc == TPM_RC_SUCCESS)
+                    rc = ret;
+            }
+        }
+        XMEMSET(space->obj, 0, sizeof(space->obj));
+        XMEMSET(space->sess, 0, sizeof(space->sess));
+
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
+}
+#endif
+
+#ifdef WOLFTPM_AUTO_RETRY
+int TPM2_GetRetryStats(TPM2_CTX* ctx, TPM2_RETRY_STAT* stats, int maxCount)
+{
+    int count = 0;
+    TPM_CC cc;
+    TPM2_RETRY_STAT* stat;
+
+    if (ctx == NULL || stats == NULL || maxCount <= 0) {
+        return BAD_FUNC_ARG;
+    }
+
+    for (cc = TPM_CC_FIRST; cc <= TPM_CC_LAST && count < maxCount; cc++) {
+        stat = &ctx->retryStat[cc - TPM_CC_FIRST];
+        if (stat->retries == 0 && stat->exhausted == 0)
+            continue;
+        stats[count].cc = cc;
+        stats[count].retries = stat->retries;
+        stats[count].exhausted = stat->exhausted;
+        count++;
+    }
+
+    return count;
+}
+#endif
+
+#ifdef WOLFTPM_HOST_DRBG
+int TPM2_SetDrbgReseed(TPM2_CTX* ctx, word32 maxBytes, word32 maxRequests)
+{
+    int rc;
+
+    if (ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_DataLock(ctx);
+        ctx->drbg.reseedBytes = maxBytes;
+        ctx->drbg.reseedReqs = maxRequests;
+        TPM2_DataUnlock(ctx);
+        TPM2_ReleaseLock(ctx);
     }
-    gWolfCryptRefCount++;
-}
-#endif
 
-/******************************************************************************/
-/* --- Public Functions -- */
-/******************************************************************************/
-TPM2_CTX* TPM2_GetActiveCtx(void)
-{
-    return gActiveTPM;
+    return rc;
 }
 
-void TPM2_SetActiveCtx(TPM2_CTX* ctx)
+int TPM2_GetDrbgStats(TPM2_CTX* ctx, TPM2_DRBG_STATS* stats)
 {
-    gActiveTPM = ctx;
+    int rc;
+
+    if (ctx == NULL || stats == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    rc = TPM2_AcquireLock(ctx);
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_DataLock(ctx);
+        *stats = ctx->drbg.stats;
+        TPM2_DataUnlock(ctx);
+        TPM2_ReleaseLock(ctx);
+    }
+
+    return rc;
 }
+#endif
 
-TPM_RC TPM2_SetSessionAuth(TPM2_AUTH_SESSION* session)
+TPM_RC TPM2_SubmitCommand(TPM2_CTX* ctx, const byte* cmd, word32 cmdSz)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
+    TPM2_Packet packet;
 
-    if (ctx == NULL)
+    if (ctx == NULL || cmd == NULL || cmdSz < TPM2_HEADER_SIZE ||
+            cmdSz > MAX_COMMAND_SIZE) {
         return BAD_FUNC_ARG;
+    }
 
     rc = TPM2_AcquireLock(ctx);
     if (rc == TPM_RC_SUCCESS) {
-        ctx->session = session;
+        if (ctx->cmdState != TPM2_CMD_IDLE) {
+            rc = TPM_RC_FAILURE;
+        }
+        else {
+            /* the command buffer allows framing in place */
+            TPM2_Packet_Init(ctx, &packet);
+            XMEMCPY(packet.buf, cmd, cmdSz);
+            packet.pos = (int)cmdSz;
+
+        #ifdef INTERNAL_SUBMIT_COMMAND
+            rc = (TPM_RC)INTERNAL_SUBMIT_COMMAND(ctx, &packet);
+        #else
+            /* no resumable transport, the command completes here */
+            rc = (TPM_RC)INTERNAL_SEND_COMMAND(ctx, &packet);
+            if (rc == TPM_RC_SUCCESS)
+                ctx->cmdState = TPM2_CMD_DONE;
+        #endif
+        }
 
         TPM2_ReleaseLock(ctx);
     }
+
     return rc;
 }
 
-/* Finds the number of active Auth Session in the given TPM2 context */
-int TPM2_GetSessionAuthCount(TPM2_CTX* ctx)
+static TPM_RC TPM2_CompleteCommand(TPM2_CTX* ctx, byte* rsp, word32* rspSz,
+    int wait)
 {
-    int sessionCount, sessionHandle;
+    TPM_RC rc;
+    TPM2_Packet packet;
+    UINT32 tmpSz;
 
-    if (ctx == NULL || ctx->session == NULL)
+    if (ctx == NULL || rsp == NULL || rspSz == NULL) {
         return BAD_FUNC_ARG;
+    }
 
-    for (sessionCount = 0; sessionCount < MAX_SESSION_NUM; sessionCount++) {
-        sessionHandle = ctx->session[sessionCount].sessionHandle;
-        /* According to the TCG Spec, Part 1, Chapter 15.4
-         * Session Handles have most significant octet at
-         * 0x02 for HMAC sessions
-         * 0x03 for Policy sessions
-         * Password sessions use predefined value of TPM_RS_PW
-         * Trial sessions are not of interest
-         */
-        if (sessionHandle != TPM_RS_PW) {
-            /* Not a password session, mask the most significant octet(MSO) */
-            sessionHandle &= 0xFF000000;
-            /* Check MSO for an HMAC or Policy session, otherwise invalid */
-            if ((sessionHandle ^ 0x02000000) && (sessionHandle ^ 0x03000000))
-                break;
+    rc = TPM2_AcquireLock(ctx);
+    if (rc != TPM_RC_SUCCESS)
+        return rc;
+
+    if (ctx->cmdState == TPM2_CMD_IDLE) {
+        rc = BAD_FUNC_ARG;
+    }
+    else {
+        TPM2_Packet_Init(ctx, &packet);
+    #ifdef INTERNAL_POLL_COMMAND
+        if (ctx->cmdState == TPM2_CMD_EXEC)
+            rc = (TPM_RC)INTERNAL_POLL_COMMAND(ctx, &packet, wait);
+    #else
+        (void)wait;
+    #endif
+        if (rc == TPM_RC_SUCCESS) {
+            XMEMCPY(&tmpSz, &packet.buf[2], sizeof(UINT32));
+            tmpSz = TPM2_Packet_SwapU32(tmpSz);
+            if (tmpSz > *rspSz) {
+                rc = BUFFER_E;
+            }
+            else {
+                XMEMCPY(rsp, packet.buf, tmpSz);
+                *rspSz = tmpSz;
+            }
         }
+        if (rc != (TPM_RC)WC_PENDING_E)
+            ctx->cmdState = TPM2_CMD_IDLE;
     }
 
-    return sessionCount;
+    TPM2_ReleaseLock(ctx);
+
+    return rc;
 }
 
-TPM_RC TPM2_ChipStartup(TPM2_CTX* ctx, int timeoutTries)
+TPM_RC TPM2_PollCommand(TPM2_CTX* ctx, byte* rsp, word32* rspSz)
+{
+    return TPM2_CompleteCommand(ctx, rsp, rspSz, 0);
+}
+
+TPM_RC TPM2_WaitCommand(TPM2_CTX* ctx, byte* rsp, word32* rspSz)
+{
+    return TPM2_CompleteCommand(ctx, rsp, rspSz, 1);
+}
+
+TPM_RC TPM2_SetHalIrqCb(TPM2_CTX* ctx, TPM2HalIrqWaitCb irqWaitCb,
+    void* irqCtx)
 {
     TPM_RC rc;
 
@@ -534,18 +2235,14 @@ TPM_RC TPM2_ChipStartup(TPM2_CTX* ctx, int timeoutTries)
 
     rc = TPM2_AcquireLock(ctx);
     if (rc == TPM_RC_SUCCESS) {
-
-        /* Wait for chip startup to complete */
-        rc = TPM2_TIS_StartupWait(ctx, timeoutTries);
+        rc = TPM2_TIS_EnableIrq(ctx, irqWaitCb != NULL);
         if (rc == TPM_RC_SUCCESS) {
-
-            /* Request locality for TPM module */
-            rc = TPM2_TIS_RequestLocality(ctx, timeoutTries);
-            if (rc == TPM_RC_SUCCESS) {
-
-                /* Get device information */
-                rc = TPM2_TIS_GetInfo(ctx);
-            }
+            ctx->irqWaitCb = irqWaitCb;
+            ctx->irqCtx = irqCtx;
+        }
+        else {
+            ctx->irqWaitCb = NULL;
+            ctx->irqCtx = NULL;
         }
 
         TPM2_ReleaseLock(ctx);
@@ -554,24 +2251,26 @@ TPM_RC TPM2_ChipStartup(TPM2_CTX* ctx, int timeoutTries)
     return rc;
 }
 
-TPM_RC TPM2_SetHalIoCb(TPM2_CTX* ctx, TPM2HalIoCb ioCb, void* userCtx)
+#ifdef WOLFTPM_TIS_OFFLOAD
+TPM_RC TPM2_SetHalCmdCb(TPM2_CTX* ctx, TPM2HalCmdCb cmdCb, void* cmdCtx)
 {
     TPM_RC rc;
 
-    if (ctx == NULL || ioCb == NULL) {
+    if (ctx == NULL) {
         return BAD_FUNC_ARG;
     }
 
     rc = TPM2_AcquireLock(ctx);
     if (rc == TPM_RC_SUCCESS) {
-        ctx->ioCb = ioCb;
-        ctx->userCtx = userCtx;
+        ctx->cmdCb = cmdCb;
+        ctx->cmdCtx = cmdCtx;
 
         TPM2_ReleaseLock(ctx);
     }
 
     return rc;
 }
+#endif
 
 /* If timeoutTries <= 0 then it will not try and startup chip and will
     use existing default locality */
@@ -589,6 +2288,9 @@ TPM_RC TPM2_Init_ex(TPM2_CTX* ctx, TPM2HalIoCb ioCb, void* userCtx,
 #ifndef WOLFTPM2_NO_WOLFCRYPT
     TPM2_WolfCrypt_Init();
 #endif
+#ifdef WOLFTPM_HOST_DRBG
+    TPM2_Drbg_Init(&ctx->drbg);
+#endif
 
 #if defined(WOLFTPM_SWTPM)
     ctx->tcpCtx.fd = -1;
@@ -641,12 +2343,24 @@ TPM_RC TPM2_Cleanup(TPM2_CTX* ctx)
     rc = TPM2_AcquireLock(ctx);
     if (rc == TPM_RC_SUCCESS) {
 
+    #ifdef INTERNAL_ABORT_COMMAND
+        INTERNAL_ABORT_COMMAND(ctx);
+    #endif
+        ctx->cmdState = TPM2_CMD_IDLE;
+
         if (TPM2_GetActiveCtx() == ctx) {
             TPM2_INTERNAL_CLEANUP(ctx);
             /* set non-active */
             TPM2_SetActiveCtx(NULL);
         }
 
+    #ifdef WOLFTPM_TIS_LOCK
+        TPM2_TIS_LockFree(ctx);
+    #endif
+    #ifdef WOLFTPM_HOST_DRBG
+        TPM2_Drbg_Free(&ctx->drbg);
+    #endif
+
         TPM2_ReleaseLock(ctx);
     }
 
@@ -657,7 +2371,8 @@ TPM_RC TPM2_Cleanup(TPM2_CTX* ctx)
         wc_FreeRng(&ctx->rng);
     }
     #endif
-    #ifndef SINGLE_THREADED
+    #if !defined(SINGLE_THREADED) && !defined(WOLFTPM_PIPELINE) && \
+        !defined(WOLFTPM_CMD_PRIORITY)
     if (ctx->hwLockInit) {
         ctx->hwLockInit = 0;
         wc_FreeMutex(&ctx->hwLock);
@@ -673,6 +2388,23 @@ TPM_RC TPM2_Cleanup(TPM2_CTX* ctx)
         wolfCrypt_Cleanup();
     }
 #endif /* !WOLFTPM2_NO_WOLFCRYPT */
+#ifdef WOLFTPM_PIPELINE
+    if (ctx->hwLockInit) {
+        ctx->hwLockInit = 0;
+        pthread_mutex_destroy(&ctx->dataLock);
+        pthread_key_delete(ctx->pipeSessionKey);
+        pthread_cond_destroy(&ctx->pipeCond);
+        pthread_mutex_destroy(&ctx->hwLock);
+    }
+#endif
+#ifdef WOLFTPM_CMD_PRIORITY
+    if (ctx->hwLockInit) {
+        ctx->hwLockInit = 0;
+        pthread_key_delete(ctx->prioKey);
+        pthread_cond_destroy(&ctx->prioCond);
+        pthread_mutex_destroy(&ctx->hwLock);
+    }
+#endif
 
     return TPM_RC_SUCCESS;
 }
@@ -681,10 +2413,9 @@ TPM_RC TPM2_Cleanup(TPM2_CTX* ctx)
 /******************************************************************************/
 /* --- BEGIN Standard TPM API's -- */
 /******************************************************************************/
-TPM_RC TPM2_Startup(Startup_In* in)
+TPM_RC TPM2_Startup_ex(TPM2_CTX* ctx, Startup_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -698,16 +2429,25 @@ TPM_RC TPM2_Startup(Startup_In* in)
 
         /* send command */
         rc = TPM2_SendCommand(ctx, &packet);
+    #ifdef WOLFTPM_NAME_CACHE
+        /* transient objects are gone */
+        if (rc == TPM_RC_SUCCESS)
+            TPM2_NameCache_Clear(ctx);
+    #endif
 
         TPM2_ReleaseLock(ctx);
     }
     return rc;
 }
 
-TPM_RC TPM2_Shutdown(Shutdown_In* in)
+TPM_RC TPM2_Startup(Startup_In* in)
+{
+    return TPM2_Startup_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_Shutdown_ex(TPM2_CTX* ctx, Shutdown_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -727,11 +2467,15 @@ TPM_RC TPM2_Shutdown(Shutdown_In* in)
     return rc;
 }
 
+TPM_RC TPM2_Shutdown(Shutdown_In* in)
+{
+    return TPM2_Shutdown_ex(TPM2_GetActiveCtx(), in);
+}
 
-TPM_RC TPM2_SelfTest(SelfTest_In* in)
+
+TPM_RC TPM2_SelfTest_ex(TPM2_CTX* ctx, SelfTest_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -751,11 +2495,15 @@ TPM_RC TPM2_SelfTest(SelfTest_In* in)
     return rc;
 }
 
-TPM_RC TPM2_IncrementalSelfTest(IncrementalSelfTest_In* in,
+TPM_RC TPM2_SelfTest(SelfTest_In* in)
+{
+    return TPM2_SelfTest_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_IncrementalSelfTest_ex(TPM2_CTX* ctx, IncrementalSelfTest_In* in,
     IncrementalSelfTest_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -786,10 +2534,15 @@ TPM_RC TPM2_IncrementalSelfTest(IncrementalSelfTest_In* in,
     return rc;
 }
 
-TPM_RC TPM2_GetTestResult(GetTestResult_Out* out)
+TPM_RC TPM2_IncrementalSelfTest(IncrementalSelfTest_In* in,
+    IncrementalSelfTest_Out* out)
+{
+    return TPM2_IncrementalSelfTest_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_GetTestResult_ex(TPM2_CTX* ctx, GetTestResult_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -814,10 +2567,15 @@ TPM_RC TPM2_GetTestResult(GetTestResult_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_GetCapability(GetCapability_In* in, GetCapability_Out* out)
+TPM_RC TPM2_GetTestResult(GetTestResult_Out* out)
+{
+    return TPM2_GetTestResult_ex(TPM2_GetActiveCtx(), out);
+}
+
+TPM_RC TPM2_GetCapability_ex(TPM2_CTX* ctx, GetCapability_In* in,
+    GetCapability_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -866,10 +2624,14 @@ TPM_RC TPM2_GetCapability(GetCapability_In* in, GetCapability_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_GetRandom(GetRandom_In* in, GetRandom_Out* out)
+TPM_RC TPM2_GetCapability(GetCapability_In* in, GetCapability_Out* out)
+{
+    return TPM2_GetCapability_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_GetRandom_ex(TPM2_CTX* ctx, GetRandom_In* in, GetRandom_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -894,10 +2656,14 @@ TPM_RC TPM2_GetRandom(GetRandom_In* in, GetRandom_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_StirRandom(StirRandom_In* in)
+TPM_RC TPM2_GetRandom(GetRandom_In* in, GetRandom_Out* out)
+{
+    return TPM2_GetRandom_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_StirRandom_ex(TPM2_CTX* ctx, StirRandom_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -918,11 +2684,15 @@ TPM_RC TPM2_StirRandom(StirRandom_In* in)
     return rc;
 }
 
+TPM_RC TPM2_StirRandom(StirRandom_In* in)
+{
+    return TPM2_StirRandom_ex(TPM2_GetActiveCtx(), in);
+}
+
 
-TPM_RC TPM2_PCR_Read(PCR_Read_In* in, PCR_Read_Out* out)
+TPM_RC TPM2_PCR_Read_ex(TPM2_CTX* ctx, PCR_Read_In* in, PCR_Read_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -954,10 +2724,14 @@ TPM_RC TPM2_PCR_Read(PCR_Read_In* in, PCR_Read_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PCR_Extend(PCR_Extend_In* in)
+TPM_RC TPM2_PCR_Read(PCR_Read_In* in, PCR_Read_Out* out)
+{
+    return TPM2_PCR_Read_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PCR_Extend_ex(TPM2_CTX* ctx, PCR_Extend_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -990,11 +2764,15 @@ TPM_RC TPM2_PCR_Extend(PCR_Extend_In* in)
     return rc;
 }
 
+TPM_RC TPM2_PCR_Extend(PCR_Extend_In* in)
+{
+    return TPM2_PCR_Extend_ex(TPM2_GetActiveCtx(), in);
+}
+
 
-TPM_RC TPM2_Create(Create_In* in, Create_Out* out)
+TPM_RC TPM2_Create_ex(TPM2_CTX* ctx, Create_In* in, Create_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1075,10 +2853,15 @@ TPM_RC TPM2_Create(Create_In* in, Create_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_CreateLoaded(CreateLoaded_In* in, CreateLoaded_Out* out)
+TPM_RC TPM2_Create(Create_In* in, Create_Out* out)
+{
+    return TPM2_Create_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_CreateLoaded_ex(TPM2_CTX* ctx, CreateLoaded_In* in,
+    CreateLoaded_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1113,6 +2896,9 @@ TPM_RC TPM2_CreateLoaded(CreateLoaded_In* in, CreateLoaded_Out* out)
 
             TPM2_Packet_ParseU16(&packet, &out->name.size);
             TPM2_Packet_ParseBytes(&packet, out->name.name, out->name.size);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Put(ctx, out->objectHandle, &out->name);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -1120,10 +2906,15 @@ TPM_RC TPM2_CreateLoaded(CreateLoaded_In* in, CreateLoaded_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_CreatePrimary(CreatePrimary_In* in, CreatePrimary_Out* out)
+TPM_RC TPM2_CreateLoaded(CreateLoaded_In* in, CreateLoaded_Out* out)
+{
+    return TPM2_CreateLoaded_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_CreatePrimary_ex(TPM2_CTX* ctx, CreatePrimary_In* in,
+    CreatePrimary_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1199,6 +2990,9 @@ TPM_RC TPM2_CreatePrimary(CreatePrimary_In* in, CreatePrimary_Out* out)
 
             TPM2_Packet_ParseU16(&packet, &out->name.size);
             TPM2_Packet_ParseBytes(&packet, out->name.name, out->name.size);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Put(ctx, out->objectHandle, &out->name);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -1206,11 +3000,15 @@ TPM_RC TPM2_CreatePrimary(CreatePrimary_In* in, CreatePrimary_Out* out)
     return rc;
 }
 
+TPM_RC TPM2_CreatePrimary(CreatePrimary_In* in, CreatePrimary_Out* out)
+{
+    return TPM2_CreatePrimary_ex(TPM2_GetActiveCtx(), in, out);
+}
+
 
-TPM_RC TPM2_Load(Load_In* in, Load_Out* out)
+TPM_RC TPM2_Load_ex(TPM2_CTX* ctx, Load_In* in, Load_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1240,6 +3038,9 @@ TPM_RC TPM2_Load(Load_In* in, Load_Out* out)
             TPM2_Packet_ParseU32(&packet, &paramSz);
             TPM2_Packet_ParseU16(&packet, &out->name.size);
             TPM2_Packet_ParseBytes(&packet, out->name.name, out->name.size);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Put(ctx, out->objectHandle, &out->name);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -1247,10 +3048,14 @@ TPM_RC TPM2_Load(Load_In* in, Load_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_FlushContext(FlushContext_In* in)
+TPM_RC TPM2_Load(Load_In* in, Load_Out* out)
+{
+    return TPM2_Load_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_FlushContext_ex(TPM2_CTX* ctx, FlushContext_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -1264,16 +3069,24 @@ TPM_RC TPM2_FlushContext(FlushContext_In* in)
 
         /* send command */
         rc = TPM2_SendCommand(ctx, &packet);
+    #ifdef WOLFTPM_NAME_CACHE
+        if (rc == TPM_RC_SUCCESS)
+            TPM2_NameCache_Drop(ctx, in->flushHandle);
+    #endif
 
         TPM2_ReleaseLock(ctx);
     }
     return rc;
 }
 
-TPM_RC TPM2_Unseal(Unseal_In* in, Unseal_Out* out)
+TPM_RC TPM2_FlushContext(FlushContext_In* in)
+{
+    return TPM2_FlushContext_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_Unseal_ex(TPM2_CTX* ctx, Unseal_In* in, Unseal_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1305,10 +3118,15 @@ TPM_RC TPM2_Unseal(Unseal_In* in, Unseal_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_StartAuthSession(StartAuthSession_In* in, StartAuthSession_Out* out)
+TPM_RC TPM2_Unseal(Unseal_In* in, Unseal_Out* out)
+{
+    return TPM2_Unseal_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_StartAuthSession_ex(TPM2_CTX* ctx, StartAuthSession_In* in,
+    StartAuthSession_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -1346,10 +3164,14 @@ TPM_RC TPM2_StartAuthSession(StartAuthSession_In* in, StartAuthSession_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PolicyRestart(PolicyRestart_In* in)
+TPM_RC TPM2_StartAuthSession(StartAuthSession_In* in, StartAuthSession_Out* out)
+{
+    return TPM2_StartAuthSession_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PolicyRestart_ex(TPM2_CTX* ctx, PolicyRestart_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -1369,10 +3191,15 @@ TPM_RC TPM2_PolicyRestart(PolicyRestart_In* in)
     return rc;
 }
 
-TPM_RC TPM2_LoadExternal(LoadExternal_In* in, LoadExternal_Out* out)
+TPM_RC TPM2_PolicyRestart(PolicyRestart_In* in)
+{
+    return TPM2_PolicyRestart_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_LoadExternal_ex(TPM2_CTX* ctx, LoadExternal_In* in,
+    LoadExternal_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -1442,6 +3269,9 @@ TPM_RC TPM2_LoadExternal(LoadExternal_In* in, LoadExternal_Out* out)
 
             TPM2_Packet_ParseU16(&packet, &out->name.size);
             TPM2_Packet_ParseBytes(&packet, out->name.name, out->name.size);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Put(ctx, out->objectHandle, &out->name);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -1449,10 +3279,14 @@ TPM_RC TPM2_LoadExternal(LoadExternal_In* in, LoadExternal_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ReadPublic(ReadPublic_In* in, ReadPublic_Out* out)
+TPM_RC TPM2_LoadExternal(LoadExternal_In* in, LoadExternal_Out* out)
+{
+    return TPM2_LoadExternal_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ReadPublic_ex(TPM2_CTX* ctx, ReadPublic_In* in, ReadPublic_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -1475,6 +3309,9 @@ TPM_RC TPM2_ReadPublic(ReadPublic_In* in, ReadPublic_Out* out)
             TPM2_Packet_ParseU16(&packet, &out->qualifiedName.size);
             TPM2_Packet_ParseBytes(&packet, out->qualifiedName.name,
                 out->qualifiedName.size);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Put(ctx, in->objectHandle, &out->name);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -1482,11 +3319,15 @@ TPM_RC TPM2_ReadPublic(ReadPublic_In* in, ReadPublic_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ActivateCredential(ActivateCredential_In* in,
+TPM_RC TPM2_ReadPublic(ReadPublic_In* in, ReadPublic_Out* out)
+{
+    return TPM2_ReadPublic_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ActivateCredential_ex(TPM2_CTX* ctx, ActivateCredential_In* in,
     ActivateCredential_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1525,10 +3366,16 @@ TPM_RC TPM2_ActivateCredential(ActivateCredential_In* in,
     return rc;
 }
 
-TPM_RC TPM2_MakeCredential(MakeCredential_In* in, MakeCredential_Out* out)
+TPM_RC TPM2_ActivateCredential(ActivateCredential_In* in,
+    ActivateCredential_Out* out)
+{
+    return TPM2_ActivateCredential_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_MakeCredential_ex(TPM2_CTX* ctx, MakeCredential_In* in,
+    MakeCredential_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -1567,10 +3414,15 @@ TPM_RC TPM2_MakeCredential(MakeCredential_In* in, MakeCredential_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ObjectChangeAuth(ObjectChangeAuth_In* in, ObjectChangeAuth_Out* out)
+TPM_RC TPM2_MakeCredential(MakeCredential_In* in, MakeCredential_Out* out)
+{
+    return TPM2_MakeCredential_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ObjectChangeAuth_ex(TPM2_CTX* ctx, ObjectChangeAuth_In* in,
+    ObjectChangeAuth_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1610,10 +3462,14 @@ TPM_RC TPM2_ObjectChangeAuth(ObjectChangeAuth_In* in, ObjectChangeAuth_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Duplicate(Duplicate_In* in, Duplicate_Out* out)
+TPM_RC TPM2_ObjectChangeAuth(ObjectChangeAuth_In* in, ObjectChangeAuth_Out* out)
+{
+    return TPM2_ObjectChangeAuth_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Duplicate_ex(TPM2_CTX* ctx, Duplicate_In* in, Duplicate_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1666,10 +3522,14 @@ TPM_RC TPM2_Duplicate(Duplicate_In* in, Duplicate_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Rewrap(Rewrap_In* in, Rewrap_Out* out)
+TPM_RC TPM2_Duplicate(Duplicate_In* in, Duplicate_Out* out)
+{
+    return TPM2_Duplicate_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Rewrap_ex(TPM2_CTX* ctx, Rewrap_In* in, Rewrap_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1721,10 +3581,14 @@ TPM_RC TPM2_Rewrap(Rewrap_In* in, Rewrap_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Import(Import_In* in, Import_Out* out)
+TPM_RC TPM2_Rewrap(Rewrap_In* in, Rewrap_Out* out)
+{
+    return TPM2_Rewrap_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Import_ex(TPM2_CTX* ctx, Import_In* in, Import_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -1770,10 +3634,15 @@ TPM_RC TPM2_Import(Import_In* in, Import_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_RSA_Encrypt(RSA_Encrypt_In* in, RSA_Encrypt_Out* out)
+TPM_RC TPM2_Import(Import_In* in, Import_Out* out)
+{
+    return TPM2_Import_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_RSA_Encrypt_ex(TPM2_CTX* ctx, RSA_Encrypt_In* in,
+    RSA_Encrypt_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -1826,10 +3695,15 @@ TPM_RC TPM2_RSA_Encrypt(RSA_Encrypt_In* in, RSA_Encrypt_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_RSA_Decrypt(RSA_Decrypt_In* in, RSA_Decrypt_Out* out)
+TPM_RC TPM2_RSA_Encrypt(RSA_Encrypt_In* in, RSA_Encrypt_Out* out)
+{
+    return TPM2_RSA_Encrypt_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_RSA_Decrypt_ex(TPM2_CTX* ctx, RSA_Decrypt_In* in,
+    RSA_Decrypt_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1877,10 +3751,15 @@ TPM_RC TPM2_RSA_Decrypt(RSA_Decrypt_In* in, RSA_Decrypt_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ECDH_KeyGen(ECDH_KeyGen_In* in, ECDH_KeyGen_Out* out)
+TPM_RC TPM2_RSA_Decrypt(RSA_Decrypt_In* in, RSA_Decrypt_Out* out)
+{
+    return TPM2_RSA_Decrypt_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ECDH_KeyGen_ex(TPM2_CTX* ctx, ECDH_KeyGen_In* in,
+    ECDH_KeyGen_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -1922,10 +3801,14 @@ TPM_RC TPM2_ECDH_KeyGen(ECDH_KeyGen_In* in, ECDH_KeyGen_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ECDH_ZGen(ECDH_ZGen_In* in, ECDH_ZGen_Out* out)
+TPM_RC TPM2_ECDH_KeyGen(ECDH_KeyGen_In* in, ECDH_KeyGen_Out* out)
+{
+    return TPM2_ECDH_KeyGen_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ECDH_ZGen_ex(TPM2_CTX* ctx, ECDH_ZGen_In* in, ECDH_ZGen_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -1960,11 +3843,15 @@ TPM_RC TPM2_ECDH_ZGen(ECDH_ZGen_In* in, ECDH_ZGen_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ECC_Parameters(ECC_Parameters_In* in,
+TPM_RC TPM2_ECDH_ZGen(ECDH_ZGen_In* in, ECDH_ZGen_Out* out)
+{
+    return TPM2_ECDH_ZGen_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ECC_Parameters_ex(TPM2_CTX* ctx, ECC_Parameters_In* in,
     ECC_Parameters_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -2028,10 +3915,15 @@ TPM_RC TPM2_ECC_Parameters(ECC_Parameters_In* in,
     return rc;
 }
 
-TPM_RC TPM2_ZGen_2Phase(ZGen_2Phase_In* in, ZGen_2Phase_Out* out)
+TPM_RC TPM2_ECC_Parameters(ECC_Parameters_In* in, ECC_Parameters_Out* out)
+{
+    return TPM2_ECC_Parameters_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ZGen_2Phase_ex(TPM2_CTX* ctx, ZGen_2Phase_In* in,
+    ZGen_2Phase_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2068,12 +3960,17 @@ TPM_RC TPM2_ZGen_2Phase(ZGen_2Phase_In* in, ZGen_2Phase_Out* out)
     return rc;
 }
 
+TPM_RC TPM2_ZGen_2Phase(ZGen_2Phase_In* in, ZGen_2Phase_Out* out)
+{
+    return TPM2_ZGen_2Phase_ex(TPM2_GetActiveCtx(), in, out);
+}
+
 /* Deprecated version, use TPM2_EncryptDecrypt2 because it allows
     encryption of the input data */
-TPM_RC TPM2_EncryptDecrypt(EncryptDecrypt_In* in, EncryptDecrypt_Out* out)
+TPM_RC TPM2_EncryptDecrypt_ex(TPM2_CTX* ctx, EncryptDecrypt_In* in,
+    EncryptDecrypt_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2120,10 +4017,15 @@ TPM_RC TPM2_EncryptDecrypt(EncryptDecrypt_In* in, EncryptDecrypt_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_EncryptDecrypt2(EncryptDecrypt2_In* in, EncryptDecrypt2_Out* out)
+TPM_RC TPM2_EncryptDecrypt(EncryptDecrypt_In* in, EncryptDecrypt_Out* out)
+{
+    return TPM2_EncryptDecrypt_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_EncryptDecrypt2_ex(TPM2_CTX* ctx, EncryptDecrypt2_In* in,
+    EncryptDecrypt2_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2170,10 +4072,14 @@ TPM_RC TPM2_EncryptDecrypt2(EncryptDecrypt2_In* in, EncryptDecrypt2_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Hash(Hash_In* in, Hash_Out* out)
+TPM_RC TPM2_EncryptDecrypt2(EncryptDecrypt2_In* in, EncryptDecrypt2_Out* out)
+{
+    return TPM2_EncryptDecrypt2_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Hash_ex(TPM2_CTX* ctx, Hash_In* in, Hash_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -2226,10 +4132,14 @@ TPM_RC TPM2_Hash(Hash_In* in, Hash_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_HMAC(HMAC_In* in, HMAC_Out* out)
+TPM_RC TPM2_Hash(Hash_In* in, Hash_Out* out)
+{
+    return TPM2_Hash_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_HMAC_ex(TPM2_CTX* ctx, HMAC_In* in, HMAC_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2270,10 +4180,14 @@ TPM_RC TPM2_HMAC(HMAC_In* in, HMAC_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_HMAC_Start(HMAC_Start_In* in, HMAC_Start_Out* out)
+TPM_RC TPM2_HMAC(HMAC_In* in, HMAC_Out* out)
+{
+    return TPM2_HMAC_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_HMAC_Start_ex(TPM2_CTX* ctx, HMAC_Start_In* in, HMAC_Start_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2312,11 +4226,15 @@ TPM_RC TPM2_HMAC_Start(HMAC_Start_In* in, HMAC_Start_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_HashSequenceStart(HashSequenceStart_In* in,
+TPM_RC TPM2_HMAC_Start(HMAC_Start_In* in, HMAC_Start_Out* out)
+{
+    return TPM2_HMAC_Start_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_HashSequenceStart_ex(TPM2_CTX* ctx, HashSequenceStart_In* in,
     HashSequenceStart_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -2354,10 +4272,15 @@ TPM_RC TPM2_HashSequenceStart(HashSequenceStart_In* in,
     return rc;
 }
 
-TPM_RC TPM2_SequenceUpdate(SequenceUpdate_In* in)
+TPM_RC TPM2_HashSequenceStart(HashSequenceStart_In* in,
+    HashSequenceStart_Out* out)
+{
+    return TPM2_HashSequenceStart_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_SequenceUpdate_ex(TPM2_CTX* ctx, SequenceUpdate_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2387,10 +4310,15 @@ TPM_RC TPM2_SequenceUpdate(SequenceUpdate_In* in)
     return rc;
 }
 
-TPM_RC TPM2_SequenceComplete(SequenceComplete_In* in, SequenceComplete_Out* out)
+TPM_RC TPM2_SequenceUpdate(SequenceUpdate_In* in)
+{
+    return TPM2_SequenceUpdate_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_SequenceComplete_ex(TPM2_CTX* ctx, SequenceComplete_In* in,
+    SequenceComplete_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2438,11 +4366,15 @@ TPM_RC TPM2_SequenceComplete(SequenceComplete_In* in, SequenceComplete_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_EventSequenceComplete(EventSequenceComplete_In* in,
-    EventSequenceComplete_Out* out)
+TPM_RC TPM2_SequenceComplete(SequenceComplete_In* in, SequenceComplete_Out* out)
+{
+    return TPM2_SequenceComplete_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_EventSequenceComplete_ex(TPM2_CTX* ctx,
+    EventSequenceComplete_In* in, EventSequenceComplete_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2491,10 +4423,15 @@ TPM_RC TPM2_EventSequenceComplete(EventSequenceComplete_In* in,
     return rc;
 }
 
-TPM_RC TPM2_Certify(Certify_In* in, Certify_Out* out)
+TPM_RC TPM2_EventSequenceComplete(EventSequenceComplete_In* in,
+    EventSequenceComplete_Out* out)
+{
+    return TPM2_EventSequenceComplete_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Certify_ex(TPM2_CTX* ctx, Certify_In* in, Certify_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2541,10 +4478,15 @@ TPM_RC TPM2_Certify(Certify_In* in, Certify_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_CertifyCreation(CertifyCreation_In* in, CertifyCreation_Out* out)
+TPM_RC TPM2_Certify(Certify_In* in, Certify_Out* out)
+{
+    return TPM2_Certify_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_CertifyCreation_ex(TPM2_CTX* ctx, CertifyCreation_In* in,
+    CertifyCreation_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2602,10 +4544,14 @@ TPM_RC TPM2_CertifyCreation(CertifyCreation_In* in, CertifyCreation_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Quote(Quote_In* in, Quote_Out* out)
+TPM_RC TPM2_CertifyCreation(CertifyCreation_In* in, CertifyCreation_Out* out)
+{
+    return TPM2_CertifyCreation_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Quote_ex(TPM2_CTX* ctx, Quote_In* in, Quote_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2653,11 +4599,15 @@ TPM_RC TPM2_Quote(Quote_In* in, Quote_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_GetSessionAuditDigest(GetSessionAuditDigest_In* in,
-    GetSessionAuditDigest_Out* out)
+TPM_RC TPM2_Quote(Quote_In* in, Quote_Out* out)
+{
+    return TPM2_Quote_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_GetSessionAuditDigest_ex(TPM2_CTX* ctx,
+    GetSessionAuditDigest_In* in, GetSessionAuditDigest_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2706,11 +4656,16 @@ TPM_RC TPM2_GetSessionAuditDigest(GetSessionAuditDigest_In* in,
     return rc;
 }
 
-TPM_RC TPM2_GetCommandAuditDigest(GetCommandAuditDigest_In* in,
-    GetCommandAuditDigest_Out* out)
+TPM_RC TPM2_GetSessionAuditDigest(GetSessionAuditDigest_In* in,
+    GetSessionAuditDigest_Out* out)
+{
+    return TPM2_GetSessionAuditDigest_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_GetCommandAuditDigest_ex(TPM2_CTX* ctx,
+    GetCommandAuditDigest_In* in, GetCommandAuditDigest_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2758,10 +4713,15 @@ TPM_RC TPM2_GetCommandAuditDigest(GetCommandAuditDigest_In* in,
     return rc;
 }
 
-TPM_RC TPM2_GetTime(GetTime_In* in, GetTime_Out* out)
+TPM_RC TPM2_GetCommandAuditDigest(GetCommandAuditDigest_In* in,
+    GetCommandAuditDigest_Out* out)
+{
+    return TPM2_GetCommandAuditDigest_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_GetTime_ex(TPM2_CTX* ctx, GetTime_In* in, GetTime_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2808,10 +4768,14 @@ TPM_RC TPM2_GetTime(GetTime_In* in, GetTime_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_Commit(Commit_In* in, Commit_Out* out)
+TPM_RC TPM2_GetTime(GetTime_In* in, GetTime_Out* out)
+{
+    return TPM2_GetTime_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Commit_ex(TPM2_CTX* ctx, Commit_In* in, Commit_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -2857,10 +4821,15 @@ TPM_RC TPM2_Commit(Commit_In* in, Commit_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_EC_Ephemeral(EC_Ephemeral_In* in, EC_Ephemeral_Out* out)
+TPM_RC TPM2_Commit(Commit_In* in, Commit_Out* out)
+{
+    return TPM2_Commit_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_EC_Ephemeral_ex(TPM2_CTX* ctx, EC_Ephemeral_In* in,
+    EC_Ephemeral_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -2898,11 +4867,15 @@ TPM_RC TPM2_EC_Ephemeral(EC_Ephemeral_In* in, EC_Ephemeral_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_VerifySignature(VerifySignature_In* in,
+TPM_RC TPM2_EC_Ephemeral(EC_Ephemeral_In* in, EC_Ephemeral_Out* out)
+{
+    return TPM2_EC_Ephemeral_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_VerifySignature_ex(TPM2_CTX* ctx, VerifySignature_In* in,
     VerifySignature_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -2953,10 +4926,14 @@ TPM_RC TPM2_VerifySignature(VerifySignature_In* in,
     return rc;
 }
 
-TPM_RC TPM2_Sign(Sign_In* in, Sign_Out* out)
+TPM_RC TPM2_VerifySignature(VerifySignature_In* in, VerifySignature_Out* out)
+{
+    return TPM2_VerifySignature_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_Sign_ex(TPM2_CTX* ctx, Sign_In* in, Sign_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3003,10 +4980,15 @@ TPM_RC TPM2_Sign(Sign_In* in, Sign_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_SetCommandCodeAuditStatus(SetCommandCodeAuditStatus_In* in)
+TPM_RC TPM2_Sign(Sign_In* in, Sign_Out* out)
+{
+    return TPM2_Sign_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_SetCommandCodeAuditStatus_ex(TPM2_CTX* ctx,
+    SetCommandCodeAuditStatus_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3047,10 +5029,14 @@ TPM_RC TPM2_SetCommandCodeAuditStatus(SetCommandCodeAuditStatus_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PCR_Event(PCR_Event_In* in, PCR_Event_Out* out)
+TPM_RC TPM2_SetCommandCodeAuditStatus(SetCommandCodeAuditStatus_In* in)
+{
+    return TPM2_SetCommandCodeAuditStatus_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PCR_Event_ex(TPM2_CTX* ctx, PCR_Event_In* in, PCR_Event_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3097,10 +5083,15 @@ TPM_RC TPM2_PCR_Event(PCR_Event_In* in, PCR_Event_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PCR_Allocate(PCR_Allocate_In* in, PCR_Allocate_Out* out)
+TPM_RC TPM2_PCR_Event(PCR_Event_In* in, PCR_Event_Out* out)
+{
+    return TPM2_PCR_Event_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PCR_Allocate_ex(TPM2_CTX* ctx, PCR_Allocate_In* in,
+    PCR_Allocate_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3138,10 +5129,14 @@ TPM_RC TPM2_PCR_Allocate(PCR_Allocate_In* in, PCR_Allocate_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PCR_SetAuthPolicy(PCR_SetAuthPolicy_In* in)
+TPM_RC TPM2_PCR_Allocate(PCR_Allocate_In* in, PCR_Allocate_Out* out)
+{
+    return TPM2_PCR_Allocate_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PCR_SetAuthPolicy_ex(TPM2_CTX* ctx, PCR_SetAuthPolicy_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3176,10 +5171,14 @@ TPM_RC TPM2_PCR_SetAuthPolicy(PCR_SetAuthPolicy_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PCR_SetAuthValue(PCR_SetAuthValue_In* in)
+TPM_RC TPM2_PCR_SetAuthPolicy(PCR_SetAuthPolicy_In* in)
+{
+    return TPM2_PCR_SetAuthPolicy_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PCR_SetAuthValue_ex(TPM2_CTX* ctx, PCR_SetAuthValue_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3209,10 +5208,14 @@ TPM_RC TPM2_PCR_SetAuthValue(PCR_SetAuthValue_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PCR_Reset(PCR_Reset_In* in)
+TPM_RC TPM2_PCR_SetAuthValue(PCR_SetAuthValue_In* in)
+{
+    return TPM2_PCR_SetAuthValue_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PCR_Reset_ex(TPM2_CTX* ctx, PCR_Reset_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3238,10 +5241,15 @@ TPM_RC TPM2_PCR_Reset(PCR_Reset_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicySigned(PolicySigned_In* in, PolicySigned_Out* out)
+TPM_RC TPM2_PCR_Reset(PCR_Reset_In* in)
+{
+    return TPM2_PCR_Reset_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicySigned_ex(TPM2_CTX* ctx, PolicySigned_In* in,
+    PolicySigned_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -3308,10 +5316,15 @@ TPM_RC TPM2_PolicySigned(PolicySigned_In* in, PolicySigned_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PolicySecret(PolicySecret_In* in, PolicySecret_Out* out)
+TPM_RC TPM2_PolicySigned(PolicySigned_In* in, PolicySigned_Out* out)
+{
+    return TPM2_PolicySigned_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PolicySecret_ex(TPM2_CTX* ctx, PolicySecret_In* in,
+    PolicySecret_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3370,10 +5383,14 @@ TPM_RC TPM2_PolicySecret(PolicySecret_In* in, PolicySecret_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PolicyTicket(PolicyTicket_In* in)
+TPM_RC TPM2_PolicySecret(PolicySecret_In* in, PolicySecret_Out* out)
+{
+    return TPM2_PolicySecret_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PolicyTicket_ex(TPM2_CTX* ctx, PolicyTicket_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3421,10 +5438,14 @@ TPM_RC TPM2_PolicyTicket(PolicyTicket_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyOR(PolicyOR_In* in)
+TPM_RC TPM2_PolicyTicket(PolicyTicket_In* in)
+{
+    return TPM2_PolicyTicket_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyOR_ex(TPM2_CTX* ctx, PolicyOR_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -3455,10 +5476,14 @@ TPM_RC TPM2_PolicyOR(PolicyOR_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyPCR(PolicyPCR_In* in)
+TPM_RC TPM2_PolicyOR(PolicyOR_In* in)
+{
+    return TPM2_PolicyOR_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyPCR_ex(TPM2_CTX* ctx, PolicyPCR_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3496,10 +5521,14 @@ TPM_RC TPM2_PolicyPCR(PolicyPCR_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyLocality(PolicyLocality_In* in)
+TPM_RC TPM2_PolicyPCR(PolicyPCR_In* in)
+{
+    return TPM2_PolicyPCR_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyLocality_ex(TPM2_CTX* ctx, PolicyLocality_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -3523,10 +5552,14 @@ TPM_RC TPM2_PolicyLocality(PolicyLocality_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyNV(PolicyNV_In* in)
+TPM_RC TPM2_PolicyLocality(PolicyLocality_In* in)
+{
+    return TPM2_PolicyLocality_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyNV_ex(TPM2_CTX* ctx, PolicyNV_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3563,10 +5596,14 @@ TPM_RC TPM2_PolicyNV(PolicyNV_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyCounterTimer(PolicyCounterTimer_In* in)
+TPM_RC TPM2_PolicyNV(PolicyNV_In* in)
+{
+    return TPM2_PolicyNV_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyCounterTimer_ex(TPM2_CTX* ctx, PolicyCounterTimer_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3605,10 +5642,14 @@ TPM_RC TPM2_PolicyCounterTimer(PolicyCounterTimer_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyCommandCode(PolicyCommandCode_In* in)
+TPM_RC TPM2_PolicyCounterTimer(PolicyCounterTimer_In* in)
+{
+    return TPM2_PolicyCounterTimer_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyCommandCode_ex(TPM2_CTX* ctx, PolicyCommandCode_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -3633,10 +5674,14 @@ TPM_RC TPM2_PolicyCommandCode(PolicyCommandCode_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyCpHash(PolicyCpHash_In* in)
+TPM_RC TPM2_PolicyCommandCode(PolicyCommandCode_In* in)
+{
+    return TPM2_PolicyCommandCode_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyCpHash_ex(TPM2_CTX* ctx, PolicyCpHash_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3670,10 +5715,14 @@ TPM_RC TPM2_PolicyCpHash(PolicyCpHash_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyNameHash(PolicyNameHash_In* in)
+TPM_RC TPM2_PolicyCpHash(PolicyCpHash_In* in)
+{
+    return TPM2_PolicyCpHash_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyNameHash_ex(TPM2_CTX* ctx, PolicyNameHash_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3708,10 +5757,15 @@ TPM_RC TPM2_PolicyNameHash(PolicyNameHash_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyDuplicationSelect(PolicyDuplicationSelect_In* in)
+TPM_RC TPM2_PolicyNameHash(PolicyNameHash_In* in)
+{
+    return TPM2_PolicyNameHash_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyDuplicationSelect_ex(TPM2_CTX* ctx,
+    PolicyDuplicationSelect_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3752,10 +5806,14 @@ TPM_RC TPM2_PolicyDuplicationSelect(PolicyDuplicationSelect_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyAuthorize(PolicyAuthorize_In* in)
+TPM_RC TPM2_PolicyDuplicationSelect(PolicyDuplicationSelect_In* in)
+{
+    return TPM2_PolicyDuplicationSelect_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyAuthorize_ex(TPM2_CTX* ctx, PolicyAuthorize_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3804,11 +5862,16 @@ TPM_RC TPM2_PolicyAuthorize(PolicyAuthorize_In* in)
     return rc;
 }
 
+TPM_RC TPM2_PolicyAuthorize(PolicyAuthorize_In* in)
+{
+    return TPM2_PolicyAuthorize_ex(TPM2_GetActiveCtx(), in);
+}
+
 
-static TPM_RC TPM2_PolicySessionOnly(TPM_CC cc, TPMI_SH_POLICY policy)
+static TPM_RC TPM2_PolicySessionOnly(TPM2_CTX* ctx, TPM_CC cc,
+    TPMI_SH_POLICY policy)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL)
         return BAD_FUNC_ARG;
@@ -3829,26 +5892,44 @@ static TPM_RC TPM2_PolicySessionOnly(TPM_CC cc, TPMI_SH_POLICY policy)
 }
 
 
+TPM_RC TPM2_PolicyPhysicalPresence_ex(TPM2_CTX* ctx,
+    PolicyPhysicalPresence_In* in)
+{
+    return TPM2_PolicySessionOnly(ctx, TPM_CC_PolicyPhysicalPresence,
+        in->policySession);
+}
+
 TPM_RC TPM2_PolicyPhysicalPresence(PolicyPhysicalPresence_In* in)
 {
-    return TPM2_PolicySessionOnly(TPM_CC_PolicyPhysicalPresence,
+    return TPM2_PolicyPhysicalPresence_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyAuthValue_ex(TPM2_CTX* ctx, PolicyAuthValue_In* in)
+{
+    return TPM2_PolicySessionOnly(ctx, TPM_CC_PolicyAuthValue,
         in->policySession);
 }
 
 TPM_RC TPM2_PolicyAuthValue(PolicyAuthValue_In* in)
 {
-    return TPM2_PolicySessionOnly(TPM_CC_PolicyAuthValue, in->policySession);
+    return TPM2_PolicyAuthValue_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyPassword_ex(TPM2_CTX* ctx, PolicyPassword_In* in)
+{
+    return TPM2_PolicySessionOnly(ctx, TPM_CC_PolicyPassword,
+        in->policySession);
 }
 
 TPM_RC TPM2_PolicyPassword(PolicyPassword_In* in)
 {
-    return TPM2_PolicySessionOnly(TPM_CC_PolicyPassword, in->policySession);
+    return TPM2_PolicyPassword_ex(TPM2_GetActiveCtx(), in);
 }
 
-TPM_RC TPM2_PolicyGetDigest(PolicyGetDigest_In* in, PolicyGetDigest_Out* out)
+TPM_RC TPM2_PolicyGetDigest_ex(TPM2_CTX* ctx, PolicyGetDigest_In* in,
+    PolicyGetDigest_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -3888,10 +5969,14 @@ TPM_RC TPM2_PolicyGetDigest(PolicyGetDigest_In* in, PolicyGetDigest_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_PolicyNvWritten(PolicyNvWritten_In* in)
+TPM_RC TPM2_PolicyGetDigest(PolicyGetDigest_In* in, PolicyGetDigest_Out* out)
+{
+    return TPM2_PolicyGetDigest_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_PolicyNvWritten_ex(TPM2_CTX* ctx, PolicyNvWritten_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -3913,10 +5998,14 @@ TPM_RC TPM2_PolicyNvWritten(PolicyNvWritten_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyTemplate(PolicyTemplate_In* in)
+TPM_RC TPM2_PolicyNvWritten(PolicyNvWritten_In* in)
+{
+    return TPM2_PolicyNvWritten_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyTemplate_ex(TPM2_CTX* ctx, PolicyTemplate_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -3948,10 +6037,14 @@ TPM_RC TPM2_PolicyTemplate(PolicyTemplate_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PolicyAuthorizeNV(PolicyAuthorizeNV_In* in)
+TPM_RC TPM2_PolicyTemplate(PolicyTemplate_In* in)
+{
+    return TPM2_PolicyTemplate_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PolicyAuthorizeNV_ex(TPM2_CTX* ctx, PolicyAuthorizeNV_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -3978,11 +6071,15 @@ TPM_RC TPM2_PolicyAuthorizeNV(PolicyAuthorizeNV_In* in)
     return rc;
 }
 
+TPM_RC TPM2_PolicyAuthorizeNV(PolicyAuthorizeNV_In* in)
+{
+    return TPM2_PolicyAuthorizeNV_ex(TPM2_GetActiveCtx(), in);
+}
+
 
-TPM_RC TPM2_HierarchyControl(HierarchyControl_In* in)
+TPM_RC TPM2_HierarchyControl_ex(TPM2_CTX* ctx, HierarchyControl_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4008,10 +6105,14 @@ TPM_RC TPM2_HierarchyControl(HierarchyControl_In* in)
     return rc;
 }
 
-TPM_RC TPM2_SetPrimaryPolicy(SetPrimaryPolicy_In* in)
+TPM_RC TPM2_HierarchyControl(HierarchyControl_In* in)
+{
+    return TPM2_HierarchyControl_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_SetPrimaryPolicy_ex(TPM2_CTX* ctx, SetPrimaryPolicy_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4040,10 +6141,14 @@ TPM_RC TPM2_SetPrimaryPolicy(SetPrimaryPolicy_In* in)
     return rc;
 }
 
-static TPM_RC TPM2_ChangeSeed(ChangeSeed_In* in, TPM_CC cc)
+TPM_RC TPM2_SetPrimaryPolicy(SetPrimaryPolicy_In* in)
+{
+    return TPM2_SetPrimaryPolicy_ex(TPM2_GetActiveCtx(), in);
+}
+
+static TPM_RC TPM2_ChangeSeed(TPM2_CTX* ctx, ChangeSeed_In* in, TPM_CC cc)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4067,20 +6172,29 @@ static TPM_RC TPM2_ChangeSeed(ChangeSeed_In* in, TPM_CC cc)
     return rc;
 }
 
+TPM_RC TPM2_ChangePPS_ex(TPM2_CTX* ctx, ChangePPS_In* in)
+{
+    return TPM2_ChangeSeed(ctx, in, TPM_CC_ChangePPS);
+}
+
 TPM_RC TPM2_ChangePPS(ChangePPS_In* in)
 {
-    return TPM2_ChangeSeed(in, TPM_CC_ChangePPS);
+    return TPM2_ChangePPS_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_ChangeEPS_ex(TPM2_CTX* ctx, ChangeEPS_In* in)
+{
+    return TPM2_ChangeSeed(ctx, in, TPM_CC_ChangeEPS);
 }
 
 TPM_RC TPM2_ChangeEPS(ChangeEPS_In* in)
 {
-    return TPM2_ChangeSeed(in, TPM_CC_ChangeEPS);
+    return TPM2_ChangeEPS_ex(TPM2_GetActiveCtx(), in);
 }
 
-TPM_RC TPM2_Clear(Clear_In* in)
+TPM_RC TPM2_Clear_ex(TPM2_CTX* ctx, Clear_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4098,16 +6212,25 @@ TPM_RC TPM2_Clear(Clear_In* in)
 
         /* send command */
         rc = TPM2_SendCommandAuth(ctx, &packet, &info);
+    #ifdef WOLFTPM_NAME_CACHE
+        /* objects of the owner hierarchy are gone */
+        if (rc == TPM_RC_SUCCESS)
+            TPM2_NameCache_Clear(ctx);
+    #endif
 
         TPM2_ReleaseLock(ctx);
     }
     return rc;
 }
 
-TPM_RC TPM2_ClearControl(ClearControl_In* in)
+TPM_RC TPM2_Clear(Clear_In* in)
+{
+    return TPM2_Clear_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_ClearControl_ex(TPM2_CTX* ctx, ClearControl_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4132,10 +6255,14 @@ TPM_RC TPM2_ClearControl(ClearControl_In* in)
     return rc;
 }
 
-TPM_RC TPM2_HierarchyChangeAuth(HierarchyChangeAuth_In* in)
+TPM_RC TPM2_ClearControl(ClearControl_In* in)
+{
+    return TPM2_ClearControl_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_HierarchyChangeAuth_ex(TPM2_CTX* ctx, HierarchyChangeAuth_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4163,10 +6290,15 @@ TPM_RC TPM2_HierarchyChangeAuth(HierarchyChangeAuth_In* in)
     return rc;
 }
 
-TPM_RC TPM2_DictionaryAttackLockReset(DictionaryAttackLockReset_In* in)
+TPM_RC TPM2_HierarchyChangeAuth(HierarchyChangeAuth_In* in)
+{
+    return TPM2_HierarchyChangeAuth_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_DictionaryAttackLockReset_ex(TPM2_CTX* ctx,
+    DictionaryAttackLockReset_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4191,10 +6323,15 @@ TPM_RC TPM2_DictionaryAttackLockReset(DictionaryAttackLockReset_In* in)
     return rc;
 }
 
-TPM_RC TPM2_DictionaryAttackParameters(DictionaryAttackParameters_In* in)
+TPM_RC TPM2_DictionaryAttackLockReset(DictionaryAttackLockReset_In* in)
+{
+    return TPM2_DictionaryAttackLockReset_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_DictionaryAttackParameters_ex(TPM2_CTX* ctx,
+    DictionaryAttackParameters_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4222,10 +6359,14 @@ TPM_RC TPM2_DictionaryAttackParameters(DictionaryAttackParameters_In* in)
     return rc;
 }
 
-TPM_RC TPM2_PP_Commands(PP_Commands_In* in)
+TPM_RC TPM2_DictionaryAttackParameters(DictionaryAttackParameters_In* in)
+{
+    return TPM2_DictionaryAttackParameters_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_PP_Commands_ex(TPM2_CTX* ctx, PP_Commands_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4260,10 +6401,14 @@ TPM_RC TPM2_PP_Commands(PP_Commands_In* in)
     return rc;
 }
 
-TPM_RC TPM2_SetAlgorithmSet(SetAlgorithmSet_In* in)
+TPM_RC TPM2_PP_Commands(PP_Commands_In* in)
+{
+    return TPM2_PP_Commands_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_SetAlgorithmSet_ex(TPM2_CTX* ctx, SetAlgorithmSet_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4291,10 +6436,14 @@ TPM_RC TPM2_SetAlgorithmSet(SetAlgorithmSet_In* in)
     return rc;
 }
 
-TPM_RC TPM2_FieldUpgradeStart(FieldUpgradeStart_In* in)
+TPM_RC TPM2_SetAlgorithmSet(SetAlgorithmSet_In* in)
+{
+    return TPM2_SetAlgorithmSet_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_FieldUpgradeStart_ex(TPM2_CTX* ctx, FieldUpgradeStart_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4329,10 +6478,15 @@ TPM_RC TPM2_FieldUpgradeStart(FieldUpgradeStart_In* in)
     return rc;
 }
 
-TPM_RC TPM2_FieldUpgradeData(FieldUpgradeData_In* in, FieldUpgradeData_Out* out)
+TPM_RC TPM2_FieldUpgradeStart(FieldUpgradeStart_In* in)
+{
+    return TPM2_FieldUpgradeStart_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_FieldUpgradeData_ex(TPM2_CTX* ctx, FieldUpgradeData_In* in,
+    FieldUpgradeData_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -4381,10 +6535,15 @@ TPM_RC TPM2_FieldUpgradeData(FieldUpgradeData_In* in, FieldUpgradeData_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_FirmwareRead(FirmwareRead_In* in, FirmwareRead_Out* out)
+TPM_RC TPM2_FieldUpgradeData(FieldUpgradeData_In* in, FieldUpgradeData_Out* out)
+{
+    return TPM2_FieldUpgradeData_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_FirmwareRead_ex(TPM2_CTX* ctx, FirmwareRead_In* in,
+    FirmwareRead_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -4424,10 +6583,15 @@ TPM_RC TPM2_FirmwareRead(FirmwareRead_In* in, FirmwareRead_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ContextSave(ContextSave_In* in, ContextSave_Out* out)
+TPM_RC TPM2_FirmwareRead(FirmwareRead_In* in, FirmwareRead_Out* out)
+{
+    return TPM2_FirmwareRead_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ContextSave_ex(TPM2_CTX* ctx, ContextSave_In* in,
+    ContextSave_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -4456,10 +6620,15 @@ TPM_RC TPM2_ContextSave(ContextSave_In* in, ContextSave_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ContextLoad(ContextLoad_In* in, ContextLoad_Out* out)
+TPM_RC TPM2_ContextSave(ContextSave_In* in, ContextSave_Out* out)
+{
+    return TPM2_ContextSave_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_ContextLoad_ex(TPM2_CTX* ctx, ContextLoad_In* in,
+    ContextLoad_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL)
         return BAD_FUNC_ARG;
@@ -4483,6 +6652,9 @@ TPM_RC TPM2_ContextLoad(ContextLoad_In* in, ContextLoad_Out* out)
         rc = TPM2_SendCommand(ctx, &packet);
         if (rc == TPM_RC_SUCCESS) {
             TPM2_Packet_ParseU32(&packet, &out->loadedHandle);
+        #ifdef WOLFTPM_NAME_CACHE
+            TPM2_NameCache_Drop(ctx, out->loadedHandle);
+        #endif
         }
 
         TPM2_ReleaseLock(ctx);
@@ -4490,10 +6662,14 @@ TPM_RC TPM2_ContextLoad(ContextLoad_In* in, ContextLoad_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_EvictControl(EvictControl_In* in)
+TPM_RC TPM2_ContextLoad(ContextLoad_In* in, ContextLoad_Out* out)
+{
+    return TPM2_ContextLoad_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_EvictControl_ex(TPM2_CTX* ctx, EvictControl_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL)
         return BAD_FUNC_ARG;
@@ -4514,16 +6690,24 @@ TPM_RC TPM2_EvictControl(EvictControl_In* in)
 
         /* send command */
         rc = TPM2_SendCommandAuth(ctx, &packet, &info);
+    #ifdef WOLFTPM_NAME_CACHE
+        if (rc == TPM_RC_SUCCESS)
+            TPM2_NameCache_Drop(ctx, in->persistentHandle);
+    #endif
 
         TPM2_ReleaseLock(ctx);
     }
     return rc;
 }
 
-TPM_RC TPM2_ReadClock(ReadClock_Out* out)
+TPM_RC TPM2_EvictControl(EvictControl_In* in)
+{
+    return TPM2_EvictControl_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_ReadClock_ex(TPM2_CTX* ctx, ReadClock_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || out == NULL)
@@ -4565,10 +6749,14 @@ TPM_RC TPM2_ReadClock(ReadClock_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_ClockSet(ClockSet_In* in)
+TPM_RC TPM2_ReadClock(ReadClock_Out* out)
+{
+    return TPM2_ReadClock_ex(TPM2_GetActiveCtx(), out);
+}
+
+TPM_RC TPM2_ClockSet_ex(TPM2_CTX* ctx, ClockSet_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4594,10 +6782,14 @@ TPM_RC TPM2_ClockSet(ClockSet_In* in)
     return rc;
 }
 
-TPM_RC TPM2_ClockRateAdjust(ClockRateAdjust_In* in)
+TPM_RC TPM2_ClockSet(ClockSet_In* in)
+{
+    return TPM2_ClockSet_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_ClockRateAdjust_ex(TPM2_CTX* ctx, ClockRateAdjust_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4622,10 +6814,14 @@ TPM_RC TPM2_ClockRateAdjust(ClockRateAdjust_In* in)
     return rc;
 }
 
-TPM_RC TPM2_TestParms(TestParms_In* in)
+TPM_RC TPM2_ClockRateAdjust(ClockRateAdjust_In* in)
+{
+    return TPM2_ClockRateAdjust_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_TestParms_ex(TPM2_CTX* ctx, TestParms_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL)
@@ -4656,10 +6852,14 @@ TPM_RC TPM2_TestParms(TestParms_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_DefineSpace(NV_DefineSpace_In* in)
+TPM_RC TPM2_TestParms(TestParms_In* in)
+{
+    return TPM2_TestParms_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_DefineSpace_ex(TPM2_CTX* ctx, NV_DefineSpace_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4704,10 +6904,14 @@ TPM_RC TPM2_NV_DefineSpace(NV_DefineSpace_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_UndefineSpace(NV_UndefineSpace_In* in)
+TPM_RC TPM2_NV_DefineSpace(NV_DefineSpace_In* in)
+{
+    return TPM2_NV_DefineSpace_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_UndefineSpace_ex(TPM2_CTX* ctx, NV_UndefineSpace_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4734,10 +6938,15 @@ TPM_RC TPM2_NV_UndefineSpace(NV_UndefineSpace_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_UndefineSpaceSpecial(NV_UndefineSpaceSpecial_In* in)
+TPM_RC TPM2_NV_UndefineSpace(NV_UndefineSpace_In* in)
+{
+    return TPM2_NV_UndefineSpace_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_UndefineSpaceSpecial_ex(TPM2_CTX* ctx,
+    NV_UndefineSpaceSpecial_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4765,10 +6974,15 @@ TPM_RC TPM2_NV_UndefineSpaceSpecial(NV_UndefineSpaceSpecial_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_ReadPublic(NV_ReadPublic_In* in, NV_ReadPublic_Out* out)
+TPM_RC TPM2_NV_UndefineSpaceSpecial(NV_UndefineSpaceSpecial_In* in)
+{
+    return TPM2_NV_UndefineSpaceSpecial_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_ReadPublic_ex(TPM2_CTX* ctx, NV_ReadPublic_In* in,
+    NV_ReadPublic_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     TPM_ST st;
 
     if (ctx == NULL || in == NULL || out == NULL)
@@ -4822,10 +7036,14 @@ TPM_RC TPM2_NV_ReadPublic(NV_ReadPublic_In* in, NV_ReadPublic_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_NV_Write(NV_Write_In* in)
+TPM_RC TPM2_NV_ReadPublic(NV_ReadPublic_In* in, NV_ReadPublic_Out* out)
+{
+    return TPM2_NV_ReadPublic_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_NV_Write_ex(TPM2_CTX* ctx, NV_Write_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4858,10 +7076,14 @@ TPM_RC TPM2_NV_Write(NV_Write_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_Increment(NV_Increment_In* in)
+TPM_RC TPM2_NV_Write(NV_Write_In* in)
+{
+    return TPM2_NV_Write_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_Increment_ex(TPM2_CTX* ctx, NV_Increment_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4888,10 +7110,14 @@ TPM_RC TPM2_NV_Increment(NV_Increment_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_Extend(NV_Extend_In* in)
+TPM_RC TPM2_NV_Increment(NV_Increment_In* in)
+{
+    return TPM2_NV_Increment_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_Extend_ex(TPM2_CTX* ctx, NV_Extend_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4922,10 +7148,14 @@ TPM_RC TPM2_NV_Extend(NV_Extend_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_SetBits(NV_SetBits_In* in)
+TPM_RC TPM2_NV_Extend(NV_Extend_In* in)
+{
+    return TPM2_NV_Extend_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_SetBits_ex(TPM2_CTX* ctx, NV_SetBits_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4954,10 +7184,14 @@ TPM_RC TPM2_NV_SetBits(NV_SetBits_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_WriteLock(NV_WriteLock_In* in)
+TPM_RC TPM2_NV_SetBits(NV_SetBits_In* in)
+{
+    return TPM2_NV_SetBits_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_WriteLock_ex(TPM2_CTX* ctx, NV_WriteLock_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -4984,10 +7218,14 @@ TPM_RC TPM2_NV_WriteLock(NV_WriteLock_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_GlobalWriteLock(NV_GlobalWriteLock_In* in)
+TPM_RC TPM2_NV_WriteLock(NV_WriteLock_In* in)
+{
+    return TPM2_NV_WriteLock_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_GlobalWriteLock_ex(TPM2_CTX* ctx, NV_GlobalWriteLock_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5014,10 +7252,14 @@ TPM_RC TPM2_NV_GlobalWriteLock(NV_GlobalWriteLock_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_Read(NV_Read_In* in, NV_Read_Out* out)
+TPM_RC TPM2_NV_GlobalWriteLock(NV_GlobalWriteLock_In* in)
+{
+    return TPM2_NV_GlobalWriteLock_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_Read_ex(TPM2_CTX* ctx, NV_Read_In* in, NV_Read_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5056,10 +7298,14 @@ TPM_RC TPM2_NV_Read(NV_Read_In* in, NV_Read_Out* out)
     return rc;
 }
 
-TPM_RC TPM2_NV_ReadLock(NV_ReadLock_In* in)
+TPM_RC TPM2_NV_Read(NV_Read_In* in, NV_Read_Out* out)
+{
+    return TPM2_NV_Read_ex(TPM2_GetActiveCtx(), in, out);
+}
+
+TPM_RC TPM2_NV_ReadLock_ex(TPM2_CTX* ctx, NV_ReadLock_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5086,10 +7332,14 @@ TPM_RC TPM2_NV_ReadLock(NV_ReadLock_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_ChangeAuth(NV_ChangeAuth_In* in)
+TPM_RC TPM2_NV_ReadLock(NV_ReadLock_In* in)
+{
+    return TPM2_NV_ReadLock_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_ChangeAuth_ex(TPM2_CTX* ctx, NV_ChangeAuth_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5119,10 +7369,14 @@ TPM_RC TPM2_NV_ChangeAuth(NV_ChangeAuth_In* in)
     return rc;
 }
 
-TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out)
+TPM_RC TPM2_NV_ChangeAuth(NV_ChangeAuth_In* in)
+{
+    return TPM2_NV_ChangeAuth_ex(TPM2_GetActiveCtx(), in);
+}
+
+TPM_RC TPM2_NV_Certify_ex(TPM2_CTX* ctx, NV_Certify_In* in, NV_Certify_Out* out)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || out == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5172,6 +7426,11 @@ TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out)
     return rc;
 }
 
+TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out)
+{
+    return TPM2_NV_Certify_ex(TPM2_GetActiveCtx(), in, out);
+}
+
 /******************************************************************************/
 /* --- END Standard TPM API's -- */
 /******************************************************************************/
@@ -5181,10 +7440,9 @@ TPM_RC TPM2_NV_Certify(NV_Certify_In* in, NV_Certify_Out* out)
 /* --- BEGIN Manufacture Specific TPM API's -- */
 /******************************************************************************/
 #if defined(WOLFTPM_ST33) || defined(WOLFTPM_AUTODETECT)
-int TPM2_SetCommandSet(SetCommandSet_In* in)
+int TPM2_SetCommandSet_ex(TPM2_CTX* ctx, SetCommandSet_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5213,10 +7471,14 @@ int TPM2_SetCommandSet(SetCommandSet_In* in)
     return rc;
 }
 
-int TPM2_SetMode(SetMode_In* in)
+int TPM2_SetCommandSet(SetCommandSet_In* in)
+{
+    return TPM2_SetCommandSet_ex(TPM2_GetActiveCtx(), in);
+}
+
+int TPM2_SetMode_ex(TPM2_CTX* ctx, SetMode_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
         return BAD_FUNC_ARG;
@@ -5245,14 +7507,18 @@ int TPM2_SetMode(SetMode_In* in)
     }
     return rc;
 }
+
+int TPM2_SetMode(SetMode_In* in)
+{
+    return TPM2_SetMode_ex(TPM2_GetActiveCtx(), in);
+}
 #endif /* WOLFTPM_ST33 || WOLFTPM_AUTODETECT */
 
 /* GPIO Vendor Specific API's */
 #ifdef WOLFTPM_ST33
-int TPM2_GPIO_Config(GpioConfig_In* in)
+int TPM2_GPIO_Config_ex(TPM2_CTX* ctx, GpioConfig_In* in)
 {
     TPM_RC rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     UINT32 i;
 
     if (ctx == NULL || in == NULL || ctx->session == NULL)
@@ -5285,12 +7551,16 @@ int TPM2_GPIO_Config(GpioConfig_In* in)
     return rc;
 }
 
+int TPM2_GPIO_Config(GpioConfig_In* in)
+{
+    return TPM2_GPIO_Config_ex(TPM2_GetActiveCtx(), in);
+}
+
 #elif defined(WOLFTPM_NUVOTON)
 
-int TPM2_NTC2_PreConfig(NTC2_PreConfig_In* in)
+int TPM2_NTC2_PreConfig_ex(TPM2_CTX* ctx, NTC2_PreConfig_In* in)
 {
     int rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (in == NULL || ctx == NULL)
         return BAD_FUNC_ARG;
@@ -5317,10 +7587,14 @@ int TPM2_NTC2_PreConfig(NTC2_PreConfig_In* in)
     return rc;
 }
 
-int TPM2_NTC2_GetConfig(NTC2_GetConfig_Out* out)
+int TPM2_NTC2_PreConfig(NTC2_PreConfig_In* in)
+{
+    return TPM2_NTC2_PreConfig_ex(TPM2_GetActiveCtx(), in);
+}
+
+int TPM2_NTC2_GetConfig_ex(TPM2_CTX* ctx, NTC2_GetConfig_Out* out)
 {
     int rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (out == NULL || ctx == NULL)
         return BAD_FUNC_ARG;
@@ -5341,6 +7615,11 @@ int TPM2_NTC2_GetConfig(NTC2_GetConfig_Out* out)
     }
     return rc;
 }
+
+int TPM2_NTC2_GetConfig(NTC2_GetConfig_Out* out)
+{
+    return TPM2_NTC2_GetConfig_ex(TPM2_GetActiveCtx(), out);
+}
 #endif /* WOLFTPM_NUVOTON */
 /******************************************************************************/
 /* --- END Manufacture Specific TPM API's -- */
@@ -5389,63 +7668,136 @@ int TPM2_GetHashType(TPMI_ALG_HASH hashAlg)
     return 0;
 }
 
+#ifndef WOLFTPM2_USE_WOLF_RNG
+/* Fills buf with TPM2_GetRandom, called with the lock held. The command is
+ * marshalled into a local buffer, as TPM2_CommandProcess calls this while its
+ * command is in cmdBuf. */
+static int TPM2_GetTpmRandom(TPM2_CTX* ctx, byte* randBuf, int randBufSz)
+{
+    int rc = TPM_RC_SUCCESS;
+    byte buf[TPM2_HEADER_SIZE + sizeof(TPM2B_DIGEST)];
+    TPM2_Packet packet;
+    UINT16 bytesRequested;
+    int randSz = 0;
+
+    while (rc == TPM_RC_SUCCESS && randSz < randBufSz) {
+        packet.buf = buf;
+        packet.size = (int)sizeof(buf);
+        packet.pos = TPM2_HEADER_SIZE;
+        bytesRequested = (UINT16)(randBufSz - randSz);
+        if (bytesRequested > sizeof(TPMU_HA))
+            bytesRequested = sizeof(TPMU_HA);
+        TPM2_Packet_AppendU16(&packet, bytesRequested);
+        TPM2_Packet_Finalize(&packet, TPM_ST_NO_SESSIONS, TPM_CC_GetRandom);
+
+        rc = TPM2_SendCommand(ctx, &packet);
+    #ifdef WOLFTPM_HOST_DRBG
+        TPM2_DataLock(ctx);
+        ctx->drbg.stats.getRandom++;
+        TPM2_DataUnlock(ctx);
+    #endif
+        if (rc == TPM_RC_SUCCESS) {
+            TPM2_Packet_ParseU16(&packet, &bytesRequested);
+            if (bytesRequested == 0 || bytesRequested > randBufSz - randSz)
+                rc = TPM_RC_FAILURE;
+        }
+        if (rc == TPM_RC_SUCCESS) {
+            TPM2_Packet_ParseBytes(&packet, &randBuf[randSz], bytesRequested);
+            randSz += bytesRequested;
+        }
+    }
+
+    return rc;
+}
+#endif
+
 /* Can optionally define WOLFTPM2_USE_HW_RNG to force using TPM hardware for RNG source */
-int TPM2_GetNonce(byte* nonceBuf, int nonceSz)
+int TPM2_GetNonce_ex(TPM2_CTX* ctx, byte* nonceBuf, int nonceSz)
 {
     int rc = 0;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 #ifdef WOLFTPM2_USE_WOLF_RNG
     WC_RNG* rng = NULL;
 #else
-    GetRandom_In in;
-    GetRandom_Out out;
-    int randSz = 0;
+    TPM_RC lockRc;
+#endif
+#ifdef WOLFTPM_HOST_DRBG
+    byte seed[TPM2_DRBG_SEED_SZ];
+    int needSeed = 0;
 #endif
 
     if (ctx == NULL || nonceBuf == NULL)
         return BAD_FUNC_ARG;
 
 #ifdef WOLFTPM2_USE_WOLF_RNG
-    rc = TPM2_GetWolfRng(&rng);
+    rc = TPM2_GetWolfRng_ex(ctx, &rng);
     if (rc == 0) {
         /* Use wolfCrypt */
         rc = wc_RNG_GenerateBlock(rng, nonceBuf, nonceSz);
     }
 #else
-    /* Use TPM GetRandom */
-    XMEMSET(&in, 0, sizeof(in));
-    while (randSz < nonceSz) {
-        in.bytesRequested = nonceSz - randSz;
-        if (in.bytesRequested > sizeof(out.randomBytes.buffer))
-            in.bytesRequested = sizeof(out.randomBytes.buffer);
-
-        rc = TPM2_GetRandom(&in, &out);
-        if (rc != TPM_RC_SUCCESS)
-            break;
-
-        XMEMCPY(&nonceBuf[randSz], out.randomBytes.buffer, out.randomBytes.size);
-        randSz += out.randomBytes.size;
+    lockRc = rc = TPM2_AcquireLock(ctx);
+#ifdef WOLFTPM_HOST_DRBG
+    /* Use the host DRBG, seeded and reseeded with TPM GetRandom */
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_DataLock(ctx);
+        needSeed = TPM2_Drbg_NeedSeed(&ctx->drbg);
+        TPM2_DataUnlock(ctx);
+        if (needSeed)
+            rc = TPM2_GetTpmRandom(ctx, seed, (int)sizeof(seed));
+    }
+    if (rc == TPM_RC_SUCCESS) {
+        TPM2_DataLock(ctx);
+        if (needSeed) {
+            TPM2_Drbg_Seed(&ctx->drbg, seed, (word32)sizeof(seed));
+        }
+        else if (nonceSz > 0) {
+            /* commands of a TPM answering MAX_RNG_REQ_SIZE bytes at most */
+            ctx->drbg.stats.avoided +=
+                ((word32)nonceSz + MAX_RNG_REQ_SIZE - 1) / MAX_RNG_REQ_SIZE;
+        }
+        if (nonceSz > 0)
+            TPM2_Drbg_Generate(&ctx->drbg, nonceBuf, (word32)nonceSz);
+        TPM2_DataUnlock(ctx);
     }
+    TPM2_ForceZero(seed, sizeof(seed));
+#else
+    /* Use TPM GetRandom */
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_GetTpmRandom(ctx, nonceBuf, nonceSz);
+#endif
+    if (lockRc == TPM_RC_SUCCESS)
+        TPM2_ReleaseLock(ctx);
 #endif
 
     return rc;
 }
 
+int TPM2_GetNonce(byte* nonceBuf, int nonceSz)
+{
+    return TPM2_GetNonce_ex(TPM2_GetActiveCtx(), nonceBuf, nonceSz);
+}
+
 /* Get name for object/handle */
 int TPM2_GetName(TPM2_CTX* ctx, UINT32 handleValue, int handleCnt, int idx, TPM2B_NAME* name)
 {
-    TPM2_AUTH_SESSION* session;
-
     if (ctx == NULL || name == NULL) {
         return BAD_FUNC_ARG;
     }
+    return TPM2_GetSessionName(ctx->session, handleValue, handleCnt, idx,
+        name);
+}
+
+static int TPM2_GetSessionName(TPM2_AUTH_SESSION* sessions,
+    UINT32 handleValue, int handleCnt, int idx, TPM2B_NAME* name)
+{
+    TPM2_AUTH_SESSION* session;
 
     XMEMSET(name, 0, sizeof(TPM2B_NAME));
 
     if (idx >= handleCnt)
         return TPM_RC_SUCCESS;
 
-    session = &ctx->session[idx];
+    session = &sessions[idx];
 
     if ((handleValue >= TRANSIENT_FIRST) ||
         (handleValue >= NV_INDEX_FIRST && handleValue <= NV_INDEX_LAST)) {
@@ -5785,10 +8137,9 @@ int TPM2_GetWolfCurve(int curve_id)
 }
 
 #ifdef WOLFTPM2_USE_WOLF_RNG
-int TPM2_GetWolfRng(WC_RNG** rng)
+int TPM2_GetWolfRng_ex(TPM2_CTX* ctx, WC_RNG** rng)
 {
     int rc;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
 
     if (ctx == NULL)
         return BAD_FUNC_ARG;
@@ -5809,6 +8160,11 @@ int TPM2_GetWolfRng(WC_RNG** rng)
 
     return 0;
 }
+
+int TPM2_GetWolfRng(WC_RNG** rng)
+{
+    return TPM2_GetWolfRng_ex(TPM2_GetActiveCtx(), rng);
+}
 #endif /* WOLFTPM2_USE_WOLF_RNG */
 
 int TPM2_ParseAttest(const TPM2B_ATTEST* in, TPMS_ATTEST* out)
@@ -5826,16 +8182,40 @@ int TPM2_ParseAttest(const TPM2B_ATTEST* in, TPMS_ATTEST* out)
     return TPM_RC_SUCCESS;
 }
 
-UINT16 TPM2_GetVendorID(void)
+UINT16 TPM2_GetVendorID_ex(TPM2_CTX* ctx)
 {
     UINT16 vid = 0;
-    TPM2_CTX* ctx = TPM2_GetActiveCtx();
     if (ctx) {
         vid = (UINT16)(ctx->did_vid & 0xFFFF);
     }
     return vid;
 }
 
+UINT16 TPM2_GetVendorID(void)
+{
+    return TPM2_GetVendorID_ex(TPM2_GetActiveCtx());
+}
+
+void TPM2_ForceZero(void* mem, word32 len)
+{
+    volatile byte* z = (volatile byte*)mem;
+
+    if (z != NULL) {
+        while (len--)
+            *z++ = 0;
+    }
+}
+
+int TPM2_ConstantCompare(const byte* a, const byte* b, word32 len)
+{
+    word32 i;
+    byte diff = 0;
+
+    for (i = 0; i < len; i++)
+        diff |= a[i] ^ b[i];
+    return (int)diff;
+}
+
 /* Stores nameAlg + the digest of nvPublic in buffer, total size in size */
 int TPM2_HashNvPublic(TPMS_NV_PUBLIC* nvPublic, byte* buffer, UINT16* size)
 {
@@ -0,0 +1,275 @@
+/* tpm2_broker.c
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Multi-client TPM broker. Raw commands of the clients run one at a time in
+ * the resource manager space of their client. The scheduling only depends on
+ * the TPM2_CTX transport, so it runs against the TIS mock on a host as well.
+ * The L4 IPC front end is in tpm2_broker_l4.cc. */
+
+#ifdef WOLFTPM_BROKER
+#include <wolftpm/tpm2_broker.h>
+
+#include <time.h>
+
+static word64 TPM2_Broker_TimeUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((word64)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static TPM2_BROKER_CLIENT* TPM2_Broker_GetClient(TPM2_BROKER* broker, int id)
+{
+    if (broker == NULL || id < 0 || id >= TPM2_BROKER_MAX_CLIENTS ||
+            !broker->client[id].inUse) {
+        return NULL;
+    }
+    return &broker->client[id];
+}
+
+/* Queued client with the lowest pass, the earliest one on a tie. Called with
+ * the broker lock held, returns -1 if no command is queued. */
+static int TPM2_Broker_Next(TPM2_BROKER* broker)
+{
+    TPM2_BROKER_CLIENT* c;
+    TPM2_BROKER_CLIENT* best = NULL;
+    int i, next = -1;
+
+    for (i = 0; i < TPM2_BROKER_MAX_CLIENTS; i++) {
+        c = &broker->client[i];
+        if (!c->inUse || !c->waiting)
+            continue;
+        if (best == NULL || c->pass < best->pass ||
+                (c->pass == best->pass &&
+                    (int)(c->ticket - best->ticket) < 0)) {
+            best = c;
+            next = i;
+        }
+    }
+    return next;
+}
+
+/* Waits until the TPM is free and it is the turn of client id, then claims
+ * the TPM. Returns the client swapped out before, -1 if none. Called with
+ * the broker lock held. */
+static int TPM2_Broker_Dispatch(TPM2_BROKER* broker, int id)
+{
+    TPM2_BROKER_CLIENT* c = &broker->client[id];
+    int prev = -1;
+
+    /* a client that was idle starts at the current position, so it does not
+     * run ahead on the share it did not use */
+    if (c->pass < broker->vtime)
+        c->pass = broker->vtime;
+    c->ticket = broker->tickets++;
+    c->waiting = 1;
+    while (broker->busy || TPM2_Broker_Next(broker) != id)
+        pthread_cond_wait(&broker->cond, &broker->lock);
+    c->waiting = 0;
+
+    broker->busy = 1;
+    broker->vtime = c->pass;
+    c->pass += TPM2_BROKER_STRIDE / c->priority;
+    if (broker->owner >= 0 && broker->owner != id)
+        prev = broker->owner;
+    broker->owner = id;
+    return prev;
+}
+
+static void TPM2_Broker_Release(TPM2_BROKER* broker)
+{
+    broker->busy = 0;
+    pthread_cond_broadcast(&broker->cond);
+}
+
+TPM_RC TPM2_Broker_Init(TPM2_BROKER* broker, TPM2_CTX* ctx)
+{
+    if (broker == NULL || ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    XMEMSET(broker, 0, sizeof(TPM2_BROKER));
+    if (pthread_mutex_init(&broker->lock, NULL) != 0) {
+        return TPM_RC_FAILURE;
+    }
+    if (pthread_cond_init(&broker->cond, NULL) != 0) {
+        pthread_mutex_destroy(&broker->lock);
+        return TPM_RC_FAILURE;
+    }
+    broker->ctx = ctx;
+    broker->owner = -1;
+
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC TPM2_Broker_Cleanup(TPM2_BROKER* broker)
+{
+    int i;
+
+    if (broker == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    for (i = 0; i < TPM2_BROKER_MAX_CLIENTS; i++) {
+        if (broker->client[i].inUse)
+            TPM2_Broker_Close(broker, i);
+    }
+    pthread_cond_destroy(&broker->cond);
+    pthread_mutex_destroy(&broker->lock);
+    broker->ctx = NULL;
+
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC TPM2_Broker_Open(TPM2_BROKER* broker, int priority, int* id)
+{
+    TPM_RC rc = TPM_RC_MEMORY;
+    TPM2_BROKER_CLIENT* c;
+    int i;
+
+    if (broker == NULL || id == NULL || priority < 1 ||
+            priority > TPM2_BROKER_MAX_PRIORITY) {
+        return BAD_FUNC_ARG;
+    }
+
+    pthread_mutex_lock(&broker->lock);
+    for (i = 0; i < TPM2_BROKER_MAX_CLIENTS; i++) {
+        c = &broker->client[i];
+        if (!c->inUse) {
+            XMEMSET(c, 0, sizeof(TPM2_BROKER_CLIENT));
+            c->space.isolate = 1;
+            c->priority = (word16)priority;
+            c->pass = broker->vtime;
+            c->inUse = 1;
+            *id = i;
+            rc = TPM_RC_SUCCESS;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&broker->lock);
+
+    return rc;
+}
+
+TPM_RC TPM2_Broker_Close(TPM2_BROKER* broker, int id)
+{
+    TPM_RC rc;
+    TPM2_BROKER_CLIENT* c;
+    int prev;
+
+    if (broker == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    pthread_mutex_lock(&broker->lock);
+    c = TPM2_Broker_GetClient(broker, id);
+    if (c == NULL || c->waiting) {
+        pthread_mutex_unlock(&broker->lock);
+        return BAD_FUNC_ARG;
+    }
+    /* the flush runs as a command of the client, the previous client stays
+     * loaded */
+    prev = TPM2_Broker_Dispatch(broker, id);
+    pthread_mutex_unlock(&broker->lock);
+
+    rc = TPM2_SpaceFlush(broker->ctx, &c->space);
+
+    pthread_mutex_lock(&broker->lock);
+    c->inUse = 0;
+    broker->owner = prev;
+    TPM2_Broker_Release(broker);
+    pthread_mutex_unlock(&broker->lock);
+
+    return rc;
+}
+
+TPM_RC TPM2_Broker_Command(TPM2_BROKER* broker, int id, const byte* cmd,
+    word32 cmdSz, byte* rsp, word32* rspSz)
+{
+    TPM_RC rc = TPM_RC_SUCCESS;
+    TPM2_BROKER_CLIENT* c;
+    word64 startUs;
+    word32 waitUs;
+    int prev;
+
+    if (broker == NULL || cmd == NULL || rsp == NULL || rspSz == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    startUs = TPM2_Broker_TimeUs();
+    pthread_mutex_lock(&broker->lock);
+    c = TPM2_Broker_GetClient(broker, id);
+    if (c == NULL || c->waiting) {
+        pthread_mutex_unlock(&broker->lock);
+        return BAD_FUNC_ARG;
+    }
+    prev = TPM2_Broker_Dispatch(broker, id);
+    waitUs = (word32)(TPM2_Broker_TimeUs() - startUs);
+    c->stats.cmds++;
+    c->stats.waitUs += waitUs;
+    if (waitUs > c->stats.maxWaitUs)
+        c->stats.maxWaitUs = waitUs;
+    if (prev >= 0)
+        c->stats.swaps++;
+    pthread_mutex_unlock(&broker->lock);
+
+    /* the TPM only holds the objects and sessions of the running client */
+    if (prev >= 0)
+        rc = TPM2_SpaceSwapOut(broker->ctx, &broker->client[prev].space);
+    if (rc == TPM_RC_SUCCESS) {
+        rc = TPM2_SpaceCommand(broker->ctx, &c->space, cmd, cmdSz, rsp,
+            rspSz);
+        prev = -1;
+    }
+
+    pthread_mutex_lock(&broker->lock);
+    if (prev >= 0) {
+        /* the previous client is partly swapped out, retry next time */
+        broker->owner = prev;
+    }
+    TPM2_Broker_Release(broker);
+    pthread_mutex_unlock(&broker->lock);
+
+    return rc;
+}
+
+TPM_RC TPM2_Broker_GetStats(TPM2_BROKER* broker, int id,
+    TPM2_BROKER_STATS* stats)
+{
+    TPM_RC rc = BAD_FUNC_ARG;
+    TPM2_BROKER_CLIENT* c;
+
+    if (broker == NULL || stats == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    pthread_mutex_lock(&broker->lock);
+    c = TPM2_Broker_GetClient(broker, id);
+    if (c != NULL) {
+        *stats = c->stats;
+        rc = TPM_RC_SUCCESS;
+    }
+    pthread_mutex_unlock(&broker->lock);
+
+    return rc;
+}
+
+#endif /* WOLFTPM_BROKER */
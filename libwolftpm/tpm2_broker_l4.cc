@@ -0,0 +1,220 @@
+/* tpm2_broker_l4.cc
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* L4 IPC front end of the broker. Every client gets a vtpm gate of its own
+ * from the factory gate, so the SWTPM backend of libwolftpm works as a
+ * broker client unchanged. A gate is served by a thread of its own: a
+ * command waiting in the broker queue only blocks its own client. */
+
+#if defined(WOLFTPM_BROKER) && defined(L4API_l4f)
+#include "wolftpm/tpm2_broker.h"
+#include "wolftpm/tpm2_packet.h"
+#include "wolftpm/tpm2_swtpm.h"
+
+#include "vtpm.h"
+#include <l4/re/env>
+#include <l4/re/rm>
+#include <l4/re/util/cap_alloc>
+#include <l4/re/util/br_manager>
+#include <l4/re/util/object_registry>
+#include <l4/sys/cxx/ipc_epiface>
+#include <l4/sys/factory>
+#include <pthread-l4.h>
+#include <pthread.h>
+#include <stdio.h>
+
+typedef L4Re::Util::Registry_server<L4Re::Util::Br_manager_hooks>
+    Broker_server;
+
+static word32 TPM2_Broker_L4_GetU32(const byte *buf) {
+  word32 v;
+  XMEMCPY(&v, buf, sizeof(v));
+  return TPM2_Packet_SwapU32(v);
+}
+
+static void TPM2_Broker_L4_PutU32(byte *buf, word32 v) {
+  v = TPM2_Packet_SwapU32(v);
+  XMEMCPY(buf, &v, sizeof(v));
+}
+
+class Broker_client : public L4::Epiface_t<Broker_client, VTPM> {
+public:
+  Broker_client(TPM2_BROKER *broker, int id, int priority)
+      : _broker(broker), _id(id), _priority(priority), _shm(nullptr),
+        _ready(false) {
+    pthread_mutex_init(&_lock, nullptr);
+    pthread_cond_init(&_cond, nullptr);
+  }
+
+  /* Starts the thread serving the client and waits for its gate */
+  L4::Cap<void> start() {
+    pthread_t tid;
+
+    if (pthread_create(&tid, nullptr, thread, this) != 0)
+      return L4::Cap<void>::Invalid;
+    pthread_detach(tid);
+    pthread_mutex_lock(&_lock);
+    while (!_ready)
+      pthread_cond_wait(&_cond, &_lock);
+    pthread_mutex_unlock(&_lock);
+    return _gate;
+  }
+
+  /* A client reconnecting after a transport error maps a new dataspace,
+   * it replaces the previous one */
+  long op_map_shm(VTPM::Rights, L4::Ipc::Snd_fpage ds_fp) {
+    L4Re::Env const *env = L4Re::Env::env();
+    L4::Cap<L4Re::Dataspace> ds = server_iface()->rcv_cap<L4Re::Dataspace>(0);
+    l4_addr_t addr = 0;
+    long err;
+
+    if (!ds_fp.cap_received() || !ds.is_valid())
+      return -L4_EINVAL;
+    err = env->rm()->attach(&addr, Vtpm_shm_size,
+                            L4Re::Rm::F::Search_addr | L4Re::Rm::F::RW,
+                            L4::Ipc::make_cap_rw(ds));
+    if (err < 0)
+      return err;
+    err = server_iface()->realloc_rcv_cap(0);
+    if (err < 0) {
+      env->rm()->detach(addr, 0);
+      return err;
+    }
+    if (_shm != nullptr) {
+      env->rm()->detach(reinterpret_cast<l4_addr_t>(_shm), 0);
+      L4Re::Util::cap_alloc.free(_ds, env->task());
+    }
+    _shm = reinterpret_cast<byte *>(addr);
+    _ds = ds;
+    return L4_EOK;
+  }
+
+  /* The response replaces the TPM_SEND_COMMAND message in place, the broker
+   * copies the command before it writes the response */
+  long op_command(VTPM::Rights, l4_uint32_t cmd_size, l4_uint32_t &rsp_size) {
+    word32 cmdSz, rspSz = Vtpm_shm_size - 2 * sizeof(word32);
+
+    if (_shm == nullptr || cmd_size < sizeof(word32) ||
+        cmd_size > Vtpm_shm_size)
+      return -L4_EINVAL;
+    if (TPM2_Broker_L4_GetU32(_shm) == TPM_SESSION_END) {
+      /* the client is gone, drop its objects and sessions */
+      TPM2_Broker_Close(_broker, _id);
+      rsp_size = 0;
+      return TPM2_Broker_Open(_broker, _priority, &_id) == TPM_RC_SUCCESS
+                 ? L4_EOK
+                 : -L4_ENOMEM;
+    }
+    if (TPM2_Broker_L4_GetU32(_shm) != TPM_SEND_COMMAND ||
+        cmd_size < TPM2_SWTPM_CMD_HDR_SZ)
+      return -L4_EINVAL;
+    cmdSz = TPM2_Broker_L4_GetU32(_shm + 5);
+    if (cmdSz > cmd_size - TPM2_SWTPM_CMD_HDR_SZ)
+      return -L4_EINVAL;
+
+    if (TPM2_Broker_Command(_broker, _id, _shm + TPM2_SWTPM_CMD_HDR_SZ, cmdSz,
+                            _shm + sizeof(word32), &rspSz) != TPM_RC_SUCCESS)
+      return -L4_EIO;
+    TPM2_Broker_L4_PutU32(_shm, rspSz);
+    TPM2_Broker_L4_PutU32(_shm + sizeof(word32) + rspSz, 0); /* ack */
+    rsp_size = rspSz + 2 * sizeof(word32);
+    return L4_EOK;
+  }
+
+private:
+  static void *thread(void *arg) {
+    Broker_client *c = static_cast<Broker_client *>(arg);
+    Broker_server server(L4::Cap<L4::Thread>(pthread_l4_cap(pthread_self())),
+                         L4Re::Env::env()->factory());
+
+    pthread_mutex_lock(&c->_lock);
+    c->_gate = server.registry()->register_obj(c);
+    c->_ready = true;
+    pthread_cond_signal(&c->_cond);
+    pthread_mutex_unlock(&c->_lock);
+    if (c->_gate.is_valid())
+      server.loop();
+    return nullptr;
+  }
+
+  TPM2_BROKER *_broker;
+  int _id;
+  int _priority;
+  byte *_shm;
+  L4::Cap<L4Re::Dataspace> _ds; /* received with map_shm */
+  bool _ready;
+  L4::Cap<void> _gate;
+  pthread_mutex_t _lock;
+  pthread_cond_t _cond;
+};
+
+/* create(VTPM_PROTO, priority) returns the vtpm gate of a new client */
+class Broker_factory : public L4::Epiface_t<Broker_factory, L4::Factory> {
+public:
+  explicit Broker_factory(TPM2_BROKER *broker) : _broker(broker) {}
+
+  long op_create(L4::Factory::Rights, L4::Ipc::Cap<void> &res,
+                 l4_mword_t type, L4::Ipc::Varg_list<> &&args) {
+    l4_mword_t priority = 1;
+    Broker_client *client;
+    L4::Cap<void> gate;
+    int id;
+
+    if (type != VTPM_PROTO)
+      return -L4_ENODEV;
+    L4::Ipc::Varg arg = args.pop_front();
+    if (arg.is_of_int())
+      priority = arg.value<l4_mword_t>();
+    if (priority < 1 || priority > TPM2_BROKER_MAX_PRIORITY)
+      return -L4_EINVAL;
+    if (TPM2_Broker_Open(_broker, (int)priority, &id) != TPM_RC_SUCCESS)
+      return -L4_ENOMEM;
+
+    client = new Broker_client(_broker, id, (int)priority);
+    gate = client->start();
+    if (!gate.is_valid()) {
+#ifdef DEBUG_WOLFTPM
+      printf("Broker_factory: client %d has no gate\n", id);
+#endif
+      delete client;
+      TPM2_Broker_Close(_broker, id);
+      return -L4_ENOMEM;
+    }
+    res = L4::Ipc::make_cap_rw(gate);
+    return L4_EOK;
+  }
+
+private:
+  TPM2_BROKER *_broker;
+};
+
+TPM_RC TPM2_Broker_L4_Serve(TPM2_BROKER *broker, const char *capName) {
+  Broker_server server(L4::Cap<L4::Thread>(pthread_l4_cap(pthread_self())),
+                       L4Re::Env::env()->factory());
+  Broker_factory factory(broker);
+
+  if (broker == NULL || capName == NULL ||
+      !server.registry()->register_obj(&factory, capName).is_valid())
+    return TPM_RC_FAILURE;
+  server.loop();
+  return TPM_RC_FAILURE;
+}
+#endif /* WOLFTPM_BROKER && L4API_l4f */
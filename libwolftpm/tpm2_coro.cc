@@ -0,0 +1,375 @@
+/* tpm2_coro.cc
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Event loop and operations of the coroutine front end. The asynchronous
+ * core is TPM2_SubmitCommand and TPM2_PollCommand, every operation marshals
+ * its command into the buffer of its device when the TPM becomes free and
+ * parses the response from there before its coroutine is resumed. */
+
+#ifdef WOLFTPM_COROUTINES
+#include "wolftpm/tpm2_coro.h"
+#include "wolftpm/tpm2_packet.h"
+
+#include <new>
+
+#define TPM2_CORO_MIN_SHIFT 6 /* smallest class is 64 bytes */
+
+namespace {
+
+union Frame_block {
+  Frame_block *next;
+  std::max_align_t align;
+};
+
+constexpr int frame_classes() {
+  int n = 0;
+  while ((std::size_t(1) << (TPM2_CORO_MIN_SHIFT + n)) < TPM2_CORO_FRAME_MAX)
+    n++;
+  return n + 1;
+}
+
+thread_local Frame_block *free_frames[frame_classes()];
+thread_local Tpm2_frame_stats frame_stats;
+
+int frame_class(std::size_t size) {
+  int c = 0;
+  while ((std::size_t(1) << (TPM2_CORO_MIN_SHIFT + c)) < size)
+    c++;
+  return c;
+}
+
+/* Auth area with a password session carrying the auth of the key */
+TPM_RC append_key_auth(TPM2_Packet *packet, const WOLFTPM2_KEY &key) {
+  TPMS_AUTH_COMMAND auth;
+  int markSz = 0;
+
+  if (key.handle.policyAuth)
+    return BAD_FUNC_ARG;
+  XMEMSET(&auth, 0, sizeof(auth));
+  auth.sessionHandle = TPM_RS_PW;
+  auth.sessionAttributes = TPMA_SESSION_continueSession;
+  auth.hmac.size = key.handle.auth.size;
+  XMEMCPY(auth.hmac.buffer, key.handle.auth.buffer, key.handle.auth.size);
+
+  TPM2_Packet_MarkU32(packet, &markSz);
+  TPM2_Packet_AppendAuthCmd(packet, &auth);
+  TPM2_Packet_PlaceU32(packet, markSz);
+  return TPM_RC_SUCCESS;
+}
+
+} // namespace
+
+void *Tpm2_frame_pool::alloc(std::size_t size) {
+  Frame_block *frame;
+  std::size_t blockSz;
+  int c, i;
+
+  frame_stats.frames++;
+  if (size > TPM2_CORO_FRAME_MAX) {
+    frame_stats.oversized++;
+    return ::operator new(size);
+  }
+
+  c = frame_class(size);
+  if (free_frames[c] == nullptr) {
+    blockSz = std::size_t(1) << (TPM2_CORO_MIN_SHIFT + c);
+    byte *chunk = static_cast<byte *>(
+        ::operator new(blockSz * TPM2_CORO_POOL_FRAMES));
+    for (i = TPM2_CORO_POOL_FRAMES - 1; i >= 0; i--) {
+      frame = reinterpret_cast<Frame_block *>(chunk + i * blockSz);
+      frame->next = free_frames[c];
+      free_frames[c] = frame;
+    }
+    frame_stats.refills++;
+  }
+  frame = free_frames[c];
+  free_frames[c] = frame->next;
+  return frame;
+}
+
+void Tpm2_frame_pool::release(void *frame, std::size_t size) noexcept {
+  Frame_block *block = static_cast<Frame_block *>(frame);
+  int c;
+
+  if (size > TPM2_CORO_FRAME_MAX) {
+    ::operator delete(frame);
+    return;
+  }
+  c = frame_class(size);
+  block->next = free_frames[c];
+  free_frames[c] = block;
+}
+
+Tpm2_frame_stats Tpm2_frame_pool::stats() noexcept { return frame_stats; }
+
+bool Tpm2_op::await_suspend(std::coroutine_handle<> waiter) {
+  _waiter = waiter;
+  return _dev.submit(this);
+}
+
+Tpm2_device::Tpm2_device(Tpm2_loop &loop, WOLFTPM2_DEV *dev)
+    : _loop(loop), _dev(dev), _next(loop._devs) {
+  loop._devs = this;
+}
+
+Tpm2_device::~Tpm2_device() {
+  Tpm2_device **link = &_loop._devs;
+
+  while (*link != nullptr && *link != this)
+    link = &(*link)->_next;
+  if (*link != nullptr)
+    *link = _next;
+}
+
+/* Marshals op and starts it on the TPM, false with op->_rc set on failure */
+bool Tpm2_device::issue(Tpm2_op *op) {
+  TPM2_Packet packet;
+
+  packet.buf = _buf;
+  packet.pos = TPM2_HEADER_SIZE;
+  packet.size = (int)sizeof(_buf);
+  op->_rc = op->marshal(&packet);
+  if (op->_rc == TPM_RC_SUCCESS)
+    op->_rc = TPM2_SubmitCommand(&_dev->ctx, _buf, (word32)packet.pos);
+  return op->_rc == TPM_RC_SUCCESS;
+}
+
+/* Starts op right away if the TPM is free, false if op failed meanwhile */
+bool Tpm2_device::submit(Tpm2_op *op) {
+  op->_next = nullptr;
+  if (_active == nullptr && _head == nullptr) {
+    if (!issue(op))
+      return false;
+    _active = op;
+  } else {
+    if (_tail != nullptr)
+      _tail->_next = op;
+    else
+      _head = op;
+    _tail = op;
+    _loop._stats.queued++;
+  }
+  _loop._pending++;
+  return true;
+}
+
+/* Puts the first queued command that can be started on the TPM */
+void Tpm2_device::start_next() {
+  Tpm2_op *op;
+
+  while (_active == nullptr && _head != nullptr) {
+    op = _head;
+    _head = op->_next;
+    if (_head == nullptr)
+      _tail = nullptr;
+    if (issue(op)) {
+      _active = op;
+    } else {
+      _loop._pending--;
+      op->_waiter.resume();
+    }
+  }
+}
+
+int Tpm2_device::poll() {
+  TPM2_Packet packet;
+  Tpm2_op *op = _active;
+  word32 rspSz = sizeof(_buf);
+  TPM_RC rc;
+
+  if (op == nullptr)
+    return 0;
+  _loop._stats.polls++;
+  rc = TPM2_PollCommand(&_dev->ctx, _buf, &rspSz);
+  if (rc == (TPM_RC)WC_PENDING_E)
+    return 0;
+
+  if (rc == TPM_RC_SUCCESS) {
+    packet.buf = _buf;
+    packet.pos = 0;
+    packet.size = (int)rspSz;
+    rc = op->parse(&packet);
+  }
+  op->_rc = rc;
+  _active = nullptr;
+  _loop._stats.cmds++;
+
+  /* keep the TPM busy while the coroutine runs */
+  start_next();
+  _loop._pending--;
+  op->_waiter.resume();
+  return 1;
+}
+
+int Tpm2_loop::run_once() {
+  Tpm2_device *dev;
+  int done = 0;
+
+  for (dev = _devs; dev != nullptr; dev = dev->_next)
+    done += dev->poll();
+  return done;
+}
+
+void Tpm2_loop::run() {
+  while (_pending > 0) {
+    if (run_once() == 0) {
+      _stats.sleeps++;
+      XTPM_SLEEP_US(TPM2_CORO_POLL_US);
+    }
+  }
+}
+
+TPM_RC Tpm2_command_op::marshal(TPM2_Packet *packet) {
+  if (_cmd == nullptr || _cmdSz < TPM2_HEADER_SIZE ||
+      _cmdSz > (word32)packet->size)
+    return BAD_FUNC_ARG;
+  XMEMCPY(packet->buf, _cmd, _cmdSz);
+  packet->pos = (int)_cmdSz;
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_command_op::parse(TPM2_Packet *packet) {
+  if (_rsp == nullptr || _rspSz == nullptr)
+    return BAD_FUNC_ARG;
+  if ((word32)packet->size > *_rspSz)
+    return BUFFER_E;
+  XMEMCPY(_rsp, packet->buf, packet->size);
+  *_rspSz = (word32)packet->size;
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_get_random_op::marshal(TPM2_Packet *packet) {
+  if (_buf == nullptr || _len > MAX_RNG_REQ_SIZE)
+    return BAD_FUNC_ARG;
+  TPM2_Packet_AppendU16(packet, (UINT16)_len);
+  TPM2_Packet_Finalize(packet, TPM_ST_NO_SESSIONS, TPM_CC_GetRandom);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_get_random_op::parse(TPM2_Packet *packet) {
+  UINT16 size = 0;
+  TPM_RC rc = TPM2_Packet_Parse(TPM_RC_SUCCESS, packet);
+
+  if (rc == TPM_RC_SUCCESS) {
+    TPM2_Packet_ParseU16(packet, &size);
+    if (size > _len)
+      return BUFFER_E;
+    TPM2_Packet_ParseBytes(packet, _buf, size);
+  }
+  return rc;
+}
+
+TPM_RC Tpm2_pcr_read_op::marshal(TPM2_Packet *packet) {
+  if (_out == nullptr)
+    return BAD_FUNC_ARG;
+  TPM2_Packet_AppendPCR(packet, const_cast<TPML_PCR_SELECTION *>(&_sel));
+  TPM2_Packet_Finalize(packet, TPM_ST_NO_SESSIONS, TPM_CC_PCR_Read);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_pcr_read_op::parse(TPM2_Packet *packet) {
+  TPM_RC rc = TPM2_Packet_Parse(TPM_RC_SUCCESS, packet);
+  int i;
+
+  if (rc == TPM_RC_SUCCESS) {
+    TPM2_Packet_ParseU32(packet, &_out->pcrUpdateCounter);
+    TPM2_Packet_ParsePCR(packet, &_out->pcrSelectionOut);
+    TPM2_Packet_ParseU32(packet, &_out->pcrValues.count);
+    if (_out->pcrValues.count > (UINT32)(sizeof(_out->pcrValues.digests) /
+                                         sizeof(_out->pcrValues.digests[0])))
+      return BUFFER_E;
+    for (i = 0; i < (int)_out->pcrValues.count; i++) {
+      TPM2_Packet_ParseU16(packet, &_out->pcrValues.digests[i].size);
+      TPM2_Packet_ParseBytes(packet, _out->pcrValues.digests[i].buffer,
+                             _out->pcrValues.digests[i].size);
+    }
+  }
+  return rc;
+}
+
+TPM_RC Tpm2_quote_op::marshal(TPM2_Packet *packet) {
+  TPM_RC rc;
+
+  if (_out == nullptr)
+    return BAD_FUNC_ARG;
+  TPM2_Packet_AppendU32(packet, _key.handle.hndl);
+  rc = append_key_auth(packet, _key);
+  if (rc != TPM_RC_SUCCESS)
+    return rc;
+  TPM2_Packet_AppendU16(packet, _nonce.size);
+  TPM2_Packet_AppendBytes(packet, const_cast<byte *>(_nonce.buffer),
+                          _nonce.size);
+  TPM2_Packet_AppendU16(packet, TPM_ALG_NULL); /* inScheme */
+  TPM2_Packet_AppendU16(packet, TPM_ALG_NULL);
+  TPM2_Packet_AppendPCR(packet, const_cast<TPML_PCR_SELECTION *>(&_sel));
+  TPM2_Packet_Finalize(packet, TPM_ST_SESSIONS, TPM_CC_Quote);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_quote_op::parse(TPM2_Packet *packet) {
+  TPM_RC rc = TPM2_Packet_Parse(TPM_RC_SUCCESS, packet);
+  UINT32 paramSz = 0;
+
+  if (rc == TPM_RC_SUCCESS) {
+    TPM2_Packet_ParseU32(packet, &paramSz);
+    TPM2_Packet_ParseU16(packet, &_out->quoted.size);
+    if (_out->quoted.size > sizeof(_out->quoted.attestationData))
+      return BUFFER_E;
+    TPM2_Packet_ParseBytes(packet, _out->quoted.attestationData,
+                           _out->quoted.size);
+    TPM2_Packet_ParseSignature(packet, &_out->signature);
+  }
+  return rc;
+}
+
+TPM_RC Tpm2_sign_op::marshal(TPM2_Packet *packet) {
+  TPM_RC rc;
+
+  if (_sig == nullptr || _digest == nullptr || _digestSz < 0 ||
+      _digestSz > (int)sizeof(TPMU_HA))
+    return BAD_FUNC_ARG;
+  TPM2_Packet_AppendU32(packet, _key.handle.hndl);
+  rc = append_key_auth(packet, _key);
+  if (rc != TPM_RC_SUCCESS)
+    return rc;
+  TPM2_Packet_AppendU16(packet, (UINT16)_digestSz);
+  TPM2_Packet_AppendBytes(packet, const_cast<byte *>(_digest), _digestSz);
+  TPM2_Packet_AppendU16(packet, TPM_ALG_NULL); /* inScheme */
+  TPM2_Packet_AppendU16(packet, TPM_ALG_NULL);
+  TPM2_Packet_AppendU16(packet, TPM_ST_HASHCHECK); /* validation */
+  TPM2_Packet_AppendU32(packet, TPM_RH_NULL);
+  TPM2_Packet_AppendU16(packet, 0);
+  TPM2_Packet_Finalize(packet, TPM_ST_SESSIONS, TPM_CC_Sign);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC Tpm2_sign_op::parse(TPM2_Packet *packet) {
+  TPM_RC rc = TPM2_Packet_Parse(TPM_RC_SUCCESS, packet);
+  UINT32 paramSz = 0;
+
+  if (rc == TPM_RC_SUCCESS) {
+    TPM2_Packet_ParseU32(packet, &paramSz);
+    TPM2_Packet_ParseSignature(packet, _sig);
+  }
+  return rc;
+}
+
+#endif /* WOLFTPM_COROUTINES */
@@ -0,0 +1,190 @@
+/* tpm2_drbg.c
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Host DRBG behind TPM2_GetNonce_ex. The key is the ChaCha20 key, a refill
+ * generates TPM2_DRBG_BUF_SZ bytes with it and takes the first 32 of them as
+ * the next key, so output already served can not be recomputed from the
+ * state (fast key erasure). A seed from the TPM is XORed into the key, which
+ * is then stirred with one block. ChaCha20 is built in, the default build
+ * has no wolfCrypt. */
+
+#ifdef WOLFTPM_HOST_DRBG
+#include <wolftpm/tpm2_drbg.h>
+
+#define TPM2_DRBG_BLOCK_SZ 64
+#define TPM2_DRBG_KEY_SZ   32
+
+#if (TPM2_DRBG_BUF_SZ % TPM2_DRBG_BLOCK_SZ) != 0 || \
+    TPM2_DRBG_BUF_SZ < 2 * TPM2_DRBG_BLOCK_SZ
+    #error TPM2_DRBG_BUF_SZ must be a multiple of 64 of at least 128
+#endif
+
+#define TPM2_DRBG_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define TPM2_DRBG_QR(a, b, c, d)                                              \
+    a += b; d ^= a; d = TPM2_DRBG_ROTL(d, 16);                                \
+    c += d; b ^= c; b = TPM2_DRBG_ROTL(b, 12);                                \
+    a += b; d ^= a; d = TPM2_DRBG_ROTL(d, 8);                                 \
+    c += d; b ^= c; b = TPM2_DRBG_ROTL(b, 7)
+
+static word32 TPM2_Drbg_GetU32(const byte* buf)
+{
+    return (word32)buf[0] | ((word32)buf[1] << 8) | ((word32)buf[2] << 16) |
+        ((word32)buf[3] << 24);
+}
+
+static void TPM2_Drbg_PutU32(byte* buf, word32 val)
+{
+    buf[0] = (byte)val;
+    buf[1] = (byte)(val >> 8);
+    buf[2] = (byte)(val >> 16);
+    buf[3] = (byte)(val >> 24);
+}
+
+/* not optimized away like a memset of memory that is not read again */
+static void TPM2_Drbg_Zero(void* mem, word32 sz)
+{
+    volatile byte* p = (volatile byte*)mem;
+    while (sz-- > 0)
+        *p++ = 0;
+}
+
+/* ChaCha20 block of key with a zero nonce, RFC 8439 */
+static void TPM2_Drbg_Block(const word32* key, word32 counter, byte* out)
+{
+    word32 x[16], s[16];
+    int i;
+
+    s[0] = 0x61707865; s[1] = 0x3320646e; s[2] = 0x79622d32; s[3] = 0x6b206574;
+    for (i = 0; i < 8; i++)
+        s[4 + i] = key[i];
+    s[12] = counter;
+    s[13] = s[14] = s[15] = 0;
+
+    for (i = 0; i < 16; i++)
+        x[i] = s[i];
+    for (i = 0; i < 10; i++) {
+        TPM2_DRBG_QR(x[0], x[4], x[8],  x[12]);
+        TPM2_DRBG_QR(x[1], x[5], x[9],  x[13]);
+        TPM2_DRBG_QR(x[2], x[6], x[10], x[14]);
+        TPM2_DRBG_QR(x[3], x[7], x[11], x[15]);
+        TPM2_DRBG_QR(x[0], x[5], x[10], x[15]);
+        TPM2_DRBG_QR(x[1], x[6], x[11], x[12]);
+        TPM2_DRBG_QR(x[2], x[7], x[8],  x[13]);
+        TPM2_DRBG_QR(x[3], x[4], x[9],  x[14]);
+    }
+    for (i = 0; i < 16; i++)
+        TPM2_Drbg_PutU32(&out[i * 4], x[i] + s[i]);
+
+    TPM2_Drbg_Zero(x, sizeof(x));
+    TPM2_Drbg_Zero(s, sizeof(s));
+}
+
+/* Replaces the key with the first bytes of the output of len bytes */
+static void TPM2_Drbg_Rekey(TPM2_DRBG* drbg, byte* out, word32 len)
+{
+    word32 pos;
+    int i;
+
+    for (pos = 0; pos < len; pos += TPM2_DRBG_BLOCK_SZ)
+        TPM2_Drbg_Block(drbg->key, pos / TPM2_DRBG_BLOCK_SZ, &out[pos]);
+    for (i = 0; i < 8; i++)
+        drbg->key[i] = TPM2_Drbg_GetU32(&out[i * 4]);
+    TPM2_Drbg_Zero(out, TPM2_DRBG_KEY_SZ);
+}
+
+void TPM2_Drbg_Init(TPM2_DRBG* drbg)
+{
+    XMEMSET(drbg, 0, sizeof(TPM2_DRBG));
+    drbg->reseedBytes = TPM2_DRBG_RESEED_BYTES;
+    drbg->reseedReqs = TPM2_DRBG_RESEED_REQS;
+}
+
+void TPM2_Drbg_Free(TPM2_DRBG* drbg)
+{
+    TPM2_Drbg_Zero(drbg->key, sizeof(drbg->key));
+    TPM2_Drbg_Zero(drbg->buf, sizeof(drbg->buf));
+    drbg->avail = 0;
+    drbg->seeded = 0;
+}
+
+int TPM2_Drbg_NeedSeed(const TPM2_DRBG* drbg)
+{
+    return !drbg->seeded ||
+        (drbg->reseedBytes > 0 && drbg->seedBytes >= drbg->reseedBytes) ||
+        (drbg->reseedReqs > 0 && drbg->seedReqs >= drbg->reseedReqs);
+}
+
+void TPM2_Drbg_Seed(TPM2_DRBG* drbg, const byte* seed, word32 seedSz)
+{
+    byte block[TPM2_DRBG_BLOCK_SZ];
+    word32 pos, len;
+    int i;
+
+    /* output of the previous key is not served after a reseed */
+    TPM2_Drbg_Zero(drbg->buf, sizeof(drbg->buf));
+    drbg->avail = 0;
+
+    for (pos = 0; pos < seedSz; pos += TPM2_DRBG_KEY_SZ) {
+        len = seedSz - pos;
+        if (len > TPM2_DRBG_KEY_SZ)
+            len = TPM2_DRBG_KEY_SZ;
+        for (i = 0; i < 8; i++)
+            TPM2_Drbg_PutU32(&block[i * 4], drbg->key[i]);
+        for (i = 0; i < (int)len; i++)
+            block[i] ^= seed[pos + i];
+        for (i = 0; i < 8; i++)
+            drbg->key[i] = TPM2_Drbg_GetU32(&block[i * 4]);
+        TPM2_Drbg_Rekey(drbg, block, sizeof(block));
+    }
+    TPM2_Drbg_Zero(block, sizeof(block));
+
+    drbg->seedBytes = 0;
+    drbg->seedReqs = 0;
+    drbg->seeded = 1;
+    drbg->stats.seeds++;
+}
+
+void TPM2_Drbg_Generate(TPM2_DRBG* drbg, byte* out, word32 outSz)
+{
+    byte* src;
+    word32 len;
+
+    drbg->seedReqs++;
+    drbg->seedBytes += outSz;
+    drbg->stats.requests++;
+    drbg->stats.bytes += outSz;
+
+    while (outSz > 0) {
+        if (drbg->avail == 0) {
+            TPM2_Drbg_Rekey(drbg, drbg->buf, sizeof(drbg->buf));
+            drbg->avail = sizeof(drbg->buf) - TPM2_DRBG_KEY_SZ;
+        }
+        len = (outSz < drbg->avail) ? outSz : drbg->avail;
+        src = &drbg->buf[sizeof(drbg->buf) - drbg->avail];
+        XMEMCPY(out, src, len);
+        TPM2_Drbg_Zero(src, len);
+        drbg->avail -= len;
+        out += len;
+        outSz -= len;
+    }
+}
+
+#endif /* WOLFTPM_HOST_DRBG */
@@ -0,0 +1,268 @@
+/* tpm2_ioring.c
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Multi-producer single-consumer submission ring. Producers claim a position
+ * with a compare and swap on the tail, each slot carries the position it is
+ * ready for, so a slot is only read once its producer published it. The IO
+ * thread is the only consumer and drives the transport through
+ * TPM2_SubmitCommand and TPM2_WaitCommand. */
+
+#ifdef WOLFTPM_IO_RING
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE /* pthread_setaffinity_np */
+#endif
+#include <wolftpm/tpm2_ioring.h>
+
+#include <sched.h>
+#ifdef L4API_l4f
+    #include <l4/re/env.h>
+    #include <l4/sys/scheduler.h>
+    #include <pthread-l4.h>
+#endif
+
+#define TPM2_IO_RING_MASK (TPM2_IO_RING_SIZE - 1)
+
+#if (TPM2_IO_RING_SIZE & TPM2_IO_RING_MASK) != 0
+    #error TPM2_IO_RING_SIZE must be a power of two
+#endif
+
+/* Takes the next published request, NULL if the ring is empty */
+static TPM2_IO_REQ* TPM2_IoRing_Pop(TPM2_IO_RING* ring)
+{
+    TPM2_IO_RING_SLOT* slot = &ring->slot[ring->head & TPM2_IO_RING_MASK];
+    TPM2_IO_REQ* req;
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring->head + 1)
+        return NULL;
+    req = slot->req;
+    /* free for the producer one lap ahead */
+    __atomic_store_n(&slot->seq, ring->head + TPM2_IO_RING_SIZE,
+        __ATOMIC_RELEASE);
+    ring->head++;
+    return req;
+}
+
+/* Blocks until a request is published, NULL once stopped and drained */
+static TPM2_IO_REQ* TPM2_IoRing_Next(TPM2_IO_RING* ring)
+{
+    TPM2_IO_REQ* req;
+
+    for (;;) {
+        req = TPM2_IoRing_Pop(ring);
+        if (req != NULL || __atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE))
+            return req;
+
+        /* announce the sleep, then look again so no wake up is lost. The
+         * fence orders the flag store before the slot load, pairing with the
+         * one in TPM2_IoRing_Submit. */
+        __atomic_store_n(&ring->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        req = TPM2_IoRing_Pop(ring);
+        if (req == NULL && !__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE)) {
+            ring->stats.sleeps++;
+            sem_wait(&ring->wake);
+            continue;
+        }
+        /* a producer that saw the flag has posted or is about to */
+        if (!__atomic_exchange_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST))
+            sem_wait(&ring->wake);
+        if (req != NULL)
+            return req;
+    }
+}
+
+static void TPM2_IoRing_Complete(TPM2_IO_REQ* req)
+{
+    sem_post(&req->done);
+}
+
+/* Puts req on the device, completes it right away on failure */
+static TPM2_IO_REQ* TPM2_IoRing_Issue(TPM2_IO_RING* ring, TPM2_IO_REQ* req)
+{
+    if (req == NULL)
+        return NULL;
+    req->rc = TPM2_SubmitCommand(ring->ctx, req->cmd, req->cmdSz);
+    if (req->rc != TPM_RC_SUCCESS) {
+        TPM2_IoRing_Complete(req);
+        return NULL;
+    }
+    return req;
+}
+
+static void* TPM2_IoRing_Thread(void* arg)
+{
+    TPM2_IO_RING* ring = (TPM2_IO_RING*)arg;
+    TPM2_IO_REQ* cur = NULL;
+    TPM2_IO_REQ* next;
+
+    for (;;) {
+        if (cur == NULL) {
+            next = TPM2_IoRing_Next(ring);
+            if (next == NULL)
+                break;
+            cur = TPM2_IoRing_Issue(ring, next);
+            continue;
+        }
+        cur->rc = TPM2_WaitCommand(ring->ctx, cur->rsp, &cur->rspSz);
+        ring->stats.cmds++;
+
+        /* keep the TPM busy while the caller wakes up */
+        next = TPM2_IoRing_Issue(ring, TPM2_IoRing_Pop(ring));
+        if (next != NULL)
+            ring->stats.chained++;
+        TPM2_IoRing_Complete(cur);
+        cur = next;
+    }
+    return NULL;
+}
+
+static void TPM2_IoRing_Pin(TPM2_IO_RING* ring, int cpu)
+{
+#ifdef L4API_l4f
+    l4_sched_param_t sp = l4_sched_param(TPM2_IO_RING_L4_PRIO, 0);
+
+    sp.affinity = l4_sched_cpu_set(cpu, 0);
+    l4_scheduler_run_thread(l4re_env()->scheduler,
+        pthread_l4_cap(ring->thread), &sp);
+#elif defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(ring->thread, sizeof(set), &set);
+#else
+    (void)ring;
+    (void)cpu;
+#endif
+}
+
+TPM_RC TPM2_IoRing_Start(TPM2_IO_RING* ring, TPM2_CTX* ctx, int cpu)
+{
+    word32 i;
+
+    if (ring == NULL || ctx == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    XMEMSET(ring, 0, sizeof(TPM2_IO_RING));
+    for (i = 0; i < TPM2_IO_RING_SIZE; i++)
+        ring->slot[i].seq = i;
+    ring->ctx = ctx;
+    if (sem_init(&ring->wake, 0, 0) != 0) {
+        return TPM_RC_FAILURE;
+    }
+    if (pthread_create(&ring->thread, NULL, TPM2_IoRing_Thread, ring) != 0) {
+        sem_destroy(&ring->wake);
+        return TPM_RC_FAILURE;
+    }
+    if (cpu >= 0)
+        TPM2_IoRing_Pin(ring, cpu);
+
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC TPM2_IoRing_Stop(TPM2_IO_RING* ring)
+{
+    if (ring == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    __atomic_store_n(&ring->stop, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST))
+        sem_post(&ring->wake);
+    pthread_join(ring->thread, NULL);
+    sem_destroy(&ring->wake);
+
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC TPM2_IoReq_Init(TPM2_IO_REQ* req)
+{
+    if (req == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    XMEMSET(req, 0, sizeof(TPM2_IO_REQ));
+    if (sem_init(&req->done, 0, 0) != 0) {
+        return TPM_RC_FAILURE;
+    }
+    return TPM_RC_SUCCESS;
+}
+
+void TPM2_IoReq_Free(TPM2_IO_REQ* req)
+{
+    if (req != NULL)
+        sem_destroy(&req->done);
+}
+
+TPM_RC TPM2_IoRing_Submit(TPM2_IO_RING* ring, TPM2_IO_REQ* req)
+{
+    TPM2_IO_RING_SLOT* slot;
+    word32 pos, seq;
+
+    if (ring == NULL || req == NULL || req->cmd == NULL ||
+            req->rsp == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &ring->slot[pos & TPM2_IO_RING_MASK];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq == pos) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos was reloaded by the failed exchange */
+        }
+        else {
+            /* full: the IO thread still has to take the slot one lap back */
+            if ((int)(seq - pos) < 0)
+                sched_yield();
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+    slot->req = req;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    /* the publish must be visible before the flag is read, or the IO thread
+     * may miss the slot and this thread the sleep */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->sleeping, __ATOMIC_SEQ_CST) &&
+            __atomic_exchange_n(&ring->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        sem_post(&ring->wake);
+    }
+    return TPM_RC_SUCCESS;
+}
+
+TPM_RC TPM2_IoRing_Wait(TPM2_IO_REQ* req)
+{
+    if (req == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    while (sem_wait(&req->done) != 0)
+        ;   /* interrupted */
+    return req->rc;
+}
+
+#endif /* WOLFTPM_IO_RING */
@@ -82,9 +82,9 @@ UINT64 TPM2_Packet_SwapU64(UINT64 data) {
 void TPM2_Packet_Init(TPM2_CTX* ctx, TPM2_Packet* packet)
 {
     if (ctx && packet) {
-        packet->buf  = ctx->cmdBuf;
+        packet->buf  = &ctx->cmdBuf[TPM2_PACKET_HEADROOM];
         packet->pos = TPM2_HEADER_SIZE; /* skip header (fill during finalize) */
-        packet->size = sizeof(ctx->cmdBuf);
+        packet->size = MAX_COMMAND_SIZE;
     }
 }
 
@@ -848,6 +848,134 @@ TPM_RC TPM2_Packet_Parse(TPM_RC rc, TPM2_Packet* packet)
     return cmdSz;
 }
 
+#if defined(WOLFTPM_RESOURCE_MGR) || defined(WOLFTPM_BROKER)
+static const TPM2_CMD_HANDLES gCmdHandles[] = {
+    {TPM_CC_NV_UndefineSpaceSpecial, 2, 0},
+    {TPM_CC_EvictControl, 2, 0},
+    {TPM_CC_HierarchyControl, 1, 0},
+    {TPM_CC_NV_UndefineSpace, 2, 0},
+    {TPM_CC_ChangeEPS, 1, 0},
+    {TPM_CC_ChangePPS, 1, 0},
+    {TPM_CC_Clear, 1, 0},
+    {TPM_CC_ClearControl, 1, 0},
+    {TPM_CC_ClockSet, 1, 0},
+    {TPM_CC_HierarchyChangeAuth, 1, 0},
+    {TPM_CC_NV_DefineSpace, 1, 0},
+    {TPM_CC_PCR_Allocate, 1, 0},
+    {TPM_CC_PCR_SetAuthPolicy, 1, 0},
+    {TPM_CC_PP_Commands, 1, 0},
+    {TPM_CC_SetPrimaryPolicy, 1, 0},
+    {TPM_CC_FieldUpgradeStart, 2, 0},
+    {TPM_CC_ClockRateAdjust, 1, 0},
+    {TPM_CC_CreatePrimary, 1, TPM2_CMD_OUT_OBJECT},
+    {TPM_CC_NV_GlobalWriteLock, 1, 0},
+    {TPM_CC_GetCommandAuditDigest, 2, 0},
+    {TPM_CC_NV_Increment, 2, 0},
+    {TPM_CC_NV_SetBits, 2, 0},
+    {TPM_CC_NV_Extend, 2, 0},
+    {TPM_CC_NV_Write, 2, 0},
+    {TPM_CC_NV_WriteLock, 2, 0},
+    {TPM_CC_DictionaryAttackLockReset, 1, 0},
+    {TPM_CC_DictionaryAttackParameters, 1, 0},
+    {TPM_CC_NV_ChangeAuth, 1, 0},
+    {TPM_CC_PCR_Event, 1, 0},
+    {TPM_CC_PCR_Reset, 1, 0},
+    {TPM_CC_SequenceComplete, 1, TPM2_CMD_END_SEQ},
+    {TPM_CC_SetAlgorithmSet, 1, 0},
+    {TPM_CC_SetCommandCodeAuditStatus, 1, 0},
+    {TPM_CC_FieldUpgradeData, 0, 0},
+    {TPM_CC_IncrementalSelfTest, 0, 0},
+    {TPM_CC_SelfTest, 0, 0},
+    {TPM_CC_Startup, 0, 0},
+    {TPM_CC_Shutdown, 0, 0},
+    {TPM_CC_StirRandom, 0, 0},
+    {TPM_CC_ActivateCredential, 2, 0},
+    {TPM_CC_Certify, 2, 0},
+    {TPM_CC_PolicyNV, 3, 0},
+    {TPM_CC_CertifyCreation, 2, 0},
+    {TPM_CC_Duplicate, 2, 0},
+    {TPM_CC_GetTime, 2, 0},
+    {TPM_CC_GetSessionAuditDigest, 3, 0},
+    {TPM_CC_NV_Read, 2, 0},
+    {TPM_CC_NV_ReadLock, 2, 0},
+    {TPM_CC_ObjectChangeAuth, 2, 0},
+    {TPM_CC_PolicySecret, 2, 0},
+    {TPM_CC_Rewrap, 2, 0},
+    {TPM_CC_Create, 1, 0},
+    {TPM_CC_ECDH_ZGen, 1, 0},
+    {TPM_CC_HMAC, 1, 0},
+    {TPM_CC_Import, 1, 0},
+    {TPM_CC_Load, 1, TPM2_CMD_OUT_OBJECT},
+    {TPM_CC_Quote, 1, 0},
+    {TPM_CC_RSA_Decrypt, 1, 0},
+    {TPM_CC_HMAC_Start, 1, TPM2_CMD_OUT_OBJECT | TPM2_CMD_OUT_SEQ},
+    {TPM_CC_SequenceUpdate, 1, 0},
+    {TPM_CC_Sign, 1, 0},
+    {TPM_CC_Unseal, 1, 0},
+    {TPM_CC_PolicySigned, 2, 0},
+    /* returns a session handle for a session context */
+    {TPM_CC_ContextLoad, 0, TPM2_CMD_OUT_OBJECT | TPM2_CMD_OUT_SESSION},
+    {TPM_CC_ContextSave, 1, 0},
+    {TPM_CC_ECDH_KeyGen, 1, 0},
+    {TPM_CC_EncryptDecrypt, 1, 0},
+    {TPM_CC_FlushContext, 1, TPM2_CMD_FLUSH},
+    {TPM_CC_LoadExternal, 0, TPM2_CMD_OUT_OBJECT},
+    {TPM_CC_MakeCredential, 1, 0},
+    {TPM_CC_NV_ReadPublic, 1, 0},
+    {TPM_CC_PolicyAuthorize, 1, 0},
+    {TPM_CC_PolicyAuthValue, 1, 0},
+    {TPM_CC_PolicyCommandCode, 1, 0},
+    {TPM_CC_PolicyCounterTimer, 1, 0},
+    {TPM_CC_PolicyCpHash, 1, 0},
+    {TPM_CC_PolicyLocality, 1, 0},
+    {TPM_CC_PolicyNameHash, 1, 0},
+    {TPM_CC_PolicyOR, 1, 0},
+    {TPM_CC_PolicyTicket, 1, 0},
+    {TPM_CC_ReadPublic, 1, 0},
+    {TPM_CC_RSA_Encrypt, 1, 0},
+    {TPM_CC_StartAuthSession, 2, TPM2_CMD_OUT_SESSION},
+    {TPM_CC_VerifySignature, 1, 0},
+    {TPM_CC_ECC_Parameters, 0, 0},
+    {TPM_CC_FirmwareRead, 0, 0},
+    {TPM_CC_GetCapability, 0, 0},
+    {TPM_CC_GetRandom, 0, 0},
+    {TPM_CC_GetTestResult, 0, 0},
+    {TPM_CC_Hash, 0, 0},
+    {TPM_CC_PCR_Read, 0, 0},
+    {TPM_CC_PolicyPCR, 1, 0},
+    {TPM_CC_PolicyRestart, 1, 0},
+    {TPM_CC_ReadClock, 0, 0},
+    {TPM_CC_PCR_Extend, 1, 0},
+    {TPM_CC_PCR_SetAuthValue, 1, 0},
+    {TPM_CC_NV_Certify, 3, 0},
+    {TPM_CC_EventSequenceComplete, 2, TPM2_CMD_END_SEQ},
+    {TPM_CC_HashSequenceStart, 0, TPM2_CMD_OUT_OBJECT | TPM2_CMD_OUT_SEQ},
+    {TPM_CC_PolicyPhysicalPresence, 1, 0},
+    {TPM_CC_PolicyDuplicationSelect, 1, 0},
+    {TPM_CC_PolicyGetDigest, 1, 0},
+    {TPM_CC_TestParms, 0, 0},
+    {TPM_CC_Commit, 1, 0},
+    {TPM_CC_PolicyPassword, 1, 0},
+    {TPM_CC_ZGen_2Phase, 1, 0},
+    {TPM_CC_EC_Ephemeral, 0, 0},
+    {TPM_CC_PolicyNvWritten, 1, 0},
+    {TPM_CC_PolicyTemplate, 1, 0},
+    {TPM_CC_CreateLoaded, 1, TPM2_CMD_OUT_OBJECT},
+    {TPM_CC_PolicyAuthorizeNV, 3, 0},
+    {TPM_CC_EncryptDecrypt2, 1, 0},
+};
+
+const TPM2_CMD_HANDLES* TPM2_GetCmdHandles(TPM_CC cc)
+{
+    word32 i;
+    for (i = 0; i < sizeof(gCmdHandles) / sizeof(gCmdHandles[0]); i++) {
+        if (gCmdHandles[i].cc == cc)
+            return &gCmdHandles[i];
+    }
+    return NULL;
+}
+#endif
+
 /******************************************************************************/
 /* --- END TPM Packet Assembly / Parsing -- */
 /******************************************************************************/
@@ -49,72 +49,204 @@
 /* --- Local Functions -- */
 /******************************************************************************/
 
-/* This function performs key generation according to Part 1 of the TPM spec
- * and returns the number of bytes generated, which may be zero.
- *
- * 'keyIn' input data is used together with the label, ContextU and ContextV to
- * generate the session key.
- *
- * 'key' points to the buffer storing the generated session key, and
- * 'key' can not be NULL.
- *
- * 'sizeInBits' must be no larger than (2^18)-1 = 256K bits (32385 bytes).
- *
- * Note: The "once" parameter is set to allow incremental generation of a large
- * value. If this flag is TRUE, "sizeInBits" is used in the HMAC computation
- * but only one iteration of the KDF is performed. This would be used for
- * XOR obfuscation so that the mask value can be generated in digest-sized
- * chunks rather than having to be generated all at once in an arbitrarily
- * large buffer and then XORed into the result. If "once" is TRUE, then
- * "sizeInBits" must be a multiple of 8.
- *
- * Any error in the processing of this command is considered fatal.
- *
- * Return values:
- *     0    hash algorithm is not supported or is TPM_ALG_NULL
- *    >0    the number of bytes in the 'key' buffer
- *
- */
-int TPM2_KDFa(
-    TPM_ALG_ID   hashAlg,   /* IN: hash algorithm used in HMAC */
-    TPM2B_DATA  *keyIn,     /* IN: key */
-    const char  *label,     /* IN: a 0-byte terminated label used in KDF */
-    TPM2B_NONCE *contextU,  /* IN: context U (newer) */
-    TPM2B_NONCE *contextV,  /* IN: context V */
-    BYTE        *key,       /* OUT: key buffer */
-    UINT32       keySz      /* IN: size of generated key in bytes */
-)
-{
 #ifndef WOLFTPM2_NO_WOLFCRYPT
-    int ret, hashType;
-    Hmac hmac_ctx;
+/* Compute the HMAC pads of a key (RFC 2104): the key, hashed first if longer
+ * than a block, XORed with ipad and opad and each hashed as the first block.
+ * The two compressions and the key setup are done once per key instead of
+ * once per HMAC as with wc_HmacSetKey. */
+static int TPM2_HmacPad_Init(TPM2_HMAC_PAD* pad, TPMI_ALG_HASH hashAlg,
+    const BYTE* key, UINT32 keySz)
+{
+    int rc, i, blockSz;
+    byte ipad[WC_MAX_BLOCK_SIZE];
+    byte opad[WC_MAX_BLOCK_SIZE];
+
+    pad->hashAlg = TPM_ALG_ERROR;
+    pad->hashType = TPM2_GetHashType(hashAlg);
+    pad->digestSz = TPM2_GetHashDigestSize(hashAlg);
+    if (pad->hashType == WC_HASH_TYPE_NONE || pad->digestSz <= 0 ||
+            pad->digestSz > WC_MAX_DIGEST_SIZE)
+        return NOT_COMPILED_IN;
+    blockSz = wc_HashGetBlockSize((enum wc_HashType)pad->hashType);
+    if (blockSz <= 0 || blockSz > WC_MAX_BLOCK_SIZE)
+        return NOT_COMPILED_IN;
+
+    XMEMSET(ipad, 0, sizeof(ipad));
+    if (keySz > (UINT32)blockSz) {
+        rc = wc_Hash((enum wc_HashType)pad->hashType, key, keySz, ipad,
+            sizeof(ipad));
+        if (rc != 0)
+            return rc;
+    }
+    else if (keySz > 0) {
+        XMEMCPY(ipad, key, keySz);
+    }
+    for (i = 0; i < blockSz; i++) {
+        opad[i] = ipad[i] ^ 0x5c;
+        ipad[i] ^= 0x36;
+    }
+
+    rc = wc_HashInit(&pad->inner, (enum wc_HashType)pad->hashType);
+    if (rc == 0) {
+        rc = wc_HashUpdate(&pad->inner, (enum wc_HashType)pad->hashType,
+            ipad, blockSz);
+    }
+    if (rc == 0)
+        rc = wc_HashInit(&pad->outer, (enum wc_HashType)pad->hashType);
+    if (rc == 0) {
+        rc = wc_HashUpdate(&pad->outer, (enum wc_HashType)pad->hashType,
+            opad, blockSz);
+    }
+    if (rc == 0)
+        pad->hashAlg = hashAlg;
+    XMEMSET(ipad, 0, sizeof(ipad));
+    XMEMSET(opad, 0, sizeof(opad));
+    return rc;
+}
+
+static void TPM2_HmacPad_Free(TPM2_HMAC_PAD* pad)
+{
+    if (pad->hashAlg != TPM_ALG_ERROR) {
+        wc_HashFree(&pad->inner, (enum wc_HashType)pad->hashType);
+        wc_HashFree(&pad->outer, (enum wc_HashType)pad->hashType);
+        pad->hashAlg = TPM_ALG_ERROR;
+    }
+}
+
+/* Copy a running hash state. Hardware, async and WOLFSSL_HASH_KEEP states
+ * own resources beyond the struct, which only the wc_*Copy functions
+ * duplicate. The copy is released with wc_HashFree. */
+static int TPM2_HashCopy(int hashType, const wc_HashAlg* src, wc_HashAlg* dst)
+{
+    /* the wc_*Copy functions do not take a const source */
+    wc_HashAlg* from = (wc_HashAlg*)src;
+
+    switch (hashType) {
+    #ifndef NO_SHA
+        case WC_HASH_TYPE_SHA:
+            return wc_ShaCopy(&from->sha, &dst->sha);
+    #endif
+    #ifndef NO_SHA256
+        case WC_HASH_TYPE_SHA256:
+            return wc_Sha256Copy(&from->sha256, &dst->sha256);
+    #endif
+    #ifdef WOLFSSL_SHA384
+        case WC_HASH_TYPE_SHA384:
+            return wc_Sha384Copy(&from->sha384, &dst->sha384);
+    #endif
+    #ifdef WOLFSSL_SHA512
+        case WC_HASH_TYPE_SHA512:
+            return wc_Sha512Copy(&from->sha512, &dst->sha512);
+    #endif
+        default:
+            break;
+    }
+    return NOT_COMPILED_IN;
+}
+
+/* Start an HMAC from a copy of the inner pad state. On success ctx is
+ * released by TPM2_HmacPad_Final or TPM2_HmacPad_Abort. */
+static int TPM2_HmacPad_Start(const TPM2_HMAC_PAD* pad, wc_HashAlg* ctx)
+{
+    return TPM2_HashCopy(pad->hashType, &pad->inner, ctx);
+}
+
+static void TPM2_HmacPad_Abort(const TPM2_HMAC_PAD* pad, wc_HashAlg* ctx)
+{
+    wc_HashFree(ctx, (enum wc_HashType)pad->hashType);
+}
+
+static int TPM2_HmacPad_Update(const TPM2_HMAC_PAD* pad, wc_HashAlg* ctx,
+    const BYTE* data, UINT32 dataSz)
+{
+    return wc_HashUpdate(ctx, (enum wc_HashType)pad->hashType, data, dataSz);
+}
+
+/* Finish the inner hash and run the outer one from a copy of the outer pad
+ * state. ctx is released in any case. */
+static int TPM2_HmacPad_Final(const TPM2_HMAC_PAD* pad, wc_HashAlg* ctx,
+    BYTE* mac)
+{
+    int rc;
+    byte digest[WC_MAX_DIGEST_SIZE];
+
+    rc = wc_HashFinal(ctx, (enum wc_HashType)pad->hashType, digest);
+    TPM2_HmacPad_Abort(pad, ctx);
+    if (rc == 0)
+        rc = TPM2_HashCopy(pad->hashType, &pad->outer, ctx);
+    if (rc == 0) {
+        rc = TPM2_HmacPad_Update(pad, ctx, digest, pad->digestSz);
+        if (rc == 0)
+            rc = wc_HashFinal(ctx, (enum wc_HashType)pad->hashType, mac);
+        TPM2_HmacPad_Abort(pad, ctx);
+    }
+    return rc;
+}
+
+/* Pads of the session key. With WOLFTPM_SESSION_CACHE they are kept in the
+ * session and only recomputed when authHash or the key changed, otherwise
+ * they are computed into tmp. Release them with TPM2_SessionHmacPad_Put. */
+static int TPM2_SessionHmacPad_Get(TPM2_AUTH_SESSION* session,
+    const TPM2B_AUTH* key, TPM2_HMAC_PAD* tmp, TPM2_HMAC_PAD** pad)
+{
+    int rc = 0;
+    UINT16 keySz = (key != NULL) ? key->size : 0;
+#ifdef WOLFTPM_SESSION_CACHE
+    TPM2_SESSION_CACHE* cache = &session->cache;
+
+    if (keySz > sizeof(cache->hmacKey.buffer))
+        return BUFFER_E;
+    if (cache->hmacPad.hashAlg == TPM_ALG_ERROR ||
+            cache->hmacPad.hashAlg != session->authHash ||
+            cache->hmacKey.size != keySz ||
+            (keySz > 0 && TPM2_ConstantCompare(cache->hmacKey.buffer,
+                key->buffer, keySz) != 0)) {
+        TPM2_HmacPad_Free(&cache->hmacPad);
+        rc = TPM2_HmacPad_Init(&cache->hmacPad, session->authHash,
+            (keySz > 0) ? key->buffer : NULL, keySz);
+        if (rc != 0)
+            return rc;
+        cache->hmacKey.size = keySz;
+        if (keySz > 0)
+            XMEMCPY(cache->hmacKey.buffer, key->buffer, keySz);
+    }
+    *pad = &cache->hmacPad;
+    (void)tmp;
+#else
+    rc = TPM2_HmacPad_Init(tmp, session->authHash,
+        (keySz > 0) ? key->buffer : NULL, keySz);
+    *pad = tmp;
+#endif
+    return rc;
+}
+
+static void TPM2_SessionHmacPad_Put(TPM2_HMAC_PAD* pad)
+{
+#ifndef WOLFTPM_SESSION_CACHE
+    TPM2_HmacPad_Free(pad);
+#else
+    (void)pad;
+#endif
+}
+
+/* KDFa counter loop over precomputed HMAC pads, see TPM2_KDFa */
+static int TPM2_KDFa_Pad(const TPM2_HMAC_PAD* pad, const char* label,
+    TPM2B_NONCE* contextU, TPM2B_NONCE* contextV, BYTE* key, UINT32 keySz)
+{
+    int ret = 0;
+    wc_HashAlg hash_ctx;
     word32 counter = 0;
-    int hLen, copyLen, lLen = 0;
+    int hLen = pad->digestSz, copyLen, lLen = 0;
     byte uint32Buf[sizeof(UINT32)];
     UINT32 sizeInBits = keySz * 8, pos;
     BYTE* keyStream = key;
     byte hash[WC_MAX_DIGEST_SIZE];
 
-    if (key == NULL)
-        return BAD_FUNC_ARG;
-
-    hashType = TPM2_GetHashType(hashAlg);
-    if (hashType == WC_HASH_TYPE_NONE)
-        return NOT_COMPILED_IN;
-
-    hLen = TPM2_GetHashDigestSize(hashAlg);
-    if ( (hLen <= 0) || (hLen > WC_MAX_DIGEST_SIZE))
-        return NOT_COMPILED_IN;
-
     /* get label length if provided, including null termination */
     if (label != NULL) {
         lLen = (int)XSTRLEN(label) + 1;
     }
 
-    ret = wc_HmacInit(&hmac_ctx, NULL, INVALID_DEVID);
-    if (ret != 0)
-        return ret;
-
     /* generate required bytes - blocks sized digest */
     for (pos = 0; pos < keySz; pos += hLen) {
         /* KDFa counter starts at 1 */
@@ -122,52 +254,48 @@ int TPM2_KDFa(
         copyLen = hLen;
 
         /* start HMAC */
-        if (keyIn) {
-            ret = wc_HmacSetKey(&hmac_ctx, hashType, keyIn->buffer, keyIn->size);
-        }
-        else {
-            ret = wc_HmacSetKey(&hmac_ctx, hashType, NULL, 0);
-        }
+        ret = TPM2_HmacPad_Start(pad, &hash_ctx);
         if (ret != 0)
-            goto exit;
+            return ret;
 
         /* add counter - KDFa i2 */
         TPM2_Packet_U32ToByteArray(counter, uint32Buf);
-        ret = wc_HmacUpdate(&hmac_ctx, uint32Buf, (word32)sizeof(uint32Buf));
-        if (ret != 0)
-            goto exit;
+        ret = TPM2_HmacPad_Update(pad, &hash_ctx, uint32Buf,
+            (word32)sizeof(uint32Buf));
 
         /* add label - KDFa label */
-        if (label != NULL) {
-            ret = wc_HmacUpdate(&hmac_ctx, (byte*)label, lLen);
-            if (ret != 0)
-                goto exit;
+        if (ret == 0 && label != NULL) {
+            ret = TPM2_HmacPad_Update(pad, &hash_ctx, (byte*)label, lLen);
         }
 
         /* add contextU */
-        if (contextU != NULL && contextU->size > 0) {
-            ret = wc_HmacUpdate(&hmac_ctx, contextU->buffer, contextU->size);
-            if (ret != 0)
-                goto exit;
+        if (ret == 0 && contextU != NULL && contextU->size > 0) {
+            ret = TPM2_HmacPad_Update(pad, &hash_ctx, contextU->buffer,
+                contextU->size);
         }
 
         /* add contextV */
-        if (contextV != NULL && contextV->size > 0) {
-            ret = wc_HmacUpdate(&hmac_ctx, contextV->buffer, contextV->size);
-            if (ret != 0)
-                goto exit;
+        if (ret == 0 && contextV != NULL && contextV->size > 0) {
+            ret = TPM2_HmacPad_Update(pad, &hash_ctx, contextV->buffer,
+                contextV->size);
         }
 
         /* add size in bits */
-        TPM2_Packet_U32ToByteArray(sizeInBits, uint32Buf);
-        ret = wc_HmacUpdate(&hmac_ctx, uint32Buf, (word32)sizeof(uint32Buf));
-        if (ret != 0)
-            goto exit;
+        if (ret == 0) {
+            TPM2_Packet_U32ToByteArray(sizeInBits, uint32Buf);
+            ret = TPM2_HmacPad_Update(pad, &hash_ctx, uint32Buf,
+                (word32)sizeof(uint32Buf));
+        }
 
         /* get result */
-        ret = wc_HmacFinal(&hmac_ctx, hash);
+        if (ret == 0) {
+            ret = TPM2_HmacPad_Final(pad, &hash_ctx, hash);
+        }
+        else {
+            TPM2_HmacPad_Abort(pad, &hash_ctx);
+        }
         if (ret != 0)
-            goto exit;
+            return ret;
 
         if ((UINT32)hLen > keySz - pos) {
           copyLen = keySz - pos;
@@ -176,10 +304,64 @@ int TPM2_KDFa(
         memcpy(keyStream, hash, copyLen);
         keyStream += copyLen;
     }
-    ret = keySz;
 
-exit:
-    wc_HmacFree(&hmac_ctx);
+    return keySz;
+}
+#endif /* !WOLFTPM2_NO_WOLFCRYPT */
+
+/* This function performs key generation according to Part 1 of the TPM spec
+ * and returns the number of bytes generated, which may be zero.
+ *
+ * 'keyIn' input data is used together with the label, ContextU and ContextV to
+ * generate the session key.
+ *
+ * 'key' points to the buffer storing the generated session key, and
+ * 'key' can not be NULL.
+ *
+ * 'sizeInBits' must be no larger than (2^18)-1 = 256K bits (32385 bytes).
+ *
+ * Note: The "once" parameter is set to allow incremental generation of a large
+ * value. If this flag is TRUE, "sizeInBits" is used in the HMAC computation
+ * but only one iteration of the KDF is performed. This would be used for
+ * XOR obfuscation so that the mask value can be generated in digest-sized
+ * chunks rather than having to be generated all at once in an arbitrarily
+ * large buffer and then XORed into the result. If "once" is TRUE, then
+ * "sizeInBits" must be a multiple of 8.
+ *
+ * Any error in the processing of this command is considered fatal.
+ *
+ * Return values:
+ *     0    hash algorithm is not supported or is TPM_ALG_NULL
+ *    >0    the number of bytes in the 'key' buffer
+ *
+ */
+int TPM2_KDFa(
+    TPM_ALG_ID   hashAlg,   /* IN: hash algorithm used in HMAC */
+    TPM2B_DATA  *keyIn,     /* IN: key */
+    const char  *label,     /* IN: a 0-byte terminated label used in KDF */
+    TPM2B_NONCE *contextU,  /* IN: context U (newer) */
+    TPM2B_NONCE *contextV,  /* IN: context V */
+    BYTE        *key,       /* OUT: key buffer */
+    UINT32       keySz      /* IN: size of generated key in bytes */
+)
+{
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+    int ret;
+    TPM2_HMAC_PAD pad;
+
+    if (key == NULL)
+        return BAD_FUNC_ARG;
+
+    /* the key is the same for every counter iteration, key it once */
+    if (keyIn != NULL && keyIn->size > 0) {
+        ret = TPM2_HmacPad_Init(&pad, hashAlg, keyIn->buffer, keyIn->size);
+    }
+    else {
+        ret = TPM2_HmacPad_Init(&pad, hashAlg, NULL, 0);
+    }
+    if (ret == 0)
+        ret = TPM2_KDFa_Pad(&pad, label, contextU, contextV, key, keySz);
+    TPM2_HmacPad_Free(&pad);
 
     /* return length rounded up to nearest 8 multiple */
     return ret;
@@ -196,6 +378,34 @@ exit:
 #endif
 }
 
+/* TPM2_KDFa keyed with the session key, reusing the session HMAC pads */
+static int TPM2_SessionKDFa(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
+    const char* label, TPM2B_NONCE* contextU, TPM2B_NONCE* contextV,
+    BYTE* key, UINT32 keySz)
+{
+#ifndef WOLFTPM2_NO_WOLFCRYPT
+    int ret;
+    TPM2_HMAC_PAD tmp, *pad = NULL;
+
+    ret = TPM2_SessionHmacPad_Get(session, keyIn, &tmp, &pad);
+    if (ret == 0) {
+        ret = TPM2_KDFa_Pad(pad, label, contextU, contextV, key, keySz);
+        TPM2_SessionHmacPad_Put(pad);
+    }
+    return ret;
+#else
+    (void)session;
+    (void)keyIn;
+    (void)label;
+    (void)contextU;
+    (void)contextV;
+    (void)key;
+    (void)keySz;
+
+    return NOT_COMPILED_IN;
+#endif
+}
+
 
 /* Perform XOR encryption over the first parameter of a TPM packet */
 static int TPM2_ParamEnc_XOR(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
@@ -212,7 +422,7 @@ static int TPM2_ParamEnc_XOR(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 
     /* Generate XOR Mask stream matching paramater size */
     XMEMSET(mask.buffer, 0, sizeof(mask.buffer));
-    rc = TPM2_KDFa(session->authHash, (TPM2B_DATA*)keyIn, "XOR",
+    rc = TPM2_SessionKDFa(session, keyIn, "XOR",
         nonceCaller, nonceTPM, mask.buffer, paramSz);
     if ((UINT32)rc != paramSz) {
     #ifdef DEBUG_WOLFTPM
@@ -247,7 +457,7 @@ static int TPM2_ParamDec_XOR(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 
     /* Generate XOR Mask stream matching paramater size */
     XMEMSET(mask.buffer, 0, sizeof(mask.buffer));
-    rc = TPM2_KDFa(session->authHash, (TPM2B_DATA*)keyIn, "XOR",
+    rc = TPM2_SessionKDFa(session, keyIn, "XOR",
         nonceTPM, nonceCaller, mask.buffer, paramSz);
     if ((UINT32)rc != paramSz) {
     #ifdef DEBUG_WOLFTPM
@@ -267,6 +477,41 @@ static int TPM2_ParamDec_XOR(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 }
 
 #if !defined(WOLFTPM2_NO_WOLFCRYPT) && defined(WOLFSSL_AES_CFB)
+/* AES object for a parameter. With WOLFTPM_SESSION_CACHE the session keeps
+ * one initialized object, otherwise tmp is initialized. Key and IV depend on
+ * the nonces, so the object is keyed for every parameter either way. Release
+ * it with TPM2_SessionAes_Put. */
+static int TPM2_SessionAes_Get(TPM2_AUTH_SESSION *session, Aes* tmp,
+    Aes** aes)
+{
+    int rc = 0;
+
+#ifdef WOLFTPM_SESSION_CACHE
+    if (!session->cache.aesInit) {
+        rc = wc_AesInit(&session->cache.aes, NULL, INVALID_DEVID);
+        if (rc != 0)
+            return rc;
+        session->cache.aesInit = 1;
+    }
+    *aes = &session->cache.aes;
+    (void)tmp;
+#else
+    rc = wc_AesInit(tmp, NULL, INVALID_DEVID);
+    *aes = tmp;
+    (void)session;
+#endif
+    return rc;
+}
+
+static void TPM2_SessionAes_Put(Aes* aes)
+{
+#ifndef WOLFTPM_SESSION_CACHE
+    wc_AesFree(aes);
+#else
+    (void)aes;
+#endif
+}
+
 /* Perform AES CFB encryption over the first parameter of a TPM packet */
 static int TPM2_ParamEnc_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
     TPM2B_NONCE* nonceCaller, TPM2B_NONCE* nonceTPM, BYTE *paramData,
@@ -276,7 +521,7 @@ static int TPM2_ParamEnc_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
     BYTE symKey[32 + 16]; /* AES key (max) + IV (block size) */
     int symKeySz = session->symmetric.keyBits.aes / 8;
     const int symKeyIvSz = 16;
-    Aes enc;
+    Aes enc, *aes = NULL;
 
     if (symKeySz > 32) {
         return BUFFER_E;
@@ -284,7 +529,7 @@ static int TPM2_ParamEnc_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 
     /* Generate AES Key and IV */
     XMEMSET(symKey, 0, sizeof(symKey));
-    rc = TPM2_KDFa(session->authHash, (TPM2B_DATA*)keyIn, "CFB",
+    rc = TPM2_SessionKDFa(session, keyIn, "CFB",
         nonceCaller, nonceTPM, symKey, symKeySz + symKeyIvSz);
     if (rc != symKeySz + symKeyIvSz) {
     #ifdef DEBUG_WOLFTPM
@@ -300,13 +545,13 @@ static int TPM2_ParamEnc_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 #endif
 
     /* Perform AES CFB Encryption */
-    rc = wc_AesInit(&enc, NULL, INVALID_DEVID);
+    rc = TPM2_SessionAes_Get(session, &enc, &aes);
     if (rc == 0) {
-        rc = wc_AesSetKey(&enc, symKey, symKeySz, &symKey[symKeySz], AES_ENCRYPTION);
+        rc = wc_AesSetKey(aes, symKey, symKeySz, &symKey[symKeySz], AES_ENCRYPTION);
         if (rc == 0) {
-            rc = wc_AesCfbEncrypt(&enc, paramData, paramData, paramSz);
+            rc = wc_AesCfbEncrypt(aes, paramData, paramData, paramSz);
         }
-        wc_AesFree(&enc);
+        TPM2_SessionAes_Put(aes);
     }
 
     return rc;
@@ -321,7 +566,7 @@ static int TPM2_ParamDec_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
     BYTE symKey[32 + 16];	/* AES key 128-bit + IV (block size) */
     int symKeySz = session->symmetric.keyBits.aes / 8;
     const int symKeyIvSz = 16;
-    Aes dec;
+    Aes dec, *aes = NULL;
 
     if (symKeySz > 32) {
         return BUFFER_E;
@@ -329,7 +574,7 @@ static int TPM2_ParamDec_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 
     /* Generate AES Key and IV */
     XMEMSET(symKey, 0, sizeof(symKey));
-    rc = TPM2_KDFa(session->authHash, (TPM2B_DATA*)keyIn, "CFB",
+    rc = TPM2_SessionKDFa(session, keyIn, "CFB",
         nonceTPM, nonceCaller, symKey, symKeySz + symKeyIvSz);
     if (rc != symKeySz + symKeyIvSz) {
     #ifdef DEBUG_WOLFTPM
@@ -345,13 +590,13 @@ static int TPM2_ParamDec_AESCFB(TPM2_AUTH_SESSION *session, TPM2B_AUTH* keyIn,
 #endif
 
     /* Perform AES CFB Decryption */
-    rc = wc_AesInit(&dec, NULL, INVALID_DEVID);
+    rc = TPM2_SessionAes_Get(session, &dec, &aes);
     if (rc == 0) {
-        rc = wc_AesSetKey(&dec, symKey, symKeySz, &symKey[symKeySz], AES_ENCRYPTION);
+        rc = wc_AesSetKey(aes, symKey, symKeySz, &symKey[symKeySz], AES_ENCRYPTION);
         if (rc == 0) {
-            rc = wc_AesCfbDecrypt(&dec, paramData, paramData, paramSz);
+            rc = wc_AesCfbDecrypt(aes, paramData, paramData, paramSz);
         }
-        wc_AesFree(&dec);
+        TPM2_SessionAes_Put(aes);
     }
 
     return rc;
@@ -369,7 +614,20 @@ int TPM2_CalcCpHash(TPMI_ALG_HASH authHash, TPM_CC cmdCode,
     TPM2B_NAME* name1, TPM2B_NAME* name2, TPM2B_NAME* name3,
     BYTE* param, UINT32 paramSz, TPM2B_DIGEST* hash)
 {
-    int rc;
+    const TPM2B_NAME* names[3];
+
+    names[0] = name1;
+    names[1] = name2;
+    names[2] = name3;
+    return TPM2_CalcCpHash_ex(authHash, cmdCode, NULL, names, 3, param,
+        paramSz, hash);
+}
+
+int TPM2_CalcCpHash_ex(TPMI_ALG_HASH authHash, TPM_CC cmdCode,
+    const BYTE* handles, const TPM2B_NAME* const* names, int handleCnt,
+    const BYTE* param, UINT32 paramSz, TPM2B_DIGEST* hash)
+{
+    int rc, i;
     wc_HashAlg hash_ctx;
     enum wc_HashType hashType;
 
@@ -387,13 +645,18 @@ int TPM2_CalcCpHash(TPMI_ALG_HASH authHash, TPM_CC cmdCode,
         UINT32 ccSwap = TPM2_Packet_SwapU32(cmdCode);
         rc = wc_HashUpdate(&hash_ctx, hashType, (byte*)&ccSwap, sizeof(ccSwap));
 
-        /* For Command's only hash each session name */
-        if (rc == 0 && name1 && name1->size > 0)
-            rc = wc_HashUpdate(&hash_ctx, hashType, name1->name, name1->size);
-        if (rc == 0 && name2 && name2->size > 0)
-            rc = wc_HashUpdate(&hash_ctx, hashType, name2->name, name2->size);
-        if (rc == 0 && name3 && name3->size > 0)
-            rc = wc_HashUpdate(&hash_ctx, hashType, name3->name, name3->size);
+        /* For Command's only hash each session name, a permanent or session
+         * handle is hashed as it is in the handle area */
+        for (i = 0; rc == 0 && i < handleCnt; i++) {
+            if (names[i] != NULL && names[i]->size > 0) {
+                rc = wc_HashUpdate(&hash_ctx, hashType, names[i]->name,
+                    names[i]->size);
+            }
+            else if (names[i] == NULL && handles != NULL) {
+                rc = wc_HashUpdate(&hash_ctx, hashType,
+                    &handles[i * sizeof(TPM_HANDLE)], sizeof(TPM_HANDLE));
+            }
+        }
 
         /* Hash Remainder of parameters - after handles and auth */
         if (rc == 0)
@@ -462,65 +725,45 @@ int TPM2_CalcRpHash(TPMI_ALG_HASH authHash,
     return rc;
 }
 
-/* Compute the HMAC using cpHash, nonces and session attributes */
-/* TCG TPM 2.0 Part 1 - 19.6.5 - HMAC Computation */
-int TPM2_CalcHmac(TPMI_ALG_HASH authHash, TPM2B_AUTH* auth,
+/* Compute the HMAC over cpHash/rpHash, nonces and attributes with the pads */
+static int TPM2_CalcHmac_Pad(const TPM2_HMAC_PAD* pad,
     const TPM2B_DIGEST* hash, const TPM2B_NONCE* nonceNew,
     const TPM2B_NONCE* nonceOld, TPMA_SESSION sessionAttributes,
     TPM2B_AUTH* hmac)
 {
     int rc;
-    Hmac hmac_ctx;
-    enum wc_HashType hashType;
+    wc_HashAlg hmac_ctx;
 
-    /* use authHash for hmac hash algorithm */
-    rc = TPM2_GetHashType(authHash);
-    hashType = (enum wc_HashType)rc;
-    hmac->size = TPM2_GetHashDigestSize(authHash);
-    if (hmac->size <= 0)
-        return BAD_FUNC_ARG;
-
-    /* setup HMAC */
-    rc = wc_HmacInit(&hmac_ctx, NULL, INVALID_DEVID);
+    hmac->size = pad->digestSz;
+    rc = TPM2_HmacPad_Start(pad, &hmac_ctx);
     if (rc != 0)
         return rc;
 
-    /* start HMAC - sessionKey || authValue */
-    /* TODO: Handle "authValue" case "a value that is found in the sensitive area of an entity" */
-    if (auth) {
-#ifdef WOLFTPM_DEBUG_VERBOSE
-    printf("HMAC Key: %d\n", auth->size);
-    TPM2_PrintBin(auth->buffer, auth->size);
-#endif
-        rc = wc_HmacSetKey(&hmac_ctx, hashType, auth->buffer, auth->size);
-    }
-    else {
-        rc = wc_HmacSetKey(&hmac_ctx, hashType, NULL, 0);
-    }
-
     /* pHash - hash of command code and parameters */
-    if (rc == 0)
-        rc = wc_HmacUpdate(&hmac_ctx, hash->buffer, hash->size);
+    rc = TPM2_HmacPad_Update(pad, &hmac_ctx, hash->buffer, hash->size);
 
     /* nonce new (on cmd caller, on resp tpm) */
     if (rc == 0)
-        rc = wc_HmacUpdate(&hmac_ctx, nonceNew->buffer, nonceNew->size);
+        rc = TPM2_HmacPad_Update(pad, &hmac_ctx, nonceNew->buffer,
+            nonceNew->size);
 
     /* nonce old (on cmd TPM, on resp caller) */
     if (rc == 0)
-        rc = wc_HmacUpdate(&hmac_ctx, nonceOld->buffer, nonceOld->size);
+        rc = TPM2_HmacPad_Update(pad, &hmac_ctx, nonceOld->buffer,
+            nonceOld->size);
 
     /* TODO: nonceTPMDecrypt */
     /* TODO: nonceTPMEncrypt */
 
     /* sessionAttributes */
     if (rc == 0)
-        rc = wc_HmacUpdate(&hmac_ctx, &sessionAttributes, 1);
+        rc = TPM2_HmacPad_Update(pad, &hmac_ctx, &sessionAttributes, 1);
 
     /* finalize return into hmac buffer */
     if (rc == 0)
-        rc = wc_HmacFinal(&hmac_ctx, hmac->buffer);
-    wc_HmacFree(&hmac_ctx);
+        rc = TPM2_HmacPad_Final(pad, &hmac_ctx, hmac->buffer);
+    else
+        TPM2_HmacPad_Abort(pad, &hmac_ctx);
 
 #ifdef WOLFTPM_DEBUG_VERBOSE
     printf("HMAC Auth: attrib %x, size %d\n", sessionAttributes, hmac->size);
@@ -529,8 +772,81 @@ int TPM2_CalcHmac(TPMI_ALG_HASH authHash, TPM2B_AUTH* auth,
 
     return rc;
 }
+
+/* Compute the HMAC using cpHash, nonces and session attributes */
+/* TCG TPM 2.0 Part 1 - 19.6.5 - HMAC Computation */
+int TPM2_CalcHmac(TPMI_ALG_HASH authHash, TPM2B_AUTH* auth,
+    const TPM2B_DIGEST* hash, const TPM2B_NONCE* nonceNew,
+    const TPM2B_NONCE* nonceOld, TPMA_SESSION sessionAttributes,
+    TPM2B_AUTH* hmac)
+{
+    int rc;
+    TPM2_HMAC_PAD pad;
+
+    if (TPM2_GetHashDigestSize(authHash) <= 0)
+        return BAD_FUNC_ARG;
+
+    /* start HMAC - sessionKey || authValue */
+    /* TODO: Handle "authValue" case "a value that is found in the sensitive area of an entity" */
+    if (auth) {
+#ifdef WOLFTPM_DEBUG_VERBOSE
+    printf("HMAC Key: %d\n", auth->size);
+    TPM2_PrintBin(auth->buffer, auth->size);
+#endif
+        rc = TPM2_HmacPad_Init(&pad, authHash, auth->buffer, auth->size);
+    }
+    else {
+        rc = TPM2_HmacPad_Init(&pad, authHash, NULL, 0);
+    }
+    if (rc == 0) {
+        rc = TPM2_CalcHmac_Pad(&pad, hash, nonceNew, nonceOld,
+            sessionAttributes, hmac);
+    }
+    TPM2_HmacPad_Free(&pad);
+
+    return rc;
+}
+
+/* TPM2_CalcHmac keyed with session->auth, reusing the session HMAC pads */
+int TPM2_CalcSessionHmac(TPM2_AUTH_SESSION* session,
+    const TPM2B_DIGEST* hash, const TPM2B_NONCE* nonceNew,
+    const TPM2B_NONCE* nonceOld, TPMA_SESSION sessionAttributes,
+    TPM2B_AUTH* hmac)
+{
+    int rc;
+    TPM2_HMAC_PAD tmp, *pad = NULL;
+
+    if (TPM2_GetHashDigestSize(session->authHash) <= 0)
+        return BAD_FUNC_ARG;
+
+    rc = TPM2_SessionHmacPad_Get(session, &session->auth, &tmp, &pad);
+    if (rc == 0) {
+        rc = TPM2_CalcHmac_Pad(pad, hash, nonceNew, nonceOld,
+            sessionAttributes, hmac);
+        TPM2_SessionHmacPad_Put(pad);
+    }
+    return rc;
+}
 #endif /* !WOLFTPM2_NO_WOLFCRYPT */
 
+/* Releases what TPM2_CalcSessionHmac kept in the session and wipes the
+ * cached key. Call it before the session is cleared or overwritten. */
+void TPM2_SessionCache_Free(TPM2_AUTH_SESSION* session)
+{
+#ifdef WOLFTPM_SESSION_CACHE
+    if (session != NULL) {
+        TPM2_HmacPad_Free(&session->cache.hmacPad);
+    #ifdef WOLFSSL_AES_CFB
+        if (session->cache.aesInit)
+            wc_AesFree(&session->cache.aes);
+    #endif
+        TPM2_ForceZero(&session->cache, sizeof(session->cache));
+    }
+#else
+    (void)session;
+#endif
+}
+
 TPM_RC TPM2_ParamEnc_CmdRequest(TPM2_AUTH_SESSION *session,
                                 BYTE *paramData, UINT32 paramSz)
 {
@@ -37,41 +37,137 @@
 #include <wolftpm/tpm2_swtpm.h>
 #include <wolftpm/tpm2_packet.h>
 
-#include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 
-static L4::Cap<TPM> tpm;
+#ifndef L4API_l4f
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#endif
 
-static TPM_RC SwTpmTransmit(TPM2_CTX* ctx, const void* buffer, ssize_t bufSz)
+/* Sends the message header and the command together, one writev on the
+ * socket or one IPC to the vtpm server */
+static TPM_RC SwTpmTransmit(TPM2_CTX* ctx, const byte* hdr, word32 hdrSz,
+    const byte* cmd, word32 cmdSz)
 {
-    if(bufSz < 0) {
-        return TPM_RC_FAILURE;
+#ifdef L4API_l4f
+    return TPM2_SWTPM_L4_Transmit(&ctx->tcpCtx, hdr, hdrSz, cmd, cmdSz);
+#else
+    struct iovec iov[2];
+    int iovCnt = 2;
+    ssize_t wrc;
+    size_t left = hdrSz + cmdSz;
+
+    iov[0].iov_base = (void*)hdr;
+    iov[0].iov_len = hdrSz;
+    iov[1].iov_base = (void*)cmd;
+    iov[1].iov_len = cmdSz;
+
+    while (left > 0) {
+        wrc = writev(ctx->tcpCtx.fd, &iov[2 - iovCnt], iovCnt);
+        if (wrc < 0) {
+            if (errno == EINTR)
+                continue;
+        #ifdef DEBUG_WOLFTPM
+            printf("SwTpmTransmit: writev failed %d\n", errno);
+        #endif
+            return SOCKET_ERROR_E;
+        }
+        left -= (size_t)wrc;
+        /* partial write, advance the vector */
+        while (iovCnt > 0 && (size_t)wrc >= iov[2 - iovCnt].iov_len) {
+            wrc -= (ssize_t)iov[2 - iovCnt].iov_len;
+            iovCnt--;
+        }
+        if (iovCnt > 0) {
+            iov[2 - iovCnt].iov_base = (byte*)iov[2 - iovCnt].iov_base + wrc;
+            iov[2 - iovCnt].iov_len -= (size_t)wrc;
+        }
     }
-    L4::Ipc_Array<l4_uint8_t, l4_uint32_t> transfer = L4::Ipc_Array<l4_uint8_t, l4_uint32_t>(&buffer, bufSz);
-    return vtpm->write(transfer);
+    return TPM_RC_SUCCESS;
+#endif
 }
 
 static TPM_RC SwTpmReceive(TPM2_CTX* ctx, void* buffer, size_t rxSz)
 {
-    if(bufSz < 0) {
-        return TPM_RC_FAILURE;
+#ifdef L4API_l4f
+    struct wolfTPM_tcpContext* tcpCtx = &ctx->tcpCtx;
+
+    if (rxSz > tcpCtx->rspSz - tcpCtx->rspPos) {
+        return SOCKET_ERROR_E;
+    }
+    XMEMCPY(buffer, tcpCtx->shm + tcpCtx->rspPos, rxSz);
+    tcpCtx->rspPos += (unsigned int)rxSz;
+    return TPM_RC_SUCCESS;
+#else
+    ssize_t rrc;
+    size_t pos = 0;
+
+    while (pos < rxSz) {
+        rrc = recv(ctx->tcpCtx.fd, (byte*)buffer + pos, rxSz - pos, 0);
+        if (rrc < 0 && errno == EINTR)
+            continue;
+        if (rrc <= 0) {
+        #ifdef DEBUG_WOLFTPM
+            printf("SwTpmReceive: recv failed %d\n", rrc < 0 ? errno : 0);
+        #endif
+            return SOCKET_ERROR_E;
+        }
+        pos += (size_t)rrc;
     }
-    L4::Ipc_Array<l4_uint8_t, l4_uint32_t> transfer = L4::Ipc_Array<l4_uint8_t, l4_uint32_t>(&buffer, bufSz);
-    return vtpm->read(transfer);
+    return TPM_RC_SUCCESS;
+#endif
 }
 
-static TPM_RC SwTpmConnect(TPM2_CTX* ctx, const char* host, const char* port)
-{   
-    tpm = chkcap(L4Re::Env->env()->get_cap("vtpm"), "failed to get vtpm capability");
+static TPM_RC SwTpmConnect(TPM2_CTX* ctx)
+{
+#ifdef L4API_l4f
+    return TPM2_SWTPM_L4_Connect(&ctx->tcpCtx);
+#else
+    struct sockaddr_un addr;
+    int fd;
 
-    //init tpm object
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return SOCKET_ERROR_E;
+    }
+
+    XMEMSET(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, TPM2_SWTPM_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    #ifdef DEBUG_WOLFTPM
+        printf("SwTpmConnect: connect to %s failed %d\n", TPM2_SWTPM_SOCKET,
+            errno);
+    #endif
+        close(fd);
+        return SOCKET_ERROR_E;
+    }
+
+    ctx->tcpCtx.fd = fd;
+    return TPM_RC_SUCCESS;
+#endif
 }
 
-static TPM_RC SwTpmDisconnect(TPM2_CTX* ctx)
+static void SwTpmDisconnect(TPM2_CTX* ctx)
 {
-    return TPM_RC_SUCESS;
+#ifdef L4API_l4f
+    TPM2_SWTPM_L4_Disconnect(&ctx->tcpCtx);
+#else
+    uint32_t tss_word = TPM2_Packet_SwapU32(TPM_SESSION_END);
+
+    /* let the simulator close its end, errors do not matter any more */
+    if (write(ctx->tcpCtx.fd, &tss_word, sizeof(tss_word)) < 0) {
+    #ifdef DEBUG_WOLFTPM
+        printf("SwTpmDisconnect: session end failed %d\n", errno);
+    #endif
+    }
+    close(ctx->tcpCtx.fd);
+    ctx->tcpCtx.fd = -1;
+#endif
 }
 
 /* Talk to a TPM through socket
@@ -81,16 +177,18 @@ static TPM_RC SwTpmDisconnect(TPM2_CTX* ctx)
  */
 int TPM2_SWTPM_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
 {
-    int rc = TPM_RC_FAILURE;
+    int rc = TPM_RC_SUCCESS;
     int rspSz = 0;
     uint32_t tss_word;
+    byte hdr[TPM2_SWTPM_CMD_HDR_SZ];
 
-    if (ctx == NULL) {
+    if (ctx == NULL || packet == NULL) {
         return BAD_FUNC_ARG;
     }
 
+    /* the connection is kept for the lifetime of the context */
     if (ctx->tcpCtx.fd < 0) {
-        rc = SwTpmConnect(ctx, TPM2_SWTPM_HOST, TPM2_SWTPM_PORT);
+        rc = SwTpmConnect(ctx);
     }
 
 #ifdef WOLFTPM_DEBUG_VERBOSE
@@ -98,36 +196,25 @@ int TPM2_SWTPM_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
     TPM2_PrintBin(packet->buf, packet->pos);
 #endif
 
-    /* send start */
-    tss_word = TPM2_Packet_SwapU32(TPM_SEND_COMMAND);
+    /* send start, locality and buffer size, then the TPM command buffer */
     if (rc == TPM_RC_SUCCESS) {
-        rc = SwTpmTransmit(ctx, &tss_word, sizeof(uint32_t));
-    }
+        tss_word = TPM2_Packet_SwapU32(TPM_SEND_COMMAND);
+        XMEMCPY(&hdr[0], &tss_word, sizeof(uint32_t));
+        hdr[4] = ctx->locality;
+        tss_word = TPM2_Packet_SwapU32(packet->pos);
+        XMEMCPY(&hdr[5], &tss_word, sizeof(uint32_t));
 
-    /* locality */
-    if (rc == TPM_RC_SUCCESS) {
-        rc = SwTpmTransmit(ctx, &ctx->locality, sizeof(uint8_t));
-    }
-
-    /* buffer size */
-    tss_word = TPM2_Packet_SwapU32(packet->pos);
-    if (rc == TPM_RC_SUCCESS) {
-        rc = SwTpmTransmit(ctx, &tss_word, sizeof(uint32_t));
-    }
-
-    /* Send the TPM command buffer */
-    if (rc == TPM_RC_SUCCESS) {
-        rc = SwTpmTransmit(ctx, packet->buf, packet->pos);
+        rc = SwTpmTransmit(ctx, hdr, sizeof(hdr), packet->buf, packet->pos);
     }
 
     /* receive response */
     if (rc == TPM_RC_SUCCESS) {
         rc = SwTpmReceive(ctx, &tss_word, sizeof(uint32_t));
         rspSz = TPM2_Packet_SwapU32(tss_word);
-        if (rspSz > packet->size) {
+        if (rc == TPM_RC_SUCCESS && (rspSz < 0 || rspSz > packet->size)) {
             #ifdef WOLFTPM_DEBUG_VERBOSE
             printf("Response size(%d) larger than command buffer(%d)\n",
-                   rspSz, packet->pos);
+                   rspSz, packet->size);
             #endif
             rc = SOCKET_ERROR_E;
         }
@@ -151,7 +238,6 @@ int TPM2_SWTPM_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
         #endif
     }
 
-
 #ifdef WOLFTPM_DEBUG_VERBOSE
     if (rspSz > 0) {
         printf("Response size: %d\n", rspSz);
@@ -159,13 +245,18 @@ int TPM2_SWTPM_SendCommand(TPM2_CTX* ctx, TPM2_Packet* packet)
     }
 #endif
 
-    if (ctx->tcpCtx.fd >= 0) {
-        TPM_RC rc_disconnect = SwTpmDisconnect(ctx);
-        if (rc == TPM_RC_SUCCESS) {
-            rc = rc_disconnect;
-        }
+    /* the stream is out of sync after an error, start over next time */
+    if (rc != TPM_RC_SUCCESS && ctx->tcpCtx.fd >= 0) {
+        SwTpmDisconnect(ctx);
     }
 
     return rc;
 }
+
+void TPM2_SWTPM_Cleanup(TPM2_CTX* ctx)
+{
+    if (ctx != NULL && ctx->tcpCtx.fd >= 0) {
+        SwTpmDisconnect(ctx);
+    }
+}
 #endif /* WOLFTPM_SWTPM */
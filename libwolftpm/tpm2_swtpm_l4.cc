@@ -0,0 +1,135 @@
+/* tpm2_swtpm_l4.cc
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* L4 transport of the SWTPM backend. The TPM TCP protocol messages are
+ * exchanged with the vtpm server through a shared dataspace, so a command
+ * costs a single IPC. See vtpm.h for the contract. */
+
+#if defined(WOLFTPM_SWTPM) && defined(L4API_l4f)
+#include "wolftpm/tpm2.h"
+#include "wolftpm/tpm2_swtpm.h"
+#include "wolftpm/tpm2_packet.h"
+
+#include "vtpm.h"
+#include <l4/re/env>
+#include <l4/re/mem_alloc>
+#include <l4/re/rm>
+#include <l4/re/util/cap_alloc>
+#include <stdio.h>
+
+static L4::Cap<VTPM> TPM2_SWTPM_L4_Vtpm(struct wolfTPM_tcpContext *tcpCtx) {
+  return L4::Cap<VTPM>(tcpCtx->vtpm);
+}
+
+int TPM2_SWTPM_L4_Connect(struct wolfTPM_tcpContext *tcpCtx) {
+  L4Re::Env const *env = L4Re::Env::env();
+  L4::Cap<VTPM> vtpm;
+  L4::Cap<L4Re::Dataspace> ds;
+  l4_addr_t addr = 0;
+  long err;
+
+  vtpm = env->get_cap<VTPM>("vtpm");
+  if (!vtpm.is_valid()) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_SWTPM_L4_Connect: no vtpm capability\n");
+#endif
+    return SOCKET_ERROR_E;
+  }
+
+  ds = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
+  if (!ds.is_valid())
+    return SOCKET_ERROR_E;
+  err = env->mem_alloc()->alloc(Vtpm_shm_size, ds);
+  if (err >= 0)
+    err = env->rm()->attach(&addr, Vtpm_shm_size,
+                            L4Re::Rm::F::Search_addr | L4Re::Rm::F::RW,
+                            L4::Ipc::make_cap_rw(ds));
+  if (err >= 0)
+    err = vtpm->map_shm(ds);
+  if (err < 0) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_SWTPM_L4_Connect: shm setup failed %ld\n", err);
+#endif
+    if (addr != 0)
+      env->rm()->detach(addr, 0);
+    L4Re::Util::cap_alloc.free(ds, env->task());
+    return SOCKET_ERROR_E;
+  }
+
+  tcpCtx->vtpm = vtpm.cap();
+  tcpCtx->ds = ds.cap();
+  tcpCtx->shm = reinterpret_cast<unsigned char *>(addr);
+  tcpCtx->rspSz = 0;
+  tcpCtx->rspPos = 0;
+  tcpCtx->fd = 0;
+  return TPM_RC_SUCCESS;
+}
+
+int TPM2_SWTPM_L4_Transmit(struct wolfTPM_tcpContext *tcpCtx, const byte *hdr,
+                           word32 hdrSz, const byte *cmd, word32 cmdSz) {
+  l4_uint32_t rspSz = 0;
+
+  if (hdrSz + cmdSz > Vtpm_shm_size)
+    return BUFFER_E;
+
+  XMEMCPY(tcpCtx->shm, hdr, hdrSz);
+  XMEMCPY(tcpCtx->shm + hdrSz, cmd, cmdSz);
+
+  tcpCtx->rspSz = 0;
+  tcpCtx->rspPos = 0;
+  if (TPM2_SWTPM_L4_Vtpm(tcpCtx)->command(hdrSz + cmdSz, &rspSz) != L4_EOK ||
+      rspSz > Vtpm_shm_size)
+    return SOCKET_ERROR_E;
+
+  tcpCtx->rspSz = rspSz;
+  return TPM_RC_SUCCESS;
+}
+
+void TPM2_SWTPM_L4_Disconnect(struct wolfTPM_tcpContext *tcpCtx) {
+  L4Re::Env const *env = L4Re::Env::env();
+
+  if (tcpCtx->shm != NULL && tcpCtx->vtpm != 0) {
+    word32 tssWord = TPM2_Packet_SwapU32(TPM_SESSION_END);
+    l4_uint32_t rspSz = 0;
+
+    /* let the server drop the state of this client, errors do not matter
+     * any more */
+    XMEMCPY(tcpCtx->shm, &tssWord, sizeof(tssWord));
+    if (TPM2_SWTPM_L4_Vtpm(tcpCtx)->command(sizeof(tssWord), &rspSz) !=
+        L4_EOK) {
+#ifdef DEBUG_WOLFTPM
+      printf("TPM2_SWTPM_L4_Disconnect: session end failed\n");
+#endif
+    }
+  }
+  if (tcpCtx->shm != NULL)
+    env->rm()->detach(reinterpret_cast<l4_addr_t>(tcpCtx->shm), 0);
+  if (tcpCtx->ds != 0)
+    L4Re::Util::cap_alloc.free(L4::Cap<L4Re::Dataspace>(tcpCtx->ds),
+                               env->task());
+  tcpCtx->shm = NULL;
+  tcpCtx->ds = 0;
+  tcpCtx->vtpm = 0;
+  tcpCtx->rspSz = 0;
+  tcpCtx->rspPos = 0;
+  tcpCtx->fd = -1;
+}
+#endif /* WOLFTPM_SWTPM && L4API_l4f */
@@ -55,6 +55,14 @@ enum tpm_tis_int_flags {
   TPM_INTF_DATA_AVAIL_INT = 0x001,
 };
 
+/* TPM_INTF_CAPS data transfer size support (bits 9-10) and interface version
+ * (bits 28-30) fields */
+#define TPM_INTF_XFER_SIZE_MASK 0x00000600u
+#define TPM_INTF_XFER_SIZE_SHIFT 9
+#define TPM_INTF_VERSION_MASK 0x70000000u
+#define TPM_INTF_VERSION_SHIFT 28
+#define TPM_INTF_VERSION_TIS13 2
+
 #define TPM_BASE_ADDRESS (0xD40000u)
 
 #ifdef WOLFTPM_I2C
@@ -79,87 +87,189 @@ enum tpm_tis_int_flags {
 #define TPM_STS(l) (TPM_BASE_ADDRESS | 0x0018u | ((l) << 12u))
 #define TPM_BURST_COUNT(l) (TPM_BASE_ADDRESS | 0x0019u | ((l) << 12u))
 #define TPM_DATA_FIFO(l) (TPM_BASE_ADDRESS | 0x0024u | ((l) << 12u))
-#define TPM_XDATA_FIFO(l) (TPM_BASE_ADDRESS | 0x0083u | ((l) << 12u))
+#define TPM_XDATA_FIFO(l) (TPM_BASE_ADDRESS | 0x0080u | ((l) << 12u))
 
 /* this option enables named semaphore protection on TIS commands for protected
-    concurrent process access */
+    concurrent process access. The lock is held for a complete command, so
+    no other process can interleave between its FIFO chunks. Nested register
+    accesses only count the depth in the ctx. */
 #ifdef WOLFTPM_TIS_LOCK
-#ifdef __linux__
+#if defined(L4API_l4f)
+#include <l4/re/c/rm.h>
+#include <l4/re/env.h>
+#include <l4/sys/semaphore.h>
+
+/* Kernel semaphore shared by all tasks using the TPM, fronted by a counter in
+ * a dataspace the same tasks share. The counter holds the number of tasks
+ * holding or waiting for the lock, so only a contended lock enters the kernel.
+ * The semaphore counts hand-overs from the holder to a waiter and starts at 0
+ * as the kernel creates it, nobody has to initialize it. Both capabilities
+ * are resolved once per ctx. Without the semaphore the task is the only
+ * client and no lock is needed. */
+#define SEM_CAP_NAME "tpm_lock"
+#define SHM_CAP_NAME "tpm_lock_ds"
+#define TIMEOUT_MS 10000
+
+static int TPM2_TIS_LockOpen(TPM2_CTX *ctx) {
+  l4_cap_idx_t sem = l4re_env_get_cap(SEM_CAP_NAME);
+  l4re_ds_t ds = l4re_env_get_cap(SHM_CAP_NAME);
+  void *addr = NULL;
+
+  if (l4_is_valid_cap(sem)) {
+    /* the zero filled dataspace must be shared by every task holding the
+     * semaphore, a private counter would not exclude anyone */
+    if (l4_is_invalid_cap(ds) ||
+        l4re_rm_attach(&addr, L4_PAGESIZE,
+                       L4RE_RM_F_SEARCH_ADDR | L4RE_RM_F_RW, ds, 0,
+                       L4_PAGESHIFT) < 0) {
+#ifdef DEBUG_WOLFTPM
+      printf("TPM2_TIS_Lock: Dataspace %s missing for %s!\n", SHM_CAP_NAME,
+             SEM_CAP_NAME);
+#endif
+      return BAD_MUTEX_E;
+    }
+    ctx->tisLock = addr;
+    ctx->tisLockSem = sem;
+  }
+  ctx->tisLockOpen = 1;
+
+  return 0;
+}
+
+static int TPM2_TIS_Lock(TPM2_CTX *ctx) {
+  int rc;
+
+  if (ctx->tisLockDepth == 0) {
+    if (!ctx->tisLockOpen && (rc = TPM2_TIS_LockOpen(ctx)) != 0)
+      return rc;
+    /* A waiter that times out stays in the count. The holder then hands
+     * over to nobody and the next caller takes that token, so exclusion
+     * holds and only the fast path is lost. */
+    if (ctx->tisLock != NULL &&
+        __atomic_fetch_add((int *)ctx->tisLock, 1, __ATOMIC_ACQUIRE) > 0 &&
+        l4_error(l4_semaphore_down(
+            ctx->tisLockSem,
+            l4_timeout(L4_IPC_TIMEOUT_NEVER,
+                       l4_timeout_from_us(TIMEOUT_MS * 1000)))) < 0) {
+#ifdef DEBUG_WOLFTPM
+      printf("TPM2_TIS_Lock: Semaphore %s timeout!\n", SEM_CAP_NAME);
+#endif
+      return WC_TIMEOUT_E;
+    }
+  }
+  ctx->tisLockDepth++;
+
+  return 0;
+}
+
+static void TPM2_TIS_Unlock(TPM2_CTX *ctx) {
+  if (ctx->tisLockDepth > 0 && --ctx->tisLockDepth == 0 &&
+      ctx->tisLock != NULL &&
+      __atomic_fetch_sub((int *)ctx->tisLock, 1, __ATOMIC_RELEASE) > 1)
+    l4_semaphore_up(ctx->tisLockSem);
+}
+
+void TPM2_TIS_LockFree(TPM2_CTX *ctx) {
+  if (ctx->tisLock != NULL) {
+    if (ctx->tisLockDepth > 0) {
+      ctx->tisLockDepth = 1;
+      TPM2_TIS_Unlock(ctx);
+    }
+    l4re_rm_detach(ctx->tisLock);
+    ctx->tisLock = NULL;
+  }
+  ctx->tisLockOpen = 0;
+  ctx->tisLockDepth = 0;
+}
+#elif defined(__linux__)
 #include <errno.h>
 #include <fcntl.h>
 #include <semaphore.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #define SEM_NAME "/wolftpm"
 #define SEM_PERMS (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP)
 #define INITIAL_VALUE 1
 #define TIMEOUT_SECONDS 10
-static int gLockCount = 0;
 
-static int TPM2_TIS_Lock(void) {
+/* The semaphore is opened once per ctx. sem_trywait and sem_post are atomic
+ * operations on the shared mapping and only enter the kernel (futex) when
+ * the lock is contended. */
+static int TPM2_TIS_Lock(TPM2_CTX *ctx) {
   int ret = 0;
-  sem_t *sem;
+  sem_t *sem = (sem_t *)ctx->tisLock;
   struct timespec timeoutTime;
 
-  if (gLockCount == 0) {
-    clock_gettime(CLOCK_REALTIME, &timeoutTime);
-    timeoutTime.tv_sec += TIMEOUT_SECONDS;
-
-    /* open semaphore and create if not found */
-    sem = sem_open(SEM_NAME, O_CREAT | O_RDWR, SEM_PERMS, INITIAL_VALUE);
-    if (sem == SEM_FAILED) {
+  if (ctx->tisLockDepth == 0) {
+    if (sem == NULL) {
+      /* open semaphore and create if not found */
+      sem = sem_open(SEM_NAME, O_CREAT | O_RDWR, SEM_PERMS, INITIAL_VALUE);
+      if (sem == SEM_FAILED) {
 #ifdef DEBUG_WOLFTPM
-      printf("TPM2_TIS_Lock: Semaphore %s open failed! %d\n", SEM_NAME, errno);
+        printf("TPM2_TIS_Lock: Semaphore %s open failed! %d\n", SEM_NAME,
+               errno);
 #endif
-      return BAD_MUTEX_E;
+        return BAD_MUTEX_E;
+      }
+      ctx->tisLock = sem;
     }
 
-    /* Try and decrement semaphore */
-    if (sem_timedwait(sem, &timeoutTime) != 0) {
+    /* Try and decrement semaphore, block only if it is taken */
+    if (sem_trywait(sem) != 0) {
+      clock_gettime(CLOCK_REALTIME, &timeoutTime);
+      timeoutTime.tv_sec += TIMEOUT_SECONDS;
+      while ((ret = sem_timedwait(sem, &timeoutTime)) != 0 && errno == EINTR)
+        ;
+      if (ret != 0) {
 #ifdef DEBUG_WOLFTPM
-      printf("TPM2_TIS_Lock: Semaphore %s timeout! %d\n", SEM_NAME, errno);
+        printf("TPM2_TIS_Lock: Semaphore %s timeout! %d\n", SEM_NAME, errno);
 #endif
-      ret = WC_TIMEOUT_E;
+        return WC_TIMEOUT_E;
+      }
     }
-
-    sem_close(sem);
-  }
-  if (ret == 0) {
-    gLockCount++;
   }
+  ctx->tisLockDepth++;
 
   return ret;
 }
 
-static void TPM2_TIS_Unlock(void) {
-  if (gLockCount > 0) {
-    gLockCount--;
-  }
-  if (gLockCount == 0) {
-    sem_t *sem = sem_open(SEM_NAME, O_RDWR);
-    if (sem == SEM_FAILED) {
-#ifdef DEBUG_WOLFTPM
-      printf("TPM2_TIS_Unlock: Semaphore %s open failed! %d\n", SEM_NAME,
-             errno);
-#endif
-      return;
-    }
+static void TPM2_TIS_Unlock(TPM2_CTX *ctx) {
+  if (ctx->tisLockDepth > 0 && --ctx->tisLockDepth == 0)
+    sem_post((sem_t *)ctx->tisLock); /* increment semaphore */
+}
 
-    sem_post(sem); /* increment semaphore */
-    sem_close(sem);
+void TPM2_TIS_LockFree(TPM2_CTX *ctx) {
+  if (ctx->tisLock != NULL) {
+    if (ctx->tisLockDepth > 0)
+      sem_post((sem_t *)ctx->tisLock);
+    sem_close((sem_t *)ctx->tisLock);
+    ctx->tisLock = NULL;
   }
+  ctx->tisLockDepth = 0;
 }
-#define TPM2_TIS_LOCK() TPM2_TIS_Lock()
-#define TPM2_TIS_UNLOCK() TPM2_TIS_Unlock()
 #else
 #error TPM TIS Locking not supported on this platform
-#endif /* __linux__ */
+#endif /* L4API_l4f / __linux__ */
+#define TPM2_TIS_LOCK(ctx) TPM2_TIS_Lock(ctx)
+#define TPM2_TIS_UNLOCK(ctx) TPM2_TIS_Unlock(ctx)
 #endif /* WOLFTPM_TIS_LOCK */
 #ifndef TPM2_TIS_LOCK
-#define TPM2_TIS_LOCK() 0
+#define TPM2_TIS_LOCK(ctx) 0
 #endif
 #ifndef TPM2_TIS_UNLOCK
-#define TPM2_TIS_UNLOCK()
+#define TPM2_TIS_UNLOCK(ctx)
+#endif
+
+#ifndef WOLFTPM_ADV_IO
+/* Writes the 4 byte SPI frame header for a register transaction */
+static void TPM2_TIS_SetHeader(byte *frame, int isRead, word32 addr,
+                               word32 len) {
+  frame[0] = (isRead ? TPM_TIS_READ : TPM_TIS_WRITE) | ((len & 0xFF) - 1);
+  frame[1] = (addr >> 16) & 0xFF;
+  frame[2] = (addr >> 8) & 0xFF;
+  frame[3] = (addr)&0xFF;
+}
 #endif
 
 int TPM2_TIS_Read(TPM2_CTX *ctx, word32 addr, byte *result, word32 len) {
@@ -172,25 +282,21 @@ int TPM2_TIS_Read(TPM2_CTX *ctx, word32 addr, byte *result, word32 len) {
   if (ctx == NULL || result == NULL || len == 0 || len > MAX_SPI_FRAMESIZE)
     return BAD_FUNC_ARG;
 
-  rc = TPM2_TIS_LOCK();
+  rc = TPM2_TIS_LOCK(ctx);
   if (rc != 0)
     return rc;
 
 #ifdef WOLFTPM_ADV_IO
   rc = ctx->ioCb(ctx, TPM_TIS_READ, addr, result, len, ctx->userCtx);
 #else
-  txBuf[0] = TPM_TIS_READ | ((len & 0xFF) - 1);
-  txBuf[1] = (addr >> 16) & 0xFF;
-  txBuf[2] = (addr >> 8) & 0xFF;
-  txBuf[3] = (addr)&0xFF;
+  TPM2_TIS_SetHeader(txBuf, 1, addr, len);
   XMEMSET(&txBuf[TPM_TIS_HEADER_SZ], 0, len);
-  XMEMSET(rxBuf, 0, sizeof(rxBuf));
 
   rc = ctx->ioCb(ctx, txBuf, rxBuf, len + TPM_TIS_HEADER_SZ, ctx->userCtx);
 
   XMEMCPY(result, &rxBuf[TPM_TIS_HEADER_SZ], len);
 #endif
-  TPM2_TIS_UNLOCK();
+  TPM2_TIS_UNLOCK(ctx);
 
   return rc;
 }
@@ -205,27 +311,107 @@ int TPM2_TIS_Write(TPM2_CTX *ctx, word32 addr, const byte *value, word32 len) {
   if (ctx == NULL || value == NULL || len == 0 || len > MAX_SPI_FRAMESIZE)
     return BAD_FUNC_ARG;
 
-  rc = TPM2_TIS_LOCK();
+  rc = TPM2_TIS_LOCK(ctx);
   if (rc != 0)
     return rc;
 
 #ifdef WOLFTPM_ADV_IO
   rc = ctx->ioCb(ctx, TPM_TIS_WRITE, addr, (byte *)value, len, ctx->userCtx);
 #else
-  txBuf[0] = TPM_TIS_WRITE | ((len & 0xFF) - 1);
-  txBuf[1] = (addr >> 16) & 0xFF;
-  txBuf[2] = (addr >> 8) & 0xFF;
-  txBuf[3] = (addr)&0xFF;
+  TPM2_TIS_SetHeader(txBuf, 0, addr, len);
   XMEMCPY(&txBuf[TPM_TIS_HEADER_SZ], value, len);
-  XMEMSET(rxBuf, 0, sizeof(rxBuf));
 
   rc = ctx->ioCb(ctx, txBuf, rxBuf, len + TPM_TIS_HEADER_SZ, ctx->userCtx);
 #endif
-  TPM2_TIS_UNLOCK();
+  TPM2_TIS_UNLOCK(ctx);
+
+  return rc;
+}
+
+/* Issues count independent register transactions. When the HAL provides a
+ * vectored callback all frames are handed over in a single call, otherwise
+ * they are sent one at a time */
+int TPM2_TIS_ReadWriteVec(TPM2_CTX *ctx, TPM2_TIS_XFER *xfer, int count) {
+  int rc = TPM_RC_SUCCESS;
+  int i;
+#ifndef WOLFTPM_ADV_IO
+  byte txBuf[TPM_TIS_MAX_XFER_VEC * (MAX_SPI_FRAMESIZE + TPM_TIS_HEADER_SZ)];
+  byte rxBuf[TPM_TIS_MAX_XFER_VEC * (MAX_SPI_FRAMESIZE + TPM_TIS_HEADER_SZ)];
+  word16 xferSz[TPM_TIS_MAX_XFER_VEC];
+  int pos;
+#endif
+
+  if (ctx == NULL || xfer == NULL || count <= 0 ||
+      count > TPM_TIS_MAX_XFER_VEC)
+    return BAD_FUNC_ARG;
+  for (i = 0; i < count; i++) {
+    if (xfer[i].buf == NULL || xfer[i].len == 0 ||
+        xfer[i].len > MAX_SPI_FRAMESIZE)
+      return BAD_FUNC_ARG;
+  }
+
+#ifndef WOLFTPM_ADV_IO
+  if (ctx->ioVecCb != NULL) {
+    rc = TPM2_TIS_LOCK(ctx);
+    if (rc != 0)
+      return rc;
+
+    pos = 0;
+    for (i = 0; i < count; i++) {
+      TPM2_TIS_SetHeader(&txBuf[pos], xfer[i].isRead, xfer[i].addr,
+                         xfer[i].len);
+      if (xfer[i].isRead)
+        XMEMSET(&txBuf[pos + TPM_TIS_HEADER_SZ], 0, xfer[i].len);
+      else
+        XMEMCPY(&txBuf[pos + TPM_TIS_HEADER_SZ], xfer[i].buf, xfer[i].len);
+      xferSz[i] = xfer[i].len + TPM_TIS_HEADER_SZ;
+      pos += xferSz[i];
+    }
+
+    rc = ctx->ioVecCb(ctx, txBuf, rxBuf, xferSz, (word16)count, ctx->userCtx);
+
+    if (rc == TPM_RC_SUCCESS) {
+      pos = 0;
+      for (i = 0; i < count; i++) {
+        if (xfer[i].isRead)
+          XMEMCPY(xfer[i].buf, &rxBuf[pos + TPM_TIS_HEADER_SZ], xfer[i].len);
+        pos += xferSz[i];
+      }
+    }
+    TPM2_TIS_UNLOCK(ctx);
+
+    return rc;
+  }
+#endif
+
+  for (i = 0; i < count && rc == TPM_RC_SUCCESS; i++) {
+    if (xfer[i].isRead)
+      rc = TPM2_TIS_Read(ctx, xfer[i].addr, xfer[i].buf, xfer[i].len);
+    else
+      rc = TPM2_TIS_Write(ctx, xfer[i].addr, xfer[i].buf, xfer[i].len);
+  }
 
   return rc;
 }
 
+/* Returns non-zero if register transactions can be batched into one IO call */
+static int TPM2_TIS_CanBatch(TPM2_CTX *ctx) {
+#ifndef WOLFTPM_ADV_IO
+  return ctx->ioVecCb != NULL;
+#else
+  (void)ctx;
+  return 0;
+#endif
+}
+
+static void TPM2_TIS_SetXfer(TPM2_TIS_XFER *xfer, int isRead, word32 addr,
+                             byte *buf, word16 len) {
+  xfer->addr = addr;
+  xfer->buf = buf;
+  xfer->len = len;
+  xfer->isRead = (byte)isRead;
+}
+
 int TPM2_TIS_StartupWait(TPM2_CTX *ctx, int timeout) {
   int rc;
   byte access = 0;
@@ -300,6 +486,33 @@ int TPM2_TIS_RequestLocality(TPM2_CTX *ctx, int timeout) {
   return rc;
 }
 
+/* Frame payload sizes for the TPM_INTF_CAPS data transfer size field, 0 is
+ * legacy or not reported */
+static const word16 kTisXferSize[] = {0, 8, 32, 64};
+
+/* Sets the FIFO frame size to the largest transfer the TPM reports, bounded
+ * by MAX_SPI_FRAMESIZE. Without a reported size MAX_SPI_FRAMESIZE is used. */
+static void TPM2_TIS_NegotiateFrame(TPM2_CTX *ctx) {
+  word16 frameSz = kTisXferSize[(ctx->caps & TPM_INTF_XFER_SIZE_MASK) >>
+                                TPM_INTF_XFER_SIZE_SHIFT];
+
+  if (frameSz == 0 || frameSz > MAX_SPI_FRAMESIZE)
+    frameSz = MAX_SPI_FRAMESIZE;
+  ctx->frameSz = frameSz;
+}
+
+int TPM2_TIS_SetMaxFrame(TPM2_CTX *ctx, word16 maxFrame) {
+  if (ctx == NULL || maxFrame == 0)
+    return BAD_FUNC_ARG;
+  if (ctx->frameSz == 0 || ctx->frameSz > MAX_SPI_FRAMESIZE)
+    TPM2_TIS_NegotiateFrame(ctx);
+  if (maxFrame < ctx->frameSz) {
+    ctx->frameSz = maxFrame;
+    ctx->burstStatic = 0; /* cached against the previous frame size */
+  }
+  return TPM_RC_SUCCESS;
+}
+
 int TPM2_TIS_GetInfo(TPM2_CTX *ctx) {
   int rc;
   word32 reg;
@@ -312,6 +525,7 @@ int TPM2_TIS_GetInfo(TPM2_CTX *ctx) {
   if (rc == TPM_RC_SUCCESS) {
     ctx->caps = reg;
   }
+  TPM2_TIS_NegotiateFrame(ctx);
 
   rc =
       TPM2_TIS_Read(ctx, TPM_DID_VID(ctx->locality), (byte *)&reg, sizeof(reg));
@@ -338,15 +552,77 @@ int TPM2_TIS_Status(TPM2_CTX *ctx, byte *status) {
   return TPM2_TIS_Read(ctx, TPM_STS(ctx->locality), status, sizeof(*status));
 }
 
+/* Enables or disables the data available and status valid interrupts. The
+ * interrupt polarity configured by the platform is kept. */
+int TPM2_TIS_EnableIrq(TPM2_CTX *ctx, int enable) {
+  int rc;
+  word32 reg = 0;
+  const word32 mask =
+      TPM_GLOBAL_INT_ENABLE | TPM_INTF_DATA_AVAIL_INT | TPM_INTF_STS_VALID_INT;
+
+  if (enable && (ctx->caps & TPM_INTF_DATA_AVAIL_INT) == 0) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_TIS_EnableIrq: data available interrupt not supported\n");
+#endif
+    return TPM_RC_FAILURE;
+  }
+
+  rc = TPM2_TIS_Read(ctx, TPM_INT_ENABLE(ctx->locality), (byte *)&reg,
+                     sizeof(reg));
+#ifdef BIG_ENDIAN_ORDER
+  reg = ByteReverseWord32(reg);
+#endif
+  if (rc != TPM_RC_SUCCESS)
+    return rc;
+
+  reg &= ~mask;
+  if (enable) {
+    reg |= TPM_GLOBAL_INT_ENABLE | TPM_INTF_DATA_AVAIL_INT;
+    if (ctx->caps & TPM_INTF_STS_VALID_INT)
+      reg |= TPM_INTF_STS_VALID_INT;
+  }
+#ifdef BIG_ENDIAN_ORDER
+  reg = ByteReverseWord32(reg);
+#endif
+  return TPM2_TIS_Write(ctx, TPM_INT_ENABLE(ctx->locality), (byte *)&reg,
+                        sizeof(reg));
+}
+
+/* Blocks until the TPM raises an interrupt and acknowledges it */
+static int TPM2_TIS_WaitIrq(TPM2_CTX *ctx) {
+  int rc;
+  word32 reg = TPM_INTF_DATA_AVAIL_INT | TPM_INTF_STS_VALID_INT;
+
+  rc = ctx->irqWaitCb(ctx, TPM_IRQ_TIMEOUT_MS, ctx->irqCtx);
+  if (rc == TPM_RC_SUCCESS) {
+#ifdef BIG_ENDIAN_ORDER
+    reg = ByteReverseWord32(reg);
+#endif
+    /* write one to clear, before the status is sampled again */
+    rc = TPM2_TIS_Write(ctx, TPM_INT_STATUS(ctx->locality), (byte *)&reg,
+                        sizeof(reg));
+  }
+  return rc;
+}
+
 int TPM2_TIS_WaitForStatus(TPM2_CTX *ctx, byte status, byte status_mask) {
   int rc;
   int timeout = TPM_TIMEOUT_TRIES;
   byte reg = 0;
+  /* only data available and status valid raise an interrupt */
+  int useIrq = ctx->irqWaitCb != NULL &&
+               (status & (TPM_STS_DATA_AVAIL | TPM_STS_VALID)) != 0;
 
   do {
     rc = TPM2_TIS_Status(ctx, &reg);
     if (rc == TPM_RC_SUCCESS && (reg & status) == status_mask)
       break;
+    if (rc == TPM_RC_SUCCESS && useIrq) {
+      if (TPM2_TIS_WaitIrq(ctx) == TPM_RC_SUCCESS)
+        continue;
+      /* no interrupt arrived, keep polling */
+      useIrq = 0;
+    }
     XTPM_WAIT();
   } while (rc == TPM_RC_SUCCESS && --timeout > 0);
 #ifdef WOLFTPM_DEBUG_TIMEOUT
@@ -357,6 +633,361 @@ int TPM2_TIS_WaitForStatus(TPM2_CTX *ctx, byte status, byte status_mask) {
   return rc;
 }
 
+/* Payload of one FIFO frame as negotiated in TPM2_TIS_GetInfo */
+static word16 TPM2_TIS_FrameSz(TPM2_CTX *ctx) {
+  if (ctx->frameSz == 0 || ctx->frameSz > MAX_SPI_FRAMESIZE)
+    return MAX_SPI_FRAMESIZE;
+  return ctx->frameSz;
+}
+
+/* FIFO bytes moved per burst count handshake, one IO call when batching */
+static word16 TPM2_TIS_MaxChunk(TPM2_CTX *ctx) {
+  return TPM2_TIS_FrameSz(ctx) * (TPM_TIS_MAX_XFER_VEC - 1);
+}
+
+/* The extended data FIFO is optional and not reported by any capability
+ * bit, it is only used with WOLFTPM_TIS_XDATA_FIFO on TIS 1.3 and later
+ * interfaces. Otherwise the data FIFO is used. */
+static word32 TPM2_TIS_FifoAddr(TPM2_CTX *ctx) {
+#ifdef WOLFTPM_TIS_XDATA_FIFO
+  if (((ctx->caps & TPM_INTF_VERSION_MASK) >> TPM_INTF_VERSION_SHIFT) >=
+      TPM_INTF_VERSION_TIS13)
+    return TPM_XDATA_FIFO(ctx->locality);
+#endif
+  return TPM_DATA_FIFO(ctx->locality);
+}
+
+/* Converts a raw burst count into a usable transfer size. With
+ * TPM_INTF_BURST_COUNT_STATIC the first valid value is cached in the ctx. */
+static word16 TPM2_TIS_BurstLimit(TPM2_CTX *ctx, word16 burstCount) {
+#if defined(WOLFTPM_ST33) || defined(WOLFTPM_AUTODETECT)
+  if (TPM2_GetVendorID() == TPM_VENDOR_STM)
+    return 32; /* fixed value */
+#endif
+  if (ctx->burstStatic != 0)
+    return ctx->burstStatic;
+  if (burstCount > TPM2_TIS_MaxChunk(ctx))
+    burstCount = TPM2_TIS_MaxChunk(ctx);
+  if (burstCount > 0 && (ctx->caps & TPM_INTF_BURST_COUNT_STATIC))
+    ctx->burstStatic = burstCount;
+  return burstCount;
+}
+
+/* TPM_STS and TPM_BURST_COUNT are adjacent, one 3 byte access returns the
+ * status and the little endian burst count */
+#define TPM_TIS_STS_BURST_SZ 3
+
+static void TPM2_TIS_ParseStsBurst(TPM2_CTX *ctx, const byte *stsBurst,
+                                   byte *status, word16 *burstCount) {
+  *status = stsBurst[0];
+  *burstCount =
+      TPM2_TIS_BurstLimit(ctx, (word16)(stsBurst[1] | (stsBurst[2] << 8)));
+}
+
+static int TPM2_TIS_StatusBurst(TPM2_CTX *ctx, byte *status,
+                                word16 *burstCount) {
+  int rc;
+  byte stsBurst[TPM_TIS_STS_BURST_SZ];
+
+  rc = TPM2_TIS_Read(ctx, TPM_STS(ctx->locality), stsBurst, sizeof(stsBurst));
+  if (rc == TPM_RC_SUCCESS)
+    TPM2_TIS_ParseStsBurst(ctx, stsBurst, status, burstCount);
+  return rc;
+}
+
+#ifdef WOLFTPM_TIS_ZERO_COPY
+/* Returns non-zero if the packet lives in the ctx command buffer, which
+ * reserves headroom and tailroom for in place framing */
+static int TPM2_TIS_CanFrameInPlace(TPM2_CTX *ctx, TPM2_Packet *packet) {
+#ifdef WOLFTPM_PIPELINE
+  int i;
+  for (i = 0; i < TPM2_PIPE_DEPTH; i++) {
+    if (packet->buf == &ctx->pipe[i].buf[TPM2_PACKET_HEADROOM])
+      return packet->size <= MAX_COMMAND_SIZE;
+  }
+#endif
+#ifdef WOLFTPM_RESOURCE_MGR
+  if (packet->buf == &ctx->rmBuf[TPM2_PACKET_HEADROOM])
+    return packet->size <= MAX_COMMAND_SIZE;
+#endif
+  return packet->buf == &ctx->cmdBuf[TPM2_PACKET_HEADROOM] &&
+         packet->size <= MAX_COMMAND_SIZE;
+}
+
+/* Moves a FIFO chunk directly between the packet and the bus. The SPI header
+ * is written over the bytes before the chunk and a status frame over the bytes
+ * after it, both are restored afterwards. Reads are received in place, writes
+ * discard the rx bytes. */
+static int TPM2_TIS_FifoInPlace(TPM2_CTX *ctx, word32 fifo, byte *data,
+                                word16 len, int isRead, byte *stsBurst) {
+  int rc;
+  byte *frame = data - TPM_TIS_HEADER_SZ;
+  byte *stsFrame = data + len;
+  byte head[TPM_TIS_HEADER_SZ];
+  byte tail[TPM_TIS_HEADER_SZ + TPM_TIS_STS_BURST_SZ];
+  byte discard[TPM_TIS_HEADER_SZ + MAX_SPI_FRAMESIZE + sizeof(tail)];
+  byte *rxBuf = isRead ? frame : discard;
+  word16 xferSz[2];
+
+  if (len == 0 || len > MAX_SPI_FRAMESIZE)
+    return BAD_FUNC_ARG;
+
+  rc = TPM2_TIS_LOCK(ctx);
+  if (rc != 0)
+    return rc;
+
+  XMEMCPY(head, frame, sizeof(head));
+  TPM2_TIS_SetHeader(frame, isRead, fifo, len);
+  xferSz[0] = len + TPM_TIS_HEADER_SZ;
+  if (stsBurst != NULL) {
+    XMEMCPY(tail, stsFrame, sizeof(tail));
+    TPM2_TIS_SetHeader(stsFrame, 1, TPM_STS(ctx->locality),
+                       TPM_TIS_STS_BURST_SZ);
+    xferSz[1] = sizeof(tail);
+    rc = ctx->ioVecCb(ctx, frame, rxBuf, xferSz, 2, ctx->userCtx);
+    if (rc == TPM_RC_SUCCESS)
+      XMEMCPY(stsBurst, &rxBuf[xferSz[0] + TPM_TIS_HEADER_SZ],
+              TPM_TIS_STS_BURST_SZ);
+    XMEMCPY(stsFrame, tail, sizeof(tail));
+  } else {
+    rc = ctx->ioCb(ctx, frame, rxBuf, xferSz[0], ctx->userCtx);
+  }
+  XMEMCPY(frame, head, sizeof(head));
+
+  TPM2_TIS_UNLOCK(ctx);
+
+  return rc;
+}
+#endif /* WOLFTPM_TIS_ZERO_COPY */
+
+/* Transfers len bytes at packet->buf[pos] through the FIFO in frames of the
+ * negotiated size and, with stsBurst set, samples status and burst count
+ * afterwards. len must not exceed TPM2_TIS_MaxChunk. When batching all frames
+ * go into one IO call, a single frame is framed in place when the packet
+ * buffer allows it. */
+static int TPM2_TIS_FifoXfer(TPM2_CTX *ctx, TPM2_Packet *packet, int isRead,
+                             int pos, int len, byte *stsBurst) {
+#ifdef WOLFTPM_TIS_ZERO_COPY
+  int rc = TPM_RC_SUCCESS;
+#endif
+  int count = 0, off, frameSz = TPM2_TIS_FrameSz(ctx);
+  word32 fifo = TPM2_TIS_FifoAddr(ctx);
+  TPM2_TIS_XFER xfer[TPM_TIS_MAX_XFER_VEC];
+
+#ifdef WOLFTPM_TIS_ZERO_COPY
+  if (TPM2_TIS_CanFrameInPlace(ctx, packet)) {
+    if (TPM2_TIS_CanBatch(ctx)) {
+      if (len <= frameSz)
+        return TPM2_TIS_FifoInPlace(ctx, fifo, &packet->buf[pos], len, isRead,
+                                    stsBurst);
+    } else {
+      for (off = 0; off < len && rc == TPM_RC_SUCCESS; off += frameSz) {
+        rc = TPM2_TIS_FifoInPlace(ctx, fifo, &packet->buf[pos + off],
+                                  len - off < frameSz ? len - off : frameSz,
+                                  isRead, NULL);
+      }
+      if (rc == TPM_RC_SUCCESS && stsBurst != NULL)
+        rc = TPM2_TIS_Read(ctx, TPM_STS(ctx->locality), stsBurst,
+                           TPM_TIS_STS_BURST_SZ);
+      return rc;
+    }
+  }
+#endif
+
+  for (off = 0; off < len && count < TPM_TIS_MAX_XFER_VEC - 1;
+       off += frameSz) {
+    TPM2_TIS_SetXfer(&xfer[count++], isRead, fifo, &packet->buf[pos + off],
+                     len - off < frameSz ? len - off : frameSz);
+  }
+  if (off < len)
+    return BAD_FUNC_ARG;
+  if (stsBurst != NULL) {
+    TPM2_TIS_SetXfer(&xfer[count++], 1, TPM_STS(ctx->locality), stsBurst,
+                     TPM_TIS_STS_BURST_SZ);
+  }
+  return TPM2_TIS_ReadWriteVec(ctx, xfer, count);
+}
+
+#ifdef WOLFTPM_ADAPTIVE_POLL
+#include <time.h>
+
+/* Conservative defaults until the first completion is observed */
+static const struct {
+  TPM_CC cc;
+  word32 expectUs;
+} gCmdTimeDefault[] = {
+    {TPM_CC_CreatePrimary, 20000}, {TPM_CC_Create, 20000},
+    {TPM_CC_CreateLoaded, 20000},  {TPM_CC_Sign, 10000},
+    {TPM_CC_Quote, 10000},         {TPM_CC_RSA_Decrypt, 10000},
+    {TPM_CC_ECDH_ZGen, 5000},      {TPM_CC_Load, 2000},
+    {TPM_CC_StartAuthSession, 2000}, {TPM_CC_NV_Write, 2000},
+};
+
+static word64 TPM2_TIS_TimeUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (word64)ts.tv_sec * 1000000ULL + (word64)ts.tv_nsec / 1000ULL;
+}
+
+/* Completion times are learned per context, each device has its own */
+static TPM2_TIS_CMD_STAT *TPM2_TIS_GetCmdStat(TPM2_CTX *ctx, TPM_CC cc) {
+  if (cc < TPM_CC_FIRST || cc > TPM_CC_LAST)
+    return NULL;
+  return &ctx->cmdStat[cc - TPM_CC_FIRST];
+}
+
+static word32 TPM2_TIS_ExpectedUs(TPM2_CTX *ctx, TPM_CC cc) {
+  TPM2_TIS_CMD_STAT *stat = TPM2_TIS_GetCmdStat(ctx, cc);
+  word32 i;
+
+  if (stat != NULL && stat->samples > 0)
+    return stat->expectUs;
+  for (i = 0; i < sizeof(gCmdTimeDefault) / sizeof(gCmdTimeDefault[0]); i++) {
+    if (gCmdTimeDefault[i].cc == cc)
+      return gCmdTimeDefault[i].expectUs;
+  }
+  return 0;
+}
+
+/* Adds an observed completion time and updates the median */
+static void TPM2_TIS_AddCmdTime(TPM2_CTX *ctx, TPM_CC cc, word32 us) {
+  TPM2_TIS_CMD_STAT *stat = TPM2_TIS_GetCmdStat(ctx, cc);
+  word32 sorted[TPM_TIS_TIME_SAMPLES], tmp;
+  int n, i, j;
+
+  if (stat == NULL)
+    return;
+
+  stat->time[stat->samples % TPM_TIS_TIME_SAMPLES] = us;
+  stat->samples++;
+  n = (stat->samples < TPM_TIS_TIME_SAMPLES) ? (int)stat->samples
+                                             : TPM_TIS_TIME_SAMPLES;
+  XMEMCPY(sorted, stat->time, n * sizeof(word32));
+  for (i = 1; i < n; i++) {
+    tmp = sorted[i];
+    for (j = i; j > 0 && sorted[j - 1] > tmp; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = tmp;
+  }
+  stat->expectUs = sorted[n / 2];
+}
+
+/* Learns the completion time of the command started at startUs, seen done
+ * at nowUs. idleUs is the last status read after the start that still had
+ * no DATA_AVAIL, 0 if there was none. The completion lies between both
+ * reads, the midpoint is learned. Without such a read the time is only
+ * bounded from above, mostly by an oversleep. Learning it would drift the
+ * median up, the shortened sleep target is learned instead so the estimate
+ * walks down until a status read lands before the completion. */
+static void TPM2_TIS_LearnCmdTime(TPM2_CTX *ctx, TPM_CC cc, word64 startUs,
+                                  word64 idleUs, word64 nowUs) {
+  word32 expectUs, us;
+
+  if (idleUs > startUs) {
+    us = (word32)((idleUs + nowUs) / 2 - startUs);
+  } else {
+    us = (word32)(nowUs - startUs);
+    expectUs = TPM2_TIS_ExpectedUs(ctx, cc);
+    if (expectUs > 0 && us > (expectUs * TPM_TIS_SLEEP_PCT) / 100)
+      us = (expectUs * TPM_TIS_SLEEP_PCT) / 100;
+  }
+  TPM2_TIS_AddCmdTime(ctx, cc, us);
+}
+
+int TPM2_TIS_GetCmdTimes(TPM2_CTX *ctx, TPM2_TIS_CMD_TIME *times,
+                         int maxCount) {
+  int count = 0;
+  TPM_CC cc;
+
+  if (ctx == NULL || times == NULL || maxCount <= 0)
+    return BAD_FUNC_ARG;
+
+  for (cc = TPM_CC_FIRST; cc <= TPM_CC_LAST && count < maxCount; cc++) {
+    word32 expectUs = TPM2_TIS_ExpectedUs(ctx, cc);
+    if (expectUs == 0 && ctx->cmdStat[cc - TPM_CC_FIRST].samples == 0)
+      continue;
+    times[count].cc = cc;
+    times[count].expectUs = expectUs;
+    times[count].samples = ctx->cmdStat[cc - TPM_CC_FIRST].samples;
+    count++;
+  }
+  return count;
+}
+
+/* Longest execution time allowed for cc: TIMEOUT_B of the TIS specification,
+ * longer for the commands generating keys */
+static word32 TPM2_TIS_ExecTimeoutMs(TPM_CC cc) {
+  if (cc == TPM_CC_CreatePrimary || cc == TPM_CC_Create ||
+      cc == TPM_CC_CreateLoaded)
+    return TPM_TIS_KEYGEN_TIMEOUT_MS;
+  return TPM_TIS_EXEC_TIMEOUT_MS;
+}
+
+/* Waits for the response of command cc started at startUs. Sleeps for most
+ * of the expected execution time, then polls with exponential backoff. The
+ * backoff is capped to a fraction of the expected time to bound the added
+ * latency. The wait ends after TPM2_TIS_ExecTimeoutMs, however often the
+ * status was read. */
+static int TPM2_TIS_WaitForCompletion(TPM2_CTX *ctx, TPM_CC cc, word64 startUs,
+                                      byte *status, word16 *burstCount) {
+  int rc;
+  word32 expectUs = TPM2_TIS_ExpectedUs(ctx, cc);
+  word32 delayUs = TPM_TIS_POLL_MIN_US, maxDelayUs;
+  word64 nowUs, sleepUntil, deadlineUs, idleUs = ctx->cmdIdleUs;
+
+  if (ctx->irqWaitCb != NULL) {
+    /* the interrupt wakes us up, only learn the time */
+    rc = TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_AVAIL, TPM_STS_DATA_AVAIL);
+    if (rc == TPM_RC_SUCCESS) {
+      *status = TPM_STS_VALID | TPM_STS_DATA_AVAIL;
+      *burstCount = 0;
+      TPM2_TIS_AddCmdTime(ctx, cc, (word32)(TPM2_TIS_TimeUs() - startUs));
+    }
+    return rc;
+  }
+
+  maxDelayUs = expectUs / 8;
+  if (maxDelayUs > TPM_TIS_POLL_MAX_US)
+    maxDelayUs = TPM_TIS_POLL_MAX_US;
+  if (maxDelayUs < TPM_TIS_POLL_MIN_US)
+    maxDelayUs = TPM_TIS_POLL_MIN_US;
+
+  deadlineUs = startUs + (word64)TPM2_TIS_ExecTimeoutMs(cc) * 1000;
+  sleepUntil = startUs + ((word64)expectUs * TPM_TIS_SLEEP_PCT) / 100;
+  if (sleepUntil > deadlineUs)
+    sleepUntil = deadlineUs;
+  nowUs = TPM2_TIS_TimeUs();
+  if (sleepUntil > nowUs + TPM_TIS_POLL_MIN_US)
+    XTPM_SLEEP_US((word32)(sleepUntil - nowUs));
+
+  for (;;) {
+    rc = TPM2_TIS_StatusBurst(ctx, status, burstCount);
+    if (rc != TPM_RC_SUCCESS)
+      break;
+    nowUs = TPM2_TIS_TimeUs();
+    if (*status & TPM_STS_DATA_AVAIL) {
+      TPM2_TIS_LearnCmdTime(ctx, cc, startUs, idleUs, nowUs);
+      break;
+    }
+    idleUs = nowUs;
+    if (nowUs >= deadlineUs) {
+#ifdef WOLFTPM_DEBUG_TIMEOUT
+      printf("TIS_WaitForCompletion: Timeout after %lu us\n",
+             (unsigned long)(nowUs - startUs));
+#endif
+      return TPM_RC_TIMEOUT;
+    }
+    if (delayUs > deadlineUs - nowUs)
+      delayUs = (word32)(deadlineUs - nowUs);
+    XTPM_SLEEP_US(delayUs);
+    delayUs *= 2;
+    if (delayUs > maxDelayUs)
+      delayUs = maxDelayUs;
+  }
+  return rc;
+}
+#endif /* WOLFTPM_ADAPTIVE_POLL */
+
 int TPM2_TIS_Ready(TPM2_CTX *ctx) {
   byte status = TPM_STS_COMMAND_READY;
   return TPM2_TIS_Write(ctx, TPM_STS(ctx->locality), &status, sizeof(status));
@@ -373,7 +1004,9 @@ int TPM2_TIS_GetBurstCount(TPM2_CTX *ctx, word16 *burstCount) {
     *burstCount = 32; /* fixed value */
   } else
 #endif
-  {
+  if (ctx->burstStatic != 0) {
+    *burstCount = ctx->burstStatic;
+  } else {
     int timeout = TPM_TIMEOUT_TRIES;
     *burstCount = 0;
     do {
@@ -391,8 +1024,7 @@ int TPM2_TIS_GetBurstCount(TPM2_CTX *ctx, word16 *burstCount) {
     printf("TIS_GetBurstCount: Timeout %d\n", TPM_TIMEOUT_TRIES - timeout);
 #endif
 
-    if (*burstCount > MAX_SPI_FRAMESIZE)
-      *burstCount = MAX_SPI_FRAMESIZE;
+    *burstCount = TPM2_TIS_BurstLimit(ctx, *burstCount);
 
     if (timeout <= 0)
       return TPM_RC_TIMEOUT;
@@ -401,13 +1033,24 @@ int TPM2_TIS_GetBurstCount(TPM2_CTX *ctx, word16 *burstCount) {
   return rc;
 }
 
-int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
+/* Writes the command and starts its execution. On success the TIS lock stays
+ * held until TPM2_TIS_PollCommand has read the response. */
+int TPM2_TIS_SubmitCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
   int rc;
-  int xferSz, pos, rspSz;
+  int xferSz, pos;
   byte access, status = 0;
-  word16 burstCount;
+  byte stsBurst[TPM_TIS_STS_BURST_SZ];
+  word16 burstCount = 0;
+  TPM2_TIS_XFER xfer[2];
 
-  rc = TPM2_TIS_LOCK();
+  if (ctx->cmdState != TPM2_CMD_IDLE) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_TIS_SubmitCommand: a command is already pending\n");
+#endif
+    return TPM_RC_FAILURE;
+  }
+
+  rc = TPM2_TIS_LOCK(ctx);
   if (rc != 0)
     return rc;
 
@@ -416,10 +1059,16 @@ int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
   TPM2_PrintBin(packet->buf, packet->pos);
 #endif
 
+  /* xfer[0] carries GO, xfer[1] reads the status together with the burst
+   * count */
+  TPM2_TIS_SetXfer(&xfer[1], 1, TPM_STS(ctx->locality), stsBurst,
+                   sizeof(stsBurst));
+
   /* Make sure TPM is ready for command */
-  rc = TPM2_TIS_Status(ctx, &status);
+  rc = TPM2_TIS_ReadWriteVec(ctx, &xfer[1], 1);
   if (rc != TPM_RC_SUCCESS)
     goto exit;
+  TPM2_TIS_ParseStsBurst(ctx, stsBurst, &status, &burstCount);
   if ((status & TPM_STS_COMMAND_READY) == 0) {
     /* Tell TPM chip to expect a command */
     rc = TPM2_TIS_Ready(ctx);
@@ -431,26 +1080,33 @@ int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
                                 TPM_STS_COMMAND_READY);
     if (rc != TPM_RC_SUCCESS)
       goto exit;
+    burstCount = 0;
   }
 
   /* Write Command */
   pos = 0;
   while (pos < packet->pos) {
-    rc = TPM2_TIS_GetBurstCount(ctx, &burstCount);
-    if (rc < 0)
-      goto exit;
+    if (burstCount == 0) {
+      rc = TPM2_TIS_GetBurstCount(ctx, &burstCount);
+      if (rc < 0)
+        goto exit;
+    }
 
     xferSz = packet->pos - pos;
     if (xferSz > burstCount)
       xferSz = burstCount;
+    if (xferSz > TPM2_TIS_MaxChunk(ctx))
+      xferSz = TPM2_TIS_MaxChunk(ctx);
 
-    rc = TPM2_TIS_Write(ctx, TPM_DATA_FIFO(ctx->locality), &packet->buf[pos],
-                        xferSz);
+    /* Write the chunk and read back status and burst count, batched into
+     * one IO call when the HAL supports it */
+    rc = TPM2_TIS_FifoXfer(ctx, packet, 0, pos, xferSz, stsBurst);
     if (rc != TPM_RC_SUCCESS)
       goto exit;
+    TPM2_TIS_ParseStsBurst(ctx, stsBurst, &status, &burstCount);
     pos += xferSz;
 
-    if (pos < packet->pos) {
+    if (pos < packet->pos && (status & TPM_STS_DATA_EXPECT) == 0) {
       /* Wait for expect more data (TPM_STS_DATA_EXPECT = 1) */
       rc =
           TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_EXPECT, TPM_STS_DATA_EXPECT);
@@ -460,6 +1116,7 @@ int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
 #endif
         goto exit;
       }
+      burstCount = 0;
     }
   }
 
@@ -468,63 +1125,171 @@ int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
 #endif
   {
     /* Wait for TPM_STS_DATA_EXPECT = 0 and TPM_STS_VALID = 1 */
-    rc = TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_EXPECT | TPM_STS_VALID,
-                                TPM_STS_VALID);
-    if (rc != TPM_RC_SUCCESS) {
+    if ((status & (TPM_STS_DATA_EXPECT | TPM_STS_VALID)) != TPM_STS_VALID) {
+      rc = TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_EXPECT | TPM_STS_VALID,
+                                  TPM_STS_VALID);
+      if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
-      printf("TPM2_TIS_SendCommand status valid timeout!\n");
+        printf("TPM2_TIS_SendCommand status valid timeout!\n");
 #endif
-      goto exit;
+        goto exit;
+      }
     }
   }
 
   /* Execute Command */
+#ifdef WOLFTPM_ADAPTIVE_POLL
+  {
+    UINT32 tmpCc;
+    XMEMCPY(&tmpCc, &packet->buf[6], sizeof(UINT32));
+    ctx->cmdCc = TPM2_Packet_SwapU32(tmpCc);
+    ctx->cmdGoUs = TPM2_TIS_TimeUs();
+    ctx->cmdIdleUs = 0;
+  }
+#endif
   access = TPM_STS_GO;
-  rc = TPM2_TIS_Write(ctx, TPM_STS(ctx->locality), &access, sizeof(access));
-  if (rc != TPM_RC_SUCCESS)
-    goto exit;
+  TPM2_TIS_SetXfer(&xfer[0], 0, TPM_STS(ctx->locality), &access,
+                   sizeof(access));
+  status = 0;
+  burstCount = 0;
+  if (TPM2_TIS_CanBatch(ctx)) {
+    rc = TPM2_TIS_ReadWriteVec(ctx, xfer, 2);
+    if (rc == TPM_RC_SUCCESS)
+      TPM2_TIS_ParseStsBurst(ctx, stsBurst, &status, &burstCount);
+  } else {
+    rc = TPM2_TIS_ReadWriteVec(ctx, xfer, 1);
+  }
+
+exit:
 
-  /* Read response */
+  if (rc == TPM_RC_SUCCESS) {
+    ctx->cmdState = TPM2_CMD_EXEC;
+    ctx->cmdSts = status;
+    ctx->cmdBurst = burstCount;
+  } else {
+    TPM2_TIS_UNLOCK(ctx);
+  }
+
+  return rc;
+}
+
+/* Reads the response of the command started by TPM2_TIS_SubmitCommand into
+ * packet. Without wait a single status read decides, WC_PENDING_E is returned
+ * while the TPM is still executing. */
+int TPM2_TIS_PollCommand(TPM2_CTX *ctx, TPM2_Packet *packet, int wait) {
+  int rc = TPM_RC_SUCCESS;
+  int xferSz, pos, rspSz;
+  byte status;
+  byte stsBurst[TPM_TIS_STS_BURST_SZ];
+  word16 burstCount;
+  TPM2_TIS_XFER xfer;
+
+  if (ctx->cmdState != TPM2_CMD_EXEC)
+    return BAD_FUNC_ARG;
+
+  status = ctx->cmdSts;
+  burstCount = ctx->cmdBurst;
+
+  if (!wait && (status & TPM_STS_DATA_AVAIL) == 0) {
+    rc = TPM2_TIS_StatusBurst(ctx, &status, &burstCount);
+    if (rc != TPM_RC_SUCCESS)
+      goto exit;
+#ifdef WOLFTPM_ADAPTIVE_POLL
+    if ((status & TPM_STS_DATA_AVAIL) == 0) {
+      ctx->cmdIdleUs = TPM2_TIS_TimeUs();
+      return WC_PENDING_E;
+    }
+    TPM2_TIS_LearnCmdTime(ctx, ctx->cmdCc, ctx->cmdGoUs, ctx->cmdIdleUs,
+                          TPM2_TIS_TimeUs());
+#else
+    if ((status & TPM_STS_DATA_AVAIL) == 0)
+      return WC_PENDING_E;
+#endif
+  }
+
+#ifdef WOLFTPM_ADAPTIVE_POLL
+  /* Wait for completion based on the expected time of this command */
+  if ((status & TPM_STS_DATA_AVAIL) == 0) {
+    rc = TPM2_TIS_WaitForCompletion(ctx, ctx->cmdCc, ctx->cmdGoUs, &status,
+                                    &burstCount);
+    if (rc != TPM_RC_SUCCESS)
+      goto exit;
+  }
+#endif
+
+  TPM2_TIS_SetXfer(&xfer, 1, TPM_STS(ctx->locality), stsBurst,
+                   sizeof(stsBurst));
+
+  /* Read response in chunks as large as the burst count allows. Until the
+   * size field arrived a dynamic burst count bounds the read to the data
+   * available, a static one only allows the header to be read. */
   pos = 0;
-  rspSz = TPM2_HEADER_SIZE; /* Read at least TPM header */
-  while (pos < rspSz) {
-    /* Wait for data to be available (TPM_STS_DATA_AVAIL = 1) */
-    rc = TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_AVAIL, TPM_STS_DATA_AVAIL);
-    if (rc != TPM_RC_SUCCESS) {
+  rspSz = 0;
+  while (rspSz == 0 || pos < rspSz) {
+    if ((status & TPM_STS_DATA_AVAIL) == 0) {
+      /* Wait for data to be available (TPM_STS_DATA_AVAIL = 1) */
+      rc = TPM2_TIS_WaitForStatus(ctx, TPM_STS_DATA_AVAIL, TPM_STS_DATA_AVAIL);
+      if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
-      printf("TPM2_TIS_SendCommand read no data available!\n");
+        printf("TPM2_TIS_SendCommand read no data available!\n");
 #endif
-      goto exit;
+        goto exit;
+      }
+      burstCount = 0;
     }
 
-    rc = TPM2_TIS_GetBurstCount(ctx, &burstCount);
-    if (rc < 0)
-      goto exit;
+    if (burstCount == 0) {
+      rc = TPM2_TIS_GetBurstCount(ctx, &burstCount);
+      if (rc < 0)
+        goto exit;
+    }
 
-    xferSz = rspSz - pos;
+    if (rspSz != 0)
+      xferSz = rspSz - pos;
+    else if (ctx->burstStatic != 0)
+      xferSz = TPM2_HEADER_SIZE - pos;
+    else
+      xferSz = burstCount;
     if (xferSz > burstCount)
       xferSz = burstCount;
+    if (xferSz > TPM2_TIS_MaxChunk(ctx))
+      xferSz = TPM2_TIS_MaxChunk(ctx);
+    if (xferSz > packet->size - pos) {
+      rc = TPM_RC_FAILURE;
+      goto exit;
+    }
 
-    rc = TPM2_TIS_Read(ctx, TPM_DATA_FIFO(ctx->locality), &packet->buf[pos],
-                       xferSz);
+    /* Read the chunk, when batching sample status and burst count for the
+     * next one in the same IO call */
+    rc = TPM2_TIS_FifoXfer(ctx, packet, 1, pos, xferSz,
+                           TPM2_TIS_CanBatch(ctx) ? stsBurst : NULL);
     if (rc != TPM_RC_SUCCESS)
       goto exit;
-
     pos += xferSz;
 
-    /* Get real response size */
-    if (pos == TPM2_HEADER_SIZE) {
+    /* Get real response size as soon as the size field arrived */
+    if (rspSz == 0 && pos >= TPM2_HEADER_SIZE) {
       /* Extract size from header */
       UINT32 tmpSz;
       XMEMCPY(&tmpSz, &packet->buf[2], sizeof(UINT32));
       rspSz = TPM2_Packet_SwapU32(tmpSz);
 
       /* safety check for stuck FFFF case */
-      if (rspSz < 0 || rspSz >= MAX_RESPONSE_SIZE || rspSz > packet->size) {
+      if (rspSz < TPM2_HEADER_SIZE || rspSz >= MAX_RESPONSE_SIZE ||
+          rspSz > packet->size || rspSz < pos) {
         rc = TPM_RC_FAILURE;
         goto exit;
       }
     }
+    if (rspSz != 0 && pos >= rspSz)
+      break;
+
+    if (!TPM2_TIS_CanBatch(ctx)) {
+      rc = TPM2_TIS_ReadWriteVec(ctx, &xfer, 1);
+      if (rc != TPM_RC_SUCCESS)
+        goto exit;
+    }
+    TPM2_TIS_ParseStsBurst(ctx, stsBurst, &status, &burstCount);
   }
 
 #ifdef WOLFTPM_DEBUG_VERBOSE
@@ -542,10 +1307,94 @@ exit:
   if (rc == TPM_RC_SUCCESS)
     rc = TPM2_TIS_Ready(ctx);
 
-  TPM2_TIS_UNLOCK();
+  ctx->cmdState = TPM2_CMD_IDLE;
+  TPM2_TIS_UNLOCK(ctx);
 
   return rc;
 }
+
+/* Drops a pending command, command ready aborts it on the TPM */
+void TPM2_TIS_AbortCommand(TPM2_CTX *ctx) {
+  if (ctx->cmdState != TPM2_CMD_EXEC)
+    return;
+  (void)TPM2_TIS_Ready(ctx);
+  ctx->cmdState = TPM2_CMD_IDLE;
+  TPM2_TIS_UNLOCK(ctx);
+}
+
+int TPM2_TIS_SendCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
+  int rc = TPM2_TIS_SubmitCommand(ctx, packet);
+  if (rc == TPM_RC_SUCCESS)
+    rc = TPM2_TIS_PollCommand(ctx, packet, 1);
+  return rc;
+}
+
+int TPM2_TIS_ServeCommand(TPM2_CTX *ctx, const byte *cmd, word32 cmdSz,
+                          byte *rsp, word32 *rspSz) {
+  int rc;
+  UINT32 tmpSz;
+  TPM2_Packet packet;
+
+  if (ctx == NULL || cmd == NULL || rsp == NULL || rspSz == NULL ||
+      cmdSz < TPM2_HEADER_SIZE || cmdSz > MAX_COMMAND_SIZE || *rspSz < cmdSz ||
+      *rspSz < TPM2_HEADER_SIZE)
+    return BAD_FUNC_ARG;
+
+  /* the response is read back into the command buffer */
+  if (rsp != cmd)
+    XMEMCPY(rsp, cmd, cmdSz);
+  packet.buf = rsp;
+  packet.pos = (int)cmdSz;
+  packet.size = (int)*rspSz;
+
+  rc = TPM2_TIS_SendCommand(ctx, &packet);
+  if (rc == TPM_RC_SUCCESS) {
+    XMEMCPY(&tmpSz, &rsp[2], sizeof(UINT32));
+    *rspSz = TPM2_Packet_SwapU32(tmpSz);
+  }
+
+  return rc;
+}
+
+#ifdef WOLFTPM_TIS_OFFLOAD
+/* Hands the whole command to the command callback and receives the complete
+ * response, falls back to the local TIS layer without a callback */
+int TPM2_TIS_OffloadCommand(TPM2_CTX *ctx, TPM2_Packet *packet) {
+  int rc;
+  UINT32 rspSz, tmpSz;
+
+  if (ctx == NULL || packet == NULL)
+    return BAD_FUNC_ARG;
+  if (ctx->cmdCb == NULL)
+    return TPM2_TIS_SendCommand(ctx, packet);
+
+#ifdef WOLFTPM_DEBUG_VERBOSE
+  printf("Command: %d\n", packet->pos);
+  TPM2_PrintBin(packet->buf, packet->pos);
+#endif
+
+  rspSz = (UINT32)packet->size;
+  rc = ctx->cmdCb(ctx, packet->buf, (UINT32)packet->pos, packet->buf, &rspSz,
+                  ctx->cmdCtx);
+  if (rc != TPM_RC_SUCCESS)
+    return rc;
+
+  /* the response must carry a header matching the returned size */
+  if (rspSz < TPM2_HEADER_SIZE || rspSz > (UINT32)packet->size)
+    return TPM_RC_FAILURE;
+  XMEMCPY(&tmpSz, &packet->buf[2], sizeof(UINT32));
+  if (TPM2_Packet_SwapU32(tmpSz) != rspSz)
+    return TPM_RC_FAILURE;
+
+#ifdef WOLFTPM_DEBUG_VERBOSE
+  printf("Response: %d\n", rspSz);
+  TPM2_PrintBin(packet->buf, rspSz);
+#endif
+
+  return TPM_RC_SUCCESS;
+}
+#endif /* WOLFTPM_TIS_OFFLOAD */
+
 /******************************************************************************/
 /* --- END TPM Interface Layer -- */
 /******************************************************************************/
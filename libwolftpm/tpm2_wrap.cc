@@ -27,13 +27,8 @@
 /* For some struct to buffer conversions */
 #include "wolftpm/tpm2_packet.h"
 
-#include "spi.h"
-#include <l4/re/env>
-#include <l4/re/error_helper>
-L4::Cap<SPI> spi;
-
 /* Local Functions */
-static int wolfTPM2_GetCapabilities_NoDev(WOLFTPM2_CAPS *cap);
+static int wolfTPM2_GetCapabilities_ex(TPM2_CTX *ctx, WOLFTPM2_CAPS *cap);
 static void wolfTPM2_CopySymmetric(TPMT_SYM_DEF *out, const TPMT_SYM_DEF *in);
 static void wolfTPM2_CopyName(TPM2B_NAME *out, const TPM2B_NAME *in);
 static void wolfTPM2_CopyAuth(TPM2B_AUTH *out, const TPM2B_AUTH *in);
@@ -77,7 +72,7 @@ static int wolfTPM2_Init_ex(TPM2_CTX *ctx, TPM2HalIoCb ioCb, void *userCtx,
   /* startup */
   XMEMSET(&startupIn, 0, sizeof(Startup_In));
   startupIn.startupType = TPM_SU_CLEAR;
-  rc = TPM2_Startup(&startupIn);
+  rc = TPM2_Startup_ex(ctx, &startupIn);
   if (rc != TPM_RC_SUCCESS &&
       rc != TPM_RC_INITIALIZE /* TPM_RC_INITIALIZE = Already started */) {
 #ifdef DEBUG_WOLFTPM
@@ -94,7 +89,7 @@ static int wolfTPM2_Init_ex(TPM2_CTX *ctx, TPM2HalIoCb ioCb, void *userCtx,
    * operations) */
   XMEMSET(&selfTest, 0, sizeof(selfTest));
   selfTest.fullTest = YES;
-  rc = TPM2_SelfTest(&selfTest);
+  rc = TPM2_SelfTest_ex(ctx, &selfTest);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_SelfTest failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -130,7 +125,7 @@ int wolfTPM2_Test(TPM2HalIoCb ioCb, void *userCtx, WOLFTPM2_CAPS *caps) {
 
   /* Optionally get and return capabilities */
   if (caps) {
-    rc = wolfTPM2_GetCapabilities_NoDev(caps);
+    rc = wolfTPM2_GetCapabilities_ex(&ctx, caps);
   }
 
   /* Perform cleanup */
@@ -148,9 +143,6 @@ int wolfTPM2_Init(WOLFTPM2_DEV *dev, TPM2HalIoCb ioCb, void *userCtx) {
   if (dev == NULL)
     return BAD_FUNC_ARG;
 
-  spi = L4Re::chkcap(L4Re::Env::env()->get_cap<SPI>("spi"),
-                     "failed to get spi cap");
-
   XMEMSET(dev, 0, sizeof(WOLFTPM2_DEV));
 
   rc = wolfTPM2_Init_ex(&dev->ctx, ioCb, userCtx, TPM_TIMEOUT_TRIES);
@@ -209,7 +201,7 @@ int wolfTPM2_SelfTest(WOLFTPM2_DEV *dev) {
   /* Full self test */
   XMEMSET(&selfTest, 0, sizeof(selfTest));
   selfTest.fullTest = YES;
-  rc = TPM2_SelfTest(&selfTest);
+  rc = TPM2_SelfTest_ex(&dev->ctx, &selfTest);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_SelfTest failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -308,7 +300,7 @@ static int wolfTPM2_ParseCapabilities(WOLFTPM2_CAPS *caps,
   return rc;
 }
 
-static int wolfTPM2_GetCapabilities_NoDev(WOLFTPM2_CAPS *cap) {
+static int wolfTPM2_GetCapabilities_ex(TPM2_CTX *ctx, WOLFTPM2_CAPS *cap) {
   int rc;
   GetCapability_In in;
   GetCapability_Out out;
@@ -324,7 +316,7 @@ static int wolfTPM2_GetCapabilities_NoDev(WOLFTPM2_CAPS *cap) {
   in.capability = TPM_CAP_TPM_PROPERTIES;
   in.property = TPM_PT_MANUFACTURER;
   in.propertyCount = 8;
-  rc = TPM2_GetCapability(&in, &out);
+  rc = TPM2_GetCapability_ex(ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_GetCapability failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -340,7 +332,7 @@ static int wolfTPM2_GetCapabilities_NoDev(WOLFTPM2_CAPS *cap) {
   in.capability = TPM_CAP_TPM_PROPERTIES;
   in.property = TPM_PT_MODES;
   in.propertyCount = 1;
-  rc = TPM2_GetCapability(&in, &out);
+  rc = TPM2_GetCapability_ex(ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_GetCapability failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -356,7 +348,7 @@ int wolfTPM2_GetCapabilities(WOLFTPM2_DEV *dev, WOLFTPM2_CAPS *cap) {
   if (dev == NULL)
     return BAD_FUNC_ARG;
 
-  return wolfTPM2_GetCapabilities_NoDev(cap);
+  return wolfTPM2_GetCapabilities_ex(&dev->ctx, cap);
 }
 
 int wolfTPM2_UnsetAuth(WOLFTPM2_DEV *dev, int index) {
@@ -367,9 +359,10 @@ int wolfTPM2_UnsetAuth(WOLFTPM2_DEV *dev, int index) {
   }
 
   session = &dev->session[index];
+  TPM2_SessionCache_Free(session);
   XMEMSET(session, 0, sizeof(TPM2_AUTH_SESSION));
 
-  return TPM2_SetSessionAuth(dev->session);
+  return TPM2_SetSessionAuth_ex(&dev->ctx, dev->session);
 }
 
 int wolfTPM2_SetAuth(WOLFTPM2_DEV *dev, int index, TPM_HANDLE sessionHandle,
@@ -382,6 +375,7 @@ int wolfTPM2_SetAuth(WOLFTPM2_DEV *dev, int index, TPM_HANDLE sessionHandle,
   }
 
   session = &dev->session[index];
+  TPM2_SessionCache_Free(session);
   XMEMSET(session, 0, sizeof(TPM2_AUTH_SESSION));
   session->sessionHandle = sessionHandle;
   session->sessionAttributes = sessionAttributes;
@@ -394,7 +388,7 @@ int wolfTPM2_SetAuth(WOLFTPM2_DEV *dev, int index, TPM_HANDLE sessionHandle,
     XMEMCPY(session->name.name, name->name, name->size);
   }
 
-  TPM2_SetSessionAuth(dev->session);
+  TPM2_SetSessionAuth_ex(&dev->ctx, dev->session);
 
   return TPM_RC_SUCCESS;
 }
@@ -443,6 +437,7 @@ int wolfTPM2_SetAuthSession(WOLFTPM2_DEV *dev, int index,
 
   if (tpmSession == NULL) {
     /* clearing auth session */
+    TPM2_SessionCache_Free(&dev->session[index]);
     XMEMSET(&dev->session[index], 0, sizeof(TPM2_AUTH_SESSION));
     return TPM_RC_SUCCESS;
   }
@@ -494,7 +489,7 @@ int wolfTPM2_CreateAuthSession_EkPolicy(WOLFTPM2_DEV *dev,
     XMEMSET(&policySecretIn, 0, sizeof(policySecretIn));
     policySecretIn.authHandle = TPM_RH_ENDORSEMENT;
     policySecretIn.policySession = tpmSession->handle.hndl;
-    rc = TPM2_PolicySecret(&policySecretIn, &policySecretOut);
+    rc = TPM2_PolicySecret_ex(&dev->ctx, &policySecretIn, &policySecretOut);
 #ifdef DEBUG_WOLFTPM
     if (rc == TPM_RC_SUCCESS) {
       printf("policySecret applied on session\n");
@@ -505,7 +500,7 @@ int wolfTPM2_CreateAuthSession_EkPolicy(WOLFTPM2_DEV *dev,
 }
 
 int wolfTPM2_Cleanup_ex(WOLFTPM2_DEV *dev, int doShutdown) {
-  int rc = 0;
+  int rc = 0, i;
 
   if (dev == NULL) {
     return BAD_FUNC_ARG;
@@ -523,7 +518,7 @@ int wolfTPM2_Cleanup_ex(WOLFTPM2_DEV *dev, int doShutdown) {
     Shutdown_In shutdownIn;
     XMEMSET(&shutdownIn, 0, sizeof(shutdownIn));
     shutdownIn.shutdownType = TPM_SU_CLEAR;
-    rc = TPM2_Shutdown(&shutdownIn);
+    rc = TPM2_Shutdown_ex(&dev->ctx, &shutdownIn);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_Shutdown failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -532,6 +527,9 @@ int wolfTPM2_Cleanup_ex(WOLFTPM2_DEV *dev, int doShutdown) {
     }
   }
 
+  for (i = 0; i < MAX_SESSION_NUM; i++) {
+    TPM2_SessionCache_Free(&dev->session[i]);
+  }
   TPM2_Cleanup(&dev->ctx);
 
   return rc;
@@ -637,7 +635,7 @@ int wolfTPM2_EncryptSalt(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *tpmKey,
   if (salt->size <= 0) {
     return TPM_RC_FAILURE;
   }
-  rc = TPM2_GetNonce(salt->buffer, salt->size);
+  rc = TPM2_GetNonce_ex(&dev->ctx, salt->buffer, salt->size);
   if (rc != 0) {
     return rc;
   }
@@ -728,7 +726,8 @@ int wolfTPM2_StartSession(WOLFTPM2_DEV *dev, WOLFTPM2_SESSION *session,
     authSesIn.symmetric.algorithm = TPM_ALG_NULL;
   }
   authSesIn.nonceCaller.size = hashDigestSz;
-  rc = TPM2_GetNonce(authSesIn.nonceCaller.buffer, authSesIn.nonceCaller.size);
+  rc = TPM2_GetNonce_ex(&dev->ctx, authSesIn.nonceCaller.buffer,
+                        authSesIn.nonceCaller.size);
   if (rc < 0) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_GetNonce failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -746,7 +745,7 @@ int wolfTPM2_StartSession(WOLFTPM2_DEV *dev, WOLFTPM2_SESSION *session,
     return rc;
   }
 
-  rc = TPM2_StartAuthSession(&authSesIn, &authSesOut);
+  rc = TPM2_StartAuthSession_ex(&dev->ctx, &authSesIn, &authSesOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_StartAuthSession failed %d: %s\n", rc,
@@ -849,7 +848,7 @@ int wolfTPM2_CreatePrimaryKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   }
   XMEMCPY(&createPriIn.inPublic.publicArea, publicTemplate,
           sizeof(TPMT_PUBLIC));
-  rc = TPM2_CreatePrimary(&createPriIn, &createPriOut);
+  rc = TPM2_CreatePrimary_ex(&dev->ctx, &createPriIn, &createPriOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_CreatePrimary: failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -897,7 +896,7 @@ int wolfTPM2_ChangeAuthKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
     XMEMCPY(changeIn.newAuth.buffer, auth, changeIn.newAuth.size);
   }
 
-  rc = TPM2_ObjectChangeAuth(&changeIn, &changeOut);
+  rc = TPM2_ObjectChangeAuth_ex(&dev->ctx, &changeIn, &changeOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_ObjectChangeAuth failed %d: %s\n", rc,
@@ -917,7 +916,7 @@ int wolfTPM2_ChangeAuthKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   loadIn.parentHandle = parent->hndl;
   wolfTPM2_CopyPriv(&loadIn.inPrivate, &changeOut.outPrivate);
   wolfTPM2_CopyPub(&loadIn.inPublic, &key->pub);
-  rc = TPM2_Load(&loadIn, &loadOut);
+  rc = TPM2_Load_ex(&dev->ctx, &loadIn, &loadOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Load key failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -972,7 +971,7 @@ int wolfTPM2_CreateKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEYBLOB *keyBlob,
     XMEMCPY(createIn.outsideInfo.buffer, createNonce, createIn.outsideInfo.size);
 #endif
 
-  rc = TPM2_Create(&createIn, &createOut);
+  rc = TPM2_Create_ex(&dev->ctx, &createIn, &createOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Create key failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -1016,7 +1015,7 @@ int wolfTPM2_LoadKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEYBLOB *keyBlob,
   loadIn.parentHandle = parent->hndl;
   wolfTPM2_CopyPriv(&loadIn.inPrivate, &keyBlob->priv);
   wolfTPM2_CopyPub(&loadIn.inPublic, &keyBlob->pub);
-  rc = TPM2_Load(&loadIn, &loadOut);
+  rc = TPM2_Load_ex(&dev->ctx, &loadIn, &loadOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Load key failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -1086,7 +1085,7 @@ int wolfTPM2_CreateLoadedKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEYBLOB *keyBlob,
   XMEMCPY(&createLoadedIn.inPublic.publicArea, publicTemplate,
           sizeof(TPMT_PUBLIC));
 
-  rc = TPM2_CreateLoaded(&createLoadedIn, &createLoadedOut);
+  rc = TPM2_CreateLoaded_ex(&dev->ctx, &createLoadedIn, &createLoadedOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_CreateLoaded key failed %d: %s\n", rc,
@@ -1129,7 +1128,7 @@ int wolfTPM2_LoadPublicKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   XMEMSET(&loadExtIn, 0, sizeof(loadExtIn));
   wolfTPM2_CopyPub(&loadExtIn.inPublic, pub);
   loadExtIn.hierarchy = TPM_RH_NULL;
-  rc = TPM2_LoadExternal(&loadExtIn, &loadExtOut);
+  rc = TPM2_LoadExternal_ex(&dev->ctx, &loadExtIn, &loadExtOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_LoadExternal: failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -1395,7 +1394,7 @@ int wolfTPM2_ImportPrivateKey(WOLFTPM2_DEV *dev, const WOLFTPM2_KEY *parentKey,
 #endif
     return rc;
   }
-  rc = TPM2_Import(&importIn, &importOut);
+  rc = TPM2_Import_ex(&dev->ctx, &importIn, &importOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Import: failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -1692,7 +1691,7 @@ int wolfTPM2_ReadPublicKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   /* Read public key */
   XMEMSET(&readPubIn, 0, sizeof(readPubIn));
   readPubIn.objectHandle = handle;
-  rc = TPM2_ReadPublic(&readPubIn, &readPubOut);
+  rc = TPM2_ReadPublic_ex(&dev->ctx, &readPubIn, &readPubOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_ReadPublic failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2061,7 +2060,7 @@ int wolfTPM2_NVStoreKey(WOLFTPM2_DEV *dev, TPM_HANDLE primaryHandle,
   in.objectHandle = key->handle.hndl;
   in.persistentHandle = persistentHandle;
 
-  rc = TPM2_EvictControl(&in);
+  rc = TPM2_EvictControl_ex(&dev->ctx, &in);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_EvictControl failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2102,7 +2101,7 @@ int wolfTPM2_NVDeleteKey(WOLFTPM2_DEV *dev, TPM_HANDLE primaryHandle,
   in.objectHandle = key->handle.hndl;
   in.persistentHandle = key->handle.hndl;
 
-  rc = TPM2_EvictControl(&in);
+  rc = TPM2_EvictControl_ex(&dev->ctx, &in);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_EvictControl failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2163,7 +2162,7 @@ int wolfTPM2_SignHashScheme(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   signIn.inScheme.details.any.hashAlg = hashAlg;
   signIn.validation.tag = TPM_ST_HASHCHECK;
   signIn.validation.hierarchy = TPM_RH_NULL;
-  rc = TPM2_Sign(&signIn, &signOut);
+  rc = TPM2_Sign_ex(&dev->ctx, &signIn, &signOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Sign failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2273,7 +2272,7 @@ int wolfTPM2_VerifyHashScheme(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
     XMEMCPY(verifySigIn.signature.signature.rsassa.sig.buffer, sig, sigSz);
   }
 
-  rc = TPM2_VerifySignature(&verifySigIn, &verifySigOut);
+  rc = TPM2_VerifySignature_ex(&dev->ctx, &verifySigIn, &verifySigOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_VerifySignature failed %d: %s\n", rc,
@@ -2367,7 +2366,7 @@ int wolfTPM2_ECDHGen(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *privKey,
 
   XMEMSET(&ecdhIn, 0, sizeof(ecdhIn));
   ecdhIn.keyHandle = privKey->handle.hndl;
-  rc = TPM2_ECDH_KeyGen(&ecdhIn, &ecdhOut);
+  rc = TPM2_ECDH_KeyGen_ex(&dev->ctx, &ecdhIn, &ecdhOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_ECDH_KeyGen failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2417,7 +2416,7 @@ int wolfTPM2_ECDHGenZ(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *privKey,
   XMEMSET(&ecdhZIn, 0, sizeof(ecdhZIn));
   ecdhZIn.keyHandle = privKey->handle.hndl;
   XMEMCPY(&ecdhZIn.inPoint.point, &pubPoint->point, sizeof(TPMS_ECC_POINT));
-  rc = TPM2_ECDH_ZGen(&ecdhZIn, &ecdhZOut);
+  rc = TPM2_ECDH_ZGen_ex(&dev->ctx, &ecdhZIn, &ecdhZOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_ECDH_ZGen failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2450,7 +2449,7 @@ int wolfTPM2_ECDHEGenKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *ecdhKey,
 
   XMEMSET(&in, 0, sizeof(in));
   in.curveID = curve_id;
-  rc = TPM2_EC_Ephemeral(&in, &out);
+  rc = TPM2_EC_Ephemeral_ex(&dev->ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_EC_Ephemeral failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2501,7 +2500,7 @@ int wolfTPM2_ECDHEGenZ(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *parentKey,
   inZGen2Ph.inScheme = TPM_ALG_ECDH;
   inZGen2Ph.counter = (UINT16)ecdhKey->handle.hndl;
 
-  rc = TPM2_ZGen_2Phase(&inZGen2Ph, &outZGen2Ph);
+  rc = TPM2_ZGen_2Phase_ex(&dev->ctx, &inZGen2Ph, &outZGen2Ph);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_ZGen_2Phase failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2551,7 +2550,7 @@ int wolfTPM2_RsaEncrypt(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
     XMEMCPY(rsaEncIn.label.buffer, label, rsaEncIn.label.size);
 #endif
 
-  rc = TPM2_RSA_Encrypt(&rsaEncIn, &rsaEncOut);
+  rc = TPM2_RSA_Encrypt_ex(&dev->ctx, &rsaEncIn, &rsaEncOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_RSA_Encrypt failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2601,7 +2600,7 @@ int wolfTPM2_RsaDecrypt(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
     XMEMCPY(rsaDecIn.label.buffer, label, rsaEncIn.label.size);
 #endif
 
-  rc = TPM2_RSA_Decrypt(&rsaDecIn, &rsaDecOut);
+  rc = TPM2_RSA_Decrypt_ex(&dev->ctx, &rsaDecIn, &rsaDecOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_RSA_Decrypt failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2635,7 +2634,7 @@ int wolfTPM2_ReadPCR(WOLFTPM2_DEV *dev, int pcrIndex, int hashAlg, byte *digest,
   }
 
   wolfTPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, hashAlg, pcrIndex);
-  rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+  rc = TPM2_PCR_Read_ex(&dev->ctx, &pcrReadIn, &pcrReadOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_PCR_Read failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2673,7 +2672,7 @@ int wolfTPM2_ExtendPCR(WOLFTPM2_DEV *dev, int pcrIndex, int hashAlg,
   pcrExtend.digests.count = 1;
   pcrExtend.digests.digests[0].hashAlg = hashAlg;
   XMEMCPY(pcrExtend.digests.digests[0].digest.H, digest, digestLen);
-  rc = TPM2_PCR_Extend(&pcrExtend);
+  rc = TPM2_PCR_Extend_ex(&dev->ctx, &pcrExtend);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_PCR_Extend failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -2687,8 +2686,281 @@ int wolfTPM2_ExtendPCR(WOLFTPM2_DEV *dev, int pcrIndex, int hashAlg,
   return rc;
 }
 
-int wolfTPM2_UnloadHandle(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *handle) {
+#ifdef WOLFTPM_SESSION_POOL
+/* wolfTPM2_SessionPool_Save layout, a header and count entries in host
+ * byte order. The entry size catches a different build. */
+#define WOLFTPM2_SESSION_POOL_MAGIC 0x57545350 /* WTSP */
+
+typedef struct WOLFTPM2_SESSION_POOL_HDR {
+  word32 magic;
+  word32 entrySz;
+  word32 count;
+} WOLFTPM2_SESSION_POOL_HDR;
+
+typedef struct WOLFTPM2_SESSION_POOL_SAVED {
+  word32 profile;
+  TPM_HANDLE tpmKey; /* handles the profile had when saved */
+  TPM_HANDLE bind;
+  word32 sesType;
+  int encDecAlg;
+  WOLFTPM2_SESSION session;
+  TPMS_CONTEXT context;
+} WOLFTPM2_SESSION_POOL_SAVED;
+
+static TPM_HANDLE wolfTPM2_SessionPool_Handle(const WOLFTPM2_HANDLE *handle) {
+  return (handle != NULL) ? handle->hndl : (TPM_HANDLE)TPM_RH_NULL;
+}
+
+/* wolfTPM2_StartSession for a profile, keeping the auth at index 0 it sets
+ * for the salt key. The session cache of index 0 moves to auth0 meanwhile,
+ * so StartSession does not free it. */
+static int wolfTPM2_SessionPool_Start(WOLFTPM2_SESSION_POOL *pool,
+                                      WOLFTPM2_SESSION_PROFILE *prof,
+                                      WOLFTPM2_SESSION *session) {
+  TPM2_AUTH_SESSION auth0 = pool->dev->session[0];
+  int rc;
+
+#ifdef WOLFTPM_SESSION_CACHE
+  XMEMSET(&pool->dev->session[0].cache, 0, sizeof(TPM2_SESSION_CACHE));
+#endif
+  rc = wolfTPM2_StartSession(pool->dev, session, prof->tpmKey, prof->bind,
+                             prof->sesType, prof->encDecAlg);
+  TPM2_SessionCache_Free(&pool->dev->session[0]);
+  pool->dev->session[0] = auth0;
+  TPM2_ForceZero(&auth0, sizeof(auth0));
+  return rc;
+}
+
+int wolfTPM2_SessionPool_Init(WOLFTPM2_DEV *dev, WOLFTPM2_SESSION_POOL *pool) {
+  if (dev == NULL || pool == NULL)
+    return BAD_FUNC_ARG;
+
+  XMEMSET(pool, 0, sizeof(WOLFTPM2_SESSION_POOL));
+  pool->dev = dev;
+  return TPM_RC_SUCCESS;
+}
+
+int wolfTPM2_SessionPool_AddProfile(WOLFTPM2_SESSION_POOL *pool,
+                                    WOLFTPM2_KEY *tpmKey,
+                                    WOLFTPM2_HANDLE *bind, TPM_SE sesType,
+                                    int encDecAlg, int depth) {
+  WOLFTPM2_SESSION_PROFILE *prof;
+
+  if (pool == NULL || pool->dev == NULL || depth < 0 ||
+      depth > TPM2_SESSION_POOL_DEPTH)
+    return BAD_FUNC_ARG;
+  if (pool->profileCount >= TPM2_SESSION_POOL_PROFILES)
+    return BUFFER_E;
+
+  prof = &pool->profile[pool->profileCount];
+  XMEMSET(prof, 0, sizeof(WOLFTPM2_SESSION_PROFILE));
+  prof->tpmKey = tpmKey;
+  prof->bind = bind;
+  prof->sesType = sesType;
+  prof->encDecAlg = encDecAlg;
+  prof->depth = depth;
+  return pool->profileCount++;
+}
+
+int wolfTPM2_SessionPool_Refill(WOLFTPM2_SESSION_POOL *pool) {
+  int rc = TPM_RC_SUCCESS;
+  int i;
+  WOLFTPM2_SESSION_PROFILE *prof;
+
+  if (pool == NULL || pool->dev == NULL)
+    return BAD_FUNC_ARG;
+
+  for (i = 0; i < pool->profileCount && rc == TPM_RC_SUCCESS; i++) {
+    prof = &pool->profile[i];
+    while (prof->count < prof->depth && rc == TPM_RC_SUCCESS) {
+      rc = wolfTPM2_SessionPool_Start(pool, prof, &prof->ready[prof->count]);
+      if (rc == TPM_RC_SUCCESS) {
+        prof->count++;
+        pool->stats.started++;
+      }
+    }
+  }
+  return rc;
+}
+
+int wolfTPM2_SessionPool_Get(WOLFTPM2_SESSION_POOL *pool, int profile,
+                             WOLFTPM2_SESSION *session) {
+  WOLFTPM2_SESSION_PROFILE *prof;
+
+  if (pool == NULL || pool->dev == NULL || session == NULL || profile < 0 ||
+      profile >= pool->profileCount)
+    return BAD_FUNC_ARG;
+
+  prof = &pool->profile[profile];
+  if (prof->count > 0) {
+    prof->count--;
+    *session = prof->ready[prof->count];
+    XMEMSET(&prof->ready[prof->count], 0, sizeof(WOLFTPM2_SESSION));
+    pool->stats.hits++;
+    return TPM_RC_SUCCESS;
+  }
+
+  pool->stats.misses++;
+  return wolfTPM2_SessionPool_Start(pool, prof, session);
+}
+
+int wolfTPM2_SessionPool_Save(WOLFTPM2_SESSION_POOL *pool, byte *buf,
+                              word32 *bufSz) {
+  int rc = TPM_RC_SUCCESS;
+  int i;
+  word32 count = 0, pos, needed;
+  WOLFTPM2_SESSION_PROFILE *prof;
+  WOLFTPM2_SESSION_POOL_HDR hdr;
+  WOLFTPM2_SESSION_POOL_SAVED saved;
+  ContextSave_In in;
+  ContextSave_Out out;
+
+  if (pool == NULL || pool->dev == NULL || bufSz == NULL)
+    return BAD_FUNC_ARG;
+
+  for (i = 0; i < pool->profileCount; i++)
+    count += pool->profile[i].count;
+  needed = sizeof(hdr) + count * sizeof(saved);
+  if (buf == NULL || *bufSz < needed) {
+    *bufSz = needed;
+    return BUFFER_E;
+  }
+
+  count = 0;
+  pos = sizeof(hdr);
+  for (i = 0; i < pool->profileCount && rc == TPM_RC_SUCCESS; i++) {
+    prof = &pool->profile[i];
+    while (prof->count > 0 && rc == TPM_RC_SUCCESS) {
+      XMEMSET(&in, 0, sizeof(in));
+      in.saveHandle = prof->ready[prof->count - 1].handle.hndl;
+      rc = TPM2_ContextSave_ex(&pool->dev->ctx, &in, &out);
+      if (rc != TPM_RC_SUCCESS) {
+#ifdef DEBUG_WOLFTPM
+        printf("TPM2_ContextSave failed %d: %s\n", rc,
+               wolfTPM2_GetRCString(rc));
+#endif
+        break;
+      }
+      prof->count--;
+      XMEMSET(&saved, 0, sizeof(saved));
+      saved.profile = (word32)i;
+      saved.tpmKey = wolfTPM2_SessionPool_Handle(
+          prof->tpmKey ? &prof->tpmKey->handle : NULL);
+      saved.bind = wolfTPM2_SessionPool_Handle(prof->bind);
+      saved.sesType = prof->sesType;
+      saved.encDecAlg = prof->encDecAlg;
+      saved.session = prof->ready[prof->count];
+      saved.context = out.context;
+      XMEMCPY(&buf[pos], &saved, sizeof(saved));
+      XMEMSET(&prof->ready[prof->count], 0, sizeof(WOLFTPM2_SESSION));
+      pos += sizeof(saved);
+      count++;
+      pool->stats.saved++;
+    }
+  }
+  XMEMSET(&saved, 0, sizeof(saved));
+
+  hdr.magic = WOLFTPM2_SESSION_POOL_MAGIC;
+  hdr.entrySz = sizeof(saved);
+  hdr.count = count;
+  XMEMCPY(buf, &hdr, sizeof(hdr));
+  *bufSz = pos;
+  return rc;
+}
+
+int wolfTPM2_SessionPool_Restore(WOLFTPM2_SESSION_POOL *pool, const byte *buf,
+                                 word32 bufSz) {
   int rc;
+  word32 i;
+  WOLFTPM2_SESSION_PROFILE *prof;
+  WOLFTPM2_SESSION_POOL_HDR hdr;
+  WOLFTPM2_SESSION_POOL_SAVED saved;
+  ContextLoad_In in;
+  ContextLoad_Out out;
+  FlushContext_In flushIn;
+
+  if (pool == NULL || pool->dev == NULL || buf == NULL)
+    return BAD_FUNC_ARG;
+
+  if (bufSz < sizeof(hdr))
+    return BUFFER_E;
+  XMEMCPY(&hdr, buf, sizeof(hdr));
+  if (hdr.magic != WOLFTPM2_SESSION_POOL_MAGIC ||
+      hdr.entrySz != sizeof(saved) ||
+      hdr.count > (bufSz - sizeof(hdr)) / sizeof(saved))
+    return BUFFER_E;
+
+  for (i = 0; i < hdr.count; i++) {
+    XMEMCPY(&saved, &buf[sizeof(hdr) + i * sizeof(saved)], sizeof(saved));
+
+    prof = NULL;
+    if (saved.profile < (word32)pool->profileCount) {
+      prof = &pool->profile[saved.profile];
+      if (saved.tpmKey != wolfTPM2_SessionPool_Handle(
+                              prof->tpmKey ? &prof->tpmKey->handle : NULL) ||
+          saved.bind != wolfTPM2_SessionPool_Handle(prof->bind) ||
+          saved.sesType != prof->sesType ||
+          saved.encDecAlg != prof->encDecAlg ||
+          prof->count >= TPM2_SESSION_POOL_DEPTH) {
+        prof = NULL;
+      }
+    }
+
+    /* a saved session keeps its slot in the TPM until it is loaded and
+     * flushed, so load it also when it has no place in the pool */
+    in.context = saved.context;
+    rc = TPM2_ContextLoad_ex(&pool->dev->ctx, &in, &out);
+    if (rc == TPM_RC_SUCCESS && prof != NULL) {
+      saved.session.handle.hndl = out.loadedHandle;
+      prof->ready[prof->count++] = saved.session;
+      pool->stats.restored++;
+    }
+    else {
+      /* saved.session.handle is a handle of the previous process, only the
+       * loaded handle belongs to this one. A context the TPM refused is gone
+       * already or not ours. */
+      if (rc == TPM_RC_SUCCESS) {
+        XMEMSET(&flushIn, 0, sizeof(flushIn));
+        flushIn.flushHandle = out.loadedHandle;
+        TPM2_FlushContext_ex(&pool->dev->ctx, &flushIn);
+      }
+      pool->stats.dropped++;
+    }
+  }
+  XMEMSET(&saved, 0, sizeof(saved));
+  return TPM_RC_SUCCESS;
+}
+
+int wolfTPM2_SessionPool_GetStats(WOLFTPM2_SESSION_POOL *pool,
+                                  WOLFTPM2_SESSION_POOL_STATS *stats) {
+  if (pool == NULL || stats == NULL)
+    return BAD_FUNC_ARG;
+
+  *stats = pool->stats;
+  return TPM_RC_SUCCESS;
+}
+
+int wolfTPM2_SessionPool_Cleanup(WOLFTPM2_SESSION_POOL *pool) {
+  int i;
+  WOLFTPM2_SESSION_PROFILE *prof;
+
+  if (pool == NULL)
+    return BAD_FUNC_ARG;
+
+  for (i = 0; i < pool->profileCount && pool->dev != NULL; i++) {
+    prof = &pool->profile[i];
+    while (prof->count > 0) {
+      prof->count--;
+      wolfTPM2_UnloadHandle(pool->dev, &prof->ready[prof->count].handle);
+    }
+  }
+  XMEMSET(pool, 0, sizeof(WOLFTPM2_SESSION_POOL));
+  return TPM_RC_SUCCESS;
+}
+#endif /* WOLFTPM_SESSION_POOL */
+
+int wolfTPM2_UnloadHandle(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *handle) {
+  int rc, i;
   FlushContext_In in;
 
   if (dev == NULL || handle == NULL)
@@ -2702,7 +2974,7 @@ int wolfTPM2_UnloadHandle(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *handle) {
 
   XMEMSET(&in, 0, sizeof(in));
   in.flushHandle = handle->hndl;
-  rc = TPM2_FlushContext(&in);
+  rc = TPM2_FlushContext_ex(&dev->ctx, &in);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_FlushContext failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2714,6 +2986,11 @@ int wolfTPM2_UnloadHandle(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *handle) {
   printf("TPM2_FlushContext: Closed handle 0x%x\n", (word32)handle->hndl);
 #endif
 
+  /* a flushed session is not used again, drop what it cached */
+  for (i = 0; i < MAX_SESSION_NUM; i++) {
+    if (dev->session[i].sessionHandle == handle->hndl)
+      TPM2_SessionCache_Free(&dev->session[i]);
+  }
   handle->hndl = TPM_RH_NULL;
 
   return TPM_RC_SUCCESS;
@@ -2748,7 +3025,7 @@ int wolfTPM2_NVCreateAuth(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *parent,
   in.publicInfo.nvPublic.attributes = nvAttributes;
   in.publicInfo.nvPublic.dataSize = (UINT16)maxSize;
 
-  rc = TPM2_NV_DefineSpace(&in);
+  rc = TPM2_NV_DefineSpace_ex(&dev->ctx, &in);
   if (rc == TPM_RC_NV_DEFINED) {
     alreadyExists = 1;
 #ifdef DEBUG_WOLFTPM
@@ -2857,7 +3134,7 @@ int wolfTPM2_NVWriteAuth(WOLFTPM2_DEV *dev, WOLFTPM2_NV *nv, word32 nvIndex,
     if (dataBuf)
       XMEMCPY(in.data.buffer, &dataBuf[pos], towrite);
 
-    rc = TPM2_NV_Write(&in);
+    rc = TPM2_NV_Write_ex(&dev->ctx, &in);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_NV_Write failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2943,7 +3220,7 @@ int wolfTPM2_NVReadAuth(WOLFTPM2_DEV *dev, WOLFTPM2_NV *nv, word32 nvIndex,
     in.offset = offset + pos;
     in.size = toread;
 
-    rc = TPM2_NV_Read(&in, &out);
+    rc = TPM2_NV_Read_ex(&dev->ctx, &in, &out);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_NV_Read failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -2994,7 +3271,7 @@ int wolfTPM2_NVReadPublic(WOLFTPM2_DEV *dev, word32 nvIndex,
 
   XMEMSET(&in, 0, sizeof(in));
   in.nvIndex = nvIndex;
-  rc = TPM2_NV_ReadPublic(&in, &out);
+  rc = TPM2_NV_ReadPublic_ex(&dev->ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_NV_ReadPublic failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -3040,7 +3317,7 @@ int wolfTPM2_NVDeleteAuth(WOLFTPM2_DEV *dev, WOLFTPM2_HANDLE *parent,
   in.authHandle = parent->hndl;
   in.nvIndex = nvIndex;
 
-  rc = TPM2_NV_UndefineSpace(&in);
+  rc = TPM2_NV_UndefineSpace_ex(&dev->ctx, &in);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_NV_UndefineSpace failed %d: %s\n", rc,
@@ -3094,7 +3371,7 @@ int wolfTPM2_GetRandom(WOLFTPM2_DEV *dev, byte *buf, word32 len) {
 
     XMEMSET(&in, 0, sizeof(in));
     in.bytesRequested = sz;
-    rc = TPM2_GetRandom(&in, &out);
+    rc = TPM2_GetRandom_ex(&dev->ctx, &in, &out);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_GetRandom failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -3127,7 +3404,7 @@ int wolfTPM2_Clear(WOLFTPM2_DEV *dev) {
   XMEMSET(&in, 0, sizeof(in));
   in.authHandle = TPM_RH_LOCKOUT;
 
-  rc = TPM2_Clear(&in);
+  rc = TPM2_Clear_ex(&dev->ctx, &in);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Clear failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -3165,7 +3442,7 @@ int wolfTPM2_HashStart(WOLFTPM2_DEV *dev, WOLFTPM2_HASH *hash,
   XMEMSET(&in, 0, sizeof(in));
   wolfTPM2_CopyAuth(&in.auth, &hash->handle.auth);
   in.hashAlg = hashAlg;
-  rc = TPM2_HashSequenceStart(&in, &out);
+  rc = TPM2_HashSequenceStart_ex(&dev->ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_HashSequenceStart failed 0x%x: %s\n", rc,
@@ -3210,7 +3487,7 @@ int wolfTPM2_HashUpdate(WOLFTPM2_DEV *dev, WOLFTPM2_HASH *hash,
 
     in.buffer.size = hashSz;
     XMEMCPY(in.buffer.buffer, &data[pos], hashSz);
-    rc = TPM2_SequenceUpdate(&in);
+    rc = TPM2_SequenceUpdate_ex(&dev->ctx, &in);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_SequenceUpdate failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -3247,7 +3524,7 @@ int wolfTPM2_HashFinish(WOLFTPM2_DEV *dev, WOLFTPM2_HASH *hash, byte *digest,
   XMEMSET(&in, 0, sizeof(in));
   in.sequenceHandle = hash->handle.hndl;
   in.hierarchy = TPM_RH_NULL;
-  rc = TPM2_SequenceComplete(&in, &out);
+  rc = TPM2_SequenceComplete_ex(&dev->ctx, &in, &out);
 
   /* mark hash handle as done */
   hash->handle.hndl = TPM_RH_NULL;
@@ -3398,7 +3675,7 @@ int wolfTPM2_LoadSymmetricKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key, int alg,
     goto exit;
 
   /* Load private key */
-  rc = TPM2_LoadExternal(&loadExtIn, &loadExtOut);
+  rc = TPM2_LoadExternal_ex(&dev->ctx, &loadExtIn, &loadExtOut);
   if (rc == TPM_RC_SUCCESS) {
     key->handle.hndl = loadExtOut.objectHandle;
     wolfTPM2_CopySymmetric(
@@ -3461,13 +3738,13 @@ int wolfTPM2_EncryptDecryptBlock(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   encDecIn.inData.size = (encDecIn.inData.size + MAX_AES_BLOCK_SIZE_BYTES - 1) &
                          ~(MAX_AES_BLOCK_SIZE_BYTES - 1);
 
-  rc = TPM2_EncryptDecrypt2(&encDecIn, &encDecOut);
+  rc = TPM2_EncryptDecrypt2_ex(&dev->ctx, &encDecIn, &encDecOut);
   if (rc == TPM_RC_COMMAND_CODE) { /* some TPM's may not support command */
     /* try to enable support */
     rc = wolfTPM2_SetCommand(dev, TPM_CC_EncryptDecrypt2, YES);
     if (rc == TPM_RC_SUCCESS) {
       /* try command again */
-      rc = TPM2_EncryptDecrypt2(&encDecIn, &encDecOut);
+      rc = TPM2_EncryptDecrypt2_ex(&dev->ctx, &encDecIn, &encDecOut);
     }
   }
 
@@ -3523,7 +3800,7 @@ int wolfTPM2_EncryptDecrypt(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
 int wolfTPM2_SetCommand(WOLFTPM2_DEV *dev, TPM_CC commandCode, int enableFlag) {
   int rc = TPM_RC_COMMAND_CODE; /* not supported */
 #if defined(WOLFTPM_ST33) || defined(WOLFTPM_AUTODETECT)
-  if (TPM2_GetVendorID() == TPM_VENDOR_STM) {
+  if (TPM2_GetVendorID_ex(&dev->ctx) == TPM_VENDOR_STM) {
     SetCommandSet_In in;
 
     /* Enable commands (like TPM2_EncryptDecrypt2) */
@@ -3531,7 +3808,7 @@ int wolfTPM2_SetCommand(WOLFTPM2_DEV *dev, TPM_CC commandCode, int enableFlag) {
     in.authHandle = TPM_RH_PLATFORM;
     in.commandCode = commandCode;
     in.enableFlag = enableFlag;
-    rc = TPM2_SetCommandSet(&in);
+    rc = TPM2_SetCommandSet_ex(&dev->ctx, &in);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_SetCommandSet failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -3593,7 +3870,7 @@ int wolfTPM2_LoadKeyedHashKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
     return rc;
   }
 
-  rc = TPM2_Create(&createIn, &createOut);
+  rc = TPM2_Create_ex(&dev->ctx, &createIn, &createOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Create key failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -3616,7 +3893,7 @@ int wolfTPM2_LoadKeyedHashKey(WOLFTPM2_DEV *dev, WOLFTPM2_KEY *key,
   loadIn.parentHandle = parent->hndl;
   wolfTPM2_CopyPriv(&loadIn.inPrivate, &createOut.outPrivate);
   wolfTPM2_CopyPub(&loadIn.inPublic, &key->pub);
-  rc = TPM2_Load(&loadIn, &loadOut);
+  rc = TPM2_Load_ex(&dev->ctx, &loadIn, &loadOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Load key failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -3674,7 +3951,7 @@ int wolfTPM2_HmacStart(WOLFTPM2_DEV *dev, WOLFTPM2_HMAC *hmac,
   in.handle = hmac->key.handle.hndl;
   wolfTPM2_CopyAuth(&in.auth, &hmac->hash.handle.auth);
   in.hashAlg = hashAlg;
-  rc = TPM2_HMAC_Start(&in, &out);
+  rc = TPM2_HMAC_Start_ex(&dev->ctx, &in, &out);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_HMAC_Start failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -3733,7 +4010,7 @@ int wolfTPM2_Shutdown(WOLFTPM2_DEV *dev, int doStartup) {
   /* shutdown */
   XMEMSET(&shutdownIn, 0, sizeof(shutdownIn));
   shutdownIn.shutdownType = TPM_SU_CLEAR;
-  rc = TPM2_Shutdown(&shutdownIn);
+  rc = TPM2_Shutdown_ex(&dev->ctx, &shutdownIn);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("TPM2_Shutdown failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
@@ -3744,7 +4021,7 @@ int wolfTPM2_Shutdown(WOLFTPM2_DEV *dev, int doStartup) {
   if (doStartup) {
     XMEMSET(&startupIn, 0, sizeof(startupIn));
     startupIn.startupType = TPM_SU_CLEAR;
-    rc = TPM2_Startup(&startupIn);
+    rc = TPM2_Startup_ex(&dev->ctx, &startupIn);
     if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
       printf("TPM2_Startup failed %d: %s\n", rc, wolfTPM2_GetRCString(rc));
@@ -4139,7 +4416,7 @@ int wolfTPM2_CreateKeySeal(WOLFTPM2_DEV *dev, WOLFTPM2_KEYBLOB *keyBlob,
   XMEMCPY(createIn.inSensitive.sensitive.data.buffer, sealData,
           createIn.inSensitive.sensitive.data.size);
 
-  rc = TPM2_Create(&createIn, &createOut);
+  rc = TPM2_Create_ex(&dev->ctx, &createIn, &createOut);
   if (rc != TPM_RC_SUCCESS) {
 #ifdef DEBUG_WOLFTPM
     printf("wolfTPM2_CreateKeySeal failed %d: %s\n", rc,
@@ -4458,7 +4735,12 @@ int wolfTPM2_CryptoDevCb(int devId, wc_CryptoInfo *info, void *ctx) {
 #ifdef DEBUG_WOLFTPM
     printf("CryptoDevCb RNG: Sz %d\n", info->rng.sz);
 #endif
+#ifdef WOLFTPM_HOST_DRBG
+    /* served by the host DRBG, seeded from the TPM */
+    rc = TPM2_GetNonce_ex(&tlsCtx->dev->ctx, info->rng.out, info->rng.sz);
+#else
     rc = wolfTPM2_GetRandom(tlsCtx->dev, info->rng.out, info->rng.sz);
+#endif
 #endif /* !WC_NO_RNG */
   }
 #if !defined(NO_RSA) || defined(HAVE_ECC)
@@ -110,7 +110,6 @@ int TPM2_IoCb(TPM2_CTX *ctx, int isRead, word32 addr, byte *buf, word16 size,
     txBuf[0] = TPM_TIS_WRITE | ((size & 0xFF) - 1);
     XMEMCPY(&txBuf[TPM_TIS_HEADER_SZ], buf, size);
   }
-  XMEMSET(rxBuf, 0, sizeof(rxBuf));
 
   ret = TPM2_IoCb_SPI(ctx, txBuf, rxBuf, size + TPM_TIS_HEADER_SZ, userCtx);
 
@@ -149,6 +148,20 @@ int TPM2_IoCb(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf, word16 xferSz,
   return ret;
 }
 
+/* Vectored IO Callback - batches several register transactions per call */
+int TPM2_IoVecCb(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                 const word16 *xferSz, word16 count, void *userCtx) {
+  int ret = TPM_RC_FAILURE;
+
+  ret = TPM2_IoVecCb_L4_SPI(ctx, txBuf, rxBuf, xferSz, count, userCtx);
+  #ifdef WOLFTPM_DEBUG
+  printf("TPM2_IoVecCb: Ret %d, Count %d\n", ret, count);
+  #endif
+  (void)ctx;
+
+  return ret;
+}
+
 #endif /* WOLFTPM_ADV_IO */
 #endif /* !(WOLFTPM_LINUX_DEV || WOLFTPM_SWTPM || WOLFTPM_WINAPI) */
 
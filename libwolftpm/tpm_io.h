@@ -63,6 +63,9 @@ int TPM2_IoCb(TPM2_CTX*, int isRead, word32 addr, byte* buf, word16 size,
 #else
 int TPM2_IoCb(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
     word16 xferSz, void* userCtx);
+/* Optional, set with TPM2_SetHalIoVecCb to batch register transactions */
+int TPM2_IoVecCb(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    const word16* xferSz, word16 count, void* userCtx);
 #endif
 #endif /* !(WOLFTPM_LINUX_DEV || WOLFTPM_SWTPM || WOLFTPM_WINAPI) */
 
@@ -82,6 +85,49 @@ int TPM2_IoCb_Atmel_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
 #elif defined(__BAREBOX__)
 int TPM2_IoCb_Barebox_SPI(TPM2_CTX* ctx, const byte* txBuf,
     byte* rxBuf, word16 xferSz, void* userCtx);
+#elif defined(L4API_l4f)
+/* Transport state of one TPM2_CTX. Pass a zeroed instance as userCtx to
+ * wolfTPM2_Init, the IRQ and command callbacks use ctx->userCtx when their
+ * own context is NULL. A NULL userCtx selects a process wide instance, which
+ * is only safe for programs with a single TPM2_CTX. The spi server keeps one
+ * shared ring per gate, contexts using the shm transport at the same time
+ * need a gate each. */
+typedef struct TPM2_L4_SPI_CTX {
+    const char* capName;    /* spi gate, NULL for "spi" */
+    unsigned long spi;      /* looked up on first use */
+    void*  shm;             /* Spi_shm_ring shared with the spi server */
+    unsigned long shmDs;
+    word32 shmNext;         /* next free ring slot */
+    int    shmFailed;
+    unsigned long irq;      /* IRQ registered with the spi server */
+    unsigned long irqThread; /* thread the IRQ is bound to */
+    int    irqFailed;
+    word32 ipcCount;
+} TPM2_L4_SPI_CTX;
+
+int TPM2_IoCb_L4_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    word16 xferSz, void* userCtx);
+int TPM2_IoVecCb_L4_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    const word16* xferSz, word16 count, void* userCtx);
+/* Same transfers through a dataspace shared with the spi server, pass to
+ * wolfTPM2_Init instead of TPM2_IoCb */
+int TPM2_IoCb_L4_SPI_Shm(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    word16 xferSz, void* userCtx);
+int TPM2_IoVecCb_L4_SPI_Shm(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
+    const word16* xferSz, word16 count, void* userCtx);
+/* Interrupt wait on the IRQ registered with the spi server, set with
+ * TPM2_SetHalIrqCb */
+int TPM2_IrqWaitCb_L4_SPI(TPM2_CTX* ctx, UINT32 timeoutMs, void* irqCtx);
+/* Command callback for WOLFTPM_TIS_OFFLOAD, set with TPM2_SetHalCmdCb */
+int TPM2_CmdCb_L4_SPI(TPM2_CTX* ctx, const byte* cmd, word32 cmdSz,
+    byte* rsp, word32* rspSz, void* cmdCtx);
+/* Number of SPI IPCs issued on userCtx, for measurements */
+word32 TPM2_IoCb_L4_SPI_IpcCount(void* userCtx);
+/* Largest frame of the spi server, set with TPM2_SetHalMaxFrame */
+word16 TPM2_IoCb_L4_SPI_MaxFrame(void* userCtx);
+/* Detaches the shared ring and frees the IRQ of userCtx, call after
+ * wolfTPM2_Cleanup */
+void TPM2_IoCb_L4_SPI_Cleanup(void* userCtx);
 #elif defined(__linux__)
 int TPM2_IoCb_Linux_SPI(TPM2_CTX* ctx, const byte* txBuf, byte* rxBuf,
     word16 xferSz, void* userCtx);
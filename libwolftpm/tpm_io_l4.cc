@@ -35,11 +35,62 @@
 #define TPM2_SPI_HZ TPM2_SPI_MAX_HZ
 #endif
 #include "spi.h"
+#include <l4/re/env>
+#include <l4/re/error_helper>
+#include <l4/re/mem_alloc>
+#include <l4/re/rm>
+#include <l4/re/util/cap_alloc>
+#include <l4/sys/irq>
+#include <pthread-l4.h>
 
-extern L4::Cap<SPI> spi;
+/* Payload budget of one transfer_vec IPC. The size table and the tx frames
+ * share the message registers, leave room for the array length words. */
+#ifndef TPM2_L4_SPI_VEC_MAX
+#define TPM2_L4_SPI_VEC_MAX                                                    \
+  ((L4_UTCB_GENERIC_DATA_SIZE - 4) * sizeof(l4_umword_t))
+#endif
+
+/* Used for a NULL userCtx, see TPM2_L4_SPI_CTX */
+static TPM2_L4_SPI_CTX gSpiDefault;
+
+static TPM2_L4_SPI_CTX *TPM2_L4_SPI_GetCtx(void *userCtx) {
+  if (userCtx == NULL)
+    return &gSpiDefault;
+  return static_cast<TPM2_L4_SPI_CTX *>(userCtx);
+}
+
+/* The spi capability is looked up on first use, so a TPM2_CTX using another
+ * HAL IO callback does not require it */
+static L4::Cap<SPI> TPM2_L4_GetSpi(TPM2_L4_SPI_CTX *spiCtx) {
+  if (spiCtx->spi == 0)
+    spiCtx->spi =
+        L4Re::chkcap(L4Re::Env::env()->get_cap<SPI>(
+                         spiCtx->capName != NULL ? spiCtx->capName : "spi"),
+                     "failed to get spi cap")
+            .cap();
+  return L4::Cap<SPI>(spiCtx->spi);
+}
+
+word32 TPM2_IoCb_L4_SPI_IpcCount(void *userCtx) {
+  return TPM2_L4_SPI_GetCtx(userCtx)->ipcCount;
+}
+
+/* Asks the spi server for its largest frame, servers without the call get
+ * the MAX_SPI_FRAMESIZE default. Pass the result to TPM2_SetHalMaxFrame. */
+word16 TPM2_IoCb_L4_SPI_MaxFrame(void *userCtx) {
+  TPM2_L4_SPI_CTX *spiCtx = TPM2_L4_SPI_GetCtx(userCtx);
+  l4_uint32_t size = 0;
+
+  spiCtx->ipcCount++;
+  if (TPM2_L4_GetSpi(spiCtx)->max_frame(&size) != L4_EOK || size == 0 ||
+      size > MAX_SPI_FRAMESIZE)
+    return MAX_SPI_FRAMESIZE;
+  return (word16)size;
+}
 
 int TPM2_IoCb_L4_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
                           word16 xferSz, void *userCtx) {
+  TPM2_L4_SPI_CTX *spiCtx = TPM2_L4_SPI_GetCtx(userCtx);
 
   L4::Ipc::Array<const l4_uint8_t, l4_uint32_t> send = 
       L4::Ipc::Array<const l4_uint8_t, l4_uint32_t>(xferSz,
@@ -48,7 +99,8 @@ int TPM2_IoCb_L4_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
       L4::Ipc::Array<l4_uint8_t, l4_uint32_t>(xferSz, 
                                               static_cast<unsigned char*>(rxBuf));
 
-  int ret = spi->transfer(send, recv, xferSz);
+  spiCtx->ipcCount++;
+  int ret = TPM2_L4_GetSpi(spiCtx)->transfer(send, recv, xferSz);
   
   if (ret != L4_EOK)
     return TPM_RC_FAILURE;
@@ -59,6 +111,296 @@ int TPM2_IoCb_L4_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
   return TPM_RC_SUCCESS;
 }
 
+/* Sends count frames with one transfer_vec IPC each time the message
+ * registers are full, all rx frames are copied back in order */
+int TPM2_IoVecCb_L4_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                        const word16 *xferSz, word16 count, void *userCtx) {
+  TPM2_L4_SPI_CTX *spiCtx = TPM2_L4_SPI_GetCtx(userCtx);
+  word16 first = 0, num;
+  word32 pos = 0, len;
+
+  while (first < count) {
+    /* collect as many frames as fit into one message */
+    num = 0;
+    len = 0;
+    while (first + num < count &&
+           len + xferSz[first + num] + (num + 1) * sizeof(l4_uint16_t) <=
+               TPM2_L4_SPI_VEC_MAX) {
+      len += xferSz[first + num];
+      num++;
+    }
+    if (num == 0)
+      return BAD_FUNC_ARG;
+
+    L4::Ipc::Array<const l4_uint16_t, l4_uint32_t> sizes(
+        num, static_cast<const l4_uint16_t *>(&xferSz[first]));
+    L4::Ipc::Array<const l4_uint8_t, l4_uint32_t> send(
+        len, static_cast<const unsigned char *>(&txBuf[pos]));
+    L4::Ipc::Array<l4_uint8_t, l4_uint32_t> recv(
+        len, static_cast<unsigned char *>(&rxBuf[pos]));
+
+    spiCtx->ipcCount++;
+    int ret = TPM2_L4_GetSpi(spiCtx)->transfer_vec(sizes, send, recv);
+    if (ret != L4_EOK || recv.length != len)
+      return TPM_RC_FAILURE;
+
+    first += num;
+    pos += len;
+  }
+
+  (void)ctx;
+
+  return TPM_RC_SUCCESS;
+}
+
+/* Shared memory transport: frames are placed in a dataspace shared with the
+ * spi server, the IPC only carries the slot range. Each TPM2_L4_SPI_CTX maps
+ * its own ring. */
+static int TPM2_L4_SPI_ShmSetup(TPM2_L4_SPI_CTX *spiCtx) {
+  L4Re::Env const *env = L4Re::Env::env();
+  L4::Cap<L4Re::Dataspace> ds;
+  l4_addr_t addr = 0;
+  long err;
+
+  if (spiCtx->shm != NULL)
+    return TPM_RC_SUCCESS;
+  if (spiCtx->shmFailed)
+    return TPM_RC_FAILURE;
+
+  ds = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
+  if (!ds.is_valid()) {
+    spiCtx->shmFailed = 1;
+    return TPM_RC_FAILURE;
+  }
+  err = env->mem_alloc()->alloc(sizeof(Spi_shm_ring), ds);
+  if (err >= 0)
+    err = env->rm()->attach(&addr, sizeof(Spi_shm_ring),
+                            L4Re::Rm::F::Search_addr | L4Re::Rm::F::RW,
+                            L4::Ipc::make_cap_rw(ds));
+  if (err >= 0)
+    err = TPM2_L4_GetSpi(spiCtx)->map_shm(ds);
+  if (err < 0) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_L4_SPI_ShmSetup: failed %ld, using array transfers\n", err);
+#endif
+    if (addr != 0)
+      env->rm()->detach(addr, 0);
+    L4Re::Util::cap_alloc.free(ds, env->task());
+    spiCtx->shmFailed = 1;
+    return TPM_RC_FAILURE;
+  }
+
+  spiCtx->shm = reinterpret_cast<void *>(addr);
+  spiCtx->shmDs = ds.cap();
+  spiCtx->shmNext = 0;
+  return TPM_RC_SUCCESS;
+}
+
+void TPM2_IoCb_L4_SPI_Cleanup(void *userCtx) {
+  TPM2_L4_SPI_CTX *spiCtx = TPM2_L4_SPI_GetCtx(userCtx);
+  L4Re::Env const *env = L4Re::Env::env();
+
+  if (spiCtx->shm != NULL) {
+    env->rm()->detach(reinterpret_cast<l4_addr_t>(spiCtx->shm), 0);
+    L4Re::Util::cap_alloc.free(L4::Cap<L4Re::Dataspace>(spiCtx->shmDs),
+                               env->task());
+    spiCtx->shm = NULL;
+    spiCtx->shmDs = 0;
+  }
+  if (spiCtx->irq != 0) {
+    L4::Cap<L4::Irq> irq(spiCtx->irq);
+
+    if (spiCtx->irqThread != 0)
+      irq->detach();
+    L4Re::Util::cap_alloc.free(irq, env->task());
+    spiCtx->irq = 0;
+    spiCtx->irqThread = 0;
+  }
+  spiCtx->shmNext = 0;
+  spiCtx->shmFailed = 0;
+  spiCtx->irqFailed = 0;
+}
+
+/* Runs count frames through the shared ring, one doorbell IPC per ring
+ * wrap. Falls back to the array transfers if the server has no shm support */
+int TPM2_IoVecCb_L4_SPI_Shm(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                            const word16 *xferSz, word16 count,
+                            void *userCtx) {
+  TPM2_L4_SPI_CTX *spiCtx = TPM2_L4_SPI_GetCtx(userCtx);
+  Spi_shm_ring *shm;
+  word16 i = 0, num;
+  word32 first, pos = 0, start;
+
+  for (num = 0; num < count; num++) {
+    if (xferSz[num] > Spi_shm_frame_max)
+      return BAD_FUNC_ARG;
+  }
+
+  if (TPM2_L4_SPI_ShmSetup(spiCtx) != TPM_RC_SUCCESS)
+    return TPM2_IoVecCb_L4_SPI(ctx, txBuf, rxBuf, xferSz, count, userCtx);
+  shm = static_cast<Spi_shm_ring *>(spiCtx->shm);
+
+  while (i < count) {
+    /* fill slots up to the end of the ring */
+    first = spiCtx->shmNext;
+    start = pos;
+    num = 0;
+    while (i + num < count && first + num < Spi_shm_slots) {
+      Spi_shm_desc *desc = &shm->desc[first + num];
+      desc->len = xferSz[i + num];
+      desc->flags = 0;
+      desc->status = -L4_EBUSY;
+      XMEMCPY(shm->data[first + num], &txBuf[pos], desc->len);
+      pos += desc->len;
+      num++;
+    }
+
+    spiCtx->ipcCount++;
+    int ret = TPM2_L4_GetSpi(spiCtx)->doorbell(first, num);
+    if (ret != L4_EOK)
+      return TPM_RC_FAILURE;
+
+    pos = start;
+    for (word16 j = 0; j < num; j++) {
+      Spi_shm_desc *desc = &shm->desc[first + j];
+      if (desc->status != L4_EOK)
+        return TPM_RC_FAILURE;
+      XMEMCPY(&rxBuf[pos], shm->data[first + j], xferSz[i + j]);
+      pos += xferSz[i + j];
+    }
+
+    i += num;
+    spiCtx->shmNext = (first + num) % Spi_shm_slots;
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+int TPM2_IoCb_L4_SPI_Shm(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                         word16 xferSz, void *userCtx) {
+  return TPM2_IoVecCb_L4_SPI_Shm(ctx, txBuf, rxBuf, &xferSz, 1, userCtx);
+}
+
+/* TPM interrupt forwarded by the spi server, one per TPM2_L4_SPI_CTX. The
+ * IRQ is bound to the thread that waits for it, a wait from another thread
+ * moves the binding. */
+static int TPM2_L4_SPI_IrqSetup(TPM2_L4_SPI_CTX *spiCtx) {
+  L4Re::Env const *env = L4Re::Env::env();
+  L4::Cap<L4::Irq> irq;
+  long err;
+
+  if (spiCtx->irq != 0)
+    return TPM_RC_SUCCESS;
+  if (spiCtx->irqFailed)
+    return TPM_RC_FAILURE;
+
+  irq = L4Re::Util::cap_alloc.alloc<L4::Irq>();
+  if (!irq.is_valid()) {
+    spiCtx->irqFailed = 1;
+    return TPM_RC_FAILURE;
+  }
+  err = l4_error(env->factory()->create(irq));
+  if (err >= 0)
+    err = TPM2_L4_GetSpi(spiCtx)->register_irq(irq);
+  if (err < 0) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_L4_SPI_IrqSetup: failed %ld, polling\n", err);
+#endif
+    L4Re::Util::cap_alloc.free(irq, env->task());
+    spiCtx->irqFailed = 1;
+    return TPM_RC_FAILURE;
+  }
+
+  spiCtx->irq = irq.cap();
+  spiCtx->irqThread = 0;
+  return TPM_RC_SUCCESS;
+}
+
+/* Binds the IRQ to the calling thread. An edge raised while the IRQ is
+ * moving is lost, the TIS layer rechecks the status after a timeout. */
+static int TPM2_L4_SPI_IrqBind(TPM2_L4_SPI_CTX *spiCtx) {
+  L4::Cap<L4::Irq> irq(spiCtx->irq);
+  l4_cap_idx_t self = pthread_l4_cap(pthread_self());
+  long err;
+
+  if (spiCtx->irqThread == self)
+    return TPM_RC_SUCCESS;
+
+  if (spiCtx->irqThread != 0)
+    irq->detach();
+  spiCtx->irqThread = 0;
+  err = l4_error(irq->bind_thread(L4::Cap<L4::Thread>(self), 0));
+  if (err < 0) {
+#ifdef DEBUG_WOLFTPM
+    printf("TPM2_L4_SPI_IrqBind: failed %ld, polling\n", err);
+#endif
+    return TPM_RC_FAILURE;
+  }
+
+  spiCtx->irqThread = self;
+  return TPM_RC_SUCCESS;
+}
+
+int TPM2_IrqWaitCb_L4_SPI(TPM2_CTX *ctx, UINT32 timeoutMs, void *irqCtx) {
+  TPM2_L4_SPI_CTX *spiCtx =
+      TPM2_L4_SPI_GetCtx(irqCtx != NULL ? irqCtx : ctx->userCtx);
+  l4_msgtag_t tag;
+  long err;
+
+  if (TPM2_L4_SPI_IrqSetup(spiCtx) != TPM_RC_SUCCESS ||
+      TPM2_L4_SPI_IrqBind(spiCtx) != TPM_RC_SUCCESS)
+    return TPM_RC_FAILURE;
+
+  tag = L4::Cap<L4::Irq>(spiCtx->irq)->receive(
+      l4_timeout(L4_IPC_TIMEOUT_NEVER, l4_timeout_from_us(timeoutMs * 1000)));
+  err = l4_ipc_error(tag, l4_utcb());
+  if (err == L4_IPC_RETIMEOUT)
+    return TPM_RC_TIMEOUT;
+  if (err != 0)
+    return TPM_RC_FAILURE;
+
+  return TPM_RC_SUCCESS;
+}
+
+/* Command callback for WOLFTPM_TIS_OFFLOAD: the spi server runs the TIS
+ * protocol and returns the response, one IPC per command */
+int TPM2_CmdCb_L4_SPI(TPM2_CTX *ctx, const byte *cmd, word32 cmdSz, byte *rsp,
+                      word32 *rspSz, void *cmdCtx) {
+  TPM2_L4_SPI_CTX *spiCtx;
+  Spi_shm_ring *shm;
+  int ret;
+
+  if (ctx == NULL || cmd == NULL || rsp == NULL || rspSz == NULL)
+    return BAD_FUNC_ARG;
+
+  spiCtx = TPM2_L4_SPI_GetCtx(cmdCtx != NULL ? cmdCtx : ctx->userCtx);
+  spiCtx->ipcCount++;
+  if (TPM2_L4_SPI_ShmSetup(spiCtx) == TPM_RC_SUCCESS &&
+      cmdSz <= sizeof(shm->data)) {
+    l4_uint32_t size = 0;
+
+    shm = static_cast<Spi_shm_ring *>(spiCtx->shm);
+    XMEMCPY(shm->data, cmd, cmdSz);
+    ret = TPM2_L4_GetSpi(spiCtx)->send_command_shm(cmdSz, &size);
+    if (ret != L4_EOK || size > *rspSz || size > sizeof(shm->data))
+      return TPM_RC_FAILURE;
+    XMEMCPY(rsp, shm->data, size);
+    *rspSz = size;
+  } else {
+    L4::Ipc::Array<const l4_uint8_t, l4_uint32_t> send(
+        cmdSz, static_cast<const unsigned char *>(cmd));
+    L4::Ipc::Array<l4_uint8_t, l4_uint32_t> recv(
+        *rspSz, static_cast<unsigned char *>(rsp));
+
+    ret = TPM2_L4_GetSpi(spiCtx)->send_command(send, recv);
+    if (ret != L4_EOK || recv.length > *rspSz)
+      return TPM_RC_FAILURE;
+    *rspSz = recv.length;
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
 /******************************************************************************/
 /* --- END IO Callback Logic -- */
 /******************************************************************************/
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <l4/sys/capability>
+#include <l4/sys/cxx/ipc_iface>
+#include <l4/sys/cxx/ipc_types>
+#include <l4/re/dataspace>
+
+enum
+{
+  VTPM_PROTO = 0x45
+};
+
+/* Size of the dataspace shared with map_shm. The client places a complete
+ * TPM TCP protocol TPM_SEND_COMMAND message (command, locality, size and the
+ * TPM command) at offset 0, the server replaces it with the response message
+ * (size, the TPM response and the acknowledge word). */
+enum
+{
+  Vtpm_shm_size = 0x2000,
+};
+
+struct VTPM : L4::Kobject_t<VTPM, L4::Kobject, VTPM_PROTO>
+{
+  /* Shares a dataspace of Vtpm_shm_size bytes with the server */
+  L4_INLINE_RPC(int, map_shm, (L4::Ipc::Cap<L4Re::Dataspace> ds));
+  /* Runs the cmd_size bytes message in the shared dataspace and returns the
+   * size of the response message */
+  L4_INLINE_RPC(int, command, (l4_uint32_t cmd_size, l4_uint32_t *rsp_size));
+  typedef L4::Typeid::Rpcs<map_shm_t, command_t> Rpcs;
+};
@@ -0,0 +1,696 @@
+/* tpm_io_mock.c
+ *
+ * Copyright (C) 2006-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfTPM.
+ *
+ * wolfTPM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfTPM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* In-process TIS emulator for measuring the IO pattern of the TIS layer */
+
+#include "tpm_io_mock.h"
+#include "wolftpm/tpm2_tis.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#ifndef WOLFTPM_ADV_IO
+
+/******************************************************************************/
+/* --- BEGIN Mock TIS Device -- */
+/******************************************************************************/
+
+/* register offsets within a locality */
+#define MOCK_REG_ACCESS 0x0000u
+#define MOCK_REG_INT_ENABLE 0x0008u
+#define MOCK_REG_INT_VECTOR 0x000Cu
+#define MOCK_REG_INT_STATUS 0x0010u
+#define MOCK_REG_INTF_CAPS 0x0014u
+#define MOCK_REG_STS 0x0018u
+#define MOCK_REG_BURST 0x0019u
+#define MOCK_REG_BURST_HI 0x001Au
+#define MOCK_REG_DATA_FIFO 0x0024u
+#define MOCK_REG_XDATA_FIFO 0x0080u
+#define MOCK_REG_DID_VID 0x0F00u
+#define MOCK_REG_RID 0x0F04u
+
+#define MOCK_ACCESS_VALID 0x80
+#define MOCK_ACCESS_ACTIVE 0x20
+#define MOCK_ACCESS_REQUEST_USE 0x02
+
+#define MOCK_STS_VALID 0x80
+#define MOCK_STS_COMMAND_READY 0x40
+#define MOCK_STS_GO 0x20
+#define MOCK_STS_DATA_AVAIL 0x10
+#define MOCK_STS_DATA_EXPECT 0x08
+
+#define MOCK_INT_DATA_AVAIL 0x01
+#define MOCK_INT_STS_VALID 0x02
+#define MOCK_INT_CMD_READY 0x80
+#define MOCK_INT_GLOBAL_ENABLE 0x80000000u
+#define MOCK_CAPS_BURST_STATIC 0x100
+
+/* default interface capabilities: all interrupts, 64 byte transfers */
+#define MOCK_DEFAULT_CAPS 0x000006FFu
+#define MOCK_DEFAULT_DID_VID 0x001B15D1u /* Infineon SLB9670 */
+
+/* handle counts of commands the mock answers with handles or sessions */
+typedef struct MockCmdHandles {
+  TPM_CC cc;
+  byte inHandles;
+  byte outHandles;
+} MockCmdHandles;
+
+static const MockCmdHandles gMockCmdHandles[] = {
+    {TPM_CC_CreatePrimary, 1, 1},    {TPM_CC_Create, 1, 0},
+    {TPM_CC_Load, 1, 1},             {TPM_CC_LoadExternal, 0, 1},
+    {TPM_CC_StartAuthSession, 2, 1}, {TPM_CC_ContextLoad, 0, 1},
+    {TPM_CC_ContextSave, 1, 0},      {TPM_CC_FlushContext, 0, 0},
+    {TPM_CC_PCR_Extend, 1, 0},       {TPM_CC_PCR_Reset, 1, 0},
+    {TPM_CC_NV_DefineSpace, 1, 0},   {TPM_CC_NV_UndefineSpace, 2, 0},
+    {TPM_CC_NV_Write, 2, 0},         {TPM_CC_NV_Read, 2, 0},
+    {TPM_CC_NV_Increment, 2, 0},     {TPM_CC_NV_ReadPublic, 1, 0},
+    {TPM_CC_Sign, 1, 0},             {TPM_CC_Unseal, 1, 0},
+    {TPM_CC_Quote, 1, 0},            {TPM_CC_ReadPublic, 1, 0},
+    {TPM_CC_EvictControl, 2, 0},     {TPM_CC_HMAC_Start, 1, 1},
+    {TPM_CC_HashSequenceStart, 0, 1}, {TPM_CC_SequenceUpdate, 1, 0},
+    {TPM_CC_SequenceComplete, 1, 0}, {TPM_CC_PolicyPCR, 1, 0},
+    {TPM_CC_PolicyGetDigest, 1, 0},  {TPM_CC_Clear, 1, 0},
+    {TPM_CC_CreateLoaded, 1, 1},     {TPM_CC_ObjectChangeAuth, 2, 0},
+    {TPM_CC_Certify, 2, 0},          {TPM_CC_RSA_Encrypt, 1, 0},
+    {TPM_CC_RSA_Decrypt, 1, 0},      {TPM_CC_ECDH_ZGen, 1, 0},
+    {TPM_CC_EventSequenceComplete, 2, 0},
+};
+
+static const MockCmdHandles *TPM2_Mock_GetHandles(TPM_CC cc) {
+  word32 i;
+  for (i = 0; i < sizeof(gMockCmdHandles) / sizeof(gMockCmdHandles[0]); i++) {
+    if (gMockCmdHandles[i].cc == cc)
+      return &gMockCmdHandles[i];
+  }
+  return NULL;
+}
+
+static word64 TPM2_Mock_TimeUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (word64)ts.tv_sec * 1000000ULL + (word64)ts.tv_nsec / 1000ULL;
+}
+
+static word32 TPM2_Mock_GetU32(const byte *b) {
+  return ((word32)b[0] << 24) | ((word32)b[1] << 16) | ((word32)b[2] << 8) |
+         (word32)b[3];
+}
+
+static word16 TPM2_Mock_GetU16(const byte *b) {
+  return (word16)(((word16)b[0] << 8) | (word16)b[1]);
+}
+
+static void TPM2_Mock_PutU32(TPM2_MOCK_TIS *mock, word32 val) {
+  mock->rsp[mock->rspSz++] = (byte)(val >> 24);
+  mock->rsp[mock->rspSz++] = (byte)(val >> 16);
+  mock->rsp[mock->rspSz++] = (byte)(val >> 8);
+  mock->rsp[mock->rspSz++] = (byte)val;
+}
+
+static void TPM2_Mock_PutU16(TPM2_MOCK_TIS *mock, word16 val) {
+  mock->rsp[mock->rspSz++] = (byte)(val >> 8);
+  mock->rsp[mock->rspSz++] = (byte)val;
+}
+
+/* Appends the response parameters for the executed command */
+static int TPM2_Mock_IsSession(word32 handle) {
+  return (handle & HR_RANGE_MASK) == HR_HMAC_SESSION ||
+         (handle & HR_RANGE_MASK) == HR_POLICY_SESSION;
+}
+
+static void TPM2_Mock_BuildParams(TPM2_MOCK_TIS *mock, TPM_CC cc,
+                                  const byte *param, int paramSz) {
+  word32 saved;
+  int i;
+
+  switch (cc) {
+  case TPM_CC_GetRandom: {
+    word16 req = (paramSz >= 2) ? TPM2_Mock_GetU16(param) : 0;
+    if (req > MAX_RNG_REQ_SIZE)
+      req = MAX_RNG_REQ_SIZE;
+    TPM2_Mock_PutU16(mock, req);
+    for (i = 0; i < req; i++)
+      mock->rsp[mock->rspSz++] = (byte)(mock->cmdCount + i);
+    break;
+  }
+  case TPM_CC_PCR_Read:
+    TPM2_Mock_PutU32(mock, mock->cmdCount); /* pcrUpdateCounter */
+    /* echo the selection and return one zero digest */
+    if (paramSz > 0 && mock->rspSz + paramSz < MAX_RESPONSE_SIZE) {
+      XMEMCPY(&mock->rsp[mock->rspSz], param, paramSz);
+      mock->rspSz += paramSz;
+    } else {
+      TPM2_Mock_PutU32(mock, 0);
+    }
+    TPM2_Mock_PutU32(mock, 1);
+    TPM2_Mock_PutU16(mock, TPM_SHA256_DIGEST_SIZE);
+    XMEMSET(&mock->rsp[mock->rspSz], 0, TPM_SHA256_DIGEST_SIZE);
+    mock->rspSz += TPM_SHA256_DIGEST_SIZE;
+    break;
+  case TPM_CC_GetCapability:
+    mock->rsp[mock->rspSz++] = NO; /* moreData */
+    TPM2_Mock_PutU32(mock, (paramSz >= 4) ? TPM2_Mock_GetU32(param) : 0);
+    TPM2_Mock_PutU32(mock, 0); /* empty list */
+    break;
+  case TPM_CC_StartAuthSession:
+    TPM2_Mock_PutU16(mock, TPM_SHA256_DIGEST_SIZE); /* nonceTPM */
+    for (i = 0; i < TPM_SHA256_DIGEST_SIZE; i++)
+      mock->rsp[mock->rspSz++] = (byte)(mock->cmdCount + i);
+    break;
+  case TPM_CC_NV_ReadPublic:
+    /* an index of 32 bytes with password auth, named with SHA-256 */
+    saved = TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE]);
+    TPM2_Mock_PutU16(mock, 14); /* nvPublic */
+    TPM2_Mock_PutU32(mock, saved);
+    TPM2_Mock_PutU16(mock, TPM_ALG_SHA256);
+    TPM2_Mock_PutU32(mock, TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD);
+    TPM2_Mock_PutU16(mock, 0); /* authPolicy */
+    TPM2_Mock_PutU16(mock, 32); /* dataSize */
+    TPM2_Mock_PutU16(mock, 2 + TPM_SHA256_DIGEST_SIZE); /* nvName */
+    TPM2_Mock_PutU16(mock, TPM_ALG_SHA256);
+    XMEMSET(&mock->rsp[mock->rspSz], 0, TPM_SHA256_DIGEST_SIZE);
+    mock->rspSz += TPM_SHA256_DIGEST_SIZE;
+    break;
+  case TPM_CC_ContextSave:
+    TPM2_Mock_PutU32(mock, 0); /* sequence */
+    TPM2_Mock_PutU32(mock, mock->cmdCount);
+    /* savedHandle, sessions keep their handle */
+    saved = TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE]);
+    TPM2_Mock_PutU32(mock, TPM2_Mock_IsSession(saved) ? saved
+                                                       : TRANSIENT_FIRST);
+    TPM2_Mock_PutU32(mock, TPM_RH_OWNER);
+    TPM2_Mock_PutU16(mock, TPM_SHA256_DIGEST_SIZE); /* contextBlob */
+    for (i = 0; i < TPM_SHA256_DIGEST_SIZE; i++)
+      mock->rsp[mock->rspSz++] = (byte)(mock->cmdCount + i);
+    break;
+  default:
+    break;
+  }
+}
+
+static int TPM2_Mock_Find(const word32 *slots, word32 handle) {
+  int i;
+  for (i = 0; i < TPM2_MOCK_MAX_OBJECTS; i++) {
+    if (slots[i] == handle)
+      return i;
+  }
+  return -1;
+}
+
+/* Moves handle into a free slot of the first max entries of slots */
+static int TPM2_Mock_Add(word32 *slots, word32 max, word32 handle) {
+  word32 i;
+  if (max > TPM2_MOCK_MAX_OBJECTS)
+    max = TPM2_MOCK_MAX_OBJECTS;
+  for (i = 0; i < max; i++) {
+    if (slots[i] == 0) {
+      slots[i] = handle;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void TPM2_Mock_Remove(word32 *slots, word32 handle) {
+  int i = TPM2_Mock_Find(slots, handle);
+  if (i >= 0)
+    slots[i] = 0;
+}
+
+/* Tracks the loaded transient objects if maxObjects is set and the sessions
+ * if maxSessions is set. auth holds the session handles of the auth area and
+ * authAttr their attributes, *handle receives the handle of a created object
+ * or session. Returns the response code. */
+static TPM_RC TPM2_Mock_Objects(TPM2_MOCK_TIS *mock, TPM_CC cc, int inHandles,
+                                int outHandles, const word32 *auth,
+                                const byte *authAttr, int authCnt,
+                                word32 *handle) {
+  word32 h = 0;
+  int i;
+
+  if (cc == TPM_CC_StartAuthSession)
+    *handle = HMAC_SESSION_FIRST + mock->cmdCount;
+  else
+    *handle = 0x80000000u + mock->cmdCount;
+
+  /* the flushHandle parameter is at the handle position */
+  if (cc == TPM_CC_FlushContext)
+    inHandles = 1;
+  for (i = 0; i < inHandles; i++) {
+    if (TPM2_HEADER_SIZE + (i + 1) * (int)sizeof(h) > mock->cmdPos)
+      return TPM_RC_COMMAND_SIZE;
+    h = TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE + i * sizeof(h)]);
+    if (mock->maxObjects > 0 && (h & HR_RANGE_MASK) == HR_TRANSIENT &&
+        TPM2_Mock_Find(mock->objects, h) < 0)
+      return TPM_RC_HANDLE;
+    if (mock->maxSessions > 0 && TPM2_Mock_IsSession(h) &&
+        TPM2_Mock_Find(mock->sessions, h) < 0 &&
+        !(cc == TPM_CC_FlushContext &&
+          TPM2_Mock_Find(mock->savedSessions, h) >= 0))
+      return TPM_RC_HANDLE;
+  }
+  for (i = 0; i < authCnt && mock->maxSessions > 0; i++) {
+    if (TPM2_Mock_IsSession(auth[i]) &&
+        TPM2_Mock_Find(mock->sessions, auth[i]) < 0)
+      return TPM_RC_HANDLE;
+  }
+
+  if (mock->maxSessions > 0) {
+    if (cc == TPM_CC_StartAuthSession &&
+        TPM2_Mock_Add(mock->sessions, mock->maxSessions, *handle) < 0)
+      return TPM_RC_SESSION_MEMORY;
+    if (cc == TPM_CC_ContextLoad && mock->cmdPos >= TPM2_HEADER_SIZE + 12) {
+      h = TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE + 8]);
+      if (TPM2_Mock_IsSession(h)) {
+        if (TPM2_Mock_Find(mock->savedSessions, h) < 0)
+          return TPM_RC_HANDLE;
+        if (TPM2_Mock_Add(mock->sessions, mock->maxSessions, h) < 0)
+          return TPM_RC_SESSION_MEMORY;
+        TPM2_Mock_Remove(mock->savedSessions, h);
+        *handle = h;
+        return TPM_RC_SUCCESS;
+      }
+    }
+    h = (inHandles > 0) ? TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE]) : 0;
+    if (cc == TPM_CC_ContextSave && TPM2_Mock_IsSession(h)) {
+      if (TPM2_Mock_Add(mock->savedSessions, TPM2_MOCK_MAX_OBJECTS, h) < 0)
+        return TPM_RC_CONTEXT_GAP;
+      TPM2_Mock_Remove(mock->sessions, h);
+    }
+    if (cc == TPM_CC_FlushContext && TPM2_Mock_IsSession(h)) {
+      TPM2_Mock_Remove(mock->sessions, h);
+      TPM2_Mock_Remove(mock->savedSessions, h);
+    }
+    for (i = 0; i < authCnt; i++) {
+      if (TPM2_Mock_IsSession(auth[i]) &&
+          (authAttr[i] & TPMA_SESSION_continueSession) == 0)
+        TPM2_Mock_Remove(mock->sessions, auth[i]);
+    }
+  }
+
+  if (mock->maxObjects > 0) {
+    h = (inHandles > 0) ? TPM2_Mock_GetU32(&mock->cmd[TPM2_HEADER_SIZE]) : 0;
+    if (cc == TPM_CC_FlushContext && (h & HR_RANGE_MASK) == HR_TRANSIENT)
+      TPM2_Mock_Remove(mock->objects, h);
+    if (outHandles > 0 && cc != TPM_CC_StartAuthSession &&
+        TPM2_Mock_Add(mock->objects, mock->maxObjects, *handle) < 0)
+      return TPM_RC_OBJECT_MEMORY;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+static void TPM2_Mock_Execute(TPM2_MOCK_TIS *mock) {
+  TPM_ST tag;
+  TPM_CC cc;
+  TPM_RC rc;
+  const MockCmdHandles *handles;
+  int inHandles = 0, outHandles = 0, authCnt = 0;
+  int pos, authEnd, paramPos, i;
+  word32 outHandle, auth[MAX_SESSION_NUM];
+  byte authAttr[MAX_SESSION_NUM];
+
+  mock->rspSz = 0;
+  mock->rspPos = 0;
+  if (mock->cmdPos < TPM2_HEADER_SIZE) {
+    TPM2_Mock_PutU16(mock, TPM_ST_NO_SESSIONS);
+    TPM2_Mock_PutU32(mock, TPM2_HEADER_SIZE);
+    TPM2_Mock_PutU32(mock, TPM_RC_COMMAND_SIZE);
+    return;
+  }
+  tag = TPM2_Mock_GetU16(&mock->cmd[0]);
+  cc = TPM2_Mock_GetU32(&mock->cmd[6]);
+
+  /* a busy TPM refuses some commands before running them */
+  if (mock->warnPct > 0) {
+    mock->warnSeed = mock->warnSeed * 1103515245u + 12345u;
+    if ((mock->warnSeed >> 16) % 100 < mock->warnPct) {
+      TPM2_Mock_PutU16(mock, TPM_ST_NO_SESSIONS);
+      TPM2_Mock_PutU32(mock, TPM2_HEADER_SIZE);
+      TPM2_Mock_PutU32(mock, mock->warnRc);
+      mock->warnings++;
+      return;
+    }
+  }
+
+  handles = TPM2_Mock_GetHandles(cc);
+  if (handles != NULL) {
+    inHandles = handles->inHandles;
+    outHandles = handles->outHandles;
+  }
+
+  /* locate the parameters, counting the sessions of the auth area */
+  paramPos = TPM2_HEADER_SIZE + inHandles * sizeof(TPM_HANDLE);
+  if (tag == TPM_ST_SESSIONS && paramPos + 4 <= mock->cmdPos) {
+    authEnd = paramPos + 4 + TPM2_Mock_GetU32(&mock->cmd[paramPos]);
+    pos = paramPos + 4;
+    while (pos + 9 <= authEnd && authEnd <= mock->cmdPos) {
+      if (authCnt < MAX_SESSION_NUM)
+        auth[authCnt] = TPM2_Mock_GetU32(&mock->cmd[pos]);
+      pos += 4;                                       /* handle */
+      pos += 2 + TPM2_Mock_GetU16(&mock->cmd[pos]);   /* nonce */
+      if (authCnt < MAX_SESSION_NUM && pos < authEnd)
+        authAttr[authCnt] = mock->cmd[pos];
+      pos += 1;                                       /* attributes */
+      pos += 2 + TPM2_Mock_GetU16(&mock->cmd[pos]);   /* hmac */
+      authCnt++;
+    }
+    paramPos = authEnd;
+  }
+  if (paramPos > mock->cmdPos)
+    paramPos = mock->cmdPos;
+
+  rc = TPM2_Mock_Objects(mock, cc, inHandles, outHandles, auth, authAttr,
+                         (authCnt < MAX_SESSION_NUM) ? authCnt
+                                                     : MAX_SESSION_NUM,
+                         &outHandle);
+  if (rc != TPM_RC_SUCCESS) {
+    TPM2_Mock_PutU16(mock, TPM_ST_NO_SESSIONS);
+    TPM2_Mock_PutU32(mock, TPM2_HEADER_SIZE);
+    TPM2_Mock_PutU32(mock, rc);
+    mock->cmdCount++;
+    return;
+  }
+
+  /* header is completed below */
+  mock->rspSz = TPM2_HEADER_SIZE;
+  for (i = 0; i < outHandles; i++)
+    TPM2_Mock_PutU32(mock, outHandle);
+  if (tag == TPM_ST_SESSIONS) {
+    int sizePos = mock->rspSz, paramStart;
+    mock->rspSz += 4;
+    paramStart = mock->rspSz;
+    TPM2_Mock_BuildParams(mock, cc, &mock->cmd[paramPos],
+                          mock->cmdPos - paramPos);
+    pos = mock->rspSz;
+    mock->rspSz = sizePos;
+    TPM2_Mock_PutU32(mock, pos - paramStart);
+    mock->rspSz = pos;
+    for (i = 0; i < authCnt; i++) {
+      TPM2_Mock_PutU16(mock, 0);                      /* nonce */
+      mock->rsp[mock->rspSz++] = TPMA_SESSION_continueSession;
+      TPM2_Mock_PutU16(mock, 0);                      /* hmac */
+    }
+  } else {
+    TPM2_Mock_BuildParams(mock, cc, &mock->cmd[paramPos],
+                          mock->cmdPos - paramPos);
+  }
+
+  pos = mock->rspSz;
+  mock->rspSz = 0;
+  TPM2_Mock_PutU16(mock, tag);
+  TPM2_Mock_PutU32(mock, pos);
+  TPM2_Mock_PutU32(mock, TPM_RC_SUCCESS);
+  mock->rspSz = pos;
+  mock->cmdCount++;
+}
+
+/* Advances a running command, returns the current status register */
+static byte TPM2_Mock_UpdateStatus(TPM2_MOCK_TIS *mock) {
+  if (mock->executing) {
+    if (mock->pollsLeft > 0)
+      mock->pollsLeft--;
+    if (mock->pollsLeft == 0 &&
+        TPM2_Mock_TimeUs() - mock->goTimeUs >= mock->execUs) {
+      TPM2_Mock_Execute(mock);
+      mock->executing = 0;
+      mock->sts = MOCK_STS_VALID | MOCK_STS_DATA_AVAIL;
+      mock->intStatus |= MOCK_INT_DATA_AVAIL | MOCK_INT_STS_VALID;
+    }
+  }
+  return mock->sts;
+}
+
+/* While a response is read a dynamic burst count is bounded by the bytes
+ * left in the FIFO, a static one always reports the FIFO size */
+static word16 TPM2_Mock_Burst(TPM2_MOCK_TIS *mock) {
+  int avail;
+
+  if (mock->executing)
+    return 0;
+  if ((mock->sts & MOCK_STS_DATA_AVAIL) &&
+      (mock->caps & MOCK_CAPS_BURST_STATIC) == 0) {
+    avail = mock->rspSz - mock->rspPos;
+    if (avail < mock->burstCount)
+      return (word16)avail;
+  }
+  return mock->burstCount;
+}
+
+static void TPM2_Mock_WriteStatus(TPM2_MOCK_TIS *mock, byte val) {
+  if (val & MOCK_STS_COMMAND_READY) {
+    mock->executing = 0;
+    mock->cmdPos = 0;
+    mock->rspSz = 0;
+    mock->rspPos = 0;
+    mock->sts = MOCK_STS_VALID | MOCK_STS_COMMAND_READY;
+    mock->intStatus |= MOCK_INT_CMD_READY;
+  } else if ((val & MOCK_STS_GO) && mock->cmdPos > 0 && !mock->executing &&
+             (mock->sts & MOCK_STS_DATA_EXPECT) == 0) {
+    mock->executing = 1;
+    mock->pollsLeft = mock->execPolls;
+    mock->goTimeUs = TPM2_Mock_TimeUs();
+    mock->sts = MOCK_STS_VALID;
+  }
+}
+
+static void TPM2_Mock_WriteFifo(TPM2_MOCK_TIS *mock, const byte *buf,
+                                int len) {
+  int cmdSz;
+
+  if (mock->cmdPos + len > (int)sizeof(mock->cmd))
+    len = (int)sizeof(mock->cmd) - mock->cmdPos;
+  XMEMCPY(&mock->cmd[mock->cmdPos], buf, len);
+  mock->cmdPos += len;
+
+  cmdSz = (mock->cmdPos >= 6) ? (int)TPM2_Mock_GetU32(&mock->cmd[2])
+                              : TPM2_HEADER_SIZE;
+  mock->sts = MOCK_STS_VALID;
+  if (mock->cmdPos < cmdSz)
+    mock->sts |= MOCK_STS_DATA_EXPECT;
+  mock->intStatus |= MOCK_INT_STS_VALID;
+}
+
+static void TPM2_Mock_ReadFifo(TPM2_MOCK_TIS *mock, byte *buf, int len) {
+  int avail = mock->rspSz - mock->rspPos;
+
+  if (len > avail) {
+    XMEMSET(&buf[avail > 0 ? avail : 0], 0xFF, len - (avail > 0 ? avail : 0));
+    len = avail > 0 ? avail : 0;
+  }
+  XMEMCPY(buf, &mock->rsp[mock->rspPos], len);
+  mock->rspPos += len;
+  if (mock->rspPos >= mock->rspSz)
+    mock->sts = MOCK_STS_VALID;
+}
+
+static void TPM2_Mock_ReadReg(TPM2_MOCK_TIS *mock, word32 reg, byte *buf,
+                              int len) {
+  word32 val = 0;
+  int i;
+
+  if (reg == MOCK_REG_DATA_FIFO || reg == MOCK_REG_XDATA_FIFO) {
+    TPM2_Mock_ReadFifo(mock, buf, len);
+    return;
+  }
+
+  /* registers are little endian */
+  switch (reg) {
+  case MOCK_REG_ACCESS:
+    val = mock->access;
+    break;
+  case MOCK_REG_INT_ENABLE:
+    val = mock->intEnable;
+    break;
+  case MOCK_REG_INT_STATUS:
+    val = mock->intStatus;
+    break;
+  case MOCK_REG_INTF_CAPS:
+    val = mock->caps;
+    break;
+  case MOCK_REG_STS:
+    mock->stsReads++;
+    val = TPM2_Mock_UpdateStatus(mock) |
+          ((word32)TPM2_Mock_Burst(mock) << 8);
+    break;
+  case MOCK_REG_BURST:
+    val = TPM2_Mock_Burst(mock);
+    break;
+  case MOCK_REG_DID_VID:
+    val = mock->didVid;
+    break;
+  default:
+    break;
+  }
+  for (i = 0; i < len; i++)
+    buf[i] = (i < 4) ? (byte)(val >> (8 * i)) : 0;
+}
+
+static void TPM2_Mock_WriteReg(TPM2_MOCK_TIS *mock, word32 reg,
+                               const byte *buf, int len) {
+  word32 val = 0;
+  int i;
+
+  if (reg == MOCK_REG_DATA_FIFO || reg == MOCK_REG_XDATA_FIFO) {
+    TPM2_Mock_WriteFifo(mock, buf, len);
+    return;
+  }
+
+  for (i = 0; i < len && i < 4; i++)
+    val |= (word32)buf[i] << (8 * i);
+  switch (reg) {
+  case MOCK_REG_ACCESS:
+    if (val & MOCK_ACCESS_REQUEST_USE)
+      mock->access = MOCK_ACCESS_VALID | MOCK_ACCESS_ACTIVE;
+    break;
+  case MOCK_REG_INT_ENABLE:
+    mock->intEnable = val;
+    break;
+  case MOCK_REG_INT_STATUS:
+    mock->intStatus &= ~val; /* write one to clear */
+    break;
+  case MOCK_REG_STS:
+    TPM2_Mock_WriteStatus(mock, (byte)val);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Decodes one SPI frame: header, 3 address bytes, payload */
+static int TPM2_Mock_Frame(TPM2_MOCK_TIS *mock, const byte *txBuf,
+                           byte *rxBuf, word16 xferSz) {
+  int len, isRead;
+  word32 reg;
+
+  if (xferSz < TPM_TIS_HEADER_SZ + 1)
+    return BAD_FUNC_ARG;
+  len = (txBuf[0] & 0x3F) + 1;
+  if (len != xferSz - TPM_TIS_HEADER_SZ)
+    return BAD_FUNC_ARG;
+  isRead = (txBuf[0] & TPM_TIS_READ) != 0;
+  /* locality bits are ignored, every locality maps to the same registers */
+  reg = (((word32)txBuf[2] << 8) | txBuf[3]) & 0x0FFFu;
+
+  /* the header is fully decoded, rxBuf may alias txBuf from here on */
+  XMEMSET(rxBuf, 0, TPM_TIS_HEADER_SZ);
+  rxBuf[TPM_TIS_HEADER_SZ - 1] = TPM_TIS_READY_MASK; /* no wait states */
+  if (isRead)
+    TPM2_Mock_ReadReg(mock, reg, &rxBuf[TPM_TIS_HEADER_SZ], len);
+  else
+    TPM2_Mock_WriteReg(mock, reg, &txBuf[TPM_TIS_HEADER_SZ], len);
+
+  mock->xfers++;
+  mock->xferBytes += len;
+  return TPM_RC_SUCCESS;
+}
+
+void TPM2_Mock_Init(TPM2_MOCK_TIS *mock) {
+  if (mock == NULL)
+    return;
+  XMEMSET(mock, 0, sizeof(*mock));
+  mock->caps = MOCK_DEFAULT_CAPS;
+  mock->didVid = MOCK_DEFAULT_DID_VID;
+  mock->burstCount = MAX_SPI_FRAMESIZE;
+  mock->execPolls = 1;
+  mock->access = MOCK_ACCESS_VALID;
+  mock->sts = MOCK_STS_VALID;
+}
+
+void TPM2_Mock_ResetStats(TPM2_MOCK_TIS *mock) {
+  if (mock == NULL)
+    return;
+  mock->ioCalls = 0;
+  mock->xfers = 0;
+  mock->stsReads = 0;
+  mock->xferBytes = 0;
+  mock->irqWaits = 0;
+  mock->warnings = 0;
+}
+
+int TPM2_IoCb_Mock_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                       word16 xferSz, void *userCtx) {
+  TPM2_MOCK_TIS *mock = (TPM2_MOCK_TIS *)userCtx;
+
+  if (mock == NULL || txBuf == NULL || rxBuf == NULL)
+    return BAD_FUNC_ARG;
+
+  mock->ioCalls++;
+  (void)ctx;
+
+  return TPM2_Mock_Frame(mock, txBuf, rxBuf, xferSz);
+}
+
+int TPM2_IoVecCb_Mock_SPI(TPM2_CTX *ctx, const byte *txBuf, byte *rxBuf,
+                          const word16 *xferSz, word16 count, void *userCtx) {
+  TPM2_MOCK_TIS *mock = (TPM2_MOCK_TIS *)userCtx;
+  int rc = TPM_RC_SUCCESS;
+  word32 pos = 0;
+  word16 i;
+
+  if (mock == NULL || txBuf == NULL || rxBuf == NULL || xferSz == NULL)
+    return BAD_FUNC_ARG;
+
+  mock->ioCalls++;
+  for (i = 0; i < count && rc == TPM_RC_SUCCESS; i++) {
+    rc = TPM2_Mock_Frame(mock, &txBuf[pos], &rxBuf[pos], xferSz[i]);
+    pos += xferSz[i];
+  }
+  (void)ctx;
+
+  return rc;
+}
+
+static int TPM2_Mock_IrqPending(TPM2_MOCK_TIS *mock) {
+  return (mock->intEnable & MOCK_INT_GLOBAL_ENABLE) &&
+         (mock->intStatus & mock->intEnable & 0xFF) != 0;
+}
+
+int TPM2_IrqWaitCb_Mock(TPM2_CTX *ctx, UINT32 timeoutMs, void *irqCtx) {
+  TPM2_MOCK_TIS *mock = (TPM2_MOCK_TIS *)irqCtx;
+  word64 now, done;
+
+  if (mock == NULL || (mock->intEnable & MOCK_INT_GLOBAL_ENABLE) == 0)
+    return TPM_RC_FAILURE;
+
+  mock->irqWaits++;
+  if (!TPM2_Mock_IrqPending(mock) && mock->executing) {
+    /* sleep for the remaining execution time instead of being polled */
+    now = TPM2_Mock_TimeUs();
+    done = mock->goTimeUs + mock->execUs;
+    if (done > now) {
+      if (done - now > (word64)timeoutMs * 1000)
+        done = now + (word64)timeoutMs * 1000;
+      usleep((useconds_t)(done - now));
+    }
+    mock->pollsLeft = 1;
+    TPM2_Mock_UpdateStatus(mock);
+  }
+  (void)ctx;
+
+  return TPM2_Mock_IrqPending(mock) ? TPM_RC_SUCCESS : TPM_RC_TIMEOUT;
+}
+
+/******************************************************************************/
+/* --- END Mock TIS Device -- */
+/******************************************************************************/
+
+#endif /* !WOLFTPM_ADV_IO */
@@ -0,0 +1,283 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_broker.h"
+#include "wolftpm/tpm2_packet.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+#ifndef TPM_SLOTS
+#define TPM_SLOTS 3
+#endif
+#ifndef CLIENTS
+#define CLIENTS 4
+#endif
+
+/* CLIENTS clients share one TPM through the broker, each with a primary key
+ * and an HMAC session of its own, on a TPM with TPM_SLOTS object and session
+ * slots. Every client signs NUM_OF_RUNS times as fast as it can, so the
+ * objects and sessions are swapped whenever the TPM goes to another client.
+ * Before that each client tries to use the session of its neighbour and a
+ * TPM handle outside its space, both have to fail. Runs once with equal
+ * priorities and once with priorities 1, 2, 4, ... and reports the share of
+ * each client while all were busy with the queueing latency. Needs
+ * WOLFTPM_BROKER in wolftpm/options.h. */
+#ifndef WOLFTPM_BROKER
+#error "enable WOLFTPM_BROKER in wolftpm/options.h"
+#endif
+
+typedef struct Client {
+    int id;
+    int priority;
+    TPM_HANDLE key;
+    TPM_HANDLE session;
+    unsigned long done[NUM_OF_RUNS];    /* completion times */
+    unsigned long latUs[NUM_OF_RUNS];   /* queueing plus execution */
+    int count;
+    int failed;
+} Client;
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static TPM2_BROKER broker;
+static Client client[CLIENTS];
+static pthread_barrier_t barrier;
+static int leaks;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int put16(byte* buf, int pos, word32 v) {
+    buf[pos] = (byte)(v >> 8);
+    buf[pos + 1] = (byte)v;
+    return pos + 2;
+}
+
+static int put32(byte* buf, int pos, word32 v) {
+    pos = put16(buf, pos, v >> 16);
+    return put16(buf, pos, v);
+}
+
+static word32 get32(const byte* buf) {
+    return ((word32)buf[0] << 24) | ((word32)buf[1] << 16) |
+        ((word32)buf[2] << 8) | buf[3];
+}
+
+/* empty command header, the size is set by run_cmd */
+static int header(byte* buf, TPM_ST tag, TPM_CC cc) {
+    int pos = put16(buf, 0, tag);
+    pos = put32(buf, pos, 0);
+    return put32(buf, pos, cc);
+}
+
+/* auth area with one session, zero nonce and HMAC of digestSz bytes */
+static int auth(byte* buf, int pos, TPM_HANDLE session, int digestSz) {
+    int i;
+    pos = put32(buf, pos, 4 + 2 + digestSz + 1 + 2 + digestSz);
+    pos = put32(buf, pos, session);
+    pos = put16(buf, pos, digestSz);
+    for (i = 0; i < digestSz; i++)
+        buf[pos++] = 0;
+    buf[pos++] = TPMA_SESSION_continueSession;
+    pos = put16(buf, pos, digestSz);
+    for (i = 0; i < digestSz; i++)
+        buf[pos++] = 0;
+    return pos;
+}
+
+static TPM_RC run_cmd(Client* c, byte* cmd, int cmdSz, TPM_HANDLE* handle) {
+    byte rsp[MAX_RESPONSE_SIZE];
+    word32 rspSz = sizeof(rsp);
+    TPM_RC rc;
+
+    put32(cmd, 2, cmdSz);
+    rc = TPM2_Broker_Command(&broker, c->id, cmd, cmdSz, rsp, &rspSz);
+    if (rc == TPM_RC_SUCCESS)
+        rc = get32(&rsp[6]);
+    if (rc == TPM_RC_SUCCESS && handle != NULL)
+        *handle = get32(&rsp[TPM2_HEADER_SIZE]);
+    return rc;
+}
+
+static TPM_RC create_primary(Client* c) {
+    byte cmd[64];
+    int pos = header(cmd, TPM_ST_SESSIONS, TPM_CC_CreatePrimary);
+    pos = put32(cmd, pos, TPM_RH_OWNER);
+    pos = auth(cmd, pos, TPM_RS_PW, 0);
+    pos = put16(cmd, pos, 4);           /* inSensitive */
+    pos = put32(cmd, pos, 0);
+    pos = put16(cmd, pos, 0);           /* inPublic */
+    pos = put16(cmd, pos, 0);           /* outsideInfo */
+    pos = put32(cmd, pos, 0);           /* creationPCR */
+    return run_cmd(c, cmd, pos, &c->key);
+}
+
+static TPM_RC start_session(Client* c) {
+    byte cmd[64];
+    int i;
+    int pos = header(cmd, TPM_ST_NO_SESSIONS, TPM_CC_StartAuthSession);
+    pos = put32(cmd, pos, TPM_RH_NULL); /* tpmKey */
+    pos = put32(cmd, pos, TPM_RH_NULL); /* bind */
+    pos = put16(cmd, pos, TPM_SHA256_DIGEST_SIZE);
+    for (i = 0; i < TPM_SHA256_DIGEST_SIZE; i++)
+        cmd[pos++] = (byte)(c->id + i);
+    pos = put16(cmd, pos, 0);           /* encryptedSalt */
+    cmd[pos++] = TPM_SE_HMAC;
+    pos = put16(cmd, pos, TPM_ALG_NULL);
+    pos = put16(cmd, pos, TPM_ALG_SHA256);
+    return run_cmd(c, cmd, pos, &c->session);
+}
+
+static TPM_RC sign(Client* c, TPM_HANDLE key, TPM_HANDLE session) {
+    byte cmd[160];
+    int i;
+    int pos = header(cmd, TPM_ST_SESSIONS, TPM_CC_Sign);
+    pos = put32(cmd, pos, key);
+    pos = auth(cmd, pos, session, TPM_SHA256_DIGEST_SIZE);
+    pos = put16(cmd, pos, TPM_SHA256_DIGEST_SIZE);
+    for (i = 0; i < TPM_SHA256_DIGEST_SIZE; i++)
+        cmd[pos++] = (byte)i;
+    pos = put16(cmd, pos, TPM_ALG_NULL); /* inScheme */
+    pos = put16(cmd, pos, TPM_ST_HASHCHECK);
+    pos = put32(cmd, pos, TPM_RH_NULL);
+    pos = put16(cmd, pos, 0);
+    return run_cmd(c, cmd, pos, NULL);
+}
+
+static void* worker(void* arg) {
+    Client* c = (Client*)arg;
+    Client* other = &client[(c->id + 1) % CLIENTS];
+    unsigned long start;
+    TPM_RC rc;
+
+    rc = create_primary(c);
+    if (rc == TPM_RC_SUCCESS)
+        rc = start_session(c);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("client %d setup failed 0x%x\n", c->id, rc);
+        c->failed++;
+    }
+    pthread_barrier_wait(&barrier);
+
+    /* neither the session of another client nor a TPM handle may work */
+    if (sign(c, c->key, other->session) == TPM_RC_SUCCESS)
+        c->failed++;
+    if (sign(c, 0x80000000u + (word32)c->id, c->session) == TPM_RC_SUCCESS)
+        c->failed++;
+    pthread_barrier_wait(&barrier);
+
+    for (c->count = 0; c->count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS;
+            c->count++) {
+        start = now_ns();
+        rc = sign(c, c->key, c->session);
+        c->done[c->count] = now_ns();
+        c->latUs[c->count] = (c->done[c->count] - start) / 1000;
+    }
+    if (rc != TPM_RC_SUCCESS) {
+        printf("client %d sign failed 0x%x\n", c->id, rc);
+        c->failed++;
+    }
+    return NULL;
+}
+
+static int cmp_ul(const void* a, const void* b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char* name, int mixed) {
+    pthread_t tid[CLIENTS];
+    TPM2_BROKER_STATS stats;
+    unsigned long start, duration, firstDone = 0;
+    word32 cmds;
+    int i, j, busy, busyTotal = 0;
+
+    TPM2_Broker_Init(&broker, &dev.ctx);
+    pthread_barrier_init(&barrier, NULL, CLIENTS);
+    for (i = 0; i < CLIENTS; i++) {
+        XMEMSET(&client[i], 0, sizeof(Client));
+        client[i].priority = mixed ? (1 << i) : 1;
+        TPM2_Broker_Open(&broker, client[i].priority, &client[i].id);
+    }
+
+    cmds = mock.cmdCount;
+    start = now_ns();
+    for (i = 0; i < CLIENTS; i++)
+        pthread_create(&tid[i], NULL, worker, &client[i]);
+    for (i = 0; i < CLIENTS; i++)
+        pthread_join(tid[i], NULL);
+    duration = now_ns() - start;
+
+    /* share while every client had commands queued */
+    for (i = 0; i < CLIENTS; i++) {
+        if (client[i].count > 0 &&
+                (firstDone == 0 ||
+                 client[i].done[client[i].count - 1] < firstDone))
+            firstDone = client[i].done[client[i].count - 1];
+    }
+    for (i = 0; i < CLIENTS; i++) {
+        for (j = 0; j < client[i].count && client[i].done[j] <= firstDone; j++)
+            ;
+        busyTotal += j;
+    }
+
+    printf("%s: clients = %d, cmds/s = %lu, tpm cmds/cmd = %u.%02u;\n", name,
+        CLIENTS, (1000000000UL * CLIENTS * NUM_OF_RUNS) / duration,
+        (mock.cmdCount - cmds) / (CLIENTS * NUM_OF_RUNS),
+        ((mock.cmdCount - cmds) * 100 / (CLIENTS * NUM_OF_RUNS)) % 100);
+    for (i = 0; i < CLIENTS; i++) {
+        Client* c = &client[i];
+        for (busy = 0; busy < c->count && c->done[busy] <= firstDone; busy++)
+            ;
+        TPM2_Broker_GetStats(&broker, c->id, &stats);
+        qsort(c->latUs, c->count, sizeof(c->latUs[0]), cmp_ul);
+        printf("  client %d, priority = %d, share = %d%%, p50 us = %lu, "
+            "p99 us = %lu, max wait us = %u, swaps = %u, failed = %d;\n",
+            c->id, c->priority, busyTotal ? busy * 100 / busyTotal : 0,
+            c->count ? c->latUs[c->count / 2] : 0,
+            c->count ? c->latUs[c->count * 99 / 100] : 0,
+            stats.maxWaitUs, stats.swaps, c->failed);
+    }
+
+    TPM2_Broker_Cleanup(&broker);
+    pthread_barrier_destroy(&barrier);
+    for (i = 0; i < TPM2_MOCK_MAX_OBJECTS; i++) {
+        if (mock.objects[i] != 0 || mock.sessions[i] != 0 ||
+                mock.savedSessions[i] != 0)
+            leaks++;
+    }
+    printf("  left in the tpm after close = %d;\n", leaks);
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    mock.maxObjects = TPM_SLOTS;
+    mock.maxSessions = TPM_SLOTS;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run("equal", 0);
+    run("mixed", 1);
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+#ifndef BULK_THREADS
+#define BULK_THREADS 4
+#endif
+#ifndef BULK_SZ
+#define BULK_SZ (64 * 1024)
+#endif
+#ifndef THINK_US
+#define THINK_US 1000
+#endif
+
+/* A TLS server signs NUM_OF_RUNS handshakes, THINK_US apart, while
+ * BULK_THREADS threads hash BULK_SZ buffers through wolfTPM2_HashUpdate on
+ * the same context, one SequenceUpdate per chunk. In FIFO order a sign waits
+ * for a chunk of every bulk thread, with the bulk threads at TPM2_PRIO_BULK
+ * and the signer at TPM2_PRIO_HIGH it waits for the chunk that is running
+ * only. Reports the sign latency and the hash throughput. Needs
+ * WOLFTPM_CMD_PRIORITY in wolftpm/options.h. */
+#ifndef WOLFTPM_CMD_PRIORITY
+#error "enable WOLFTPM_CMD_PRIORITY in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static byte bulk[BULK_SZ];
+static unsigned long latUs[NUM_OF_RUNS];
+static volatile int stop;
+static volatile unsigned long chunks;
+static int failed;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static void* bulk_worker(void* arg) {
+    WOLFTPM2_HASH hash;
+    TPM2_CMD_PRIO prio = *(TPM2_CMD_PRIO*)arg;
+    int rc;
+
+    rc = TPM2_SetCmdPriority(&dev.ctx, prio);
+    if (rc == TPM_RC_SUCCESS)
+        rc = wolfTPM2_HashStart(&dev, &hash, TPM_ALG_SHA256, NULL, 0);
+    while (rc == TPM_RC_SUCCESS && !stop) {
+        rc = wolfTPM2_HashUpdate(&dev, &hash, bulk, sizeof(bulk));
+        __sync_fetch_and_add(&chunks,
+            (sizeof(bulk) + MAX_DIGEST_BUFFER - 1) / MAX_DIGEST_BUFFER);
+    }
+    if (rc != TPM_RC_SUCCESS) {
+        printf("hash failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        __sync_fetch_and_add(&failed, 1);
+    }
+    return NULL;
+}
+
+static int cmp_ul(const void* a, const void* b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char* name, int bulkThreads, TPM2_CMD_PRIO signPrio,
+    TPM2_CMD_PRIO bulkPrio) {
+    pthread_t tid[BULK_THREADS];
+    Sign_In sign;
+    Sign_Out signOut;
+    unsigned long start, duration;
+    int i, rc = TPM_RC_SUCCESS;
+
+    stop = 0;
+    chunks = 0;
+    failed = 0;
+    for (i = 0; i < bulkThreads; i++)
+        pthread_create(&tid[i], NULL, bulk_worker, &bulkPrio);
+
+    XMEMSET(&sign, 0, sizeof(sign));
+    sign.keyHandle = TRANSIENT_FIRST;
+    sign.digest.size = TPM_SHA256_DIGEST_SIZE;
+    sign.inScheme.scheme = TPM_ALG_NULL;
+    sign.validation.tag = TPM_ST_HASHCHECK;
+    sign.validation.hierarchy = TPM_RH_NULL;
+    TPM2_SetCmdPriority(&dev.ctx, signPrio);
+    start = now_ns();
+    for (i = 0; i < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; i++) {
+        unsigned long t = now_ns();
+        rc = TPM2_Sign_ex(&dev.ctx, &sign, &signOut);
+        latUs[i] = (now_ns() - t) / 1000;
+        usleep(THINK_US);
+    }
+    duration = now_ns() - start;
+    stop = 1;
+    for (i = 0; i < bulkThreads; i++)
+        pthread_join(tid[i], NULL);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("sign failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        failed++;
+    }
+
+    qsort(latUs, NUM_OF_RUNS, sizeof(latUs[0]), cmp_ul);
+    printf("%s, bulk threads = %d, sign p50 us = %lu, p99 us = %lu, "
+        "max us = %lu, hash KiB/s = %lu, failed = %d;\n", name, bulkThreads,
+        latUs[NUM_OF_RUNS / 2], latUs[NUM_OF_RUNS * 99 / 100],
+        latUs[NUM_OF_RUNS - 1],
+        chunks * MAX_DIGEST_BUFFER / 1024 * 1000000000UL / duration, failed);
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run("idle", 0, TPM2_PRIO_NORMAL, TPM2_PRIO_NORMAL);
+    run("fifo", 1, TPM2_PRIO_NORMAL, TPM2_PRIO_NORMAL);
+    run("priority", 1, TPM2_PRIO_HIGH, TPM2_PRIO_BULK);
+    run("fifo", BULK_THREADS, TPM2_PRIO_NORMAL, TPM2_PRIO_NORMAL);
+    run("priority", BULK_THREADS, TPM2_PRIO_HIGH, TPM2_PRIO_BULK);
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_coro.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef MAX_TPMS
+#define MAX_TPMS 8
+#endif
+#ifndef IN_FLIGHT
+#define IN_FLIGHT 4
+#endif
+#ifndef EXEC_US
+#define EXEC_US 2000
+#endif
+
+/* NUM_OF_RUNS attestations (PCR_Read and Quote) per TPM on 1 to MAX_TPMS
+ * TPMs (in-process mocks taking EXEC_US per command), all from one thread.
+ * Blocking runs TPM2_PCR_Read_ex and TPM2_Quote_ex one TPM after the other,
+ * coro spawns IN_FLIGHT coroutines per TPM on a Tpm2_loop, each awaiting
+ * an attestation coroutine per request. Reports attestations/s, the latency
+ * and the frames the pool took from the heap during the run. Needs
+ * WOLFTPM_COROUTINES in wolftpm/options.h. */
+#ifndef WOLFTPM_COROUTINES
+#error "enable WOLFTPM_COROUTINES in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock[MAX_TPMS];
+static WOLFTPM2_DEV dev[MAX_TPMS];
+static WOLFTPM2_KEY aik;
+static TPML_PCR_SELECTION sel;
+static unsigned long latUs[MAX_TPMS * NUM_OF_RUNS];
+static int latCount;
+static int failed;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int cmp_ul(const void* a, const void* b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+static void set_nonce(TPM2B_DATA* nonce, int count) {
+    nonce->size = TPM_SHA256_DIGEST_SIZE;
+    for (int i = 0; i < nonce->size; i++)
+        nonce->buffer[i] = (byte)(count + i);
+}
+
+static TPM_RC attest_blocking(TPM2_CTX* ctx, int count) {
+    PCR_Read_In pcrIn;
+    PCR_Read_Out pcrOut;
+    Quote_In quoteIn;
+    Quote_Out quoteOut;
+    TPM_RC rc;
+
+    pcrIn.pcrSelectionIn = sel;
+    rc = TPM2_PCR_Read_ex(ctx, &pcrIn, &pcrOut);
+    if (rc == TPM_RC_SUCCESS) {
+        XMEMSET(&quoteIn, 0, sizeof(quoteIn));
+        quoteIn.signHandle = aik.handle.hndl;
+        quoteIn.inScheme.scheme = TPM_ALG_NULL;
+        quoteIn.PCRselect = sel;
+        set_nonce(&quoteIn.qualifyingData, count);
+        rc = TPM2_Quote_ex(ctx, &quoteIn, &quoteOut);
+    }
+    return rc;
+}
+
+static Tpm2_task<TPM_RC> attest(Tpm2_device& tpm, int count) {
+    PCR_Read_Out pcrs;
+    Quote_Out quote;
+    TPM2B_DATA nonce;
+    TPM_RC rc;
+
+    rc = co_await tpm.pcr_read(sel, &pcrs);
+    if (rc == TPM_RC_SUCCESS) {
+        set_nonce(&nonce, count);
+        rc = co_await tpm.quote(aik, sel, nonce, &quote);
+    }
+    co_return rc;
+}
+
+static Tpm2_task<> requester(Tpm2_device& tpm, int runs) {
+    for (int count = 0; count < runs; count++) {
+        unsigned long start = now_ns();
+        TPM_RC rc = co_await attest(tpm, count);
+        latUs[latCount++] = (now_ns() - start) / 1000;
+        if (rc != TPM_RC_SUCCESS) {
+            printf("attestation failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+            failed++;
+            break;
+        }
+    }
+}
+
+static void run(int tpms, int coro) {
+    Tpm2_loop loop;
+    Tpm2_device* tpm[MAX_TPMS];
+    Tpm2_frame_stats before, after;
+    unsigned long start, duration;
+    int i, j, total = tpms * NUM_OF_RUNS;
+    TPM_RC rc = TPM_RC_SUCCESS;
+
+    latCount = 0;
+    failed = 0;
+    for (i = 0; i < tpms; i++)
+        tpm[i] = new Tpm2_device(loop, &dev[i]);
+    before = Tpm2_frame_pool::stats();
+
+    start = now_ns();
+    if (coro) {
+        for (i = 0; i < tpms; i++) {
+            for (j = 0; j < IN_FLIGHT; j++)
+                loop.spawn(requester(*tpm[i], NUM_OF_RUNS / IN_FLIGHT));
+        }
+        loop.run();
+    }
+    else {
+        for (j = 0; j < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; j++) {
+            for (i = 0; i < tpms && rc == TPM_RC_SUCCESS; i++) {
+                unsigned long t = now_ns();
+                rc = attest_blocking(&dev[i].ctx, j);
+                latUs[latCount++] = (now_ns() - t) / 1000;
+            }
+        }
+        if (rc != TPM_RC_SUCCESS) {
+            printf("attestation failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+            failed++;
+        }
+    }
+    duration = now_ns() - start;
+    after = Tpm2_frame_pool::stats();
+    for (i = 0; i < tpms; i++)
+        delete tpm[i];
+
+    qsort(latUs, latCount, sizeof(latUs[0]), cmp_ul);
+    printf("%s, tpms = %d, attest/s = %lu, p50 us = %lu, p99 us = %lu, "
+        "failed = %d", coro ? "coro" : "blocking", tpms,
+        (1000000000UL * total) / duration, latUs[latCount / 2],
+        latUs[latCount * 99 / 100], failed);
+    if (coro) {
+        printf(", frames = %u, heap refills = %u, polls/cmd = %u",
+            after.frames - before.frames, after.refills - before.refills,
+            loop.stats().polls / (loop.stats().cmds ? loop.stats().cmds : 1));
+    }
+    printf(";\n");
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc, i;
+
+    for (i = 0; i < MAX_TPMS; i++) {
+        TPM2_Mock_Init(&mock[i]);
+        mock[i].execPolls = 0;
+        mock[i].execUs = EXEC_US;
+        rc = wolfTPM2_Init(&dev[i], TPM2_IoCb_Mock_SPI, &mock[i]);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+            return rc;
+        }
+    }
+    aik.handle.hndl = TRANSIENT_FIRST;
+    sel.count = 1;
+    sel.pcrSelections[0].hash = TPM_ALG_SHA256;
+    sel.pcrSelections[0].sizeofSelect = PCR_SELECT_MIN;
+    sel.pcrSelections[0].pcrSelect[0] = 0x01;
+
+    /* the first run warms the frame pool */
+    run(MAX_TPMS, 1);
+    for (int tpms = 1; tpms <= MAX_TPMS; tpms *= 2) {
+        run(tpms, 0);
+        run(tpms, 1);
+    }
+
+    for (i = 0; i < MAX_TPMS; i++)
+        wolfTPM2_Cleanup(&dev[i]);
+    return 0;
+}
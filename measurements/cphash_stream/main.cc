@@ -0,0 +1,187 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_param_enc.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 10000
+#endif
+#ifndef PARAM_SZ
+#define PARAM_SZ MAX_DIGEST_BUFFER
+#endif
+
+/* Host cost of the cpHash and rpHash of a command with three SHA-256 HMAC
+ * sessions and a PARAM_SZ byte parameter. "copy" is the previous
+ * implementation, copying the three handle names with TPM2_GetName and
+ * hashing command code, names and parameters once per session for both
+ * directions, "stream" hashes straight over the packet once per hash
+ * algorithm. The second part times TPM2_SequenceUpdate_ex of PARAM_SZ bytes
+ * with the three sessions on the in-process mock (the mock returns no
+ * response HMACs, so only the command side is in there). Needs wolfCrypt,
+ * WOLFTPM_NAME_CACHE in wolftpm/options.h is optional. On arm64 the generic
+ * timer is read (CNTVCT_EL0 ticks), on x86 the TSC, elsewhere nanoseconds. */
+#ifdef WOLFTPM2_NO_WOLFCRYPT
+#error "remove WOLFTPM2_NO_WOLFCRYPT from wolftpm/options.h"
+#endif
+
+#define SESSIONS 3
+
+static TPM2_MOCK_TIS mock;
+
+static inline unsigned long long cycles(void) {
+#if defined(__aarch64__)
+    unsigned long long val;
+    asm volatile("mrs %0, CNTVCT_EL0" : "=r" (val));
+    return val;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int lo, hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+#endif
+}
+
+static void fill(byte* buf, int sz, int seed) {
+    for (int i = 0; i < sz; i++)
+        buf[i] = (byte)(seed + i * 7);
+}
+
+static void run_hash(WOLFTPM2_DEV* dev) {
+    TPM_HANDLE handles[MAX_HANDLE_NUM] = {
+        TRANSIENT_FIRST, NV_INDEX_FIRST, TPM_RH_OWNER };
+    BYTE handleBuf[sizeof(handles)];
+    const TPM2B_NAME* names[MAX_HANDLE_NUM];
+    TPM2B_NAME name1, name2, name3, saved[MAX_HANDLE_NUM];
+    TPM2B_DIGEST cpHash, rpHash, refCp, refRp;
+    BYTE param[PARAM_SZ];
+    unsigned long long start, before = 0, after = 0;
+    int count, i, match = 1;
+
+    /* the first two handles are named by their sessions, restored below */
+    for (i = 0; i < MAX_HANDLE_NUM; i++) {
+        saved[i] = dev->ctx.session[i].name;
+        TPM2_Packet_U32ToByteArray(handles[i],
+            &handleBuf[i * sizeof(TPM_HANDLE)]);
+        dev->ctx.session[i].name.size = (i < 2) ? 34 : 0;
+        fill(dev->ctx.session[i].name.name, dev->ctx.session[i].name.size, i);
+        names[i] = (i < 2) ? &dev->ctx.session[i].name : NULL;
+    }
+
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        fill(param, sizeof(param), count);
+
+        start = cycles();
+        for (i = 0; i < SESSIONS; i++) {
+            TPM2_GetName(&dev->ctx, handles[0], MAX_HANDLE_NUM, 0, &name1);
+            TPM2_GetName(&dev->ctx, handles[1], MAX_HANDLE_NUM, 1, &name2);
+            TPM2_GetName(&dev->ctx, handles[2], MAX_HANDLE_NUM, 2, &name3);
+            TPM2_CalcCpHash(TPM_ALG_SHA256, TPM_CC_NV_Write, &name1, &name2,
+                &name3, param, sizeof(param), &refCp);
+        }
+        for (i = 0; i < SESSIONS; i++) {
+            TPM2_CalcRpHash(TPM_ALG_SHA256, TPM_CC_NV_Write, param,
+                sizeof(param), &refRp);
+        }
+        before += cycles() - start;
+
+        start = cycles();
+        TPM2_CalcCpHash_ex(TPM_ALG_SHA256, TPM_CC_NV_Write, handleBuf, names,
+            MAX_HANDLE_NUM, param, sizeof(param), &cpHash);
+        TPM2_CalcRpHash(TPM_ALG_SHA256, TPM_CC_NV_Write, param,
+            sizeof(param), &rpHash);
+        after += cycles() - start;
+
+        if (cpHash.size != refCp.size ||
+                XMEMCMP(cpHash.buffer, refCp.buffer, cpHash.size) != 0 ||
+                XMEMCMP(rpHash.buffer, refRp.buffer, rpHash.size) != 0) {
+            match = 0;
+        }
+    }
+    for (i = 0; i < MAX_HANDLE_NUM; i++)
+        dev->ctx.session[i].name = saved[i];
+
+    printf("cpHash and rpHash, sessions = %d, bytes = %d, copy cycles = %llu, "
+        "stream cycles = %llu, match = %d;\n", SESSIONS, PARAM_SZ,
+        before / NUM_OF_RUNS, after / NUM_OF_RUNS, match);
+}
+
+static int run_update(WOLFTPM2_DEV* dev, int print) {
+    WOLFTPM2_SESSION session[SESSIONS];
+    HashSequenceStart_In startIn;
+    HashSequenceStart_Out startOut;
+    SequenceUpdate_In in;
+    unsigned long long start, total = 0;
+    int rc = TPM_RC_SUCCESS, count, i;
+
+    XMEMSET(session, 0, sizeof(session));
+    for (i = 0; i < SESSIONS && rc == TPM_RC_SUCCESS; i++) {
+        rc = wolfTPM2_StartSession(dev, &session[i], NULL, NULL, TPM_SE_HMAC,
+            TPM_ALG_NULL);
+        if (rc == TPM_RC_SUCCESS) {
+            rc = wolfTPM2_SetAuthSession(dev, i, &session[i],
+                TPMA_SESSION_continueSession);
+        }
+    }
+    if (rc == TPM_RC_SUCCESS) {
+        XMEMSET(&startIn, 0, sizeof(startIn));
+        startIn.hashAlg = TPM_ALG_SHA256;
+        rc = TPM2_HashSequenceStart_ex(&dev->ctx, &startIn, &startOut);
+    }
+
+    XMEMSET(&in, 0, sizeof(in));
+    in.sequenceHandle = startOut.sequenceHandle;
+    in.buffer.size = PARAM_SZ;
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        fill(in.buffer.buffer, in.buffer.size, count);
+        start = cycles();
+        rc = TPM2_SequenceUpdate_ex(&dev->ctx, &in);
+        total += cycles() - start;
+    }
+    if (rc != TPM_RC_SUCCESS) {
+        printf("SequenceUpdate failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+    }
+    else if (print) {
+        printf("SequenceUpdate, sessions = %d, bytes = %d, name cache = %d, "
+            "cycles/cmd = %llu;\n", SESSIONS, PARAM_SZ,
+#ifdef WOLFTPM_NAME_CACHE
+            1,
+#else
+            0,
+#endif
+            total / NUM_OF_RUNS);
+    }
+
+    for (i = 0; i < SESSIONS; i++) {
+        wolfTPM2_UnsetAuth(dev, i);
+        wolfTPM2_UnloadHandle(dev, &session[i].handle);
+    }
+    return rc;
+}
+
+int main(void) {
+    WOLFTPM2_DEV dev;
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    /* no simulated execution time, only the host side is of interest */
+    mock.execPolls = 0;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run_hash(&dev);
+    /* the first pass warms the caches */
+    for (int print = 0; print <= 1; print++)
+        run_update(&dev, print);
+
+    wolfTPM2_Cleanup(&dev);
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_param_enc.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 10000
+#endif
+
+/* Host cost of TPM2_KDFa and of the session HMACs of one command (command
+ * and response HMAC) with SHA-256. "rekey" is the previous implementation,
+ * calling wc_HmacSetKey for every KDFa counter iteration and every HMAC,
+ * "pad" starts each HMAC from the precomputed pads, kept in the session for
+ * the command HMACs. Needs wolfCrypt and WOLFTPM_SESSION_CACHE in
+ * wolftpm/options.h. On arm64 the generic timer is read (CNTVCT_EL0 ticks), on
+ * x86 the TSC, elsewhere nanoseconds. */
+#ifdef WOLFTPM2_NO_WOLFCRYPT
+#error "remove WOLFTPM2_NO_WOLFCRYPT from wolftpm/options.h"
+#endif
+#ifndef WOLFTPM_SESSION_CACHE
+#error "enable WOLFTPM_SESSION_CACHE in wolftpm/options.h"
+#endif
+
+static inline unsigned long long cycles(void) {
+#if defined(__aarch64__)
+    unsigned long long val;
+    asm volatile("mrs %0, CNTVCT_EL0" : "=r" (val));
+    return val;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int lo, hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+#endif
+}
+
+static int rekey_update(Hmac* hmac, const byte* data, word32 sz) {
+    return (sz > 0) ? wc_HmacUpdate(hmac, data, sz) : 0;
+}
+
+/* TPM2_KDFa as it keyed the HMAC before */
+static int rekey_kdfa(TPM2B_DATA* keyIn, const char* label,
+    TPM2B_NONCE* contextU, TPM2B_NONCE* contextV, BYTE* key, UINT32 keySz) {
+    Hmac hmac;
+    byte buf[sizeof(UINT32)], hash[WC_MAX_DIGEST_SIZE];
+    UINT32 pos, counter = 0, copyLen;
+    int rc;
+
+    rc = wc_HmacInit(&hmac, NULL, INVALID_DEVID);
+    for (pos = 0; rc == 0 && pos < keySz; pos += TPM_SHA256_DIGEST_SIZE) {
+        rc = wc_HmacSetKey(&hmac, WC_SHA256, keyIn->buffer, keyIn->size);
+        TPM2_Packet_U32ToByteArray(++counter, buf);
+        if (rc == 0)
+            rc = rekey_update(&hmac, buf, sizeof(buf));
+        if (rc == 0)
+            rc = rekey_update(&hmac, (const byte*)label, XSTRLEN(label) + 1);
+        if (rc == 0)
+            rc = rekey_update(&hmac, contextU->buffer, contextU->size);
+        if (rc == 0)
+            rc = rekey_update(&hmac, contextV->buffer, contextV->size);
+        TPM2_Packet_U32ToByteArray(keySz * 8, buf);
+        if (rc == 0)
+            rc = rekey_update(&hmac, buf, sizeof(buf));
+        if (rc == 0)
+            rc = wc_HmacFinal(&hmac, hash);
+        copyLen = keySz - pos;
+        if (copyLen > TPM_SHA256_DIGEST_SIZE)
+            copyLen = TPM_SHA256_DIGEST_SIZE;
+        XMEMCPY(&key[pos], hash, copyLen);
+    }
+    wc_HmacFree(&hmac);
+    return (rc == 0) ? (int)keySz : rc;
+}
+
+/* TPM2_CalcHmac as it keyed the HMAC before */
+static int rekey_hmac(TPM2B_AUTH* auth, const TPM2B_DIGEST* hash,
+    const TPM2B_NONCE* nonceNew, const TPM2B_NONCE* nonceOld,
+    TPMA_SESSION attrib, TPM2B_AUTH* hmac) {
+    Hmac ctx;
+    int rc;
+
+    hmac->size = TPM_SHA256_DIGEST_SIZE;
+    rc = wc_HmacInit(&ctx, NULL, INVALID_DEVID);
+    if (rc == 0)
+        rc = wc_HmacSetKey(&ctx, WC_SHA256, auth->buffer, auth->size);
+    if (rc == 0)
+        rc = rekey_update(&ctx, hash->buffer, hash->size);
+    if (rc == 0)
+        rc = rekey_update(&ctx, nonceNew->buffer, nonceNew->size);
+    if (rc == 0)
+        rc = rekey_update(&ctx, nonceOld->buffer, nonceOld->size);
+    if (rc == 0)
+        rc = rekey_update(&ctx, &attrib, 1);
+    if (rc == 0)
+        rc = wc_HmacFinal(&ctx, hmac->buffer);
+    wc_HmacFree(&ctx);
+    return rc;
+}
+
+static void fill(byte* buf, int sz, int seed) {
+    for (int i = 0; i < sz; i++)
+        buf[i] = (byte)(seed + i * 7);
+}
+
+static void run_kdfa(UINT32 keySz) {
+    TPM2B_DATA keyIn;
+    TPM2B_NONCE nonceCaller, nonceTPM;
+    BYTE key[256], ref[256];
+    unsigned long long start, before = 0, after = 0;
+    int count, match = 1;
+
+    keyIn.size = TPM_SHA256_DIGEST_SIZE;
+    fill(keyIn.buffer, keyIn.size, 1);
+    nonceCaller.size = nonceTPM.size = TPM_SHA256_DIGEST_SIZE;
+    fill(nonceTPM.buffer, nonceTPM.size, 3);
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        fill(nonceCaller.buffer, nonceCaller.size, count);
+
+        start = cycles();
+        rekey_kdfa(&keyIn, "XOR", &nonceCaller, &nonceTPM, ref, keySz);
+        before += cycles() - start;
+
+        start = cycles();
+        TPM2_KDFa(TPM_ALG_SHA256, &keyIn, "XOR", &nonceCaller, &nonceTPM,
+            key, keySz);
+        after += cycles() - start;
+
+        if (XMEMCMP(key, ref, keySz) != 0)
+            match = 0;
+    }
+    printf("KDFa, bytes = %u, rekey cycles = %llu, pad cycles = %llu, "
+        "match = %d;\n", keySz, before / NUM_OF_RUNS, after / NUM_OF_RUNS,
+        match);
+}
+
+static void run_hmac(void) {
+    TPM2_AUTH_SESSION session;
+    TPM2B_DIGEST cpHash, rpHash;
+    TPM2B_AUTH hmac, ref;
+    unsigned long long start, before = 0, after = 0;
+    int count, match = 1;
+
+    XMEMSET(&session, 0, sizeof(session));
+    session.authHash = TPM_ALG_SHA256;
+    session.sessionAttributes = TPMA_SESSION_continueSession;
+    session.auth.size = TPM_SHA256_DIGEST_SIZE;
+    fill(session.auth.buffer, session.auth.size, 5);
+    session.nonceCaller.size = session.nonceTPM.size = TPM_SHA256_DIGEST_SIZE;
+    cpHash.size = rpHash.size = TPM_SHA256_DIGEST_SIZE;
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        fill(session.nonceCaller.buffer, session.nonceCaller.size, count);
+        fill(session.nonceTPM.buffer, session.nonceTPM.size, count + 1);
+        fill(cpHash.buffer, cpHash.size, count + 2);
+        fill(rpHash.buffer, rpHash.size, count + 3);
+
+        start = cycles();
+        rekey_hmac(&session.auth, &cpHash, &session.nonceCaller,
+            &session.nonceTPM, session.sessionAttributes, &ref);
+        rekey_hmac(&session.auth, &rpHash, &session.nonceTPM,
+            &session.nonceCaller, session.sessionAttributes, &ref);
+        before += cycles() - start;
+
+        start = cycles();
+        TPM2_CalcSessionHmac(&session, &cpHash, &session.nonceCaller,
+            &session.nonceTPM, session.sessionAttributes, &hmac);
+        TPM2_CalcSessionHmac(&session, &rpHash, &session.nonceTPM,
+            &session.nonceCaller, session.sessionAttributes, &hmac);
+        after += cycles() - start;
+
+        if (XMEMCMP(hmac.buffer, ref.buffer, ref.size) != 0)
+            match = 0;
+    }
+    printf("HMAC per command, rekey cycles = %llu, pad cycles = %llu, "
+        "match = %d;\n", before / NUM_OF_RUNS, after / NUM_OF_RUNS, match);
+}
+
+int main(void) {
+    /* AES-128 key and IV, AES-256 key and IV, XOR mask of a parameter */
+    run_kdfa(32);
+    run_kdfa(48);
+    run_kdfa(256);
+    run_hmac();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+
+/* NUM_OF_RUNS PCR_Extend on an HMAC session (a fresh nonceCaller per
+ * command) against the in-process mock taking EXEC_US per command. Without
+ * WOLFTPM_HOST_DRBG every nonce is a TPM2_GetRandom of its own, with it the
+ * nonces come from the host DRBG, run for several reseed schedules. Select
+ * WOLFTPM_HOST_DRBG in wolftpm/options.h to compare. Reports the time and the
+ * TPM commands per PCR_Extend and the TPM2_GetRandom commands avoided. */
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static TPM2_AUTH_SESSION session[MAX_SESSION_NUM];
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static void run(unsigned maxBytes, unsigned maxRequests) {
+    PCR_Extend_In pcrExtend;
+    unsigned long start, duration;
+    word32 cmds;
+    int count, rc = TPM_RC_SUCCESS;
+#ifdef WOLFTPM_HOST_DRBG
+    TPM2_DRBG_STATS before, after;
+
+    TPM2_SetDrbgReseed(&dev.ctx, maxBytes, maxRequests);
+    TPM2_GetDrbgStats(&dev.ctx, &before);
+#endif
+
+    cmds = mock.cmdCount;
+    start = now_ns();
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+        pcrExtend.pcrHandle = 16;
+        pcrExtend.digests.count = 1;
+        pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+        rc = TPM2_PCR_Extend_ex(&dev.ctx, &pcrExtend);
+    }
+    duration = now_ns() - start;
+    if (rc != TPM_RC_SUCCESS) {
+        printf("PCR_Extend failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return;
+    }
+
+#ifdef WOLFTPM_HOST_DRBG
+    TPM2_GetDrbgStats(&dev.ctx, &after);
+    printf("drbg, reseed bytes = %u, reseed requests = %u, us/cmd = %lu, "
+        "tpm cmds/cmd = %.3f, seeds = %u, avoided = %u;\n", maxBytes,
+        maxRequests, duration / 1000 / NUM_OF_RUNS,
+        (double)(mock.cmdCount - cmds) / NUM_OF_RUNS,
+        after.seeds - before.seeds, after.avoided - before.avoided);
+#else
+    (void)maxBytes;
+    (void)maxRequests;
+    printf("tpm, us/cmd = %lu, tpm cmds/cmd = %.3f;\n",
+        duration / 1000 / NUM_OF_RUNS,
+        (double)(mock.cmdCount - cmds) / NUM_OF_RUNS);
+#endif
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    /* HMAC session as left by StartAuthSession, the mock does not check the
+     * authorization */
+    session[0].sessionHandle = HMAC_SESSION_FIRST;
+    session[0].authHash = TPM_ALG_SHA256;
+    session[0].nonceCaller.size = TPM_SHA256_DIGEST_SIZE;
+    session[0].nonceTPM.size = TPM_SHA256_DIGEST_SIZE;
+    session[0].sessionAttributes = TPMA_SESSION_continueSession;
+    rc = TPM2_SetSessionAuth_ex(&dev.ctx, session);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("TPM2_SetSessionAuth_ex failed 0x%x\n", rc);
+        return rc;
+    }
+
+#ifdef WOLFTPM_HOST_DRBG
+    run(0, 1);
+    run(0, 16);
+    run(TPM2_DRBG_RESEED_BYTES, TPM2_DRBG_RESEED_REQS);
+    run(0, 0);
+#else
+    run(0, 0);
+#endif
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
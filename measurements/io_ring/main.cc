@@ -0,0 +1,149 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_ioring.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef MAX_THREADS
+#define MAX_THREADS 32
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+#ifndef IO_CPU
+#define IO_CPU -1
+#endif
+
+/* 1 to MAX_THREADS threads each run NUM_OF_RUNS raw GetRandom commands on
+ * one TPM. In the mutex model every thread takes a mutex and drives the
+ * transport itself with TPM2_SubmitCommand and TPM2_WaitCommand. In the ring
+ * model the threads queue the commands with TPM2_IoRing_Submit and one IO
+ * thread, pinned to IO_CPU if set, runs them. Needs WOLFTPM_IO_RING in
+ * wolftpm/options.h. */
+#ifndef WOLFTPM_IO_RING
+#error "enable WOLFTPM_IO_RING in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static TPM2_IO_RING ring;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long latUs[MAX_THREADS * NUM_OF_RUNS];
+static int useRing;
+static volatile int failed;
+
+static const byte getRandom[] = {
+    0x80, 0x01,             /* TPM_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x0C, /* size */
+    0x00, 0x00, 0x01, 0x7B, /* TPM_CC_GetRandom */
+    0x00, 0x10              /* bytesRequested */
+};
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static void* worker(void* arg) {
+    unsigned long* lat = (unsigned long*)arg;
+    byte rsp[64];
+    word32 rspSz;
+    TPM2_IO_REQ req;
+    unsigned long start;
+    int count, rc;
+
+    rc = TPM2_IoReq_Init(&req);
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        start = now_ns();
+        if (useRing) {
+            req.cmd = getRandom;
+            req.cmdSz = sizeof(getRandom);
+            req.rsp = rsp;
+            req.rspSz = sizeof(rsp);
+            rc = TPM2_IoRing_Submit(&ring, &req);
+            if (rc == TPM_RC_SUCCESS)
+                rc = TPM2_IoRing_Wait(&req);
+        }
+        else {
+            rspSz = sizeof(rsp);
+            pthread_mutex_lock(&lock);
+            rc = TPM2_SubmitCommand(&dev.ctx, getRandom, sizeof(getRandom));
+            if (rc == TPM_RC_SUCCESS)
+                rc = TPM2_WaitCommand(&dev.ctx, rsp, &rspSz);
+            pthread_mutex_unlock(&lock);
+        }
+        lat[count] = (now_ns() - start) / 1000;
+    }
+    TPM2_IoReq_Free(&req);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("command failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        __sync_fetch_and_add(&failed, 1);
+    }
+    return NULL;
+}
+
+static int cmp_ul(const void* a, const void* b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(int threads, int ringMode) {
+    pthread_t tid[MAX_THREADS];
+    unsigned long start, duration;
+    int i, total = threads * NUM_OF_RUNS;
+
+    useRing = ringMode;
+    failed = 0;
+    if (useRing && TPM2_IoRing_Start(&ring, &dev.ctx, IO_CPU) != 0) {
+        printf("TPM2_IoRing_Start failed\n");
+        return;
+    }
+    start = now_ns();
+    for (i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, worker, &latUs[i * NUM_OF_RUNS]);
+    for (i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    duration = now_ns() - start;
+    if (useRing)
+        TPM2_IoRing_Stop(&ring);
+
+    qsort(latUs, total, sizeof(latUs[0]), cmp_ul);
+    printf("%s, threads = %d, cmds/s = %lu, p50 us = %lu, p99 us = %lu, "
+        "failed = %d", useRing ? "ring" : "mutex", threads,
+        (1000000000UL * total) / duration, latUs[total / 2],
+        latUs[total * 99 / 100], failed);
+    if (useRing) {
+        printf(", chained = %u%%, io sleeps = %u", ring.stats.chained * 100 /
+            (ring.stats.cmds ? ring.stats.cmds : 1), ring.stats.sleeps);
+    }
+    printf(";\n");
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        run(threads, 0);
+        run(threads, 1);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
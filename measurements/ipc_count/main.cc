@@ -0,0 +1,129 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 100
+#endif
+
+/* Counts the IO callback invocations per command with and without the
+ * vectored SPI callback. By default the in-process TIS mock is used, build
+ * with -DUSE_L4_SPI to count the IPCs to the spi server instead. */
+
+static TPM2_MOCK_TIS mock;
+#ifdef USE_L4_SPI
+static TPM2_L4_SPI_CTX spiCtx;
+#endif
+
+static word32 io_count(void) {
+#ifdef USE_L4_SPI
+    return TPM2_IoCb_L4_SPI_IpcCount(&spiCtx);
+#else
+    return mock.ioCalls;
+#endif
+}
+
+static int run(const char* name, int vec) {
+    int rc, count, pcrIndex = 16;
+    WOLFTPM2_DEV dev;
+    word32 ipc, xfers;
+    struct timespec start, end;
+    unsigned long duration;
+    union {
+        PCR_Extend_In pcrExtend;
+        PCR_Read_In pcrRead;
+        GetRandom_In getRand;
+        GetCapability_In cap;
+        byte maxInput[MAX_COMMAND_SIZE];
+    } cmdIn;
+    union {
+        PCR_Read_Out pcrRead;
+        GetRandom_Out getRand;
+        GetCapability_Out cap;
+        byte maxOutput[MAX_RESPONSE_SIZE];
+    } cmdOut;
+
+    TPM2_Mock_Init(&mock);
+#ifdef USE_L4_SPI
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb, &spiCtx);
+#else
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+#endif
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    if (vec) {
+#ifdef USE_L4_SPI
+        TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb);
+#else
+        TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb_Mock_SPI);
+#endif
+    }
+
+    for (int cmd = 0; cmd < 4; cmd++) {
+        const char* cmdName = "";
+        ipc = io_count();
+        xfers = mock.xfers;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (count = 0; count < NUM_OF_RUNS; count++) {
+            switch (cmd) {
+            case 0:
+                /* 65 byte command, two FIFO chunks */
+                cmdName = "PCR_Extend";
+                XMEMSET(&cmdIn.pcrExtend, 0, sizeof(cmdIn.pcrExtend));
+                cmdIn.pcrExtend.pcrHandle = pcrIndex;
+                cmdIn.pcrExtend.digests.count = 1;
+                cmdIn.pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+                rc = TPM2_PCR_Extend(&cmdIn.pcrExtend);
+                break;
+            case 1:
+                cmdName = "PCR_Read";
+                XMEMSET(&cmdIn.pcrRead, 0, sizeof(cmdIn.pcrRead));
+                TPM2_SetupPCRSel(&cmdIn.pcrRead.pcrSelectionIn,
+                    TPM_ALG_SHA256, pcrIndex);
+                rc = TPM2_PCR_Read(&cmdIn.pcrRead, &cmdOut.pcrRead);
+                break;
+            case 2:
+                cmdName = "GetRandom";
+                cmdIn.getRand.bytesRequested = 32;
+                rc = TPM2_GetRandom(&cmdIn.getRand, &cmdOut.getRand);
+                break;
+            default:
+                cmdName = "GetCapability";
+                cmdIn.cap.capability = TPM_CAP_TPM_PROPERTIES;
+                cmdIn.cap.property = TPM_PT_MANUFACTURER;
+                cmdIn.cap.propertyCount = 1;
+                rc = TPM2_GetCapability(&cmdIn.cap, &cmdOut.cap);
+                break;
+            }
+            if (rc != TPM_RC_SUCCESS) {
+                printf("%s failed 0x%x: %s\n", cmdName, rc,
+                    TPM2_GetRCString(rc));
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        duration = ((end.tv_sec * 1000000000) + end.tv_nsec) -
+            ((start.tv_sec * 1000000000) + start.tv_nsec);
+
+        printf("%s, %s, ipc/cmd = %u, xfers/cmd = %u, ns/cmd = %lu;\n",
+            name, cmdName, (io_count() - ipc) / NUM_OF_RUNS,
+            (mock.xfers - xfers) / NUM_OF_RUNS, duration / NUM_OF_RUNS);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+#ifdef USE_L4_SPI
+    TPM2_IoCb_L4_SPI_Cleanup(&spiCtx);
+#endif
+    return 0;
+}
+
+int main(void) {
+    run("single", 0);
+    run("vectored", 1);
+    fflush(stdout);
+    return 0;
+}
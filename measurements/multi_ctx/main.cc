@@ -0,0 +1,104 @@
+#include <time.h>
+#include <cstdio>
+#include <pthread.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef MAX_THREADS
+#define MAX_THREADS 8
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+
+/* Stress test of independent contexts: every thread drives its own TIS mock
+ * through its own WOLFTPM2_DEV with PCR extends and random reads. The active
+ * context is cleared before the threads start, so a command that still went
+ * through the global fails. Each mock has to see exactly the commands of its
+ * thread. Throughput should scale with the thread count. */
+
+static TPM2_MOCK_TIS mock[MAX_THREADS];
+static WOLFTPM2_DEV dev[MAX_THREADS];
+static volatile int failed;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static void* worker(void* arg) {
+    WOLFTPM2_DEV* d = (WOLFTPM2_DEV*)arg;
+    byte digest[TPM_SHA256_DIGEST_SIZE];
+    byte rnd[16];
+    int count, rc = 0;
+
+    for (count = 0; count < NUM_OF_RUNS && rc == 0; count++) {
+        XMEMSET(digest, count, sizeof(digest));
+        rc = wolfTPM2_ExtendPCR(d, 16, TPM_ALG_SHA256, digest,
+            sizeof(digest));
+        if (rc == 0)
+            rc = wolfTPM2_GetRandom(d, rnd, sizeof(rnd));
+    }
+    if (rc != 0) {
+        printf("command failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        __sync_fetch_and_add(&failed, 1);
+    }
+    return NULL;
+}
+
+static void run(int threads) {
+    pthread_t tid[MAX_THREADS];
+    word32 cmds[MAX_THREADS];
+    unsigned long start, duration;
+    int i, mismatch = 0;
+
+    failed = 0;
+    for (i = 0; i < threads; i++)
+        cmds[i] = mock[i].cmdCount;
+    start = now_ns();
+    for (i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, worker, &dev[i]);
+    for (i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    duration = now_ns() - start;
+
+    for (i = 0; i < threads; i++) {
+        if (mock[i].cmdCount - cmds[i] != 2 * NUM_OF_RUNS)
+            mismatch++;
+    }
+
+    printf("threads = %d, cmds/s = %lu, us/cmd per ctx = %lu, "
+        "failed = %d, mismatched = %d;\n", threads,
+        (2UL * NUM_OF_RUNS * threads * 1000000000UL) / duration,
+        duration / 1000 / (2 * NUM_OF_RUNS), failed, mismatch);
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc, i;
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        TPM2_Mock_Init(&mock[i]);
+        mock[i].execPolls = 0;
+        mock[i].execUs = EXEC_US;
+        rc = wolfTPM2_Init(&dev[i], TPM2_IoCb_Mock_SPI, &mock[i]);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("wolfTPM2_Init failed 0x%x: %s\n", rc,
+                TPM2_GetRCString(rc));
+            return rc;
+        }
+    }
+    TPM2_SetActiveCtx(NULL);
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2)
+        run(threads);
+
+    for (i = 0; i < MAX_THREADS; i++)
+        wolfTPM2_Cleanup(&dev[i]);
+    return 0;
+}
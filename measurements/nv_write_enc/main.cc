@@ -0,0 +1,124 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+#ifndef WRITE_SZ
+#define WRITE_SZ 16
+#endif
+
+/* Host cost of wolfTPM2_NVWriteAuth for NUM_OF_RUNS writes of WRITE_SZ bytes
+ * on the in-process mock, without a session and with an HMAC session doing
+ * TPMA_SESSION_decrypt parameter encryption with XOR and AES-CFB. Each write
+ * is an NV_ReadPublic and an NV_Write. Compare a libwolftpm built with
+ * WOLFTPM_SESSION_CACHE against one without. Needs wolfCrypt, and without
+ * WOLFTPM_ADAPTIVE_POLL in wolftpm/options.h the expected NV_Write time adds
+ * no sleeps on the mock. On arm64 the generic timer is read (CNTVCT_EL0 ticks),
+ * on x86 the TSC, elsewhere nanoseconds. */
+#ifdef WOLFTPM2_NO_WOLFCRYPT
+#error "remove WOLFTPM2_NO_WOLFCRYPT from wolftpm/options.h"
+#endif
+
+#define NV_INDEX 0x01800200
+
+static TPM2_MOCK_TIS mock;
+
+static inline unsigned long long cycles(void) {
+#if defined(__aarch64__)
+    unsigned long long val;
+    asm volatile("mrs %0, CNTVCT_EL0" : "=r" (val));
+    return val;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int lo, hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+#endif
+}
+
+static int run(WOLFTPM2_DEV* dev, const char* name, int encDecAlg,
+    int print) {
+    int rc = TPM_RC_SUCCESS, count;
+    word32 cmds;
+    WOLFTPM2_SESSION session;
+    WOLFTPM2_NV nv;
+    byte data[WRITE_SZ];
+    unsigned long long start, total = 0;
+
+    XMEMSET(&nv, 0, sizeof(nv));
+    nv.handle.hndl = NV_INDEX;
+    nv.handle.auth.size = 16;
+    XMEMSET(nv.handle.auth.buffer, 0x5a, nv.handle.auth.size);
+    XMEMSET(&session, 0, sizeof(session));
+
+    if (encDecAlg != TPM_ALG_NULL) {
+        rc = wolfTPM2_StartSession(dev, &session, NULL, NULL, TPM_SE_HMAC,
+            encDecAlg);
+        if (rc == TPM_RC_SUCCESS) {
+            rc = wolfTPM2_SetAuthSession(dev, 1, &session,
+                TPMA_SESSION_decrypt | TPMA_SESSION_continueSession);
+        }
+    }
+    else {
+        rc = wolfTPM2_SetAuthHandle(dev, 0, &nv.handle);
+    }
+
+    cmds = mock.cmdCount;
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        XMEMSET(data, (byte)count, sizeof(data));
+        start = cycles();
+        rc = wolfTPM2_NVWriteAuth(dev, &nv, NV_INDEX, data, sizeof(data), 0);
+        total += cycles() - start;
+    }
+    if (rc != TPM_RC_SUCCESS) {
+        printf("%s failed 0x%x: %s\n", name, rc, TPM2_GetRCString(rc));
+    }
+    else if (print) {
+        printf("%s, bytes = %d, session cache = %d, cycles/write = %llu, "
+            "cmds/write = %u;\n", name, WRITE_SZ,
+#ifdef WOLFTPM_SESSION_CACHE
+            1,
+#else
+            0,
+#endif
+            total / NUM_OF_RUNS, (mock.cmdCount - cmds) / NUM_OF_RUNS);
+    }
+
+    if (encDecAlg != TPM_ALG_NULL) {
+        wolfTPM2_UnsetAuth(dev, 1);
+        wolfTPM2_UnloadHandle(dev, &session.handle);
+    }
+    return rc;
+}
+
+int main(void) {
+    WOLFTPM2_DEV dev;
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    /* no simulated execution time, only the host side is of interest */
+    mock.execPolls = 0;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    /* the first pass warms the caches */
+    for (int print = 0; print <= 1; print++) {
+        run(&dev, "password", TPM_ALG_NULL, print);
+        run(&dev, "xor", TPM_ALG_XOR, print);
+        run(&dev, "aes-cfb", TPM_ALG_CFB, print);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <time.h>
+#include <cstdio>
+#include <pthread.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef MAX_THREADS
+#define MAX_THREADS 8
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+
+/* Back to back PCR_Extend from several threads sharing one context, each
+ * thread on its own HMAC session. Serialized, the hwLock is held for the
+ * whole command. With TPM2_SetPipeline it only covers the transport and the
+ * session reservations, the session crypto of the threads runs
+ * concurrently. Needs WOLFTPM_PIPELINE in wolftpm/options.h, build with
+ * wolfCrypt and WOLFTPM_SESSION_CACHE for the HMAC cost of a real host. */
+#ifndef WOLFTPM_PIPELINE
+#error "enable WOLFTPM_PIPELINE in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static TPM2_AUTH_SESSION session[MAX_THREADS][MAX_SESSION_NUM];
+static volatile int failed;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static void* worker(void* arg) {
+    TPM2_AUTH_SESSION* s = (TPM2_AUTH_SESSION*)arg;
+    int count, rc;
+    PCR_Extend_In pcrExtend;
+
+    /* HMAC session as left by StartAuthSession, the mock does not check the
+     * authorization */
+    XMEMSET(s, 0, sizeof(TPM2_AUTH_SESSION) * MAX_SESSION_NUM);
+    s[0].sessionHandle = HMAC_SESSION_FIRST +
+        (TPM_HANDLE)((s - session[0]) / MAX_SESSION_NUM);
+    s[0].authHash = TPM_ALG_SHA256;
+    s[0].nonceCaller.size = TPM_SHA256_DIGEST_SIZE;
+    s[0].nonceTPM.size = TPM_SHA256_DIGEST_SIZE;
+    s[0].sessionAttributes = TPMA_SESSION_continueSession;
+    rc = TPM2_SetSessionAuth_ex(&dev.ctx, s);
+
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+        pcrExtend.pcrHandle = 16;
+        pcrExtend.digests.count = 1;
+        pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+        rc = TPM2_PCR_Extend_ex(&dev.ctx, &pcrExtend);
+    }
+    if (rc != TPM_RC_SUCCESS) {
+        printf("PCR_Extend failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        __sync_fetch_and_add(&failed, 1);
+    }
+    return NULL;
+}
+
+static void run(int threads, int pipeline) {
+    pthread_t tid[MAX_THREADS];
+    unsigned long start, duration;
+    word32 cmds;
+    int i;
+
+    if (TPM2_SetPipeline(&dev.ctx, pipeline) != TPM_RC_SUCCESS) {
+        printf("TPM2_SetPipeline failed\n");
+        return;
+    }
+    failed = 0;
+    cmds = mock.cmdCount;
+    start = now_ns();
+    for (i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, worker, session[i]);
+    for (i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    duration = now_ns() - start;
+
+    printf("%s, threads = %d, cmds/s = %lu, us/cmd = %lu, "
+        "tpm cmds/cmd = %u, failed = %d;\n",
+        pipeline ? "pipeline" : "serial", threads,
+        (1000000000UL * threads * NUM_OF_RUNS) / duration,
+        duration / 1000 / (threads * NUM_OF_RUNS),
+        (mock.cmdCount - cmds) / (threads * NUM_OF_RUNS), failed);
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb_Mock_SPI);
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        run(threads, 0);
+        run(threads, 1);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
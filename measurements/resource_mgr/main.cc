@@ -0,0 +1,245 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+#ifndef TPM_SLOTS
+#define TPM_SLOTS 3
+#endif
+
+/* A service juggling an SRK, an AIK, a signing key and a sealed object on a
+ * TPM with TPM_SLOTS transient slots. Each round signs four times, quotes,
+ * unseals and decrypts with a short lived key loaded under the SRK. Without
+ * help the fourth object fails with TPM_RC_OBJECT_MEMORY, the naive fix
+ * reloads every object around each use. The resource manager keeps the hot
+ * objects loaded and evicts the least recently used one. Needs
+ * WOLFTPM_RESOURCE_MGR in wolftpm/options.h, with TPM2_RM_MAX_LOADED matching
+ * TPM_SLOTS. */
+#ifndef WOLFTPM_RESOURCE_MGR
+#error "enable WOLFTPM_RESOURCE_MGR in wolftpm/options.h"
+#endif
+
+enum { SRK, AIK, SIGN, SEAL, NUM_OBJS };
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static TPM_HANDLE handle[NUM_OBJS];
+static TPMS_CONTEXT saved[NUM_OBJS];
+static int naive;
+static word32 naiveLoads, naiveSaves, naiveFlushes;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int flush(TPM_HANDLE h) {
+    FlushContext_In in;
+    in.flushHandle = h;
+    naiveFlushes += naive;
+    return TPM2_FlushContext_ex(&dev.ctx, &in);
+}
+
+/* naive: load the saved object before each use */
+static int acquire(int obj, TPM_HANDLE* h) {
+    ContextLoad_In in;
+    ContextLoad_Out out;
+    int rc;
+
+    if (!naive) {
+        *h = handle[obj];
+        return TPM_RC_SUCCESS;
+    }
+    XMEMCPY(&in.context, &saved[obj], sizeof(in.context));
+    rc = TPM2_ContextLoad_ex(&dev.ctx, &in, &out);
+    *h = out.loadedHandle;
+    naiveLoads++;
+    return rc;
+}
+
+/* naive: flush the object after each use */
+static int release(TPM_HANDLE h) {
+    return naive ? flush(h) : TPM_RC_SUCCESS;
+}
+
+/* keeps a new object, naive saves it once and flushes it */
+static int keep(int obj, TPM_HANDLE h) {
+    ContextSave_In in;
+    ContextSave_Out out;
+    int rc = TPM_RC_SUCCESS;
+
+    handle[obj] = h;
+    if (naive) {
+        in.saveHandle = h;
+        rc = TPM2_ContextSave_ex(&dev.ctx, &in, &out);
+        if (rc == TPM_RC_SUCCESS) {
+            XMEMCPY(&saved[obj], &out.context, sizeof(saved[obj]));
+            naiveSaves++;
+            rc = flush(h);
+        }
+    }
+    return rc;
+}
+
+static int load_child(TPM_HANDLE* h) {
+    Load_In in;
+    Load_Out out;
+    int rc;
+
+    XMEMSET(&in, 0, sizeof(in));
+    rc = acquire(SRK, &in.parentHandle);
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_Load_ex(&dev.ctx, &in, &out);
+    *h = out.objectHandle;
+    if (rc == TPM_RC_SUCCESS)
+        rc = release(in.parentHandle);
+    return rc;
+}
+
+static int setup(void) {
+    CreatePrimary_In in;
+    CreatePrimary_Out out;
+    TPM_HANDLE h;
+    int rc, obj;
+
+    XMEMSET(&in, 0, sizeof(in));
+    in.primaryHandle = TPM_RH_OWNER;
+    rc = TPM2_CreatePrimary_ex(&dev.ctx, &in, &out);
+    if (rc == TPM_RC_SUCCESS)
+        rc = keep(SRK, out.objectHandle);
+    for (obj = AIK; obj < NUM_OBJS && rc == TPM_RC_SUCCESS; obj++) {
+        rc = load_child(&h);
+        if (rc == TPM_RC_SUCCESS)
+            rc = keep(obj, h);
+    }
+    return rc;
+}
+
+static int round_trip(void) {
+    Sign_In sign;
+    Sign_Out signOut;
+    Quote_In quote;
+    Quote_Out quoteOut;
+    Unseal_In unseal;
+    Unseal_Out unsealOut;
+    RSA_Decrypt_In dec;
+    RSA_Decrypt_Out decOut;
+    int rc = TPM_RC_SUCCESS, i;
+
+    XMEMSET(&sign, 0, sizeof(sign));
+    for (i = 0; i < 4 && rc == TPM_RC_SUCCESS; i++) {
+        rc = acquire(SIGN, &sign.keyHandle);
+        if (rc == TPM_RC_SUCCESS)
+            rc = TPM2_Sign_ex(&dev.ctx, &sign, &signOut);
+        if (rc == TPM_RC_SUCCESS)
+            rc = release(sign.keyHandle);
+    }
+
+    XMEMSET(&quote, 0, sizeof(quote));
+    if (rc == TPM_RC_SUCCESS)
+        rc = acquire(AIK, &quote.signHandle);
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_Quote_ex(&dev.ctx, &quote, &quoteOut);
+    if (rc == TPM_RC_SUCCESS)
+        rc = release(quote.signHandle);
+
+    XMEMSET(&unseal, 0, sizeof(unseal));
+    if (rc == TPM_RC_SUCCESS)
+        rc = acquire(SEAL, &unseal.itemHandle);
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_Unseal_ex(&dev.ctx, &unseal, &unsealOut);
+    if (rc == TPM_RC_SUCCESS)
+        rc = release(unseal.itemHandle);
+
+    /* short lived key, flushed after use in both modes */
+    XMEMSET(&dec, 0, sizeof(dec));
+    if (rc == TPM_RC_SUCCESS)
+        rc = load_child(&dec.keyHandle);
+    if (rc == TPM_RC_SUCCESS)
+        rc = TPM2_RSA_Decrypt_ex(&dev.ctx, &dec, &decOut);
+    if (rc == TPM_RC_SUCCESS)
+        rc = flush(dec.keyHandle);
+    return rc;
+}
+
+static int teardown(void) {
+    int rc = TPM_RC_SUCCESS, obj;
+    for (obj = 0; obj < NUM_OBJS && rc == TPM_RC_SUCCESS; obj++) {
+        if (!naive)
+            rc = flush(handle[obj]);
+    }
+    return rc;
+}
+
+static void run(const char* name, int useNaive, int useRm,
+                TPM2_RM_STATS* stats) {
+    unsigned long start, duration;
+    word32 cmds;
+    int rc, count = 0;
+
+    naive = useNaive;
+    naiveLoads = naiveSaves = naiveFlushes = 0;
+    rc = TPM2_SetResourceMgr(&dev.ctx, useRm);
+    cmds = mock.cmdCount;
+    start = now_ns();
+    if (rc == TPM_RC_SUCCESS)
+        rc = setup();
+    for (; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++)
+        rc = round_trip();
+    if (rc == TPM_RC_SUCCESS)
+        rc = teardown();
+    duration = now_ns() - start;
+    cmds = mock.cmdCount - cmds;
+    TPM2_GetResourceMgrStats(&dev.ctx, stats);
+    if (useNaive) {
+        stats->uses = naiveLoads;
+        stats->loads = naiveLoads;
+        stats->saves = naiveSaves;
+        stats->flushes = naiveFlushes;
+    }
+
+    printf("%s, rounds = %d, tpm cmds = %u, tpm cmds/round = %u, "
+        "us/round = %lu, uses = %u, loads = %u, saves = %u, "
+        "flushes = %u, rc = 0x%x;\n", name, count, cmds,
+        cmds / (count ? count : 1), duration / 1000 / (count ? count : 1),
+        stats->uses, stats->loads, stats->saves, stats->flushes, rc);
+    fflush(stdout);
+
+    /* start the next run with an empty TPM */
+    for (int i = 0; i < TPM2_MOCK_MAX_OBJECTS; i++)
+        mock.objects[i] = 0;
+}
+
+int main(void) {
+    TPM2_RM_STATS stats[3];
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    mock.maxObjects = TPM_SLOTS;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb_Mock_SPI);
+
+    run("direct", 0, 0, &stats[0]);
+    run("naive reload", 1, 0, &stats[1]);
+    run("resource mgr", 0, 1, &stats[2]);
+    printf("avoided, loads = %u, saves = %u, flushes = %u;\n",
+        stats[1].loads - stats[2].loads, stats[1].saves - stats[2].saves,
+        stats[1].flushes - stats[2].flushes);
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+
+/* A TPM refuses a share of the commands with a warning asking for a retry
+ * (TPM_RC_RETRY, TPM_RC_YIELDED or TPM_RC_TESTING, injected by the mock).
+ * NUM_OF_RUNS signs with a password session and NUM_OF_RUNS GetRandom run
+ * for every share, reporting the commands that failed in the end, those the
+ * caller would have seen fail without resubmission, the latency and the
+ * counts of TPM2_GetRetryStats. Needs WOLFTPM_AUTO_RETRY in
+ * wolftpm/options.h. */
+#ifndef WOLFTPM_AUTO_RETRY
+#error "enable WOLFTPM_AUTO_RETRY in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static unsigned long latUs[2 * NUM_OF_RUNS];
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int cmp_ul(const void* a, const void* b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char* name, TPM_RC warnRc, word32 warnPct) {
+    Sign_In sign;
+    Sign_Out signOut;
+    GetRandom_In rand;
+    GetRandom_Out randOut;
+    TPM2_RETRY_STAT stats[8];
+    word32 retried = 0, retries = 0, exhausted = 0;
+    int i, count, failed = 0, total = 0;
+    TPM_RC rc;
+
+    XMEMSET(&dev.ctx.retryStat, 0, sizeof(dev.ctx.retryStat));
+    mock.warnRc = warnRc;
+    mock.warnPct = warnPct;
+    mock.warnSeed = 1;
+    mock.warnings = 0;
+
+    XMEMSET(&sign, 0, sizeof(sign));
+    sign.keyHandle = TRANSIENT_FIRST;
+    sign.digest.size = TPM_SHA256_DIGEST_SIZE;
+    sign.inScheme.scheme = TPM_ALG_NULL;
+    sign.validation.tag = TPM_ST_HASHCHECK;
+    sign.validation.hierarchy = TPM_RH_NULL;
+    rand.bytesRequested = MAX_RNG_REQ_SIZE;
+
+    for (i = 0; i < NUM_OF_RUNS; i++) {
+        for (int cmd = 0; cmd < 2; cmd++) {
+            word32 warnings = mock.warnings;
+            unsigned long start = now_ns();
+            if (cmd == 0)
+                rc = TPM2_Sign_ex(&dev.ctx, &sign, &signOut);
+            else
+                rc = TPM2_GetRandom_ex(&dev.ctx, &rand, &randOut);
+            latUs[total++] = (now_ns() - start) / 1000;
+            if (rc != TPM_RC_SUCCESS)
+                failed++;
+            if (mock.warnings != warnings)
+                retried++;
+        }
+    }
+
+    count = TPM2_GetRetryStats(&dev.ctx, stats, 8);
+    for (i = 0; i < count; i++) {
+        retries += stats[i].retries;
+        exhausted += stats[i].exhausted;
+    }
+    qsort(latUs, total, sizeof(latUs[0]), cmp_ul);
+    printf("%s, refused = %u%%, cmds = %d, failed = %d, failed without retry "
+        "= %u, retries = %u, exhausted = %u, p50 us = %lu, p99 us = %lu, "
+        "max us = %lu;\n", name, warnPct, total, failed, retried, retries,
+        exhausted, latUs[total / 2], latUs[total * 99 / 100],
+        latUs[total - 1]);
+    for (i = 0; i < count; i++) {
+        printf("  cc 0x%x: retries = %u, exhausted = %u;\n",
+            (word32)stats[i].cc, stats[i].retries,
+            stats[i].exhausted);
+    }
+    fflush(stdout);
+}
+
+int main(void) {
+    int rc;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run("none", TPM_RC_RETRY, 0);
+    run("retry", TPM_RC_RETRY, 10);
+    run("retry", TPM_RC_RETRY, 30);
+    run("yielded", TPM_RC_YIELDED, 30);
+    run("testing", TPM_RC_TESTING, 30);
+    run("retry", TPM_RC_RETRY, 70);
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
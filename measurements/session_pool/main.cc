@@ -0,0 +1,177 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 200
+#endif
+#ifndef EXEC_US
+#define EXEC_US 200
+#endif
+#ifndef POOL_DEPTH
+#define POOL_DEPTH 2
+#endif
+
+/* NUM_OF_RUNS requests of a PCR_Extend on a fresh HMAC session against the
+ * in-process mock (3 session slots, EXEC_US per command). "start" runs
+ * wolfTPM2_StartSession per request, "pool" takes the session from a
+ * session pool refilled after each request, "restart" restores a saved pool
+ * in a new pool and times the first request. Latency is of the request
+ * only, the refill is reported separately. The sessions are unsalted so the
+ * measurement runs without wolfCrypt; a salted profile also moves the salt
+ * encryption and KDFa off the request. Needs WOLFTPM_SESSION_POOL in
+ * wolftpm/options.h. */
+#ifndef WOLFTPM_SESSION_POOL
+#error "enable WOLFTPM_SESSION_POOL in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+static WOLFTPM2_DEV dev;
+static WOLFTPM2_SESSION_POOL pool;
+static byte saved[32 * 1024];
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+/* one request, the session ends with the command */
+static int request(WOLFTPM2_SESSION* session) {
+    PCR_Extend_In pcrExtend;
+    int rc;
+
+    rc = wolfTPM2_SetAuthSession(&dev, 0, session, 0);
+    if (rc == TPM_RC_SUCCESS) {
+        XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+        pcrExtend.pcrHandle = 16;
+        pcrExtend.digests.count = 1;
+        pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+        rc = TPM2_PCR_Extend_ex(&dev.ctx, &pcrExtend);
+    }
+    wolfTPM2_UnsetAuth(&dev, 0);
+    return rc;
+}
+
+static void report(const char* name, int runs, unsigned long reqNs,
+    word32 reqCmds, unsigned long refillNs) {
+    WOLFTPM2_SESSION_POOL_STATS stats;
+
+    wolfTPM2_SessionPool_GetStats(&pool, &stats);
+    printf("%s, us/request = %lu, tpm cmds/request = %.2f, "
+        "refill us/request = %lu, hits = %u, misses = %u, restored = %u, "
+        "dropped = %u;\n", name, reqNs / 1000 / runs,
+        (double)reqCmds / runs, refillNs / 1000 / runs, stats.hits,
+        stats.misses, stats.restored, stats.dropped);
+    fflush(stdout);
+}
+
+static int run_start(void) {
+    WOLFTPM2_SESSION session;
+    unsigned long start, reqNs = 0;
+    word32 cmds = mock.cmdCount;
+    int count, rc = TPM_RC_SUCCESS;
+
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        start = now_ns();
+        rc = wolfTPM2_StartSession(&dev, &session, NULL, NULL, TPM_SE_HMAC,
+            TPM_ALG_NULL);
+        if (rc == TPM_RC_SUCCESS)
+            rc = request(&session);
+        reqNs += now_ns() - start;
+    }
+    if (rc == TPM_RC_SUCCESS)
+        report("start", NUM_OF_RUNS, reqNs, mock.cmdCount - cmds, 0);
+    return rc;
+}
+
+static int run_pool(int profile) {
+    WOLFTPM2_SESSION session;
+    unsigned long start, reqNs = 0, refillNs = 0;
+    word32 cmds, reqCmds = 0;
+    int count, rc;
+
+    rc = wolfTPM2_SessionPool_Refill(&pool);
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        cmds = mock.cmdCount;
+        start = now_ns();
+        rc = wolfTPM2_SessionPool_Get(&pool, profile, &session);
+        if (rc == TPM_RC_SUCCESS)
+            rc = request(&session);
+        reqNs += now_ns() - start;
+        reqCmds += mock.cmdCount - cmds;
+
+        /* off the critical path */
+        start = now_ns();
+        if (rc == TPM_RC_SUCCESS)
+            rc = wolfTPM2_SessionPool_Refill(&pool);
+        refillNs += now_ns() - start;
+    }
+    if (rc == TPM_RC_SUCCESS)
+        report("pool", NUM_OF_RUNS, reqNs, reqCmds, refillNs);
+    return rc;
+}
+
+static int run_restart(void) {
+    WOLFTPM2_SESSION session;
+    unsigned long start, reqNs;
+    word32 cmds, savedSz = sizeof(saved);
+    int profile, rc;
+
+    /* the pool is full from run_pool, the process "exits" */
+    rc = wolfTPM2_SessionPool_Save(&pool, saved, &savedSz);
+    wolfTPM2_SessionPool_Cleanup(&pool);
+
+    if (rc == TPM_RC_SUCCESS)
+        rc = wolfTPM2_SessionPool_Init(&dev, &pool);
+    if (rc == TPM_RC_SUCCESS) {
+        profile = wolfTPM2_SessionPool_AddProfile(&pool, NULL, NULL,
+            TPM_SE_HMAC, TPM_ALG_NULL, POOL_DEPTH);
+        rc = (profile < 0) ? profile : TPM_RC_SUCCESS;
+    }
+    if (rc == TPM_RC_SUCCESS)
+        rc = wolfTPM2_SessionPool_Restore(&pool, saved, savedSz);
+    if (rc == TPM_RC_SUCCESS) {
+        cmds = mock.cmdCount;
+        start = now_ns();
+        rc = wolfTPM2_SessionPool_Get(&pool, profile, &session);
+        if (rc == TPM_RC_SUCCESS)
+            rc = request(&session);
+        reqNs = now_ns() - start;
+        if (rc == TPM_RC_SUCCESS)
+            report("restart", 1, reqNs, mock.cmdCount - cmds, 0);
+    }
+    return rc;
+}
+
+int main(void) {
+    int rc, profile;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+    mock.maxSessions = 3;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    rc = wolfTPM2_SessionPool_Init(&dev, &pool);
+    profile = wolfTPM2_SessionPool_AddProfile(&pool, NULL, NULL, TPM_SE_HMAC,
+        TPM_ALG_NULL, POOL_DEPTH);
+    if (rc == TPM_RC_SUCCESS && profile >= 0)
+        rc = run_start();
+    if (rc == TPM_RC_SUCCESS)
+        rc = run_pool(profile);
+    if (rc == TPM_RC_SUCCESS)
+        rc = run_restart();
+    if (rc != TPM_RC_SUCCESS)
+        printf("failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+
+    wolfTPM2_SessionPool_Cleanup(&pool);
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
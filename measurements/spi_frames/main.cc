@@ -0,0 +1,75 @@
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 10
+#endif
+
+/* IO calls, SPI transactions and status reads for a 1 KB TPM2_Hash command on
+ * the TIS mock. The TPM_INTF_CAPS transfer size and the burst count of the
+ * mock are varied. With WOLFTPM_TIS_XDATA_FIFO in wolftpm/options.h a TIS 1.3
+ * interface version selects the XDATA FIFO. */
+
+static TPM2_MOCK_TIS mock;
+
+static int run(const char* name, word32 caps, word16 burstCount, int vec) {
+    int rc = TPM_RC_SUCCESS, count;
+    WOLFTPM2_DEV dev;
+    Hash_In hashIn;
+    Hash_Out hashOut;
+
+    TPM2_Mock_Init(&mock);
+    mock.caps = caps;
+    mock.burstCount = burstCount;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    if (vec)
+        TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb_Mock_SPI);
+
+    XMEMSET(&hashIn, 0, sizeof(hashIn));
+    hashIn.data.size = MAX_DIGEST_BUFFER;
+    hashIn.hashAlg = TPM_ALG_SHA256;
+    hashIn.hierarchy = TPM_RH_NULL;
+
+    TPM2_Mock_ResetStats(&mock);
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        rc = TPM2_Hash(&hashIn, &hashOut);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("TPM2_Hash failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+            break;
+        }
+    }
+    printf("%s, burst = %u, vec = %d, io/cmd = %u, xfers/cmd = %u, "
+        "sts reads/cmd = %u;\n", name, burstCount, vec,
+        mock.ioCalls / NUM_OF_RUNS, mock.xfers / NUM_OF_RUNS,
+        mock.stsReads / NUM_OF_RUNS);
+
+    wolfTPM2_Cleanup(&dev);
+    return rc;
+}
+
+int main(void) {
+    static const struct {
+        const char* name;
+        word32 caps;
+    } intf[] = {
+        { "tis12 64 byte", 0x000006FF },
+        { "tis13 32 byte", 0x200004FF },
+        { "tis13 64 byte", 0x200006FF },
+    };
+    static const word16 bursts[] = { 64, 256 };
+
+    for (unsigned i = 0; i < sizeof(intf) / sizeof(intf[0]); i++) {
+        for (unsigned b = 0; b < sizeof(bursts) / sizeof(bursts[0]); b++) {
+            run(intf[i].name, intf[i].caps, bursts[b], 0);
+            run(intf[i].name, intf[i].caps, bursts[b], 1);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_tis.h"
+#include "tpm_io.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+
+/* Compares the latency of the array copy SPI transport (TPM2_IoCb) with the
+ * shared dataspace transport (TPM2_IoCb_L4_SPI_Shm) */
+
+static unsigned long elapsed(struct timespec* start, struct timespec* end) {
+    return ((end->tv_sec * 1000000000) + end->tv_nsec) -
+        ((start->tv_sec * 1000000000) + start->tv_nsec);
+}
+
+/* raw register read of len bytes at TPM_DID_VID, returns ns per transfer */
+static unsigned long raw_read(TPM2_CTX* ctx, TPM2HalIoCb ioCb, word16 len) {
+    byte txBuf[MAX_SPI_FRAMESIZE + TPM_TIS_HEADER_SZ];
+    byte rxBuf[MAX_SPI_FRAMESIZE + TPM_TIS_HEADER_SZ];
+    struct timespec start, end;
+    word32 addr = 0xD40F00u;
+
+    XMEMSET(txBuf, 0, sizeof(txBuf));
+    txBuf[0] = TPM_TIS_READ | ((len & 0xFF) - 1);
+    txBuf[1] = (addr >> 16) & 0xFF;
+    txBuf[2] = (addr >> 8) & 0xFF;
+    txBuf[3] = (addr) & 0xFF;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int count = 0; count < NUM_OF_RUNS; count++) {
+        if (ioCb(ctx, txBuf, rxBuf, len + TPM_TIS_HEADER_SZ,
+                ctx->userCtx) != 0) {
+            printf("raw transfer failed\n");
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsed(&start, &end) / NUM_OF_RUNS;
+}
+
+static int run(const char* name, TPM2HalIoCb ioCb) {
+    int rc;
+    WOLFTPM2_DEV dev;
+    struct timespec start, end;
+    word32 ipc;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+    TPM2_L4_SPI_CTX spiCtx;
+
+    XMEMSET(&spiCtx, 0, sizeof(spiCtx));
+    rc = wolfTPM2_Init(&dev, ioCb, &spiCtx);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    printf("%s, raw 1 byte, ns = %lu;\n", name, raw_read(&dev.ctx, ioCb, 1));
+    printf("%s, raw %d byte, ns = %lu;\n", name, MAX_SPI_FRAMESIZE,
+        raw_read(&dev.ctx, ioCb, MAX_SPI_FRAMESIZE));
+
+    ipc = TPM2_IoCb_L4_SPI_IpcCount(&spiCtx);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int count = 0; count < NUM_OF_RUNS; count++) {
+        getRandIn.bytesRequested = 32;
+        rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("TPM2_GetRandom failed 0x%x: %s\n", rc,
+                TPM2_GetRCString(rc));
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%s, GetRandom, ipc/cmd = %u, ns = %lu;\n", name,
+        (TPM2_IoCb_L4_SPI_IpcCount(&spiCtx) - ipc) / NUM_OF_RUNS,
+        elapsed(&start, &end) / NUM_OF_RUNS);
+
+    wolfTPM2_Cleanup(&dev);
+    TPM2_IoCb_L4_SPI_Cleanup(&spiCtx);
+    return rc;
+}
+
+int main(void) {
+    run("array", TPM2_IoCb);
+    run("shm", TPM2_IoCb_L4_SPI_Shm);
+    fflush(stdout);
+    return 0;
+}
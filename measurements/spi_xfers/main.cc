@@ -0,0 +1,77 @@
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 10
+#endif
+
+/* SPI transactions per command on the TIS mock, with a dynamic and a static
+ * (TPM_INTF_BURST_COUNT_STATIC) burst count */
+
+static TPM2_MOCK_TIS mock;
+
+static int run(const char* name, int staticBurst) {
+    int rc, count, pcrIndex = 16;
+    WOLFTPM2_DEV dev;
+    PCR_Extend_In pcrExtend;
+    PCR_Read_In pcrReadIn;
+    PCR_Read_Out pcrReadOut;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+
+    TPM2_Mock_Init(&mock);
+    if (staticBurst)
+        mock.caps |= 0x100;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    for (int cmd = 0; cmd < 3; cmd++) {
+        const char* cmdName = "";
+        TPM2_Mock_ResetStats(&mock);
+        for (count = 0; count < NUM_OF_RUNS; count++) {
+            if (cmd == 0) {
+                cmdName = "PCR_Extend";
+                XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+                pcrExtend.pcrHandle = pcrIndex;
+                pcrExtend.digests.count = 1;
+                pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+                rc = TPM2_PCR_Extend(&pcrExtend);
+            }
+            else if (cmd == 1) {
+                cmdName = "PCR_Read";
+                XMEMSET(&pcrReadIn, 0, sizeof(pcrReadIn));
+                TPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, TPM_ALG_SHA256,
+                    pcrIndex);
+                rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+            }
+            else {
+                cmdName = "GetRandom";
+                getRandIn.bytesRequested = 32;
+                rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+            }
+            if (rc != TPM_RC_SUCCESS) {
+                printf("%s failed 0x%x: %s\n", cmdName, rc,
+                    TPM2_GetRCString(rc));
+                break;
+            }
+        }
+        printf("%s, %s, xfers/cmd = %u, sts reads/cmd = %u, bytes/cmd = %u;\n",
+            name, cmdName, mock.xfers / NUM_OF_RUNS,
+            mock.stsReads / NUM_OF_RUNS, mock.xferBytes / NUM_OF_RUNS);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    return rc;
+}
+
+int main(void) {
+    run("dynamic burst", 0);
+    run("static burst", 1);
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+
+/* Round trip cost per command through the SWTPM backend. On L4 this is the
+ * vtpm server (one IPC per command over the shared dataspace), on a Linux
+ * host the simulator behind TPM2_SWTPM_SOCKET, for example
+ * swtpm socket --tpm2 --server type=unixio,path=/tmp/swtpm.sock
+ *   --flags not-need-init,startup-clear
+ * Needs WOLFTPM_SWTPM in wolftpm/options.h. */
+#ifndef WOLFTPM_SWTPM
+#error "enable WOLFTPM_SWTPM in wolftpm/options.h"
+#endif
+
+int main(void) {
+    int rc, count, pcrIndex = 16;
+    WOLFTPM2_DEV dev;
+    struct timespec start, end;
+    unsigned long duration;
+    PCR_Extend_In pcrExtend;
+    PCR_Read_In pcrReadIn;
+    PCR_Read_Out pcrReadOut;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+
+    rc = wolfTPM2_Init(&dev, NULL, NULL);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    for (int cmd = 0; cmd < 3; cmd++) {
+        const char* cmdName = "";
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (count = 0; count < NUM_OF_RUNS; count++) {
+            if (cmd == 0) {
+                cmdName = "PCR_Extend";
+                XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+                pcrExtend.pcrHandle = pcrIndex;
+                pcrExtend.digests.count = 1;
+                pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+                rc = TPM2_PCR_Extend(&pcrExtend);
+            }
+            else if (cmd == 1) {
+                cmdName = "PCR_Read";
+                XMEMSET(&pcrReadIn, 0, sizeof(pcrReadIn));
+                TPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, TPM_ALG_SHA256,
+                    pcrIndex);
+                rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+            }
+            else {
+                cmdName = "GetRandom";
+                getRandIn.bytesRequested = 32;
+                rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+            }
+            if (rc != TPM_RC_SUCCESS) {
+                printf("%s failed 0x%x: %s\n", cmdName, rc,
+                    TPM2_GetRCString(rc));
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        duration = ((end.tv_sec * 1000000000) + end.tv_nsec) -
+            ((start.tv_sec * 1000000000) + start.tv_nsec);
+
+        printf("swtpm, %s, ns/cmd = %lu;\n", cmdName, duration / NUM_OF_RUNS);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    fflush(stdout);
+    return 0;
+}
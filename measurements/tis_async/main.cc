@@ -0,0 +1,116 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 100
+#endif
+#ifndef MAX_TPMS
+#define MAX_TPMS 8
+#endif
+#ifndef EXEC_US
+#define EXEC_US 2000
+#endif
+
+/* One thread drives several TPMs (in-process mocks taking EXEC_US per
+ * command). Blocking submits each GetRandom and waits for it, async submits
+ * to all TPMs and then polls them round robin with TPM2_PollCommand. */
+
+static TPM2_MOCK_TIS mock[MAX_TPMS];
+static WOLFTPM2_DEV dev[MAX_TPMS];
+
+/* TPM2_GetRandom of 32 bytes, marshalled */
+static const byte getRandom[] = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                 0x00, 0x00, 0x01, 0x7b, 0x00, 0x20};
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int run(int tpms, int async) {
+    int rc = TPM_RC_SUCCESS, count, i, done;
+    int pending[MAX_TPMS];
+    byte rsp[MAX_RESPONSE_SIZE];
+    word32 rspSz;
+    unsigned long start, duration, polls = 0;
+
+    start = now_ns();
+    for (count = 0; count < NUM_OF_RUNS && rc == TPM_RC_SUCCESS; count++) {
+        if (!async) {
+            for (i = 0; i < tpms && rc == TPM_RC_SUCCESS; i++) {
+                rc = TPM2_SubmitCommand(&dev[i].ctx, getRandom,
+                    sizeof(getRandom));
+                rspSz = sizeof(rsp);
+                if (rc == TPM_RC_SUCCESS)
+                    rc = TPM2_WaitCommand(&dev[i].ctx, rsp, &rspSz);
+            }
+            continue;
+        }
+
+        for (i = 0; i < tpms && rc == TPM_RC_SUCCESS; i++) {
+            rc = TPM2_SubmitCommand(&dev[i].ctx, getRandom, sizeof(getRandom));
+            pending[i] = 1;
+        }
+        done = 0;
+        while (done < tpms && rc == TPM_RC_SUCCESS) {
+            for (i = 0; i < tpms; i++) {
+                if (!pending[i])
+                    continue;
+                rspSz = sizeof(rsp);
+                rc = TPM2_PollCommand(&dev[i].ctx, rsp, &rspSz);
+                polls++;
+                if (rc == WC_PENDING_E) {
+                    rc = TPM_RC_SUCCESS;
+                    continue;
+                }
+                if (rc != TPM_RC_SUCCESS)
+                    break;
+                pending[i] = 0;
+                done++;
+            }
+            /* an event loop would do other work here */
+            if (done < tpms)
+                XTPM_SLEEP_US(50);
+        }
+    }
+    duration = now_ns() - start;
+    if (rc != TPM_RC_SUCCESS) {
+        printf("%s failed 0x%x: %s\n", async ? "async" : "blocking", rc,
+            TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    printf("%s, tpms = %d, ns/cmd = %lu, polls/cmd = %lu;\n",
+        async ? "async" : "blocking", tpms,
+        duration / (NUM_OF_RUNS * tpms), polls / (NUM_OF_RUNS * tpms));
+    return 0;
+}
+
+int main(void) {
+    int rc, i;
+
+    for (i = 0; i < MAX_TPMS; i++) {
+        TPM2_Mock_Init(&mock[i]);
+        mock[i].execPolls = 0;
+        mock[i].execUs = EXEC_US;
+        rc = wolfTPM2_Init(&dev[i], TPM2_IoCb_Mock_SPI, &mock[i]);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+            return rc;
+        }
+    }
+
+    for (int tpms = 1; tpms <= MAX_TPMS; tpms *= 2) {
+        run(tpms, 0);
+        run(tpms, 1);
+    }
+
+    for (i = 0; i < MAX_TPMS; i++)
+        wolfTPM2_Cleanup(&dev[i]);
+    fflush(stdout);
+    return 0;
+}
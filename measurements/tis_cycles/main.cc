@@ -0,0 +1,110 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+
+/* Host cost of the TIS layer per command on the in-process mock, so only the
+ * framing, copies and register logic are measured. Compare a default build
+ * with one without WOLFTPM_TIS_ZERO_COPY in wolftpm/options.h. On arm64 the
+ * generic timer is read (CNTVCT_EL0 ticks), on x86 the TSC, elsewhere
+ * nanoseconds. */
+
+static TPM2_MOCK_TIS mock;
+
+static inline unsigned long long cycles(void) {
+#if defined(__aarch64__)
+    unsigned long long val;
+    asm volatile("mrs %0, CNTVCT_EL0" : "=r" (val));
+    return val;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int lo, hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+#endif
+}
+
+static int run(const char* name, int vec) {
+    int rc = TPM_RC_SUCCESS, count, pcrIndex = 16;
+    WOLFTPM2_DEV dev;
+    PCR_Extend_In pcrExtend;
+    PCR_Read_In pcrReadIn;
+    PCR_Read_Out pcrReadOut;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+    unsigned long long start, total;
+
+    TPM2_Mock_Init(&mock);
+    /* no simulated execution time, only the host side is of interest */
+    mock.execPolls = 0;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    if (vec)
+        TPM2_SetHalIoVecCb(&dev.ctx, TPM2_IoVecCb_Mock_SPI);
+
+    for (int cmd = 0; cmd < 3; cmd++) {
+        const char* cmdName = "";
+        total = 0;
+        TPM2_Mock_ResetStats(&mock);
+        for (count = 0; count < NUM_OF_RUNS; count++) {
+            if (cmd == 0) {
+                cmdName = "PCR_Extend";
+                XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+                pcrExtend.pcrHandle = pcrIndex;
+                pcrExtend.digests.count = 1;
+                pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+                start = cycles();
+                rc = TPM2_PCR_Extend(&pcrExtend);
+            }
+            else if (cmd == 1) {
+                cmdName = "PCR_Read";
+                XMEMSET(&pcrReadIn, 0, sizeof(pcrReadIn));
+                TPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, TPM_ALG_SHA256,
+                    pcrIndex);
+                start = cycles();
+                rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+            }
+            else {
+                cmdName = "GetRandom";
+                getRandIn.bytesRequested = 32;
+                start = cycles();
+                rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+            }
+            total += cycles() - start;
+            if (rc != TPM_RC_SUCCESS) {
+                printf("%s failed 0x%x: %s\n", cmdName, rc,
+                    TPM2_GetRCString(rc));
+                break;
+            }
+        }
+        printf("%s, %s, zero copy = %d, cycles/cmd = %llu, xfers/cmd = %u;\n",
+            name, cmdName,
+#ifdef WOLFTPM_TIS_ZERO_COPY
+            1,
+#else
+            0,
+#endif
+            total / NUM_OF_RUNS, mock.xfers / NUM_OF_RUNS);
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    return rc;
+}
+
+int main(void) {
+    run("single", 0);
+    run("vectored", 1);
+    fflush(stdout);
+    return 0;
+}
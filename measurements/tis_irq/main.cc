@@ -0,0 +1,103 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 100
+#endif
+
+/* Simulated execution time of a command in the TIS mock */
+#ifndef EXEC_US
+#define EXEC_US 2000
+#endif
+
+/* Reports wall time, CPU time and bus transactions per command for polled
+ * and interrupt driven completion. By default the TIS mock is used, build
+ * with -DUSE_L4_SPI to run against the spi server. */
+
+static TPM2_MOCK_TIS mock;
+#ifdef USE_L4_SPI
+static TPM2_L4_SPI_CTX spiCtx;
+#endif
+
+static unsigned long elapsed(struct timespec* start, struct timespec* end) {
+    return ((end->tv_sec * 1000000000) + end->tv_nsec) -
+        ((start->tv_sec * 1000000000) + start->tv_nsec);
+}
+
+static word32 bus_count(void) {
+#ifdef USE_L4_SPI
+    return TPM2_IoCb_L4_SPI_IpcCount(&spiCtx);
+#else
+    return mock.xfers;
+#endif
+}
+
+static int run(const char* name, int irq) {
+    int rc, count;
+    WOLFTPM2_DEV dev;
+    struct timespec start, end, cpuStart, cpuEnd;
+    word32 bus;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    mock.execUs = EXEC_US;
+#ifdef USE_L4_SPI
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb, &spiCtx);
+#else
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+#endif
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+    if (irq) {
+    #ifdef USE_L4_SPI
+        rc = TPM2_SetHalIrqCb(&dev.ctx, TPM2_IrqWaitCb_L4_SPI, NULL);
+    #else
+        rc = TPM2_SetHalIrqCb(&dev.ctx, TPM2_IrqWaitCb_Mock, &mock);
+    #endif
+        if (rc != TPM_RC_SUCCESS)
+            printf("TPM2_SetHalIrqCb failed 0x%x, polling\n", rc);
+    }
+
+    bus = bus_count();
+    TPM2_Mock_ResetStats(&mock);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStart);
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        getRandIn.bytesRequested = 32;
+        rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+        if (rc != TPM_RC_SUCCESS) {
+            printf("TPM2_GetRandom failed 0x%x: %s\n", rc,
+                TPM2_GetRCString(rc));
+            break;
+        }
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuEnd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%s, wall ns/cmd = %lu, cpu ns/cmd = %lu, bus/cmd = %u, "
+        "sts reads/cmd = %u, irq waits/cmd = %u;\n", name,
+        elapsed(&start, &end) / NUM_OF_RUNS,
+        elapsed(&cpuStart, &cpuEnd) / NUM_OF_RUNS,
+        (bus_count() - bus) / NUM_OF_RUNS, mock.stsReads / NUM_OF_RUNS,
+        mock.irqWaits / NUM_OF_RUNS);
+
+    wolfTPM2_Cleanup(&dev);
+#ifdef USE_L4_SPI
+    TPM2_IoCb_L4_SPI_Cleanup(&spiCtx);
+#endif
+    return rc;
+}
+
+int main(void) {
+    run("polling", 0);
+    run("irq", 1);
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <time.h>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "wolftpm/tpm2_wrap.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 1000
+#endif
+#ifndef MAX_PROCS
+#define MAX_PROCS 8
+#endif
+
+/* N processes issue PCR reads against one TIS mock in shared memory, the
+ * TIS lock is all that keeps their commands apart. Needs WOLFTPM_TIS_LOCK in
+ * wolftpm/options.h and fork, so it runs on a Linux host. */
+#ifndef WOLFTPM_TIS_LOCK
+#error "enable WOLFTPM_TIS_LOCK in wolftpm/options.h"
+#endif
+
+typedef struct {
+    TPM2_MOCK_TIS mock;
+    volatile int ready;
+    volatile int go;
+    volatile int failed;
+} SHARED;
+
+static SHARED* shared;
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000UL) + ts.tv_nsec;
+}
+
+static int client(void) {
+    int rc, count;
+    WOLFTPM2_DEV dev;
+    PCR_Read_In pcrReadIn;
+    PCR_Read_Out pcrReadOut;
+
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &shared->mock);
+    __sync_fetch_and_add(&shared->ready, 1);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        __sync_fetch_and_add(&shared->failed, 1);
+        return rc;
+    }
+    while (!shared->go)
+        usleep(100);
+
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        XMEMSET(&pcrReadIn, 0, sizeof(pcrReadIn));
+        TPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, TPM_ALG_SHA256, 16);
+        rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+        if (rc != TPM_RC_SUCCESS ||
+                pcrReadOut.pcrValues.count != 1 ||
+                pcrReadOut.pcrValues.digests[0].size !=
+                    TPM_SHA256_DIGEST_SIZE) {
+            __sync_fetch_and_add(&shared->failed, 1);
+        }
+    }
+
+    wolfTPM2_Cleanup(&dev);
+    return 0;
+}
+
+static void run(int procs) {
+    int i;
+    unsigned long start, duration;
+
+    TPM2_Mock_Init(&shared->mock);
+    shared->ready = 0;
+    shared->go = 0;
+    shared->failed = 0;
+
+    for (i = 0; i < procs; i++) {
+        if (fork() == 0)
+            _exit(client());
+    }
+    while (shared->ready < procs)
+        usleep(100);
+
+    start = now_ns();
+    shared->go = 1;
+    for (i = 0; i < procs; i++)
+        wait(NULL);
+    duration = now_ns() - start;
+
+    printf("procs = %d, cmds = %d, ns/cmd = %lu, failed = %d;\n", procs,
+        procs * NUM_OF_RUNS, duration / (procs * NUM_OF_RUNS), shared->failed);
+    fflush(stdout);
+}
+
+int main(void) {
+    shared = (SHARED*)mmap(NULL, sizeof(SHARED), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        printf("mmap failed\n");
+        return 1;
+    }
+    for (int procs = 1; procs <= MAX_PROCS; procs *= 2)
+        run(procs);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_tis.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 100
+#endif
+
+/* Compares the round trips per command of the client side TIS layer with
+ * the offloaded TIS layer. Needs WOLFTPM_TIS_OFFLOAD in wolftpm/options.h.
+ * By default the server side runs in process on the TIS mock, build with
+ * -DUSE_L4_SPI to use the spi server. */
+#ifndef WOLFTPM_TIS_OFFLOAD
+#error "enable WOLFTPM_TIS_OFFLOAD in wolftpm/options.h"
+#endif
+
+static TPM2_MOCK_TIS mock;
+#ifdef USE_L4_SPI
+static TPM2_L4_SPI_CTX spiCtx;
+#endif
+static TPM2_CTX server;
+static word32 served = 0;
+
+/* in process stand-in for the send_command IPC */
+static int loopback_cmd(TPM2_CTX* ctx, const byte* cmd, word32 cmdSz,
+    byte* rsp, word32* rspSz, void* cmdCtx)
+{
+    (void)ctx;
+    served++;
+    return TPM2_TIS_ServeCommand((TPM2_CTX*)cmdCtx, cmd, cmdSz, rsp, rspSz);
+}
+
+/* client round trips, the SPI transactions of the server stay in process */
+static word32 round_trips(int offloaded) {
+#ifdef USE_L4_SPI
+    (void)offloaded;
+    return TPM2_IoCb_L4_SPI_IpcCount(&spiCtx);
+#else
+    return offloaded ? served : mock.ioCalls;
+#endif
+}
+
+static unsigned long elapsed(struct timespec* start, struct timespec* end) {
+    return ((end->tv_sec * 1000000000) + end->tv_nsec) -
+        ((start->tv_sec * 1000000000) + start->tv_nsec);
+}
+
+static void run(const char* name, int offloaded) {
+    int rc = 0, count, pcrIndex = 16;
+    word32 trips, xfers;
+    struct timespec start, end;
+    PCR_Extend_In pcrExtend;
+    PCR_Read_In pcrReadIn;
+    PCR_Read_Out pcrReadOut;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+
+    for (int cmd = 0; cmd < 3; cmd++) {
+        const char* cmdName = "";
+        trips = round_trips(offloaded);
+        xfers = mock.xfers;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (count = 0; count < NUM_OF_RUNS; count++) {
+            if (cmd == 0) {
+                cmdName = "PCR_Extend";
+                XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+                pcrExtend.pcrHandle = pcrIndex;
+                pcrExtend.digests.count = 1;
+                pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+                rc = TPM2_PCR_Extend(&pcrExtend);
+            }
+            else if (cmd == 1) {
+                cmdName = "PCR_Read";
+                XMEMSET(&pcrReadIn, 0, sizeof(pcrReadIn));
+                TPM2_SetupPCRSel(&pcrReadIn.pcrSelectionIn, TPM_ALG_SHA256,
+                    pcrIndex);
+                rc = TPM2_PCR_Read(&pcrReadIn, &pcrReadOut);
+            }
+            else {
+                cmdName = "GetRandom";
+                getRandIn.bytesRequested = 32;
+                rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+            }
+            if (rc != TPM_RC_SUCCESS) {
+                printf("%s failed 0x%x: %s\n", cmdName, rc,
+                    TPM2_GetRCString(rc));
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("%s, %s, round trips/cmd = %u, xfers/cmd = %u, ns/cmd = %lu;\n",
+            name, cmdName, (round_trips(offloaded) - trips) / NUM_OF_RUNS,
+            (mock.xfers - xfers) / NUM_OF_RUNS,
+            elapsed(&start, &end) / NUM_OF_RUNS);
+    }
+}
+
+int main(void) {
+    int rc;
+    WOLFTPM2_DEV dev;
+
+    TPM2_Mock_Init(&mock);
+#ifdef USE_L4_SPI
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb, &spiCtx);
+#else
+    /* the server context owns the TPM, the client only submits commands */
+    rc = TPM2_Init(&server, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc == TPM_RC_SUCCESS)
+        rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+#endif
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run("client tis", 0);
+
+#ifdef USE_L4_SPI
+    TPM2_SetHalCmdCb(&dev.ctx, TPM2_CmdCb_L4_SPI, NULL);
+#else
+    TPM2_SetHalCmdCb(&dev.ctx, loopback_cmd, &server);
+#endif
+    run("offloaded tis", 1);
+
+    wolfTPM2_Cleanup(&dev);
+#ifdef USE_L4_SPI
+    TPM2_IoCb_L4_SPI_Cleanup(&spiCtx);
+#endif
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <time.h>
+#include <cstdio>
+#include "wolftpm/tpm2_wrap.h"
+#include "wolftpm/tpm2_tis.h"
+#include "tpm_io.h"
+#include "tpm_io_mock.h"
+
+#ifndef NUM_OF_RUNS
+#define NUM_OF_RUNS 50
+#endif
+
+/* Status reads, CPU and wall time per command while waiting for completion.
+ * The TIS mock executes each command class with a fixed duration. Enable
+ * WOLFTPM_ADAPTIVE_POLL in wolftpm/options.h for the adaptive wait, without
+ * it this is the busy polling baseline. */
+
+static TPM2_MOCK_TIS mock;
+
+static unsigned long elapsed(struct timespec* start, struct timespec* end) {
+    return ((end->tv_sec * 1000000000) + end->tv_nsec) -
+        ((start->tv_sec * 1000000000) + start->tv_nsec);
+}
+
+static int run(const char* name, word32 execUs, int cmd) {
+    int rc = 0, count;
+    struct timespec start, end, cpuStart, cpuEnd;
+    PCR_Extend_In pcrExtend;
+    GetRandom_In getRandIn;
+    GetRandom_Out getRandOut;
+
+    mock.execUs = execUs;
+    TPM2_Mock_ResetStats(&mock);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStart);
+    for (count = 0; count < NUM_OF_RUNS; count++) {
+        if (cmd == 0) {
+            getRandIn.bytesRequested = 32;
+            rc = TPM2_GetRandom(&getRandIn, &getRandOut);
+        }
+        else {
+            XMEMSET(&pcrExtend, 0, sizeof(pcrExtend));
+            pcrExtend.pcrHandle = 16;
+            pcrExtend.digests.count = 1;
+            pcrExtend.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+            rc = TPM2_PCR_Extend(&pcrExtend);
+        }
+        if (rc != TPM_RC_SUCCESS) {
+            printf("%s failed 0x%x: %s\n", name, rc, TPM2_GetRCString(rc));
+            break;
+        }
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuEnd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%s, exec us = %u, wall ns/cmd = %lu, cpu ns/cmd = %lu, "
+        "sts reads/cmd = %u;\n", name, execUs,
+        elapsed(&start, &end) / NUM_OF_RUNS,
+        elapsed(&cpuStart, &cpuEnd) / NUM_OF_RUNS,
+        mock.stsReads / NUM_OF_RUNS);
+    return rc;
+}
+
+int main(void) {
+    int rc;
+    WOLFTPM2_DEV dev;
+
+    TPM2_Mock_Init(&mock);
+    mock.execPolls = 0;
+    rc = wolfTPM2_Init(&dev, TPM2_IoCb_Mock_SPI, &mock);
+    if (rc != TPM_RC_SUCCESS) {
+        printf("wolfTPM2_Init failed 0x%x: %s\n", rc, TPM2_GetRCString(rc));
+        return rc;
+    }
+
+    run("GetRandom", 100, 0);
+    run("PCR_Extend", 1000, 1);
+    /* PCR_Extend again, now as slow as an RSA key operation */
+    run("PCR_Extend", 50000, 1);
+
+#ifdef WOLFTPM_ADAPTIVE_POLL
+    TPM2_TIS_CMD_TIME times[16];
+    int n = TPM2_TIS_GetCmdTimes(&dev.ctx, times, 16);
+    for (int i = 0; i < n; i++) {
+        printf("cc = 0x%x, expect us = %u, samples = %u;\n",
+            (unsigned)times[i].cc, times[i].expectUs, times[i].samples);
+    }
+#endif
+
+    wolfTPM2_Cleanup(&dev);
+    fflush(stdout);
+    return 0;
+}